@@ -6,6 +6,7 @@ include(CheckIncludeFileCXX)
 include(CheckFunctionExists)
 include(CheckStructHasMember)
 include(CheckCXXSymbolExists)
+include(CheckCXXSourceCompiles)
 
 set(CMAKE_REQUIRED_LIBRARIES ${CMAKE_REQUIRED_LIBRARIES} ${INKSCAPE_LIBS})
 set(CMAKE_REQUIRED_INCLUDES ${CMAKE_REQUIRED_INCLUDES} ${INKSCAPE_INCS_SYS})
@@ -20,6 +21,13 @@ CHECK_STRUCT_HAS_MEMBER("struct mallinfo" hblkhd   malloc.h HAVE_STRUCT_MALLINFO
 CHECK_STRUCT_HAS_MEMBER("struct mallinfo" uordblks malloc.h HAVE_STRUCT_MALLINFO_UORDBLKS )
 CHECK_STRUCT_HAS_MEMBER("struct mallinfo" usmblks  malloc.h HAVE_STRUCT_MALLINFO_USMBLKS  )
 CHECK_CXX_SYMBOL_EXISTS(sincos math.h HAVE_SINCOS)  # 2geom define
+CHECK_CXX_SOURCE_COMPILES("
+#include <charconv>
+int main() {
+    char buf[32];
+    double d;
+    std::from_chars(buf, std::to_chars(buf, buf + 32, 0.5, std::chars_format::general, 8).ptr, d);
+}" HAVE_FLOAT_CHARCONV)
 
 # Create the configuration files config.h in the binary root dir
 configure_file(${CMAKE_SOURCE_DIR}/config.h.cmake ${CMAKE_BINARY_DIR}/include/config.h)
@@ -240,6 +240,13 @@ IF(JPEG_FOUND)
     set(HAVE_JPEG ON)
 ENDIF()
 
+FIND_PACKAGE(TIFF)
+IF(TIFF_FOUND)
+    list(APPEND INKSCAPE_INCS_SYS ${TIFF_INCLUDE_DIR})
+    list(APPEND INKSCAPE_LIBS ${TIFF_LIBRARIES})
+    set(HAVE_TIFF ON)
+ENDIF()
+
 find_package(PNG REQUIRED)
 list(APPEND INKSCAPE_INCS_SYS ${PNG_PNG_INCLUDE_DIR})
 list(APPEND INKSCAPE_LIBS ${PNG_LIBRARY})
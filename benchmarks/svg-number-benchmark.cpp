@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Time reading and writing SVG numbers with Inkscape::SVG against the code it replaced, which is
+ * kept here as it was: SVGOStringStream with strip_trailing_zeros(), sp_svg_number_write_de()
+ * and sp_svg_number_read_d().
+ *
+ * Usage: svg-number-benchmark [count]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <locale>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <glib.h>
+
+#include "svg/svg-number.h"
+
+namespace {
+
+template <typename F>
+void measure(char const *name, std::size_t count, F &&f)
+{
+    auto const start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::nano> const elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("%-30s %8.1f ns/number\n", name, elapsed.count() / count);
+}
+
+// The writer behind SVGOStringStream::operator<<(double).
+
+std::string strip_trailing_zeros(std::string str)
+{
+    std::string::size_type p_ix = str.find('.');
+    if (p_ix != std::string::npos) {
+        std::string::size_type e_ix = str.find('e', p_ix);
+        std::string::size_type nz_ix = str.find_last_not_of('0', (e_ix == std::string::npos
+                                                                  ? e_ix
+                                                                  : e_ix - 1));
+        if (nz_ix == std::string::npos || nz_ix < p_ix || nz_ix >= e_ix) {
+            g_error("have `.' but couldn't find non-0");
+        } else {
+            str.erase(str.begin() + (nz_ix == p_ix
+                                     ? p_ix
+                                     : nz_ix + 1),
+                      (e_ix == std::string::npos
+                       ? str.end()
+                       : str.begin() + e_ix));
+        }
+    }
+    return str;
+}
+
+void old_stream_write(std::ostringstream &os, double d)
+{
+    /* Try as integer first. */
+    {
+        int const n = int(d);
+        if (d == n) {
+            os << n;
+            return;
+        }
+    }
+
+    std::ostringstream s;
+    s.imbue(std::locale::classic());
+    s.flags(os.setf(std::ios::showpoint));
+    s.precision(os.precision());
+    s << d;
+    os << strip_trailing_zeros(s.str());
+}
+
+// The writer behind path data and transforms.
+
+std::string old_number_write_d(double val, unsigned int tprec, unsigned int fprec)
+{
+    std::string buf;
+    /* Process sign */
+    if (val < 0.0) {
+        buf.append("-");
+        val = std::fabs(val);
+    }
+
+    /* Determine number of integral digits */
+    int idigits = 0;
+    if (val >= 1.0) {
+        idigits = (int) std::floor(std::log10(val)) + 1;
+    }
+
+    /* Determine the actual number of fractional digits */
+    fprec = std::max(static_cast<int>(fprec), static_cast<int>(tprec) - idigits);
+    /* Round value */
+    val += 0.5 / std::pow(10.0, fprec);
+    /* Extract integral and fractional parts */
+    double dival = std::floor(val);
+    double fval = val - dival;
+    /* Write integra */
+    if (idigits > (int)tprec) {
+        buf.append(std::to_string((unsigned int)std::floor(dival/std::pow(10.0, idigits-tprec) + .5)));
+        for(unsigned int j=0; j<(unsigned int)idigits-tprec; j++) {
+            buf.append("0");
+        }
+    } else {
+       buf.append(std::to_string((unsigned int)dival));
+    }
+
+    if (fprec > 0 && fval > 0.0) {
+        std::string s(".");
+        do {
+            fval *= 10.0;
+            dival = std::floor(fval);
+            fval -= dival;
+            int const int_dival = (int) dival;
+            s.append(std::to_string(int_dival));
+            if(int_dival != 0){
+                buf.append(s);
+                s="";
+            }
+            fprec -= 1;
+        } while(fprec > 0 && fval > 0.0);
+    }
+    return buf;
+}
+
+std::string old_number_write_de(double val, unsigned int tprec, int min_exp)
+{
+    std::string buf;
+    int eval = (int)std::floor(std::log10(std::fabs(val)));
+    if (val == 0.0 || eval < min_exp) {
+        buf.append("0");
+        return buf;
+    }
+    unsigned int maxnumdigitsWithoutExp = // This doesn't include the sign because it is included in either representation
+        eval<0?tprec+(unsigned int)-eval+1:
+        eval+1<(int)tprec?tprec+1:
+        (unsigned int)eval+1;
+    unsigned int maxnumdigitsWithExp = tprec + ( eval<0 ? 4 : 3 ); // It's not necessary to take larger exponents into account, because then maxnumdigitsWithoutExp is DEFINITELY larger
+    if (maxnumdigitsWithoutExp <= maxnumdigitsWithExp) {
+        buf.append(old_number_write_d(val, tprec, 0));
+    } else {
+        val = eval < 0 ? val * std::pow(10.0, -eval) : val / std::pow(10.0, eval);
+        buf.append(old_number_write_d(val, tprec, 0));
+        buf.append("e");
+        buf.append(std::to_string(eval));
+    }
+    return buf;
+}
+
+// The reader behind lengths and path strings.
+
+unsigned int old_number_read_d(gchar const *str, double *val, char **next)
+{
+    if (!str) {
+        return 0;
+    }
+
+    char *e;
+    double const v = g_ascii_strtod(str, &e);
+    *next = e;
+    if ((gchar const *) e == str) {
+        return 0;
+    }
+
+    *val = v;
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::size_t const count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    // Coordinates as they come in drawings: a few digits before the point and many after.
+    std::mt19937_64 random(1);
+    std::uniform_real_distribution<double> distribution(-5000.0, 5000.0);
+    std::vector<double> values(count);
+    for (auto &value : values) {
+        value = distribution(random);
+    }
+
+    std::string text;
+    double sink = 0;
+
+    measure("append_number", count, [&] {
+        text.clear();
+        for (auto value : values) {
+            Inkscape::SVG::append_number(text, value, 8);
+            text += ' ';
+        }
+    });
+
+    measure("old SVGOStringStream", count, [&] {
+        std::ostringstream os;
+        os.imbue(std::locale::classic());
+        os.setf(std::ios::showpoint);
+        os.precision(8);
+        for (auto value : values) {
+            old_stream_write(os, value);
+            os << ' ';
+        }
+        text = os.str();
+    });
+
+    measure("old sp_svg_number_write_de", count, [&] {
+        text.clear();
+        for (auto value : values) {
+            text += old_number_write_de(value, 8, -8);
+            text += ' ';
+        }
+    });
+
+    measure("append_number_de", count, [&] {
+        text.clear();
+        for (auto value : values) {
+            Inkscape::SVG::append_number_de(text, value, 8, -8);
+            text += ' ';
+        }
+    });
+
+    measure("read_number", count, [&] {
+        for (char const *p = text.c_str();;) {
+            double value = 0;
+            auto const next = Inkscape::SVG::read_number(p, value);
+            if (next == p) {
+                break;
+            }
+            sink += value;
+            p = next;
+        }
+    });
+
+    measure("old sp_svg_number_read_d", count, [&] {
+        for (char const *p = text.c_str();;) {
+            double value = 0;
+            char *next;
+            if (!old_number_read_d(p, &value, &next)) {
+                break;
+            }
+            sink += value;
+            p = next;
+        }
+    });
+
+    // Keep the reads from being optimized away.
+    return sink == 0.5 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
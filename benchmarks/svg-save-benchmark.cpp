@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Time writing a large generated document as SVG and as SVGZ.
+ *
+ * Usage: svg-save-benchmark [paths] [runs]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "gc-anchored.h"
+#include "inkgc/gc-core.h"
+#include "svg/svg-number.h"
+#include "xml/document.h"
+#include "xml/repr.h"
+
+namespace {
+
+/// An SVG document with the given number of paths of random line segments.
+std::string make_document(std::size_t paths)
+{
+    std::mt19937_64 random(1);
+    std::uniform_real_distribution<double> distribution(0.0, 1000.0);
+
+    std::string svg = "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"1000\" height=\"1000\">\n";
+    for (std::size_t i = 0; i < paths; i++) {
+        svg += "<path id=\"path" + std::to_string(i) + "\" style=\"fill:none;stroke:#000000;stroke-width:1\" d=\"M";
+        for (int j = 0; j < 200; j++) {
+            svg += ' ';
+            Inkscape::SVG::append_number(svg, distribution(random), 8);
+            svg += ',';
+            Inkscape::SVG::append_number(svg, distribution(random), 8);
+        }
+        svg += "\"/>\n";
+    }
+    svg += "</svg>\n";
+    return svg;
+}
+
+void measure(char const *name, Inkscape::XML::Document *doc, bool compress, int runs)
+{
+    double best = 0;
+    long size = 0;
+    for (int run = 0; run < runs; run++) {
+        auto const file = std::tmpfile();
+        if (!file) {
+            std::perror("tmpfile");
+            std::exit(EXIT_FAILURE);
+        }
+        auto const start = std::chrono::steady_clock::now();
+        sp_repr_save_snapshot(doc, file, SP_SVG_NS_URI, compress, 0, 2);
+        std::fflush(file);
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+        size = std::ftell(file);
+        std::fclose(file);
+        best = run == 0 ? elapsed.count() : std::min(best, elapsed.count());
+    }
+    std::printf("%-5s %10ld bytes %8.1f ms\n", name, size, best * 1000);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::size_t const paths = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    int const runs = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    Inkscape::GC::init();
+
+    auto const svg = make_document(paths);
+    auto const doc = sp_repr_read_mem(svg.data(), svg.size(), SP_SVG_NS_URI);
+    if (!doc) {
+        std::fprintf(stderr, "Could not read the generated document\n");
+        return EXIT_FAILURE;
+    }
+    std::printf("%zu paths, %zu bytes of input, best of %d runs\n", paths, svg.size(), runs);
+
+    measure("SVG", doc, false, runs);
+    measure("SVGZ", doc, true, runs);
+
+    Inkscape::GC::release(doc);
+    return EXIT_SUCCESS;
+}
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
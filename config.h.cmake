@@ -38,6 +38,9 @@
 /* Define to 1 if you have the `mallinfo' function. */
 #cmakedefine HAVE_MALLINFO 1
 
+/* Define to 1 if std::from_chars and std::to_chars support floating point numbers. */
+#cmakedefine HAVE_FLOAT_CHARCONV 1
+
 /* Define to 1 if you have the <malloc.h> header file. */
 #cmakedefine HAVE_MALLOC_H 1
 
@@ -80,6 +83,9 @@
 /* Use libjpeg */
 #cmakedefine HAVE_JPEG 1
 
+/* Use libtiff for TIFF export */
+#cmakedefine HAVE_TIFF 1
+
 /* Build in libcdr */
 #cmakedefine WITH_LIBCDR 1
 
@@ -0,0 +1,30 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Threads shared by the parts of Inkscape that spread work over the processor cores.
+ */
+
+#include "thread-pool.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace Inkscape::Async {
+
+boost::asio::thread_pool &helper_pool()
+{
+    static boost::asio::thread_pool pool(std::max(std::thread::hardware_concurrency(), 2u));
+    return pool;
+}
+
+} // namespace Inkscape::Async
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
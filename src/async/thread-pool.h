@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file Thread-pool
+ * Threads shared by the parts of Inkscape that spread work over the processor cores.
+ */
+#ifndef INKSCAPE_ASYNC_THREAD_POOL_H
+#define INKSCAPE_ASYNC_THREAD_POOL_H
+
+#include <boost/asio/thread_pool.hpp>
+
+namespace Inkscape::Async {
+
+/**
+ * The threads helping with filter branches, path effects and image decoding. Sharing them keeps
+ * the number of busy threads near the number of cores when these run at the same time.
+ *
+ * Work posted here may wait in the queue behind other work, so a caller that waits for it should
+ * also do part of it itself, rather than depend on when a helper starts.
+ */
+boost::asio::thread_pool &helper_pool();
+
+} // namespace Inkscape::Async
+
+#endif // INKSCAPE_ASYNC_THREAD_POOL_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -16,20 +16,28 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <utility>
 #include <vector>
+#include <glib/gstdio.h>
 #include <glibmm/fileutils.h>
 #include <glibmm/i18n.h> // Internationalization
 #include <glibmm/main.h>
 #include <glibmm/miscutils.h>
+#include <giomm/file.h>
 
 #include "auto-save.h"
 #include "document.h"
+#include "gc-anchored.h"
 #include "inkscape-application.h"
 #include "preferences.h"
-#include "extension/output.h"
+#include "async/async.h"
 #include "helper/auto-connection.h"
+#include "io/stream/inkscapestream.h"
 #include "io/sys.h"
+#include "xml/node-observer.h"
 #include "xml/repr.h"
+#include "xml/simple-document.h"
+#include "xml/text-node.h"
 
 #ifdef _WIN32
 #include <process.h>
@@ -38,6 +46,230 @@ typedef int uid_t;
 #endif
 
 namespace Inkscape {
+namespace {
+
+/// A document to be saved in the background.
+struct Job
+{
+    SPDocument *document; // Only compared against the open documents; it may be gone by the end.
+    Inkscape::XML::Document *snapshot;
+    std::string filename;
+    bool saved = false;
+};
+
+/// How long the documents are copied for at a time, in microseconds.
+constexpr gint64 COPY_SLICE = 4000;
+
+/// The start of the names of the autosave files of this user.
+std::string autosave_base_name()
+{
+    uid_t uid = getuid(); // Avoid naming conflicts between users
+    return "automatic-save-" + std::to_string(uid);
+}
+
+/// Copy a node without its children.
+Inkscape::XML::Node *copy_node(Inkscape::XML::Node const &node, Inkscape::XML::Document *doc)
+{
+    switch (node.type()) {
+        case Inkscape::XML::NodeType::ELEMENT_NODE: {
+            auto copy = doc->createElement(node.name());
+            for (auto const &attr : node.attributeList()) {
+                copy->setAttribute(g_quark_to_string(attr.key), attr.value);
+            }
+            return copy;
+        }
+        case Inkscape::XML::NodeType::TEXT_NODE: {
+            auto text = dynamic_cast<Inkscape::XML::TextNode const *>(&node);
+            return doc->createTextNode(node.content(), text && text->is_CData());
+        }
+        case Inkscape::XML::NodeType::COMMENT_NODE:
+            return doc->createComment(node.content());
+        case Inkscape::XML::NodeType::PI_NODE:
+            return doc->createPI(node.name(), node.content());
+        default:
+            return nullptr;
+    }
+}
+
+/// Write the copy of a document to the autosave directory, making room for it first. Runs in the background.
+bool write_autosave(Job const &job, std::string const &autosave_dir, std::string const &base_name,
+                    int autosave_max, int inlineattrs, int indent)
+{
+    // The following we do for each document (rather wasteful...) so that
+    // we make room for each document that needs saving. We probably should
+    // be counting per document and not overall documents.
+
+    // Find/create autosave directory and open it. Nothing may be thrown out of the background.
+    std::vector<std::string> file_names;
+    try {
+        Glib::RefPtr<Gio::File> dir_file = Gio::File::create_for_path(autosave_dir);
+        if (!dir_file->query_exists()) {
+            if (!dir_file->make_directory_with_parents()) {
+                std::cerr << "InkscapeApplication::document_autosave: Failed to create autosave directory: " << autosave_dir << std::endl;
+                return false;
+            }
+        }
+        Glib::Dir directory(autosave_dir);
+        file_names.assign(directory.begin(), directory.end());
+    } catch (Glib::Error const &) {
+        std::cerr << "InkscapeApplication::document_autosave: Failed to open autosave directory: " << autosave_dir << std::endl;
+        return false;
+    }
+
+    // Sort them so that oldest are last (file name encodes time).
+    std::sort(file_names.begin(), file_names.end(), std::greater<std::string>());
+
+    // Delete oldest files.
+    int count = 0;
+    for (auto &file_name : file_names) {
+        if (file_name.compare(0, base_name.size(), base_name) == 0) {
+            ++count;
+            if (count >= autosave_max) {
+                // Delete (making room for one more).
+                std::string path = Glib::build_filename(autosave_dir, file_name);
+                if (unlink(path.c_str()) == -1) {
+                    std::cerr << "InkscapeApplication::document_autosave: Failed to unlink file: "
+                              << path << ": " << strerror(errno) << std::endl;
+                }
+            }
+        }
+    }
+
+    // Write to a temporary file and rename it once complete, so that a crash meanwhile never
+    // leaves a truncated file behind under the final name.
+    std::string path = Glib::build_filename(autosave_dir, job.filename);
+    std::string part_path = path + ".part";
+
+    FILE *file = Inkscape::IO::fopen_utf8name(part_path.c_str(), "w");
+    bool saved = false;
+    if (file) {
+        try {
+            sp_repr_save_snapshot(job.snapshot, file, SP_SVG_NS_URI, false, inlineattrs, indent);
+            saved = true;
+        } catch (Inkscape::IO::StreamException const &) {
+        }
+        saved = fclose(file) == 0 && saved;
+        saved = saved && g_rename(part_path.c_str(), path.c_str()) == 0;
+        if (!saved) {
+            g_unlink(part_path.c_str());
+        }
+    }
+
+    if (!saved) {
+        auto const safeUri = Inkscape::IO::sanitizeString(path.c_str());
+        gchar *errortext = g_strdup_printf(_("Autosave failed! File %s could not be saved."), safeUri.c_str());
+        g_warning("%s", errortext);
+        g_free(errortext);
+    }
+    return saved;
+}
+
+} // namespace
+
+/**
+ * The copy of a document being made for autosave, one node at a time.
+ *
+ * Copying the whole tree at once would hold up the user for longer the larger the document, so
+ * the copy is made in short idle steps instead. Any change to the document before the copy is
+ * complete makes it useless; it is then dropped and the document saved next time.
+ */
+struct AutoSave::Copy final : public Inkscape::XML::NodeObserver
+{
+    Copy(SPDocument *document, std::string filename);
+    ~Copy() override;
+
+    bool step(); // Copies one node; returns false once done, or once the copy is useless.
+    void detach();
+
+    SPDocument *document;
+    std::string filename;
+    Inkscape::XML::Document *snapshot;
+    bool changed = false; // The document was changed partway through the copy.
+    bool closed = false;  // The document was closed partway through the copy.
+
+    void notifyChildAdded(Inkscape::XML::Node &, Inkscape::XML::Node &,
+                          Inkscape::XML::Node *) override { changed = true; }
+    void notifyChildRemoved(Inkscape::XML::Node &, Inkscape::XML::Node &,
+                            Inkscape::XML::Node *) override { changed = true; }
+    void notifyChildOrderChanged(Inkscape::XML::Node &, Inkscape::XML::Node &, Inkscape::XML::Node *,
+                                 Inkscape::XML::Node *) override { changed = true; }
+    void notifyContentChanged(Inkscape::XML::Node &, Inkscape::Util::ptr_shared,
+                              Inkscape::Util::ptr_shared) override { changed = true; }
+    void notifyAttributeChanged(Inkscape::XML::Node &, GQuark, Inkscape::Util::ptr_shared,
+                                Inkscape::Util::ptr_shared) override { changed = true; }
+    void notifyElementNameChanged(Inkscape::XML::Node &, GQuark, GQuark) override { changed = true; }
+
+private:
+    /// The next node to copy at one level of the tree, and the copy it is to be appended to.
+    struct Level
+    {
+        Inkscape::XML::Node const *next;
+        Inkscape::XML::Node *parent;
+    };
+
+    std::vector<Level> _levels;
+    Inkscape::XML::Node *_observed;
+    auto_connection _destroy_connection;
+};
+
+AutoSave::Copy::Copy(SPDocument *document, std::string filename)
+    : document(document)
+    , filename(std::move(filename))
+    , snapshot(new Inkscape::XML::SimpleDocument())
+    , _observed(document->getReprDoc())
+{
+    _observed->addSubtreeObserver(*this);
+    _destroy_connection = document->connectDestroy([this] {
+        closed = changed = true;
+        detach();
+    });
+    _levels.push_back({_observed->firstChild(), snapshot});
+}
+
+AutoSave::Copy::~Copy()
+{
+    detach();
+    if (snapshot) {
+        Inkscape::GC::release(snapshot);
+    }
+}
+
+bool AutoSave::Copy::step()
+{
+    while (!_levels.empty() && !_levels.back().next) {
+        _levels.pop_back();
+    }
+    if (changed || _levels.empty()) {
+        return false;
+    }
+
+    auto &level = _levels.back();
+    auto source = level.next;
+    auto parent = level.parent;
+    level.next = source->next();
+
+    if (auto copy = copy_node(*source, snapshot)) {
+        parent->appendChild(copy);
+        Inkscape::GC::release(copy);
+        if (source->firstChild()) {
+            _levels.push_back({source->firstChild(), copy});
+        }
+    }
+    return true;
+}
+
+/// Stops watching the document.
+void AutoSave::Copy::detach()
+{
+    if (_observed) {
+        _observed->removeSubtreeObserver(*this);
+        _observed = nullptr;
+    }
+    _destroy_connection.disconnect();
+}
+
+AutoSave::AutoSave() = default;
+AutoSave::~AutoSave() = default;
 
 void
 AutoSave::init(InkscapeApplication* app)
@@ -70,30 +302,18 @@ AutoSave::start()
 bool
 AutoSave::save()
 {
+    if (_saving) {
+        // Still copying or writing the previous files; these documents will be saved next time.
+        return true;
+    }
+
     std::vector<SPDocument *> documents = _app->get_documents();
     if (documents.empty()) {
         // Nothing to save!
         return true;
     }
 
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-
-    // Find/create autosave directory
-    std::string autosave_dir = prefs->getString("/options/autosave/path"); // Filenames should be std::string
-    if (autosave_dir.empty()) {
-        autosave_dir = Glib::build_filename(Glib::get_user_cache_dir(), "inkscape");
-    }
-
-    Glib::RefPtr<Gio::File> dir_file = Gio::File::create_for_path(autosave_dir);
-    if (!dir_file->query_exists()) {
-        if (!dir_file->make_directory_with_parents()) {
-            std::cerr << "InkscapeApplication::document_autosave: Failed to create autosave directory: " << autosave_dir << std::endl;
-            return true;
-        }
-    }
-
     // Get unique info
-    uid_t uid = getuid(); // Avoid naming conflicts between users
     int pid = ::getpid(); // Avoid naming conflicts between processes
 
     // Get time stamp
@@ -102,79 +322,111 @@ AutoSave::save()
     std::stringstream datetime;
     datetime << std::put_time(&tm, "%Y_%m_%d_%H_%M_%S");
 
+    std::string base_name = autosave_base_name();
+
+    // Copy each modified document to write out in the background. The copy is made a little at a
+    // time while idle, as copying a large document in one go would hold up the user noticeably.
     int docnum = 0;
-    int autosave_max = prefs->getInt("/options/autosave/max", 10);
     for (auto document : documents) {
 
         ++docnum; // Give each document a unique number.
 
         if (document->isModifiedSinceAutoSave()) {
-            std::string base_name = "automatic-save-" + std::to_string(uid);
-
-            // The following we do for each document (rather wasteful...) so that
-            // we make room for each document that needs saving. We probably should
-            // be counting per document and not overall documents.
-
-            // Open directory
-            Glib::Dir directory(autosave_dir);
-            std::vector<std::string> file_names(directory.begin(), directory.end());
-
-            // Sort them so that oldest are last (file name encodes time).
-            std::sort(file_names.begin(), file_names.end(), std::greater<std::string>());
-
-            // Delete oldest files.
-            int count = 0;
-            for (auto &file_name : file_names) {
-                if (file_name.compare(0, base_name.size(), base_name) == 0) {
-                    ++count;
-                    if (count >= autosave_max) {
-                        // Delete (making room for one more).
-                        std::string path = Glib::build_filename(autosave_dir, file_name);
-                        if (unlink(path.c_str()) == -1) {
-                            std::cerr << "InkscapeApplication::document_autosave: Failed to unlink file: "
-                                      << path << ": " << strerror(errno) << std::endl;
-                        }
-                    }
-                }
-            }
-
             // Construct save file path
-            // datetime MUST happen first, otherwise the above sorting will fail
+            // datetime MUST happen first, otherwise the sorting in write_autosave() will fail
             std::string filename = base_name + "-" + datetime.str() + "-" + std::to_string(pid) + "-" + std::to_string(docnum) + ".svg";
-            std::string path = Glib::build_filename(autosave_dir, filename.c_str());
-
-            // Try to save the file
-            // Following code needs to be reviewed
-            FILE *file = Inkscape::IO::fopen_utf8name(path.c_str(), "w");
-            gchar *errortext = nullptr;
-            if (file) {
-                try {
-                    Inkscape::XML::Node *repr = document->getReprRoot();
-                    sp_repr_save_stream(repr->document(), file, SP_SVG_NS_URI);
-                } catch (Inkscape::Extension::Output::no_extension_found &e) {
-                    errortext = g_strdup(_("Autosave failed! Could not find inkscape extension to save document."));
-                } catch (Inkscape::Extension::Output::save_failed &e) {
-                    auto const safeUri = Inkscape::IO::sanitizeString(path.c_str());
-                    errortext = g_strdup_printf(_("Autosave failed! File %s could not be saved."), safeUri.c_str());
-                }
-                fclose(file);
-            } else {
-                auto const safeUri = Inkscape::IO::sanitizeString(path.c_str());
-                errortext = g_strdup_printf(_("Autosave failed! File %s could not be saved."), safeUri.c_str());
-            }
+            _copies.push_back(std::make_unique<Copy>(document, std::move(filename)));
 
-            if (errortext) {
-                g_warning("%s", errortext);
-                g_free(errortext);
-            } else {
-                document->setModifiedSinceAutoSaveFalse();
-            }
+            // Changes from now on are not in the copy.
+            document->setModifiedSinceAutoSave(false);
         }
-    } // Loop over documents
+    }
+
+    if (_copies.empty()) {
+        return true;
+    }
+
+    _saving = true;
+    _copy_connection = Glib::signal_idle().connect(sigc::mem_fun(*this, &AutoSave::copy));
 
     return true;
 }
 
+bool
+AutoSave::copy()
+{
+    // Only copy for a few milliseconds at a time, whatever the size of the documents.
+    auto const deadline = g_get_monotonic_time() + COPY_SLICE;
+    for (auto &copy : _copies) {
+        while (copy->step()) {
+            if (g_get_monotonic_time() >= deadline) {
+                return true; // Go on when next idle.
+            }
+        }
+    }
+
+    std::vector<Job> jobs;
+    for (auto &copy : _copies) {
+        copy->detach();
+        if (copy->closed) {
+            continue;
+        }
+        if (copy->changed) {
+            // Try again next time.
+            copy->document->setModifiedSinceAutoSave(true);
+            continue;
+        }
+        jobs.push_back({copy->document, std::exchange(copy->snapshot, nullptr), copy->filename});
+    }
+    _copies.clear();
+
+    if (jobs.empty()) {
+        _saving = false;
+        return false;
+    }
+
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+
+    // Find autosave directory
+    std::string autosave_dir = prefs->getString("/options/autosave/path"); // Filenames should be std::string
+    if (autosave_dir.empty()) {
+        autosave_dir = Glib::build_filename(Glib::get_user_cache_dir(), "inkscape");
+    }
+    int autosave_max = prefs->getInt("/options/autosave/max", 10);
+
+    // The preferences cannot be read from the background.
+    bool inlineattrs = prefs->getBool("/options/svgoutput/inlineattrs");
+    int indent = prefs->getInt("/options/svgoutput/indent", 2);
+
+    std::string base_name = autosave_base_name();
+
+    auto [src, dst] = Async::Channel::create();
+    _channel = std::move(dst);
+
+    Async::fire_and_forget([this, autosave_dir, base_name, autosave_max, inlineattrs, indent,
+                             jobs = std::move(jobs), src = std::move(src)] () mutable {
+        for (auto &job : jobs) {
+            job.saved = write_autosave(job, autosave_dir, base_name, autosave_max, inlineattrs, indent);
+        }
+
+        // The copies are let go of where they were made. If the channel is closed, we are
+        // shutting down and they are simply left behind.
+        src.run([this, jobs = std::move(jobs)] {
+            auto const documents = _app->get_documents();
+            for (auto &job : jobs) {
+                Inkscape::GC::release(job.snapshot);
+                if (!job.saved && std::find(documents.begin(), documents.end(), job.document) != documents.end()) {
+                    // Try again next time.
+                    job.document->setModifiedSinceAutoSave(true);
+                }
+            }
+            _saving = false;
+        });
+    });
+
+    return false;
+}
+
 void
 AutoSave::restart()
 {
@@ -13,13 +13,20 @@
 #ifndef INKSCAPE_AUTOSAVE_H
 #define INKSCAPE_AUTOSAVE_H
 
+#include <memory>
+#include <vector>
+
+#include "async/channel.h"
+#include "helper/auto-connection.h"
+
 class InkscapeApplication;
 
 namespace Inkscape {
 
 class AutoSave final {
 private:
-    AutoSave() = default;
+    AutoSave();
+    ~AutoSave();
 
 public:
     AutoSave(const AutoSave &) = delete;
@@ -36,10 +43,18 @@ public:
     static void restart();
     void init(InkscapeApplication *app);
     void start(); // Includes restarting.
-    bool save();
+    bool save(); // Returns at once, leaving the files to be written in the background.
 
 private:
+    struct Copy;
+
+    bool copy(); // Copies the documents a little further, then writes them out once copied.
+
     InkscapeApplication* _app = nullptr;
+    bool _saving = false; // Whether the previous save is still being copied or written.
+    std::vector<std::unique_ptr<Copy>> _copies;
+    auto_connection _copy_connection;
+    Async::Channel::Dest _channel;
 };
 
 } // namespace Inkscape
@@ -19,7 +19,9 @@
 #include <2geom/point.h>
 #include <2geom/sbasis-to-bezier.h>
 #include <2geom/transforms.h>
+#include <array>
 #include <atomic>
+#include <bit>
 #include <boost/algorithm/string.hpp>
 #include <boost/operators.hpp>
 #include <boost/optional/optional.hpp>
@@ -30,10 +32,15 @@
 #include <cairomm/surface.h>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib/gstdio.h>
 #include <glibmm/fileutils.h>
+#include <mutex>
 #include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "cairo-templates.h"
 #include "colors/manager.h"
@@ -321,6 +328,143 @@ Pixbuf *Pixbuf::create_from_data_uri(gchar const *uri_data, double svgdpi)
     return pixbuf;
 }
 
+namespace {
+
+/**
+ * The images decoded from data URIs that are still in use. They are found by a SHA-256 digest of
+ * the URI, so that the cache does not hold another copy of the encoded data, and an entry is
+ * removed as soon as its image is no longer used.
+ */
+class DataUriCache
+{
+public:
+    struct Key
+    {
+        std::array<guint8, 32> digest;
+        std::size_t length;
+        double svgdpi;
+        bool operator==(Key const &) const = default;
+    };
+
+    static DataUriCache &get()
+    {
+        // Never destroyed, as images released late during shutdown still remove their entries.
+        static auto const instance = new DataUriCache;
+        return *instance;
+    }
+
+    static Key key(std::string_view uri, double svgdpi)
+    {
+        Key key{{}, uri.size(), svgdpi};
+        auto const checksum = g_checksum_new(G_CHECKSUM_SHA256);
+        g_checksum_update(checksum, reinterpret_cast<guchar const *>(uri.data()), uri.size());
+        gsize digest_length = key.digest.size();
+        g_checksum_get_digest(checksum, key.digest.data(), &digest_length);
+        g_checksum_free(checksum);
+        return key;
+    }
+
+    std::shared_ptr<Pixbuf const> find(Key const &key)
+    {
+        auto lock = std::lock_guard{_mutex};
+        auto const it = _images.find(key);
+        auto image = it != _images.end() ? it->second.image.lock() : nullptr;
+        if (image) {
+            _stats.hits++;
+            _stats.bytes_saved += _bytes(*image);
+        } else {
+            _stats.misses++;
+        }
+        return image;
+    }
+
+    /**
+     * Add a newly decoded image, returning the one to use, which may be one added meanwhile by
+     * another thread.
+     */
+    std::shared_ptr<Pixbuf const> insert(Key const &key, Pixbuf *pixbuf)
+    {
+        // Declared before the lock, so that an unused new image is only dropped once the lock
+        // is released, as dropping it calls _remove().
+        auto image = std::shared_ptr<Pixbuf const>(pixbuf, [key] (Pixbuf const *p) {
+            DataUriCache::get()._remove(key, p);
+            delete p;
+        });
+        auto lock = std::lock_guard{_mutex};
+        auto &entry = _images[key];
+        if (auto existing = entry.image.lock()) {
+            return existing;
+        }
+        entry = {image, pixbuf};
+        return image;
+    }
+
+    Pixbuf::DataUriCacheStats stats()
+    {
+        auto lock = std::lock_guard{_mutex};
+        return _stats;
+    }
+
+private:
+    struct Hash
+    {
+        std::size_t operator()(Key const &key) const
+        {
+            std::size_t hash;
+            std::memcpy(&hash, key.digest.data(), sizeof(hash));
+            return hash ^ std::hash<double>{}(key.svgdpi);
+        }
+    };
+
+    struct Entry
+    {
+        std::weak_ptr<Pixbuf const> image;
+        Pixbuf const *pixbuf = nullptr; ///< Tells the image apart from another one for the same key once it has expired.
+    };
+
+    /// Called when an image is no longer used, to drop its entry unless another image took its place.
+    void _remove(Key const &key, Pixbuf const *pixbuf)
+    {
+        auto lock = std::lock_guard{_mutex};
+        auto const it = _images.find(key);
+        if (it != _images.end() && it->second.pixbuf == pixbuf) {
+            _images.erase(it);
+        }
+    }
+
+    static std::uint64_t _bytes(Pixbuf const &image)
+    {
+        return std::uint64_t(image.rowstride()) * image.height();
+    }
+
+    std::mutex _mutex;
+    std::unordered_map<Key, Entry, Hash> _images;
+    Pixbuf::DataUriCacheStats _stats{};
+};
+
+} // namespace
+
+std::shared_ptr<Pixbuf const> Pixbuf::get_shared_from_data_uri(gchar const *uri, double svgdpi)
+{
+    auto &cache = DataUriCache::get();
+    auto const key = DataUriCache::key(uri, svgdpi);
+    if (auto image = cache.find(key)) {
+        return image;
+    }
+
+    auto const pixbuf = create_from_data_uri(uri, svgdpi);
+    if (!pixbuf) {
+        return nullptr;
+    }
+    pixbuf->ensurePixelFormat(PF_CAIRO);
+    return cache.insert(key, pixbuf);
+}
+
+Pixbuf::DataUriCacheStats Pixbuf::data_uri_cache_stats()
+{
+    return DataUriCache::get().stats();
+}
+
 Pixbuf *Pixbuf::create_from_file(std::string const &fn, double svgdpi)
 {
     Pixbuf *pb = nullptr;
@@ -1183,6 +1327,134 @@ ink_cairo_surface_create_identical(cairo_surface_t *s)
     return ns;
 }
 
+namespace {
+
+/// Number of SurfacePoolScope objects alive on this thread.
+thread_local int surface_pool_scopes = 0;
+
+cairo_user_data_key_t surface_pool_key;
+
+/**
+ * Pixel buffers of destroyed pooled surfaces, kept for new ones. Buffers are bucketed by size in
+ * steps of a quarter of a power of two, so a reused buffer is at most 25% larger than needed.
+ */
+class SurfaceBufferPool
+{
+public:
+    struct Buffer
+    {
+        unsigned char *data;
+        std::size_t size;
+    };
+
+    static SurfaceBufferPool &get()
+    {
+        static SurfaceBufferPool instance;
+        return instance;
+    }
+
+    /// Returns a buffer of at least the given size, with undefined contents; or no data if out of memory.
+    Buffer take(std::size_t size)
+    {
+        size = _bucket_size(size);
+        {
+            auto lock = std::lock_guard(_mutex);
+            auto &bucket = _free[size];
+            if (!bucket.empty()) {
+                auto data = bucket.back();
+                bucket.pop_back();
+                _held -= size;
+                return {data, size};
+            }
+        }
+        return {static_cast<unsigned char *>(g_try_malloc(size)), size};
+    }
+
+    void give(Buffer buffer)
+    {
+        {
+            auto lock = std::lock_guard(_mutex);
+            if (_held + buffer.size <= MAX_HELD) {
+                _free[buffer.size].push_back(buffer.data);
+                _held += buffer.size;
+                return;
+            }
+        }
+        g_free(buffer.data);
+    }
+
+private:
+    /// Bytes of free buffers the pool may hold on to.
+    static constexpr std::size_t MAX_HELD = 64 << 20;
+
+    static std::size_t _bucket_size(std::size_t size)
+    {
+        if (size <= 4096) {
+            return 4096;
+        }
+        // Round up to three significant bits.
+        int const shift = std::bit_width(size - 1) - 3;
+        return (((size - 1) >> shift) + 1) << shift;
+    }
+
+    std::mutex _mutex;
+    std::unordered_map<std::size_t, std::vector<unsigned char *>> _free;
+    std::size_t _held = 0;
+};
+
+/**
+ * Create a cleared image surface whose buffer comes from the SurfaceBufferPool.
+ * Returns null if that is not possible, for the caller to fall back on a normal surface.
+ */
+cairo_surface_t *create_pooled_surface(cairo_content_t content, int width, int height, double x_scale, double y_scale)
+{
+    auto const format = content == CAIRO_CONTENT_ALPHA ? CAIRO_FORMAT_A8
+                      : content == CAIRO_CONTENT_COLOR ? CAIRO_FORMAT_RGB24
+                                                       : CAIRO_FORMAT_ARGB32;
+    int const stride = cairo_format_stride_for_width(format, width);
+    if (width <= 0 || height <= 0 || stride <= 0) {
+        return nullptr;
+    }
+
+    auto const size = static_cast<std::size_t>(stride) * height;
+    auto &pool = SurfaceBufferPool::get();
+    auto buffer = pool.take(size);
+    if (!buffer.data) {
+        return nullptr;
+    }
+    std::memset(buffer.data, 0, size);
+
+    auto s = cairo_image_surface_create_for_data(buffer.data, format, width, height, stride);
+    auto owned = new SurfaceBufferPool::Buffer(buffer);
+    auto const destroy = [] (void *data) {
+        auto buffer = static_cast<SurfaceBufferPool::Buffer *>(data);
+        SurfaceBufferPool::get().give(*buffer);
+        delete buffer;
+    };
+    if (cairo_surface_status(s) != CAIRO_STATUS_SUCCESS ||
+        cairo_surface_set_user_data(s, &surface_pool_key, owned, destroy) != CAIRO_STATUS_SUCCESS)
+    {
+        cairo_surface_destroy(s);
+        delete owned;
+        pool.give(buffer);
+        return nullptr;
+    }
+    cairo_surface_set_device_scale(s, x_scale, y_scale);
+    return s;
+}
+
+} // namespace
+
+Inkscape::SurfacePoolScope::SurfacePoolScope()
+{
+    surface_pool_scopes++;
+}
+
+Inkscape::SurfacePoolScope::~SurfacePoolScope()
+{
+    surface_pool_scopes--;
+}
+
 cairo_surface_t *
 ink_cairo_surface_create_same_size(cairo_surface_t *s, cairo_content_t c)
 {
@@ -1195,6 +1467,13 @@ ink_cairo_surface_create_same_size(cairo_surface_t *s, cairo_content_t c)
     assert (x_scale > 0);
     assert (y_scale > 0);
 
+    if (surface_pool_scopes > 0 && cairo_surface_get_type(s) == CAIRO_SURFACE_TYPE_IMAGE) {
+        if (auto ns = create_pooled_surface(c, ink_cairo_surface_get_width(s), ink_cairo_surface_get_height(s),
+                                            x_scale, y_scale)) {
+            return ns;
+        }
+    }
+
     cairo_surface_t *ns =
         cairo_surface_create_similar(s, c,
                                      ink_cairo_surface_get_width(s)/x_scale,
@@ -13,6 +13,8 @@
 #ifndef SEEN_INKSCAPE_DISPLAY_CAIRO_UTILS_H
 #define SEEN_INKSCAPE_DISPLAY_CAIRO_UTILS_H
 
+#include <cstdint>
+#include <memory>
 #include <2geom/forward.h>
 #include <cairomm/cairomm.h>
 #include "style.h"
@@ -68,6 +70,25 @@ public:
     static void ensure_argb32(GdkPixbuf *pb);
 
     static Pixbuf *create_from_data_uri(gchar const *uri, double svgdpi = 0);
+
+    /**
+     * The image of a data URI in PF_CAIRO format, shared with everyone else asking for the same
+     * data while it is in use, so that an image embedded many times is decoded and held once.
+     *
+     * @return The image, or nullptr if the data could not be read.
+     */
+    static std::shared_ptr<Pixbuf const> get_shared_from_data_uri(gchar const *uri, double svgdpi = 0);
+
+    struct DataUriCacheStats
+    {
+        std::uint64_t hits;        ///< Requests for images already decoded for someone else.
+        std::uint64_t misses;      ///< Requests for images that had to be decoded.
+        std::uint64_t bytes_saved; ///< Bytes of pixels not decoded or held again thanks to the hits.
+    };
+
+    /// Counts of the requests to get_shared_from_data_uri(), since the program started.
+    static DataUriCacheStats data_uri_cache_stats();
+
     static Pixbuf *create_from_file(std::string const &fn, double svgddpi = 0);
     static Pixbuf *create_from_buffer(std::string const &, double svgddpi = 0, std::string const &fn = "");
 
@@ -89,6 +110,20 @@ public:
     bool _cairo_store;
 };
 
+/**
+ * While alive, image surfaces made on the same thread by ink_cairo_surface_create_same_size() and
+ * the functions using it take their pixel buffers from a pool shared by all threads, and give them
+ * back when destroyed. Meant for short-lived surfaces such as the intermediate results of filters.
+ */
+class SurfacePoolScope final
+{
+public:
+    SurfacePoolScope();
+    ~SurfacePoolScope();
+    SurfacePoolScope(SurfacePoolScope const &) = delete;
+    SurfacePoolScope &operator=(SurfacePoolScope const &) = delete;
+};
+
 } // namespace Inkscape
 
 // Atomic accessors to global variable governing number of filter threads.
@@ -10,6 +10,12 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include <2geom/bezier-curve.h>
 
 #include "drawing.h"
@@ -19,6 +25,182 @@
 #include "cairo-templates.h"
 
 namespace Inkscape {
+namespace {
+
+/// Images smaller than this, in pixels, are always drawn from their full size.
+constexpr std::int64_t MIN_MIPMAP_PIXELS = 512 * 512;
+
+/// Bytes of reduced images kept for all images together.
+constexpr std::size_t MIPMAP_BUDGET = 256 << 20;
+
+/// An ARGB32 surface with half the width and height of another, each pixel the average of four.
+cairo_surface_t *half_size(cairo_surface_t *src)
+{
+    int const w = cairo_image_surface_get_width(src);
+    int const h = cairo_image_surface_get_height(src);
+    int const src_stride = cairo_image_surface_get_stride(src);
+    auto const src_data = cairo_image_surface_get_data(src);
+
+    int const hw = (w + 1) / 2;
+    int const hh = (h + 1) / 2;
+    auto const dst = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, hw, hh);
+    int const dst_stride = cairo_image_surface_get_stride(dst);
+    auto const dst_data = cairo_image_surface_get_data(dst);
+
+    // Premultiplied channels can be averaged independently.
+    for (int y = 0; y < hh; y++) {
+        auto const row0 = src_data + 2 * y * src_stride;
+        auto const row1 = src_data + std::min(2 * y + 1, h - 1) * src_stride;
+        auto out = dst_data + y * dst_stride;
+        for (int x = 0; x < hw; x++) {
+            int const x0 = 8 * x;
+            int const x1 = 4 * std::min(2 * x + 1, w - 1);
+            for (int c = 0; c < 4; c++) {
+                *out++ = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4;
+            }
+        }
+    }
+
+    cairo_surface_mark_dirty(dst);
+    return dst;
+}
+
+/**
+ * How many times an image of the given size can be halved for drawing it with the given number of
+ * device pixels per image pixel, without losing detail.
+ */
+int mipmap_level(double expansion, int width, int height)
+{
+    if (!(expansion > 0.0) || std::int64_t{width} * height < MIN_MIPMAP_PIXELS) {
+        return 0;
+    }
+    int level = 0;
+    while (expansion <= 0.5 && width > 1 && height > 1) {
+        expansion *= 2;
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+        level++;
+    }
+    return level;
+}
+
+/**
+ * Reduced copies of images, at a half, a quarter, and so on of their size, for drawing them
+ * zoomed out without filtering all of their pixels every time. They are made when first needed
+ * and shared by all the items and threads drawing the same image. The least recently used are
+ * dropped when they take more than their budget.
+ */
+class MipmapCache
+{
+public:
+    static MipmapCache &get()
+    {
+        static MipmapCache instance;
+        return instance;
+    }
+
+    /// The image halved @a level times, with a reference for the caller.
+    cairo_surface_t *reduced(std::shared_ptr<Pixbuf const> const &pixbuf, int level);
+
+private:
+    struct Entry
+    {
+        std::weak_ptr<Pixbuf const> pixbuf;
+        std::vector<cairo_surface_t *> levels; ///< Owned; levels[i] is the image halved i + 1 times.
+        std::size_t bytes;
+        std::list<Pixbuf const *>::iterator lru;
+    };
+    using Entries = std::unordered_map<Pixbuf const *, Entry>;
+
+    ~MipmapCache()
+    {
+        while (!_entries.empty()) {
+            _erase(_entries.begin());
+        }
+    }
+
+    void _erase(Entries::iterator it)
+    {
+        for (auto const surface : it->second.levels) {
+            cairo_surface_destroy(surface);
+        }
+        _bytes -= it->second.bytes;
+        _lru.erase(it->second.lru);
+        _entries.erase(it);
+    }
+
+    std::mutex _mutex;
+    Entries _entries;
+    std::list<Pixbuf const *> _lru; ///< Most recently used first.
+    std::size_t _bytes = 0;
+};
+
+cairo_surface_t *MipmapCache::reduced(std::shared_ptr<Pixbuf const> const &pixbuf, int level)
+{
+    auto lock = std::unique_lock{_mutex};
+
+    auto it = _entries.find(pixbuf.get());
+    if (it != _entries.end() && it->second.pixbuf.lock() != pixbuf) {
+        // Left by an image since freed, at the same address.
+        _erase(it);
+        it = _entries.end();
+    }
+    if (it == _entries.end()) {
+        _lru.push_front(pixbuf.get());
+        it = _entries.emplace(pixbuf.get(), Entry{pixbuf, {}, 0, _lru.begin()}).first;
+    } else {
+        _lru.splice(_lru.begin(), _lru, it->second.lru);
+    }
+
+    std::size_t const have = it->second.levels.size();
+    if (have >= std::size_t(level)) {
+        return cairo_surface_reference(it->second.levels[level - 1]);
+    }
+
+    // Make the missing levels without holding up other threads.
+    auto const base = cairo_surface_reference(have ? it->second.levels.back()
+                                                   : const_cast<cairo_surface_t *>(pixbuf->getSurfaceRaw()));
+    lock.unlock();
+
+    std::vector<cairo_surface_t *> made;
+    for (auto i = have; i < std::size_t(level); i++) {
+        made.push_back(half_size(made.empty() ? base : made.back()));
+    }
+    cairo_surface_destroy(base);
+    auto const result = cairo_surface_reference(made.back());
+
+    lock.lock();
+    it = _entries.find(pixbuf.get());
+    if (it == _entries.end() || it->second.levels.size() != have) {
+        // Dropped or extended by another thread meanwhile.
+        for (auto const surface : made) {
+            cairo_surface_destroy(surface);
+        }
+        return result;
+    }
+
+    for (auto const surface : made) {
+        auto const bytes = std::size_t(cairo_image_surface_get_stride(surface)) * cairo_image_surface_get_height(surface);
+        it->second.levels.push_back(surface);
+        it->second.bytes += bytes;
+        _bytes += bytes;
+    }
+
+    for (auto other = _entries.begin(); other != _entries.end();) {
+        auto const next = std::next(other);
+        if (other->second.pixbuf.expired()) {
+            _erase(other);
+        }
+        other = next;
+    }
+    while (_bytes > MIPMAP_BUDGET && _lru.back() != pixbuf.get()) {
+        _erase(_entries.find(_lru.back()));
+    }
+
+    return result;
+}
+
+} // namespace
 
 DrawingImage::DrawingImage(Drawing &drawing)
     : DrawingItem(drawing)
@@ -116,11 +298,6 @@ unsigned DrawingImage::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::
 
         dc.translate(_origin);
         dc.scale(_scale);
-        // const_cast required since Cairo needs to modify the internal refcount variable, but we do not want to give up the
-        // benefits of const for the rest of our code. The underlying object is guaranteed to be non-const, so this is well-defined.
-        // It is also thread-safe to modify the refcount in this way, since Cairo uses atomics internally.
-        dc.setSource(const_cast<cairo_surface_t*>(_pixbuf->getSurfaceRaw()), 0, 0);
-        dc.patternSetExtend(CAIRO_EXTEND_PAD);
 
         // See: http://www.w3.org/TR/SVG/painting.html#ImageRenderingProperty
         //      https://drafts.csswg.org/css-images-3/#the-image-rendering
@@ -129,21 +306,48 @@ unsigned DrawingImage::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::
         // CSS 3 defines:
         //   'optimizeSpeed' as alias for "pixelated"
         //   'optimizeQuality' as alias for "smooth"
+        cairo_filter_t filter;
         switch (style_image_rendering) {
             case SP_CSS_IMAGE_RENDERING_OPTIMIZESPEED:
             case SP_CSS_IMAGE_RENDERING_PIXELATED:
             // we don't have an implementation for crisp-edges, but it should *not* smooth or blur
             case SP_CSS_IMAGE_RENDERING_CRISPEDGES:
-                dc.patternSetFilter( CAIRO_FILTER_NEAREST );
+                filter = CAIRO_FILTER_NEAREST;
                 break;
             case SP_CSS_IMAGE_RENDERING_AUTO:
             case SP_CSS_IMAGE_RENDERING_OPTIMIZEQUALITY:
             default:
                 // In recent Cairo, BEST used Lanczos3, which is prohibitively slow
-                dc.patternSetFilter( CAIRO_FILTER_GOOD );
+                filter = CAIRO_FILTER_GOOD;
                 break;
         }
 
+        // Draw a large image zoomed out from a reduced copy, rather than filtering all its pixels.
+        int level = 0;
+        if (filter != CAIRO_FILTER_NEAREST &&
+            cairo_image_surface_get_format(const_cast<cairo_surface_t *>(_pixbuf->getSurfaceRaw())) == CAIRO_FORMAT_ARGB32)
+        {
+            cairo_matrix_t matrix;
+            cairo_get_matrix(dc.raw(), &matrix);
+            auto const affine = ink_matrix_to_2geom(matrix);
+            level = mipmap_level(std::max(affine.expansionX(), affine.expansionY()), _pixbuf->width(), _pixbuf->height());
+        }
+
+        if (level > 0) {
+            auto const reduced = MipmapCache::get().reduced(_pixbuf, level);
+            dc.scale(Geom::Scale(double(_pixbuf->width()) / cairo_image_surface_get_width(reduced),
+                                 double(_pixbuf->height()) / cairo_image_surface_get_height(reduced)));
+            dc.setSource(reduced, 0, 0);
+            cairo_surface_destroy(reduced);
+        } else {
+            // const_cast required since Cairo needs to modify the internal refcount variable, but we do not want to give up the
+            // benefits of const for the rest of our code. The underlying object is guaranteed to be non-const, so this is well-defined.
+            // It is also thread-safe to modify the refcount in this way, since Cairo uses atomics internally.
+            dc.setSource(const_cast<cairo_surface_t*>(_pixbuf->getSurfaceRaw()), 0, 0);
+        }
+        dc.patternSetExtend(CAIRO_EXTEND_PAD);
+        dc.patternSetFilter(filter);
+
         // Handle an exceptional case where the greyscale color mode needs to be applied per-image.
         bool const greyscale_exception = (flags & RENDER_OUTLINE) && _drawing.colorMode() == ColorMode::GRAYSCALE;
         if (greyscale_exception) {
@@ -32,6 +32,7 @@
 #include "object/sp-item.h"
 
 static constexpr auto CACHE_SCORE_THRESHOLD = 50000.0; ///< Do not consider objects for caching below this score.
+static constexpr auto CACHE_PIXEL_COST = 2.0; ///< Nominal time to composite one pixel in ns, the unit of measured cache scores.
 
 namespace Inkscape {
 
@@ -634,9 +635,11 @@ void DrawingItem::update(Geom::IntRect const &area, UpdateContext const &ctx, un
             // so this will not execute (cache score threshold must be positive)
             cr.cache_size = _cacheRect()->area() * 4;
             cr.item = this;
-            auto it = std::lower_bound(_drawing._candidate_items.begin(), _drawing._candidate_items.end(), cr, std::greater<CacheRecord>());
-            _cache_iterator = _drawing._candidate_items.insert(it, cr);
+            _cache_iterator = _drawing._candidate_items.insert(_drawing._candidate_items.end(), cr);
             _has_cache_iterator = true;
+            if (!_last_rendered.load(std::memory_order_relaxed)) {
+                _last_rendered.store(g_get_monotonic_time(), std::memory_order_relaxed);
+            }
         }
 
         /* Update cache if enabled.
@@ -753,6 +756,11 @@ unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRec
 
     std::unique_lock<std::mutex> lock;
 
+    // Record the use of the item for the ageing of cache candidates.
+    if (_has_cache_iterator) {
+        _last_rendered.store(g_get_monotonic_time(), std::memory_order_relaxed);
+    }
+
     // Render from cache if possible, unless requested not to (hatches).
     if (_cache && !(flags & RENDER_BYPASS_CACHE)) {
         lock = std::unique_lock(_cache->mutables);
@@ -766,9 +774,13 @@ unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRec
             _cache->surface->paintFromCache(dc, carea, forcecache);
             if (!carea) {
                 dc.setSource(0, 0, 0, 0);
+                _drawing._cache_hits.fetch_add(1, std::memory_order_relaxed);
                 return RENDER_OK;
             }
+            _drawing._cache_misses.fetch_add(1, std::memory_order_relaxed);
         } else {
+            _drawing._cache_misses.fetch_add(1, std::memory_order_relaxed);
+
             // There is no cache. This could be because caching of this item
             // was just turned on after the last update phase, or because
             // we were previously outside of the canvas.
@@ -823,6 +835,8 @@ unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRec
         return _renderItem(dc, rc, *carea, flags & ~RENDER_FILTER_BACKGROUND, stop_at);
     }
 
+    auto const render_start = g_get_monotonic_time();
+
     DrawingSurface intermediate(*carea, device_scale);
     DrawingContext ict(intermediate);
     cairo_set_antialias(ict.raw(), cairo_get_antialias(dc.raw())); // propagate antialias setting
@@ -908,6 +922,13 @@ unsigned DrawingItem::render(DrawingContext &dc, RenderContext &rc, Geom::IntRec
     ict.setOperator(CAIRO_OPERATOR_IN);
     ict.paint();
 
+    // Measure the cost of rendering per pixel for the cache scoring, smoothing over renders.
+    if (auto const elapsed = g_get_monotonic_time() - render_start; elapsed > 0) {
+        float const sample = elapsed * 1000.0f / carea->area();
+        float const old = _render_cost.load(std::memory_order_relaxed);
+        _render_cost.store(old > 0.0f ? 0.75f * old + 0.25f * sample : sample, std::memory_order_relaxed);
+    }
+
     // 6. Paint the completed rendering onto the base context (or into cache)
     if (_cache && !(flags & RENDER_BYPASS_CACHE)) {
         if (!forcecache) {
@@ -1203,7 +1224,12 @@ double DrawingItem::_cacheScore()
 {
     Geom::OptIntRect cache_rect = _cacheRect();
     if (!cache_rect) return -1.0;
-    // a crude first approximation:
+    // once the item has been rendered, use the measured time it would take to
+    // render the cache area again, in units of plain pixels composited
+    if (auto const cost = _render_cost.load(std::memory_order_relaxed); cost > 0.0f) {
+        return cache_rect->area() * (cost / CACHE_PIXEL_COST);
+    }
+    // until then, a crude first approximation:
     // the basic score is the number of pixels in the drawbox
     double score = cache_rect->area();
     // this is multiplied by the filter complexity and its expansion
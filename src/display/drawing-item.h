@@ -13,6 +13,7 @@
 #ifndef INKSCAPE_DISPLAY_DRAWING_ITEM_H
 #define INKSCAPE_DISPLAY_DRAWING_ITEM_H
 
+#include <atomic>
 #include <cstdint>
 #include <exception>
 #include <memory>
@@ -20,7 +21,6 @@
 #include <optional>
 #include <type_traits>
 #include <utility>
-#include <boost/operators.hpp>
 #include <boost/intrusive/list.hpp>
 #include <2geom/rect.h>
 #include <2geom/affine.h>
@@ -62,13 +62,11 @@ struct UpdateContext
 
 struct CacheData;
 
-struct CacheRecord : boost::totally_ordered<CacheRecord>
+struct CacheRecord
 {
-    bool operator<(CacheRecord const &other) const { return score < other.score; }
-    bool operator==(CacheRecord const &other) const { return score == other.score; }
     operator DrawingItem*() const { return item; }
-    double score;
-    size_t cache_size;
+    double score;      ///< Estimated cost of rendering the cache area, in plain pixel equivalents.
+    size_t cache_size; ///< Memory needed to cache the item, in bytes.
     DrawingItem *item;
 };
 using CacheList = std::list<CacheRecord>;
@@ -233,6 +231,8 @@ protected:
     bool _contains_unisolated_blend : 1;
 
     CacheList::iterator _cache_iterator;
+    mutable std::atomic<float> _render_cost{0.0f};       ///< Measured time to render one pixel, in ns; zero if unknown.
+    mutable std::atomic<std::int64_t> _last_rendered{0}; ///< Monotonic time of the last render, in µs.
 
     bool style_vector_effect_size   : 1;
     bool style_vector_effect_rotate : 1;
@@ -10,6 +10,11 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
 #include <cairomm/region.h>
 #include <cairo.h>
 #include "cairo-utils.h"
@@ -22,6 +27,141 @@
 #include "ui/util.h"
 
 namespace Inkscape {
+namespace {
+
+/// Tiles with more pixels than this are rendered piecemeal into DrawingPattern::surfaces instead.
+constexpr int MAX_SHARED_TILE_PIXELS = 1 << 20;
+
+/// Everything that determines the contents of a rendered tile.
+struct TileKey
+{
+    std::uint64_t content;
+    std::uint64_t generation;
+    Geom::IntPoint resolution;
+    Geom::Rect tile_rect;
+    Geom::Affine child_transform;
+    Geom::Affine overflow_initial_transform;
+    Geom::Affine overflow_step_transform;
+    int overflow_steps;
+    float opacity;
+    int device_scale;
+    int antialiasing; ///< -1 if not overridden.
+    std::array<int, 7> drawing_settings;
+
+    bool operator==(TileKey const &) const = default;
+};
+
+struct TileKeyHash
+{
+    std::size_t operator()(TileKey const &key) const
+    {
+        std::size_t seed = 0;
+        auto combine = [&] (auto value) {
+            seed ^= std::hash<decltype(value)>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        };
+        combine(key.content);
+        combine(key.generation);
+        combine(key.resolution.x());
+        combine(key.resolution.y());
+        for (int i = 0; i < 2; i++) {
+            combine(key.tile_rect[i].min());
+            combine(key.tile_rect[i].max());
+        }
+        for (int i = 0; i < 6; i++) {
+            combine(key.child_transform[i]);
+            combine(key.overflow_initial_transform[i]);
+            combine(key.overflow_step_transform[i]);
+        }
+        combine(key.overflow_steps);
+        combine(key.opacity);
+        combine(key.device_scale);
+        combine(key.antialiasing);
+        for (auto setting : key.drawing_settings) {
+            combine(setting);
+        }
+        return seed;
+    }
+};
+
+/**
+ * Rendered pattern tiles, shared by all DrawingPatterns showing the same pattern, in all drawings
+ * and render threads. The cache is split into independently locked shards so that threads rarely
+ * wait for each other, and each shard drops its least recently used tiles to stay within budget.
+ */
+class TileCache
+{
+public:
+    static TileCache &get()
+    {
+        static TileCache instance;
+        return instance;
+    }
+
+    Cairo::RefPtr<Cairo::ImageSurface> find(TileKey const &key, std::size_t hash)
+    {
+        auto &shard = _shards[hash % SHARDS];
+        auto lock = std::lock_guard(shard.mutex);
+        auto const it = shard.map.find(key);
+        if (it == shard.map.end()) {
+            return {};
+        }
+        shard.order.splice(shard.order.begin(), shard.order, it->second);
+        return it->second->surface;
+    }
+
+    void insert(TileKey const &key, std::size_t hash, Cairo::RefPtr<Cairo::ImageSurface> const &surface)
+    {
+        auto const bytes = std::size_t(surface->get_stride()) * surface->get_height();
+        if (bytes > SHARD_BUDGET) {
+            return;
+        }
+
+        auto &shard = _shards[hash % SHARDS];
+        auto lock = std::lock_guard(shard.mutex);
+        if (shard.map.count(key)) {
+            return; // Another thread got there first.
+        }
+        while (shard.bytes + bytes > SHARD_BUDGET) {
+            shard.bytes -= shard.order.back().bytes;
+            shard.map.erase(shard.order.back().key);
+            shard.order.pop_back();
+        }
+        shard.order.push_front({key, surface, bytes});
+        shard.map.emplace(key, shard.order.begin());
+        shard.bytes += bytes;
+    }
+
+private:
+    static constexpr int SHARDS = 16;
+    static constexpr std::size_t SHARD_BUDGET = (std::size_t{256} << 20) / SHARDS;
+
+    struct Entry
+    {
+        TileKey key;
+        Cairo::RefPtr<Cairo::ImageSurface> surface;
+        std::size_t bytes;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::list<Entry> order; ///< Most recently used first.
+        std::unordered_map<TileKey, std::list<Entry>::iterator, TileKeyHash> map;
+        std::size_t bytes = 0;
+    };
+
+    std::array<Shard, SHARDS> _shards;
+};
+
+} // namespace
+
+struct DrawingPattern::SharedContent
+{
+    std::uint64_t const id = next_id++;
+    std::atomic<std::uint64_t> generation = 0;
+
+    static inline std::atomic<std::uint64_t> next_id = 0;
+};
 
 DrawingPattern::Surface::Surface(Geom::IntRect const &rect, int device_scale)
     : rect(rect)
@@ -33,6 +173,7 @@ DrawingPattern::Surface::Surface(Geom::IntRect const &rect, int device_scale)
 DrawingPattern::DrawingPattern(Drawing &drawing)
     : DrawingGroup(drawing)
     , _overflow_steps(1)
+    , _shared(std::make_shared<SharedContent>())
 {
 }
 
@@ -65,6 +206,15 @@ void DrawingPattern::setOverflow(Geom::Affine const &initial_transform, int step
     });
 }
 
+void DrawingPattern::shareTilesWith(DrawingPattern const &other)
+{
+    defer([=, this, shared = other._shared] {
+        if (_shared == shared) return;
+        _shared = shared;
+        _markForRendering();
+    });
+}
+
 cairo_pattern_t *DrawingPattern::renderPattern(RenderContext &rc, Geom::IntRect const &area, float opacity, int device_scale) const
 {
     if (opacity < 1e-3) {
@@ -140,12 +290,113 @@ cairo_pattern_t *DrawingPattern::renderPattern(RenderContext &rc, Geom::IntRect
         }
     };
 
+    auto paint = [&, this] (DrawingContext &dc, Geom::IntRect const &rect) {
+        if (_overflow_steps == 1) {
+            render(dc, rc, rect);
+        } else {
+            // Overflow transforms need to be transformed to the old coordinate system
+            // before stretching to the pattern resolution.
+            auto const initial_transform = idt * _overflow_initial_transform * dt;
+            auto const step_transform    = idt * _overflow_step_transform    * dt;
+            dc.transform(initial_transform);
+            for (int i = 0; i < _overflow_steps; i++) {
+                // render() fails to handle transforms applied here when using cache.
+                render(dc, rc, rect, RENDER_BYPASS_CACHE);
+                dc.transform(step_transform);
+                // auto raw = pattern_surface.raw();
+                // auto filename = "drawing-pattern" + std::to_string(i) + ".png";
+                // cairo_surface_write_to_png(pattern_surface.raw(), filename.c_str());
+            }
+        }
+    };
+
+    // Draw the pattern contents to a region of a surface, taking care of possible wrapping.
+    auto paint_region = [&, this] (DrawingContext &dc, Cairo::RefPtr<Cairo::Region> const &region) {
+        if (rc.antialiasing_override) {
+            apply_antialias(dc, rc.antialiasing_override.value());
+        }
+
+        for (int i = 0; i < region->get_num_rectangles(); i++) {
+            auto const rect = cairo_to_geom(region->get_rectangle(i));
+            for (int x = 0; x <= 1; x++) {
+                for (int y = 0; y <= 1; y++) {
+                    auto const wrap = _pattern_resolution * Geom::IntPoint(x, y);
+                    auto const rect2 = rect & Geom::IntRect(wrap, wrap + _pattern_resolution);
+                    if (!rect2) continue;
+                    auto save = DrawingContext::Save(dc);
+                    // Clip to rectangle to be drawn.
+                    dc.rectangle(*rect2);
+                    dc.clip();
+                    // Draw the pattern.
+                    dc.translate(wrap);
+                    paint(dc, *rect2 - wrap);
+                    // Apply opacity, if necessary.
+                    if (opacity < 1.0 - 1e-3) {
+                        dc.setOperator(CAIRO_OPERATOR_DEST_IN);
+                        dc.setSource(0.0, 0.0, 0.0, opacity);
+                        dc.paint();
+                    }
+                }
+            }
+        }
+    };
+
+    // Create a pattern from a surface covering the given rectangle of the tile.
+    auto create_pattern = [&, this] (Cairo::RefPtr<Cairo::ImageSurface> const &surface, Geom::IntRect const &rect, Geom::IntRect const &area_orig) {
+        auto cp = cairo_pattern_create_for_surface(surface->cobj());
+        auto const shift = rect.min() + round_down(area_orig.min() - rect.min(), _pattern_resolution);
+        ink_cairo_pattern_set_matrix(cp, pattern_to_tile * Geom::Translate(-shift));
+        cairo_pattern_set_extend(cp, CAIRO_EXTEND_REPEAT);
+        if (rc.antialiasing_override && rc.antialiasing_override.value() == Antialiasing::None) {
+            cairo_pattern_set_filter(cp, CAIRO_FILTER_NEAREST);
+        }
+        return cp;
+    };
+
     // Calculate the requested area to draw within tile rasterisation space.
     auto const area_orig = (Geom::Rect(area) * screen_to_tile).roundOutwards();
+
+    // Tiles of moderate size are rendered whole and shared with the other patterns showing the same content.
+    auto const full_tile = Geom::IntRect({0, 0}, _pattern_resolution);
+    if (double(full_tile.area()) * device_scale * device_scale <= MAX_SHARED_TILE_PIXELS) {
+        auto const key = TileKey{
+            .content = _shared->id,
+            .generation = _shared->generation.load(std::memory_order_relaxed),
+            .resolution = _pattern_resolution,
+            .tile_rect = *_tile_rect,
+            .child_transform = _child_transform ? *_child_transform : Geom::identity(),
+            .overflow_initial_transform = _overflow_initial_transform,
+            .overflow_step_transform = _overflow_step_transform,
+            .overflow_steps = _overflow_steps,
+            .opacity = opacity,
+            .device_scale = device_scale,
+            .antialiasing = rc.antialiasing_override ? static_cast<int>(*rc.antialiasing_override) : -1,
+            .drawing_settings = {
+                static_cast<int>(_drawing.renderMode()),
+                static_cast<int>(_drawing.colorMode()),
+                _drawing.outlineOverlay(),
+                _drawing.imageOutlineMode(),
+                _drawing.filterQuality(),
+                _drawing.blurQuality(),
+                _drawing.useDithering()
+            }
+        };
+        auto const hash = TileKeyHash()(key);
+
+        auto &cache = TileCache::get();
+        auto surface = cache.find(key, hash);
+        if (!surface) {
+            surface = Surface(full_tile, device_scale).surface;
+            Inkscape::DrawingContext dc(surface->cobj(), full_tile.min());
+            paint_region(dc, Cairo::Region::create(geom_to_cairo(full_tile)));
+            cache.insert(key, hash, surface);
+        }
+        return create_pattern(surface, full_tile, area_orig);
+    }
+
     auto const area_tile = canonicalised(area_orig);
 
-    // Simplest solution for now to protecting pattern cache is a mutex. This makes all
-    // pattern rendering single-threaded, however patterns are typically not the bottleneck.
+    // Larger tiles are drawn only where needed, and kept by this DrawingPattern alone.
     auto lock = std::lock_guard(mutables);
 
     auto get_surface = [&, this] () -> std::pair<Surface*, Cairo::RefPtr<Cairo::Region>> {
@@ -201,76 +452,23 @@ cairo_pattern_t *DrawingPattern::renderPattern(RenderContext &rc, Geom::IntRect
     // Find an already-drawn surface containing the requested area, or create if it none exists.
     auto [surface, dirty] = get_surface();
 
-    // Draw the pattern contents to the dirty areas of the surface, taking care of possible wrapping.
-    Inkscape::DrawingContext dc(surface->surface->cobj(), surface->rect.min());
-    if (rc.antialiasing_override) {
-        apply_antialias(dc, rc.antialiasing_override.value());
-    }
-
-    auto paint = [&, this] (Geom::IntRect const &rect) {
-        if (_overflow_steps == 1) {
-            render(dc, rc, rect);
-        } else {
-            // Overflow transforms need to be transformed to the old coordinate system
-            // before stretching to the pattern resolution.
-            auto const initial_transform = idt * _overflow_initial_transform * dt;
-            auto const step_transform    = idt * _overflow_step_transform    * dt;
-            dc.transform(initial_transform);
-            for (int i = 0; i < _overflow_steps; i++) {
-                // render() fails to handle transforms applied here when using cache.
-                render(dc, rc, rect, RENDER_BYPASS_CACHE);
-                dc.transform(step_transform);
-                // auto raw = pattern_surface.raw();
-                // auto filename = "drawing-pattern" + std::to_string(i) + ".png";
-                // cairo_surface_write_to_png(pattern_surface.raw(), filename.c_str());
-            }
-        }
-    };
-
+    // Draw the pattern contents to the dirty areas of the surface.
     if (dirty) {
-        for (int i = 0; i < dirty->get_num_rectangles(); i++) {
-            auto const rect = cairo_to_geom(dirty->get_rectangle(i));
-            for (int x = 0; x <= 1; x++) {
-                for (int y = 0; y <= 1; y++) {
-                    auto const wrap = _pattern_resolution * Geom::IntPoint(x, y);
-                    auto const rect2 = rect & Geom::IntRect(wrap, wrap + _pattern_resolution);
-                    if (!rect2) continue;
-                    auto save = DrawingContext::Save(dc);
-                    // Clip to rectangle to be drawn.
-                    dc.rectangle(*rect2);
-                    dc.clip();
-                    // Draw the pattern.
-                    dc.translate(wrap);
-                    paint(*rect2 - wrap);
-                    // Apply opacity, if necessary.
-                    if (opacity < 1.0 - 1e-3) {
-                        dc.setOperator(CAIRO_OPERATOR_DEST_IN);
-                        dc.setSource(0.0, 0.0, 0.0, opacity);
-                        dc.paint();
-                    }
-                }
-            }
-        }
+        Inkscape::DrawingContext dc(surface->surface->cobj(), surface->rect.min());
+        paint_region(dc, dirty);
         dirty.reset();
     }
 
     // Debug: Show pattern tile.
     // surface->surface->write_to_png("/tmp/patternsurface.png");
 
-    // Create and return pattern.
-    auto cp = cairo_pattern_create_for_surface(surface->surface->cobj());
-    auto const shift = surface->rect.min() + round_down(area_orig.min() - surface->rect.min(), _pattern_resolution);
-    ink_cairo_pattern_set_matrix(cp, pattern_to_tile * Geom::Translate(-shift));
-    cairo_pattern_set_extend(cp, CAIRO_EXTEND_REPEAT);
-    if (rc.antialiasing_override && rc.antialiasing_override.value() == Antialiasing::None) {
-        cairo_pattern_set_filter(cp, CAIRO_FILTER_NEAREST);
-    }
-    return cp;
+    return create_pattern(surface->surface, surface->rect, area_orig);
 }
 
 unsigned DrawingPattern::_updateItem(Geom::IntRect const &area, UpdateContext const &ctx, unsigned flags, unsigned reset)
 {
-    _dropPatternCache();
+    // Shared tiles are keyed on the resolution, so only our own need dropping.
+    surfaces.clear();
 
     if (!_tile_rect || _tile_rect->hasZeroArea()) {
         return STATE_NONE;
@@ -295,6 +493,8 @@ unsigned DrawingPattern::_updateItem(Geom::IntRect const &area, UpdateContext co
 
 void DrawingPattern::_dropPatternCache()
 {
+    // The contents may have changed; this also invalidates the tiles of the patterns sharing them.
+    _shared->generation.fetch_add(1, std::memory_order_relaxed);
     surfaces.clear();
 }
 
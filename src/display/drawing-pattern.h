@@ -13,6 +13,7 @@
 #ifndef INKSCAPE_DISPLAY_DRAWING_PATTERN_H
 #define INKSCAPE_DISPLAY_DRAWING_PATTERN_H
 
+#include <memory>
 #include <mutex>
 #include <cairomm/surface.h>
 #include "drawing-group.h"
@@ -28,6 +29,10 @@ namespace Inkscape {
  *
  * It renders its children to a cairo_pattern_t structure that can be
  * applied as source for fill or stroke operations.
+ *
+ * Every object painted with a pattern has its own DrawingPattern. Those showing the same
+ * pattern can share their rendered tiles, which are then kept in a cache common to all
+ * drawings and render threads.
  */
 class DrawingPattern
     : public DrawingGroup
@@ -55,6 +60,15 @@ public:
      */
     void setOverflow(Geom::Affine const &initial_transform, int steps, Geom::Affine const &step_transform);
 
+    /**
+     * Share rendered tiles with another DrawingPattern showing the same pattern.
+     *
+     * Tiles are only reused when everything that affects them is the same, such as the tile
+     * rectangle, the resolution and the opacity. Changes to the contents of either pattern
+     * invalidate the tiles of both.
+     */
+    void shareTilesWith(DrawingPattern const &other);
+
     /**
      * Render the pattern.
      *
@@ -81,6 +95,10 @@ protected:
     // Set on update.
     Geom::IntPoint _pattern_resolution;
 
+    // Identifies the contents of the patterns sharing tiles, and counts changes to them.
+    struct SharedContent;
+    std::shared_ptr<SharedContent> _shared;
+
     struct Surface
     {
         Surface(Geom::IntRect const &rect, int device_scale);
@@ -90,7 +108,8 @@ protected:
 
     mutable std::mutex mutables;
 
-    // Parts of the pattern tile that have been rendered. Read/written on render, cleared on update.
+    // Parts of the pattern tile that have been rendered, for tiles too large for the shared cache.
+    // Read/written on render, cleared on update.
     mutable std::vector<Surface> surfaces;
 };
 
@@ -10,7 +10,11 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <cmath>
+#include <vector>
+#include <2geom/int-rect.h>
 #include <2geom/pathvector.h>
+#include <2geom/transforms.h>
 
 #include "style.h"
 
@@ -19,6 +23,7 @@
 #include "drawing-surface.h"
 #include "drawing-text.h"
 #include "drawing.h"
+#include "glyph-atlas.h"
 
 #include "helper/geom.h"
 
@@ -463,6 +468,102 @@ void DrawingText::decorateItem(DrawingContext &dc, double phase_length, bool und
     }
 }
 
+/**
+ * Fill all the glyphs through their masks in the glyph atlas, if they are all small enough and
+ * upright, the way they are drawn now.
+ *
+ * @return Whether they were drawn.
+ */
+bool DrawingText::_drawGlyphsFromAtlas(DrawingContext &dc, CairoPatternUniqPtr const &fill) const
+{
+    auto const max_size = _drawing.glyphAtlasSize();
+    if (max_size <= 0) {
+        return false;
+    }
+
+    // Masks are rendered in pixels of the target, which has more than one per unit of device
+    // space on HiDPI screens.
+    double scale_x = 1.0;
+    double scale_y = 1.0;
+    cairo_surface_get_device_scale(cairo_get_group_target(dc.raw()), &scale_x, &scale_y);
+    cairo_matrix_t matrix;
+    cairo_get_matrix(dc.raw(), &matrix);
+    auto const device = ink_matrix_to_2geom(matrix) * Geom::Scale(scale_x, scale_y);
+
+    for (auto &i : _children) {
+        auto g = cast<DrawingGlyphs>(&i);
+        if (!g) throw InvalidItemException();
+        if (g->_ctm.isSingular() || !g->pathvec) continue;
+        if (g->pixbuf || !GlyphAtlas::accepts(g->_ctm * device, max_size)) {
+            return false;
+        }
+    }
+
+    Inkscape::DrawingContext::Save save(dc);
+    dc.transform(_ctm);
+    _nrstyle.applyFill(dc, fill);
+
+    // The fill is now fixed to the text; paint it through the masks in pixels. The scale goes in
+    // the matrix rather than on the masks, which may be in use by other threads.
+    auto const ct = dc.raw();
+    auto const fill_rule = cairo_get_fill_rule(ct);
+    auto const antialias = cairo_get_antialias(ct);
+    cairo_identity_matrix(ct);
+    cairo_scale(ct, 1.0 / scale_x, 1.0 / scale_y);
+
+    // Only the masks of the glyphs in the visible part of the target are needed.
+    double x0, y0, x1, y1;
+    cairo_clip_extents(ct, &x0, &y0, &x1, &y1);
+    auto const clip = Geom::IntRect(std::floor(x0), std::floor(y0), std::ceil(x1), std::ceil(y1));
+
+    struct Mask
+    {
+        cairo_surface_t *surface;
+        Geom::IntPoint origin;
+    };
+    std::vector<Mask> masks;
+    Geom::OptIntRect area;
+
+    auto &atlas = GlyphAtlas::get();
+    for (auto &i : _children) {
+        auto g = cast<DrawingGlyphs>(&i);
+        if (g->_ctm.isSingular() || !g->pathvec) continue;
+        Geom::IntPoint origin;
+        if (auto const mask = atlas.mask(g->_font_data, g->_glyph, *g->pathvec, g->_ctm * device, fill_rule, antialias, origin)) {
+            auto const rect = Geom::IntRect::from_xywh(origin, {cairo_image_surface_get_width(mask),
+                                                                cairo_image_surface_get_height(mask)});
+            if (auto const visible = rect & clip) {
+                masks.push_back({mask, origin});
+                area.unionWith(*visible);
+            } else {
+                cairo_surface_destroy(mask);
+            }
+        }
+    }
+
+    if (masks.size() == 1) {
+        cairo_mask_surface(ct, masks.front().surface, masks.front().origin.x(), masks.front().origin.y());
+    } else if (area && !area->hasZeroArea()) {
+        // Where glyphs overlap, they must be painted once, as when their outlines are filled
+        // together, or translucent text would come out darker there. So the masks are merged
+        // into one, through which the fill is painted.
+        auto const coverage = cairo_image_surface_create(CAIRO_FORMAT_A8, area->width(), area->height());
+        auto const cc = cairo_create(coverage);
+        for (auto const &mask : masks) {
+            cairo_set_source_surface(cc, mask.surface, mask.origin.x() - area->left(), mask.origin.y() - area->top());
+            cairo_paint(cc);
+        }
+        cairo_destroy(cc);
+        cairo_mask_surface(ct, coverage, area->left(), area->top());
+        cairo_surface_destroy(coverage);
+    }
+
+    for (auto const &mask : masks) {
+        cairo_surface_destroy(mask.surface);
+    }
+    return true;
+}
+
 unsigned DrawingText::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::IntRect const &area, unsigned flags, DrawingItem const *stop_at) const
 {
     auto visible = area & _bbox;
@@ -605,37 +706,41 @@ unsigned DrawingText::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::I
             dc.newPath(); // Clear text-decoration path
         }
 
-        // Accumulate the path that represents the glyphs and/or draw SVG glyphs.
-        for (auto &i : _children) {
-            auto g = cast<DrawingGlyphs>(&i);
-            if (!g) throw InvalidItemException();
+        // Draw small glyphs through their masks in the glyph atlas if possible, or else accumulate
+        // the path that represents the glyphs and/or draw SVG glyphs.
+        bool const from_atlas = has_fill && !has_stroke && _drawGlyphsFromAtlas(dc, has_fill);
+        if (!from_atlas) {
+            for (auto &i : _children) {
+                auto g = cast<DrawingGlyphs>(&i);
+                if (!g) throw InvalidItemException();
 
-            Inkscape::DrawingContext::Save save(dc);
-            if (g->_ctm.isSingular()) continue;
-            dc.transform(g->_ctm);
-            if (g->pathvec) {
-                if (g->pixbuf) {
-                    // Geom::OptRect box = bounds_exact(*g->pathvec);
-                    // if (box) {
-                    //     Inkscape::DrawingContext::Save save(dc);
-                    //     dc.newPath();
-                    //     dc.rectangle(*box);
-                    //     dc.setLineWidth(0.01);
-                    //     dc.setSource(0x8080ffff);
-                    //     dc.stroke();
-                    // }
-                    {
-                        // pixbuf is in font design units, scale to embox.
-                        double scale = g->design_units;
-                        if (scale <= 0) scale = 1000;
-                        Inkscape::DrawingContext::Save save(dc);
-                        dc.translate(0, 1);
-                        dc.scale(1.0 / scale, -1.0 / scale);
-                        dc.setSource(g->pixbuf->getSurfaceRaw(), 0, 0);
-                        dc.paint(1);
+                Inkscape::DrawingContext::Save save(dc);
+                if (g->_ctm.isSingular()) continue;
+                dc.transform(g->_ctm);
+                if (g->pathvec) {
+                    if (g->pixbuf) {
+                        // Geom::OptRect box = bounds_exact(*g->pathvec);
+                        // if (box) {
+                        //     Inkscape::DrawingContext::Save save(dc);
+                        //     dc.newPath();
+                        //     dc.rectangle(*box);
+                        //     dc.setLineWidth(0.01);
+                        //     dc.setSource(0x8080ffff);
+                        //     dc.stroke();
+                        // }
+                        {
+                            // pixbuf is in font design units, scale to embox.
+                            double scale = g->design_units;
+                            if (scale <= 0) scale = 1000;
+                            Inkscape::DrawingContext::Save save(dc);
+                            dc.translate(0, 1);
+                            dc.scale(1.0 / scale, -1.0 / scale);
+                            dc.setSource(g->pixbuf->getSurfaceRaw(), 0, 0);
+                            dc.paint(1);
+                        }
+                    } else {
+                        dc.path(*g->pathvec);
                     }
-                } else {
-                    dc.path(*g->pathvec);
                 }
             }
         }
@@ -644,7 +749,7 @@ unsigned DrawingText::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::I
         {
             Inkscape::DrawingContext::Save save(dc);
             dc.transform(_ctm);
-            if (has_fill && fill_first) {
+            if (has_fill && fill_first && !from_atlas) {
                 _nrstyle.applyFill(dc, has_fill);
                 dc.fillPreserve();
             }
@@ -674,7 +779,7 @@ unsigned DrawingText::_renderItem(DrawingContext &dc, RenderContext &rc, Geom::I
         {
             Inkscape::DrawingContext::Save save(dc);
             dc.transform(_ctm);
-            if (has_fill && !fill_first) {
+            if (has_fill && !fill_first && !from_atlas) {
                 _nrstyle.applyFill(dc, has_fill);
                 dc.fillPreserve();
             }
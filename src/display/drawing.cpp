@@ -14,6 +14,7 @@
 #include "drawing.h"
 
 #include <array>
+#include <cmath>
 #include <thread>
 
 #include "cairo-utils.h"
@@ -48,6 +49,16 @@ static auto default_numthreads()
     return ret == 0 ? 4 : ret; // Sensible fallback if not reported.
 }
 
+static constexpr auto CACHE_HALF_LIFE = 30.0; ///< Seconds without being drawn after which the caching priority of an item halves.
+
+/*
+ * Cache memory of all the drawings that cache, i.e. the canvases of all open windows. They share a single
+ * budget so that it bounds the memory of the whole session, rather than of each document.
+ * Only accessed from the main thread.
+ */
+static size_t shared_cache_used = 0;
+static int shared_cache_drawings = 0;
+
 Drawing::Drawing(Inkscape::CanvasItemDrawing *canvas_item_drawing)
     : _canvas_item_drawing(canvas_item_drawing)
     , _grayscale_matrix(std::vector<double>(grayscale_matrix.begin(), grayscale_matrix.end()))
@@ -58,6 +69,11 @@ Drawing::Drawing(Inkscape::CanvasItemDrawing *canvas_item_drawing)
 Drawing::~Drawing()
 {
     delete _root;
+
+    if (_cache_shared) {
+        _setCacheUsed(0);
+        shared_cache_drawings--;
+    }
 }
 
 void Drawing::setRoot(DrawingItem *root)
@@ -188,6 +204,16 @@ void Drawing::setDithering(bool use_dithering)
     });
 }
 
+void Drawing::setGlyphAtlasSize(int size)
+{
+    defer([=, this] {
+        _glyph_atlas_size = size;
+        if (_rendermode != RenderMode::OUTLINE) {
+            _root->_markForRendering();
+        }
+    });
+}
+
 void Drawing::setCacheBudget(size_t bytes)
 {
     defer([=, this] {
@@ -275,17 +301,56 @@ void Drawing::unsnapshot()
     _funclog();
 }
 
+Drawing::CacheStats Drawing::cacheStats() const
+{
+    return {
+        .hits = _cache_hits.load(std::memory_order_relaxed),
+        .misses = _cache_misses.load(std::memory_order_relaxed),
+        .evictions = _cache_evictions,
+        .used = _cache_used,
+        .shared_used = _cache_shared ? shared_cache_used : _cache_used,
+        .budget = _cache_budget
+    };
+}
+
+void Drawing::_setCacheUsed(size_t bytes)
+{
+    if (_cache_shared) {
+        shared_cache_used = shared_cache_used - _cache_used + bytes;
+    }
+    _cache_used = bytes;
+}
+
 void Drawing::_pickItemsForCaching()
 {
+    // Each drawing sharing the budget is entitled to an equal part of it, plus whatever the others leave unused.
+    size_t budget = _cache_budget;
+    if (_cache_shared && shared_cache_drawings > 1) {
+        auto const others = std::min(shared_cache_used - _cache_used, _cache_budget);
+        budget = std::max(_cache_budget / shared_cache_drawings, _cache_budget - others);
+    }
+
+    // Rank the candidates by the rendering time their cache saves per byte, decaying with the time since they were last drawn.
+    auto const now = g_get_monotonic_time();
+    std::vector<std::pair<double, CacheRecord const *>> ranked;
+    ranked.reserve(_candidate_items.size());
+    for (auto const &rec : _candidate_items) {
+        auto const age = (now - rec.item->_last_rendered.load(std::memory_order_relaxed)) / 1e6;
+        ranked.emplace_back(rec.score / rec.cache_size * std::exp2(-age / CACHE_HALF_LIFE), &rec);
+    }
+    std::sort(ranked.begin(), ranked.end(), [] (auto const &a, auto const &b) { return a.first > b.first; });
+
     // Build sorted list of items that should be cached.
     std::vector<DrawingItem*> to_cache;
     size_t used = 0;
-    for (auto &rec : _candidate_items) {
-        if (used + rec.cache_size > _cache_budget) break;
-        to_cache.emplace_back(rec.item);
-        used += rec.cache_size;
+    for (auto const &entry : ranked) {
+        auto const rec = entry.second;
+        if (used + rec->cache_size > budget) continue;
+        to_cache.emplace_back(rec->item);
+        used += rec->cache_size;
     }
     std::sort(to_cache.begin(), to_cache.end());
+    _setCacheUsed(used);
 
     // Uncache the items that are cached but should not be cached.
     // Note: setCached() modifies _cached_items, so the temporary container is necessary.
@@ -294,6 +359,9 @@ void Drawing::_pickItemsForCaching()
                         to_cache.begin(), to_cache.end(),
                         std::back_inserter(to_uncache));
     for (auto item : to_uncache) {
+        if (!item->_cached_persistent) {
+            _cache_evictions++;
+        }
         item->_setCached(false);
     }
 
@@ -311,6 +379,7 @@ void Drawing::_clearCache()
     for (auto item : to_uncache) {
         item->_setCached(false, true);
     }
+    _setCacheUsed(0);
 }
 
 void Drawing::_loadPrefs()
@@ -325,6 +394,7 @@ void Drawing::_loadPrefs()
     _filter_quality      = prefs->getIntLimited("/options/filterquality/value",          0, Filters::FILTER_QUALITY_WORST, Filters::FILTER_QUALITY_BEST);
     _blur_quality        = prefs->getInt       ("/options/blurquality/value",            0);
     _use_dithering       = prefs->getBool      ("/options/dithering/value",              true);
+    _glyph_atlas_size    = prefs->getIntLimited("/options/rendering/glyphatlassize",     32, 0, 256);
     _cursor_tolerance    = prefs->getDouble    ("/options/cursortolerance/value",        1.0);
     _select_zero_opacity = prefs->getBool      ("/options/selection/zeroopacity",        false);
 
@@ -332,6 +402,8 @@ void Drawing::_loadPrefs()
     if (_canvas_item_drawing) {
         // Preference is stored in MiB; convert to bytes, taking care not to overflow.
         _cache_budget = (size_t{1} << 20) * prefs->getIntLimited("/options/renderingcache/size", 64, 0, 4096);
+        _cache_shared = true;
+        shared_cache_drawings++;
     } else {
         _cache_budget = 0;
     }
@@ -351,6 +423,7 @@ void Drawing::_loadPrefs()
         actions.emplace("/options/filterquality/value",          [this] (auto &entry) { setFilterQuality(entry.getIntLimited(0, Filters::FILTER_QUALITY_WORST, Filters::FILTER_QUALITY_BEST)); });
         actions.emplace("/options/blurquality/value",            [this] (auto &entry) { setBlurQuality(entry.getInt(0)); });
         actions.emplace("/options/dithering/value",              [this] (auto &entry) { setDithering(entry.getBool(true)); });
+        actions.emplace("/options/rendering/glyphatlassize",     [this] (auto &entry) { setGlyphAtlasSize(entry.getIntLimited(32, 0, 256)); });
         actions.emplace("/options/cursortolerance/value",        [this] (auto &entry) { setCursorTolerance(entry.getDouble(1.0)); });
         actions.emplace("/options/selection/zeroopacity",        [this] (auto &entry) { setSelectZeroOpacity(entry.getBool(false)); });
         actions.emplace("/options/renderingcache/size",          [this] (auto &entry) { setCacheBudget((1 << 20) * entry.getIntLimited(64, 0, 4096)); });
@@ -387,6 +460,7 @@ void Drawing::setExact()
 {
     setFilterQuality(Filters::FILTER_QUALITY_BEST);
     setBlurQuality(BLUR_QUALITY_BEST);
+    setGlyphAtlasSize(0);
 }
 
 /*
@@ -13,6 +13,7 @@
 #ifndef INKSCAPE_DISPLAY_DRAWING_H
 #define INKSCAPE_DISPLAY_DRAWING_H
 
+#include <atomic>
 #include <optional>
 #include <set>
 #include <cstdint>
@@ -37,6 +38,16 @@ class DrawingContext;
 class Drawing
 {
 public:
+    struct CacheStats
+    {
+        std::uint64_t hits;      ///< Renders of cached items served entirely from the cache.
+        std::uint64_t misses;    ///< Renders of cached items that had to paint (part of) their cache.
+        std::uint64_t evictions; ///< Items whose cache was dropped to stay within the budget.
+        size_t used;             ///< Bytes of cache held by this drawing.
+        size_t shared_used;      ///< Bytes of cache held by all the drawings sharing the budget.
+        size_t budget;           ///< The budget shared by all caching drawings.
+    };
+
     Drawing(CanvasItemDrawing *drawing = nullptr);
     Drawing(Drawing const &) = delete;
     Drawing &operator=(Drawing const &) = delete;
@@ -57,6 +68,7 @@ public:
     void setFilterQuality(int);
     void setBlurQuality(int);
     void setDithering(bool);
+    void setGlyphAtlasSize(int);
     void setCursorTolerance(double tol) { _cursor_tolerance = tol; }
     void setSelectZeroOpacity(bool select_zero_opacity) { _select_zero_opacity = select_zero_opacity; }
     void setCacheBudget(size_t bytes);
@@ -75,9 +87,11 @@ public:
     int filterQuality() const { return _filter_quality; }
     int blurQuality() const { return _blur_quality; }
     bool useDithering() const { return _use_dithering; }
+    int glyphAtlasSize() const { return _glyph_atlas_size; }
     double cursorTolerance() const { return _cursor_tolerance; }
     bool selectZeroOpacity() const { return _select_zero_opacity; }
     Geom::OptIntRect const &cacheLimit() const { return _cache_limit; }
+    CacheStats cacheStats() const;
 
     void update(Geom::IntRect const &area = Geom::IntRect::infinite(), Geom::Affine const &affine = Geom::identity(),
                 unsigned flags = DrawingItem::STATE_ALL, unsigned reset = 0);
@@ -96,6 +110,7 @@ public:
 private:
     void _pickItemsForCaching();
     void _clearCache();
+    void _setCacheUsed(size_t bytes);
     void _loadPrefs();
 
     DrawingItem *_root = nullptr;
@@ -113,15 +128,19 @@ private:
     int _filter_quality;
     int _blur_quality;
     bool _use_dithering;
+    int _glyph_atlas_size; ///< Text smaller than this many device pixels per em is drawn from the glyph atlas.
     double _cursor_tolerance;
-    size_t _cache_budget; ///< Maximum allowed size of cache.
+    size_t _cache_budget; ///< Maximum allowed size of cache, shared with the other drawings that cache.
+    size_t _cache_used = 0; ///< Size of the caches picked by the last _pickItemsForCaching().
+    bool _cache_shared = false; ///< Whether this drawing takes part in the shared cache budget.
     Geom::OptIntRect _cache_limit;
     std::optional<Geom::PathVector> _clip;
     bool _select_zero_opacity;
     std::optional<Antialiasing> _antialiasing_override;
 
     std::set<DrawingItem*> _cached_items; // modified by DrawingItem::_setCached()
-    CacheList _candidate_items;           // keep this list always sorted with std::greater
+    CacheList _candidate_items;           // unordered; ranked by _pickItemsForCaching()
+    std::uint64_t _cache_evictions = 0;
 
     /*
      * Simple cacheline separator compatible with x86 (64 bytes) and M* (128 bytes).
@@ -130,6 +149,9 @@ private:
      */
     char cacheline_separator[127];
 
+    mutable std::atomic<std::uint64_t> _cache_hits{0};   // updated by render threads
+    mutable std::atomic<std::uint64_t> _cache_misses{0};
+
     bool _snapshotted = false;
     Util::FuncLog _funclog;
 
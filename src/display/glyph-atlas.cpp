@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Cache of rendered glyphs, shared by all drawings and render threads.
+ */
+
+#include "glyph-atlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <2geom/pathvector.h>
+#include <2geom/transforms.h>
+
+#include "cairo-utils.h"
+
+namespace Inkscape {
+namespace {
+
+/// Bytes of masks kept for all glyphs together.
+constexpr std::size_t MAX_BYTES = 32 << 20;
+
+/// Sizes are rounded to 1/SIZE_STEPS pixel, positions to 1/SUBPIXEL_STEPS pixel.
+constexpr int SIZE_STEPS = 16;
+constexpr int SUBPIXEL_STEPS = 4;
+
+struct Key
+{
+    void const *font;
+    int glyph;
+    int sx, sy; ///< Scale along each axis, in steps, with the sign giving its direction.
+    int fx, fy; ///< Position within the pixel, in steps.
+    cairo_fill_rule_t fill_rule;
+    cairo_antialias_t antialias;
+
+    bool operator==(Key const &other) const = default;
+};
+
+struct KeyHash
+{
+    std::size_t operator()(Key const &key) const
+    {
+        auto h = std::hash<void const *>{}(key.font);
+        for (int x : {key.glyph, key.sx, key.sy, key.fx * SUBPIXEL_STEPS + key.fy,
+                      int(key.fill_rule) * 64 + int(key.antialias)}) {
+            h = h * 31 + std::hash<int>{}(x);
+        }
+        return h;
+    }
+};
+
+/// Split a device coordinate into whole pixels and a rounded position within the pixel.
+void split_position(double x, int &pixel, int &step)
+{
+    auto const steps = std::floor(x * SUBPIXEL_STEPS + 0.5);
+    auto const whole = std::floor(steps / SUBPIXEL_STEPS);
+    pixel = static_cast<int>(whole);
+    step = static_cast<int>(steps - whole * SUBPIXEL_STEPS);
+}
+
+/// Render the coverage of a path, returning nullptr if it covers nothing.
+cairo_surface_t *render_mask(Geom::PathVector const &path, cairo_fill_rule_t fill_rule,
+                             cairo_antialias_t antialias, Geom::IntPoint &offset)
+{
+    auto const bounds = path.boundsFast();
+    if (!bounds) {
+        return nullptr;
+    }
+    auto area = bounds->roundOutwards();
+    area.expandBy(1);
+
+    auto const surface = cairo_image_surface_create(CAIRO_FORMAT_A8, area.width(), area.height());
+    auto const ct = cairo_create(surface);
+    cairo_translate(ct, -area.left(), -area.top());
+    cairo_set_fill_rule(ct, fill_rule);
+    cairo_set_antialias(ct, antialias);
+    feed_pathvector_to_cairo(ct, path);
+    cairo_fill(ct);
+    cairo_destroy(ct);
+    cairo_surface_flush(surface);
+
+    offset = area.min();
+    return surface;
+}
+
+} // namespace
+
+struct GlyphAtlas::Data
+{
+    struct Entry
+    {
+        std::weak_ptr<void const> font;
+        cairo_surface_t *surface; ///< Owned; nullptr if the glyph covers nothing.
+        Geom::IntPoint offset;    ///< Of the top left corner of the mask from the pixel of the glyph origin.
+        std::size_t bytes;        ///< Including the entry itself.
+        std::list<Key>::iterator lru;
+    };
+    using Entries = std::unordered_map<Key, Entry, KeyHash>;
+
+    std::mutex mutex;
+    Entries entries;
+    std::list<Key> lru; ///< Most recently used first.
+    std::size_t bytes = 0;
+
+    void erase(Entries::iterator it)
+    {
+        if (it->second.surface) {
+            cairo_surface_destroy(it->second.surface);
+        }
+        bytes -= it->second.bytes;
+        lru.erase(it->second.lru);
+        entries.erase(it);
+    }
+};
+
+GlyphAtlas &GlyphAtlas::get()
+{
+    static GlyphAtlas instance;
+    return instance;
+}
+
+GlyphAtlas::GlyphAtlas()
+    : _data{std::make_unique<Data>()}
+{}
+
+GlyphAtlas::~GlyphAtlas()
+{
+    while (!_data->entries.empty()) {
+        _data->erase(_data->entries.begin());
+    }
+}
+
+bool GlyphAtlas::accepts(Geom::Affine const &transform, double max_size)
+{
+    auto const sx = std::fabs(transform[0]);
+    auto const sy = std::fabs(transform[3]);
+    auto const size = std::max(sx, sy);
+    return transform.isFinite() && size <= max_size && std::min(sx, sy) * SIZE_STEPS >= 1.0 &&
+           std::fabs(transform[1]) <= size * 1e-6 && std::fabs(transform[2]) <= size * 1e-6;
+}
+
+cairo_surface_t *GlyphAtlas::mask(std::shared_ptr<void const> const &font, int glyph, Geom::PathVector const &path,
+                                  Geom::Affine const &transform, cairo_fill_rule_t fill_rule,
+                                  cairo_antialias_t antialias, Geom::IntPoint &origin)
+{
+    Key key;
+    key.font = font.get();
+    key.glyph = glyph;
+    key.sx = std::lround(transform[0] * SIZE_STEPS);
+    key.sy = std::lround(transform[3] * SIZE_STEPS);
+    key.fill_rule = fill_rule;
+    key.antialias = antialias;
+
+    Geom::IntPoint pixel;
+    split_position(transform[4], pixel[Geom::X], key.fx);
+    split_position(transform[5], pixel[Geom::Y], key.fy);
+
+    auto &d = *_data;
+    auto lock = std::unique_lock{d.mutex};
+
+    auto it = d.entries.find(key);
+    if (it != d.entries.end() && it->second.font.lock() != font) {
+        // Left by a font since freed, at the same address.
+        d.erase(it);
+        it = d.entries.end();
+    }
+    if (it != d.entries.end()) {
+        d.lru.splice(d.lru.begin(), d.lru, it->second.lru);
+        origin = pixel + it->second.offset;
+        return it->second.surface ? cairo_surface_reference(it->second.surface) : nullptr;
+    }
+
+    // Render the glyph without holding up other threads.
+    lock.unlock();
+    auto const placed = Geom::Scale(double(key.sx) / SIZE_STEPS, double(key.sy) / SIZE_STEPS) *
+                        Geom::Translate(double(key.fx) / SUBPIXEL_STEPS, double(key.fy) / SUBPIXEL_STEPS);
+    Geom::IntPoint offset;
+    auto surface = render_mask(path * placed, fill_rule, antialias, offset);
+    auto bytes = sizeof(Data::Entry) + sizeof(Key);
+    if (surface) {
+        bytes += std::size_t(cairo_image_surface_get_stride(surface)) * cairo_image_surface_get_height(surface);
+    }
+    lock.lock();
+
+    auto const [inserted, is_new] = d.entries.try_emplace(key, Data::Entry{font, surface, offset, bytes, {}});
+    if (!is_new) {
+        // Rendered by another thread meanwhile.
+        if (surface) {
+            cairo_surface_destroy(surface);
+        }
+        surface = inserted->second.surface;
+        offset = inserted->second.offset;
+    } else {
+        d.lru.push_front(key);
+        inserted->second.lru = d.lru.begin();
+        d.bytes += bytes;
+        while (d.bytes > MAX_BYTES && d.lru.back() != key) {
+            d.erase(d.entries.find(d.lru.back()));
+        }
+    }
+
+    origin = pixel + offset;
+    return surface ? cairo_surface_reference(surface) : nullptr;
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Cache of rendered glyphs, shared by all drawings and render threads.
+ */
+
+#ifndef SEEN_INKSCAPE_DISPLAY_GLYPH_ATLAS_H
+#define SEEN_INKSCAPE_DISPLAY_GLYPH_ATLAS_H
+
+#include <memory>
+#include <2geom/forward.h>
+#include <2geom/int-point.h>
+#include <cairo.h>
+
+namespace Inkscape {
+
+/**
+ * Keeps the coverage of glyphs rendered at small sizes, so that text can be drawn by painting
+ * through these masks instead of filling the outlines of its glyphs every time.
+ *
+ * A glyph is rendered once for each font, glyph, size to a sixteenth of a pixel, direction of
+ * its axes, fill rule and antialiasing, and for each of the 4 × 4 positions it can take within
+ * a pixel. Only glyphs whose axes are aligned with those of the device are drawn this way.
+ *
+ * The masks are kept within a budget, dropping the least recently used first. The atlas may be
+ * used from any thread.
+ */
+class GlyphAtlas
+{
+public:
+    static GlyphAtlas &get();
+
+    /// Whether glyphs drawn with a transform from their em square to device space can be drawn from the atlas.
+    static bool accepts(Geom::Affine const &transform, double max_size);
+
+    /**
+     * The coverage of a glyph, with a reference for the caller, and the device position of its
+     * top left corner in @a origin. This is nullptr if the glyph covers nothing.
+     *
+     * @param font The data of the font of the glyph, which must be kept alive by the caller.
+     * @param path The outline of the glyph in its em square.
+     * @param transform A transform from the em square to device space accepted by accepts().
+     */
+    cairo_surface_t *mask(std::shared_ptr<void const> const &font, int glyph, Geom::PathVector const &path,
+                          Geom::Affine const &transform, cairo_fill_rule_t fill_rule,
+                          cairo_antialias_t antialias, Geom::IntPoint &origin);
+
+private:
+    GlyphAtlas();
+    ~GlyphAtlas();
+
+    struct Data;
+    std::unique_ptr<Data> _data;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_INKSCAPE_DISPLAY_GLYPH_ATLAS_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
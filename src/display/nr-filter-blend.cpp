@@ -92,14 +92,9 @@ static inline cairo_operator_t get_cairo_op(SPBlendMode _blend_mode)
 
 void FilterBlend::render_cairo(FilterSlot &slot) const
 {
-    cairo_surface_t *input1 = slot.getcairo(_input);
-    cairo_surface_t *input2 = slot.getcairo(_input2);
-
-    // We may need to transform input surface to correct color interpolation space. The input surface
-    // might be used as input to another primitive but it is likely that all the primitives in a given
-    // filter use the same color interpolation space so we don't copy the input before converting.
-    set_cairo_surface_ci(input1, color_interpolation);
-    set_cairo_surface_ci(input2, color_interpolation);
+    // Inputs in the color interpolation space of this primitive.
+    cairo_surface_t *input1 = slot.getcairo(_input, color_interpolation);
+    cairo_surface_t *input2 = slot.getcairo(_input2, color_interpolation);
 
     // input2 is the "background" image
     // out should be ARGB32 if any of the inputs is ARGB32
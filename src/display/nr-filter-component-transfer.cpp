@@ -168,14 +168,10 @@ private:
 
 void FilterComponentTransfer::render_cairo(FilterSlot &slot) const
 {
-    cairo_surface_t *input = slot.getcairo(_input);
+    // Input in the color interpolation space of this primitive.
+    cairo_surface_t *input = slot.getcairo(_input, color_interpolation);
     cairo_surface_t *out = ink_cairo_surface_create_same_size(input, CAIRO_CONTENT_COLOR_ALPHA);
-
-    // We may need to transform input surface to correct color interpolation space. The input surface
-    // might be used as input to another primitive but it is likely that all the primitives in a given
-    // filter use the same color interpolation space so we don't copy the input before converting.
     set_cairo_surface_ci(out, color_interpolation);
-    set_cairo_surface_ci(input, color_interpolation);
 
     ink_cairo_surface_blit(input, out);
 
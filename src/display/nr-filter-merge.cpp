@@ -48,9 +48,7 @@ void FilterMerge::render_cairo(FilterSlot &slot) const
     cairo_t *out_ct = cairo_create(out);
 
     for (auto &i : _input_image) {
-        cairo_surface_t *in = slot.getcairo(i);
-
-        set_cairo_surface_ci(in, color_interpolation);
+        cairo_surface_t *in = slot.getcairo(i, color_interpolation);
         cairo_set_source_surface(out_ct, in, 0, 0);
         cairo_paint(out_ct);
     }
@@ -13,6 +13,7 @@
 #define SEEN_NR_FILTER_PRIMITIVE_H
 
 #include <memory>
+#include <vector>
 #include <2geom/forward.h>
 #include <2geom/rect.h>
 
@@ -72,6 +73,16 @@ public:
      */
     virtual void set_output(int slot);
 
+    /**
+     * Returns the slots read by render_cairo(), where NR_FILTER_SLOT_NOT_SET stands for the
+     * output of the previous filter primitive. Used to find out which primitives of a filter
+     * depend on each other.
+     */
+    virtual std::vector<int> get_inputs() const { return {_input}; }
+
+    /// Returns the slot written by render_cairo(), NR_FILTER_SLOT_NOT_SET if not named.
+    int get_output() const { return _output; }
+
     // returns cache score factor, reflecting the cost of rendering this filter
     // this should return how many times slower this primitive is that normal rendering
     virtual double complexity(Geom::Affine const &/*ctm*/) const { return 1.0; }
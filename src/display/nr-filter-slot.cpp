@@ -28,7 +28,8 @@ namespace Inkscape {
 namespace Filters {
 
 FilterSlot::FilterSlot(DrawingContext *bgdc, DrawingContext &graphic, FilterUnits const &units, RenderContext &rc, int blurquality)
-    : _source_graphic(graphic.rawTarget())
+    : _storage(std::make_shared<Storage>())
+    , _source_graphic(graphic.rawTarget())
     , _background_ct(bgdc ? bgdc->raw() : nullptr)
     , _source_graphic_area(graphic.targetLogicalBounds().roundOutwards()) // fixme
     , _background_area(bgdc ? bgdc->targetLogicalBounds().roundOutwards() : Geom::IntRect()) // fixme
@@ -57,23 +58,66 @@ FilterSlot::FilterSlot(DrawingContext *bgdc, DrawingContext &graphic, FilterUnit
     }
 }
 
-FilterSlot::~FilterSlot()
+FilterSlot::FilterSlot(FilterSlot const &other, int last_out)
+    : FilterSlot(other)
 {
-    for (auto &_slot : _slots) {
+    _last_out = last_out;
+}
+
+FilterSlot::~FilterSlot() = default;
+
+FilterSlot::Storage::~Storage()
+{
+    for (auto &_slot : slots) {
         cairo_surface_destroy(_slot.second);
     }
+    for (auto &c : converted) {
+        cairo_surface_destroy(c.second);
+    }
 }
 
 cairo_surface_t *FilterSlot::getcairo(int slot_nr)
+{
+    auto lock = std::lock_guard(_storage->mutex);
+    return _getcairo(slot_nr);
+}
+
+cairo_surface_t *FilterSlot::getcairo(int slot_nr, SPColorInterpolation ci)
+{
+    auto lock = std::lock_guard(_storage->mutex);
+
+    if (slot_nr == NR_FILTER_SLOT_NOT_SET)
+        slot_nr = _last_out;
+
+    cairo_surface_t *s = _getcairo(slot_nr);
+    if (cairo_surface_get_content(s) == CAIRO_CONTENT_ALPHA || get_cairo_surface_ci(s) == ci) {
+        return s;
+    }
+
+    auto &converted = _storage->converted[{slot_nr, ci}];
+    if (!converted) {
+        converted = ink_cairo_surface_copy(s);
+        if (cairo_surface_status(converted) == CAIRO_STATUS_NO_MEMORY) {
+            cairo_surface_destroy(converted);
+            _storage->converted.erase({slot_nr, ci});
+            throw std::bad_alloc();
+        }
+        set_cairo_surface_ci(converted, ci);
+    }
+    return converted;
+}
+
+cairo_surface_t *FilterSlot::_getcairo(int slot_nr)
 {
     if (slot_nr == NR_FILTER_SLOT_NOT_SET)
         slot_nr = _last_out;
 
-    SlotMap::iterator s = _slots.find(slot_nr);
+    auto &slots = _storage->slots;
+    SlotMap::iterator s = slots.find(slot_nr);
 
     /* If we didn't have the specified image, but we could create it
      * from the other information we have, let's do that */
-    if (s == _slots.end()
+    if (s == slots.end()
         && (slot_nr == NR_FILTER_SOURCEGRAPHIC
             || slot_nr == NR_FILTER_SOURCEALPHA
             || slot_nr == NR_FILTER_BACKGROUNDIMAGE
@@ -97,13 +141,13 @@ cairo_surface_t *FilterSlot::getcairo(int slot_nr)
                 cairo_surface_destroy(bg);
             } break;
             case NR_FILTER_SOURCEALPHA: {
-                cairo_surface_t *src = getcairo(NR_FILTER_SOURCEGRAPHIC);
+                cairo_surface_t *src = _getcairo(NR_FILTER_SOURCEGRAPHIC);
                 cairo_surface_t *alpha = ink_cairo_extract_alpha(src);
                 _set_internal(NR_FILTER_SOURCEALPHA, alpha);
                 cairo_surface_destroy(alpha);
             } break;
             case NR_FILTER_BACKGROUNDALPHA: {
-                cairo_surface_t *src = getcairo(NR_FILTER_BACKGROUNDIMAGE);
+                cairo_surface_t *src = _getcairo(NR_FILTER_BACKGROUNDIMAGE);
                 cairo_surface_t *ba = ink_cairo_extract_alpha(src);
                 _set_internal(NR_FILTER_BACKGROUNDALPHA, ba);
                 cairo_surface_destroy(ba);
@@ -113,17 +157,17 @@ cairo_surface_t *FilterSlot::getcairo(int slot_nr)
             default:
                 break;
         }
-        s = _slots.find(slot_nr);
+        s = slots.find(slot_nr);
     }
 
-    if (s == _slots.end()) {
+    if (s == slots.end()) {
         // create empty surface
         cairo_surface_t *empty = cairo_surface_create_similar(
             _source_graphic, cairo_surface_get_content(_source_graphic),
             _slot_w, _slot_h);
         _set_internal(slot_nr, empty);
         cairo_surface_destroy(empty);
-        s = _slots.find(slot_nr);
+        s = slots.find(slot_nr);
     }
 
     if (s->second && cairo_surface_status(s->second) == CAIRO_STATUS_NO_MEMORY) {
@@ -220,12 +264,24 @@ void FilterSlot::_set_internal(int slot_nr, cairo_surface_t *surface)
     // this way assigning a surface to a slot it already occupies will not cause errors
     cairo_surface_reference(surface);
 
-    SlotMap::iterator s = _slots.find(slot_nr);
-    if (s != _slots.end()) {
+    auto &slots = _storage->slots;
+    SlotMap::iterator s = slots.find(slot_nr);
+    if (s != slots.end()) {
         cairo_surface_destroy(s->second);
     }
 
-    _slots[slot_nr] = surface;
+    slots[slot_nr] = surface;
+    _drop_converted(slot_nr);
+}
+
+void FilterSlot::_drop_converted(int slot_nr)
+{
+    auto &converted = _storage->converted;
+    auto c = converted.lower_bound({slot_nr, SPColorInterpolation{}});
+    while (c != converted.end() && c->first.first == slot_nr) {
+        cairo_surface_destroy(c->second);
+        c = converted.erase(c);
+    }
 }
 
 void FilterSlot::set(int slot_nr, cairo_surface_t *surface)
@@ -235,16 +291,37 @@ void FilterSlot::set(int slot_nr, cairo_surface_t *surface)
     if (slot_nr == NR_FILTER_SLOT_NOT_SET)
         slot_nr = NR_FILTER_UNNAMED_SLOT;
 
+    auto lock = std::lock_guard(_storage->mutex);
     _set_internal(slot_nr, surface);
     _last_out = slot_nr;
 }
 
+void FilterSlot::release(int slot_nr)
+{
+    auto lock = std::lock_guard(_storage->mutex);
+
+    auto &slots = _storage->slots;
+    SlotMap::iterator s = slots.find(slot_nr);
+    if (s != slots.end()) {
+        cairo_surface_destroy(s->second);
+        slots.erase(s);
+    }
+    _drop_converted(slot_nr);
+}
+
+int FilterSlot::get_slot_count() const
+{
+    auto lock = std::lock_guard(_storage->mutex);
+    return _storage->slots.size();
+}
+
 void FilterSlot::set_primitive_area(int slot_nr, Geom::Rect &area)
 {
     if (slot_nr == NR_FILTER_SLOT_NOT_SET)
         slot_nr = NR_FILTER_UNNAMED_SLOT;
 
-    _primitiveAreas[slot_nr] = area;
+    auto lock = std::lock_guard(_storage->mutex);
+    _storage->primitiveAreas[slot_nr] = area;
 }
 
 Geom::Rect FilterSlot::get_primitive_area(int slot_nr) const
@@ -252,9 +329,11 @@ Geom::Rect FilterSlot::get_primitive_area(int slot_nr) const
     if (slot_nr == NR_FILTER_SLOT_NOT_SET)
         slot_nr = _last_out;
 
-    auto s = _primitiveAreas.find(slot_nr);
+    auto lock = std::lock_guard(_storage->mutex);
+    auto const &areas = _storage->primitiveAreas;
+    auto s = areas.find(slot_nr);
 
-    if (s == _primitiveAreas.end()) {
+    if (s == areas.end()) {
         return *_units.get_filter_area();
     }
     return s->second;
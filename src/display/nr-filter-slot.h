@@ -16,8 +16,11 @@
  */
 
 #include <map>
+#include <memory>
+#include <mutex>
 #include "nr-filter-types.h"
 #include "nr-filter-units.h"
+#include "style-enums.h"
 
 extern "C" {
 typedef struct _cairo cairo_t;
@@ -37,7 +40,13 @@ public:
     /** Creates a new FilterSlot object. */
     FilterSlot(DrawingContext *bgdc, DrawingContext &graphic, FilterUnits const &units, RenderContext &rc, int blurquality);
 
-    /** Destroys the FilterSlot object and all its contents */
+    /** Creates a view of the same slots for rendering one filter primitive, in which
+     * NR_FILTER_SLOT_NOT_SET stands for 'last_out'. Views can be used from several threads at
+     * once, as long as no primitive writes a slot that another one reads or writes meanwhile.
+     */
+    FilterSlot(FilterSlot const &other, int last_out);
+
+    /** Destroys the FilterSlot object, and all its contents if no other view uses them */
     ~FilterSlot();
 
     /** Returns the pixblock in specified slot.
@@ -49,19 +58,28 @@ public:
      */
     cairo_surface_t *getcairo(int slot);
 
+    /** Returns the pixblock in specified slot in the given color interpolation space.
+     * The slot itself is left as it is, so that other primitives can read it at the
+     * same time; a converted copy is made instead if needed, and kept for later readers.
+     */
+    cairo_surface_t *getcairo(int slot, SPColorInterpolation ci);
+
     /** Sets or re-sets the pixblock associated with given slot.
      * If there was a pixblock already assigned with this slot,
      * that pixblock is destroyed.
      */
     void set(int slot, cairo_surface_t *s);
 
+    /** Frees the pixblock in specified slot, once no remaining primitive reads it. */
+    void release(int slot);
+
     cairo_surface_t *get_result(int slot_nr);
 
     void set_primitive_area(int slot, Geom::Rect &area);
     Geom::Rect get_primitive_area(int slot) const;
     
     /** Returns the number of slots in use. */
-    int get_slot_count() const { return _slots.size(); }
+    int get_slot_count() const;
 
     /** Gets the gaussian filtering quality. Affects used interpolation methods */
     int get_blurquality() const { return _blurquality; }
@@ -75,12 +93,25 @@ public:
     RenderContext &get_rendercontext() const { return rc; }
 
 private:
+    FilterSlot(FilterSlot const &) = default;
+
     using SlotMap = std::map<int, cairo_surface_t *>;
-    SlotMap _slots;
+    using ConvertedMap = std::map<std::pair<int, SPColorInterpolation>, cairo_surface_t *>;
 
     // We need to keep track of the primitive area as this is needed in feTile
     using PrimitiveAreaMap = std::map<int, Geom::Rect>;
-    PrimitiveAreaMap _primitiveAreas;
+
+    /// The contents of the slots, shared by all views.
+    struct Storage
+    {
+        ~Storage();
+
+        std::mutex mutex;
+        SlotMap slots;
+        ConvertedMap converted;
+        PrimitiveAreaMap primitiveAreas;
+    };
+    std::shared_ptr<Storage> _storage;
 
     int _slot_w, _slot_h;
     double _slot_x, _slot_y;
@@ -99,7 +130,10 @@ private:
     cairo_surface_t *_get_fill_paint() const;
     cairo_surface_t *_get_stroke_paint() const;
 
+    // These expect the storage mutex to be held.
+    cairo_surface_t *_getcairo(int slot);
     void _set_internal(int slot, cairo_surface_t *s);
+    void _drop_converted(int slot);
 };
 
 } // namespace Filters
@@ -24,7 +24,15 @@
 #include "display/nr-filter-turbulence.h"
 #include "display/nr-filter-units.h"
 #include "display/nr-filter-utils.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 namespace Inkscape {
 namespace Filters{
@@ -116,109 +124,25 @@ public:
         _inited = true;
     }
 
-    G_GNUC_PURE
-    guint32 turbulencePixel(Geom::Point const &p) const
+    /**
+     * Computes the n pixels from 'start' rightwards, in pixel coordinates which 'trans' maps to
+     * those of the noise. Pixels are done Lanes at a time, in loops over plain arrays that the
+     * compiler turns into vector instructions.
+     */
+    void turbulenceRow(Geom::Affine const &trans, Geom::Point const &start, int n, guint32 *out) const
     {
-        int wrapx = _wrapx, wrapy = _wrapy, wrapw = _wrapw, wraph = _wraph;
-
-        double pixel[4];
-        double x = p[Geom::X] * _baseFreq[Geom::X];
-        double y = p[Geom::Y] * _baseFreq[Geom::Y];
-        double ratio = 1.0;
-
-        for (double & k : pixel)
-            k = 0.0;
-
-        for (int octave = 0; octave < _octaves; ++octave)
-        {
-            double tx = x + PerlinOffset;
-            double bx = floor(tx);
-            double rx0 = tx - bx, rx1 = rx0 - 1.0;
-            int bx0 = bx, bx1 = bx0 + 1;
-
-            double ty = y + PerlinOffset;
-            double by = floor(ty);
-            double ry0 = ty - by, ry1 = ry0 - 1.0;
-            int by0 = by, by1 = by0 + 1;
-
-            if (_stitchTiles) {
-                if (bx0 >= wrapx) bx0 -= wrapw;
-                if (bx1 >= wrapx) bx1 -= wrapw;
-                if (by0 >= wrapy) by0 -= wraph;
-                if (by1 >= wrapy) by1 -= wraph;
-            }
-            bx0 &= BMask;
-            bx1 &= BMask;
-            by0 &= BMask;
-            by1 &= BMask;
-
-            int i = _latticeSelector[bx0];
-            int j = _latticeSelector[bx1];
-            int b00 = _latticeSelector[i + by0];
-            int b01 = _latticeSelector[i + by1];
-            int b10 = _latticeSelector[j + by0];
-            int b11 = _latticeSelector[j + by1];
-
-            double sx = _scurve(rx0);
-            double sy = _scurve(ry0);
-
-            double result[4];
-            // channel numbering: R=0, G=1, B=2, A=3
-            for (int k = 0; k < 4; ++k) {
-                double const *qxa = _gradient[b00][k];
-                double const *qxb = _gradient[b10][k];
-                double a = _lerp(sx, rx0 * qxa[0] + ry0 * qxa[1],
-                                     rx1 * qxb[0] + ry0 * qxb[1]);
-                double const *qya = _gradient[b01][k];
-                double const *qyb = _gradient[b11][k];
-                double b = _lerp(sx, rx0 * qya[0] + ry1 * qya[1],
-                                     rx1 * qyb[0] + ry1 * qyb[1]);
-                result[k] = _lerp(sy, a, b);
-            }
-
-            if (_fractalnoise) {
-                for (int k = 0; k < 4; ++k)
-                    pixel[k] += result[k] / ratio;
-            } else {
-                for (int k = 0; k < 4; ++k)
-                    pixel[k] += fabs(result[k]) / ratio;
-            }
-
-            x *= 2;
-            y *= 2;
-            ratio *= 2;
-
-            if(_stitchTiles)
-            {
-                // Update stitch values. Subtracting PerlinOffset before the multiplication and
-                // adding it afterward simplifies to subtracting it once.
-                wrapw *= 2;
-                wraph *= 2;
-                wrapx = wrapx*2 - PerlinOffset;
-                wrapy = wrapy*2 - PerlinOffset;
+        for (int i = 0; i < n; i += Lanes) {
+            double x[Lanes], y[Lanes];
+            for (int l = 0; l < Lanes; ++l) {
+                // Lanes past the end repeat the last pixel.
+                auto const p = Geom::Point(start[Geom::X] + std::min(i + l, n - 1), start[Geom::Y]) * trans;
+                x[l] = p[Geom::X] * _baseFreq[Geom::X];
+                y[l] = p[Geom::Y] * _baseFreq[Geom::Y];
             }
-        }
 
-        if (_fractalnoise) {
-            guint32 r = CLAMP_D_TO_U8((pixel[0]*255.0 + 255.0) / 2);
-            guint32 g = CLAMP_D_TO_U8((pixel[1]*255.0 + 255.0) / 2);
-            guint32 b = CLAMP_D_TO_U8((pixel[2]*255.0 + 255.0) / 2);
-            guint32 a = CLAMP_D_TO_U8((pixel[3]*255.0 + 255.0) / 2);
-            r = premul_alpha(r, a);
-            g = premul_alpha(g, a);
-            b = premul_alpha(b, a);
-            ASSEMBLE_ARGB32(pxout, a,r,g,b);
-            return pxout;
-        } else {
-            guint32 r = CLAMP_D_TO_U8(pixel[0]*255.0);
-            guint32 g = CLAMP_D_TO_U8(pixel[1]*255.0);
-            guint32 b = CLAMP_D_TO_U8(pixel[2]*255.0);
-            guint32 a = CLAMP_D_TO_U8(pixel[3]*255.0);
-            r = premul_alpha(r, a);
-            g = premul_alpha(g, a);
-            b = premul_alpha(b, a);
-            ASSEMBLE_ARGB32(pxout, a,r,g,b);
-            return pxout;
+            guint32 px[Lanes];
+            _turbulenceLanes(x, y, px);
+            std::copy_n(px, std::min(Lanes, n - i), out + i);
         }
     }
 
@@ -250,7 +174,111 @@ public:
     bool ready() const { return _inited; }
     void dirty() { _inited = false; }
 
+    /// Number of pixels computed together by turbulenceRow().
+    static int constexpr Lanes = 8;
+
 private:
+    void _turbulenceLanes(double *x, double *y, guint32 *out) const
+    {
+        int wrapx = _wrapx, wrapy = _wrapy, wrapw = _wrapw, wraph = _wraph;
+
+        double pixel[4][Lanes] = {};
+        double ratio = 1.0;
+
+        for (int octave = 0; octave < _octaves; ++octave)
+        {
+            double rx0[Lanes], rx1[Lanes], ry0[Lanes], ry1[Lanes], sx[Lanes], sy[Lanes];
+            int b00[Lanes], b01[Lanes], b10[Lanes], b11[Lanes];
+
+            for (int l = 0; l < Lanes; ++l) {
+                double tx = x[l] + PerlinOffset;
+                double bx = floor(tx);
+                rx0[l] = tx - bx;
+                rx1[l] = rx0[l] - 1.0;
+                int bx0 = bx, bx1 = bx0 + 1;
+
+                double ty = y[l] + PerlinOffset;
+                double by = floor(ty);
+                ry0[l] = ty - by;
+                ry1[l] = ry0[l] - 1.0;
+                int by0 = by, by1 = by0 + 1;
+
+                if (_stitchTiles) {
+                    if (bx0 >= wrapx) bx0 -= wrapw;
+                    if (bx1 >= wrapx) bx1 -= wrapw;
+                    if (by0 >= wrapy) by0 -= wraph;
+                    if (by1 >= wrapy) by1 -= wraph;
+                }
+                bx0 &= BMask;
+                bx1 &= BMask;
+                by0 &= BMask;
+                by1 &= BMask;
+
+                int i = _latticeSelector[bx0];
+                int j = _latticeSelector[bx1];
+                b00[l] = _latticeSelector[i + by0];
+                b01[l] = _latticeSelector[i + by1];
+                b10[l] = _latticeSelector[j + by0];
+                b11[l] = _latticeSelector[j + by1];
+
+                sx[l] = _scurve(rx0[l]);
+                sy[l] = _scurve(ry0[l]);
+            }
+
+            // channel numbering: R=0, G=1, B=2, A=3
+            for (int k = 0; k < 4; ++k) {
+                for (int l = 0; l < Lanes; ++l) {
+                    double const *qxa = _gradient[b00[l]][k];
+                    double const *qxb = _gradient[b10[l]][k];
+                    double a = _lerp(sx[l], rx0[l] * qxa[0] + ry0[l] * qxa[1],
+                                            rx1[l] * qxb[0] + ry0[l] * qxb[1]);
+                    double const *qya = _gradient[b01[l]][k];
+                    double const *qyb = _gradient[b11[l]][k];
+                    double b = _lerp(sx[l], rx0[l] * qya[0] + ry1[l] * qya[1],
+                                            rx1[l] * qyb[0] + ry1[l] * qyb[1]);
+                    double result = _lerp(sy[l], a, b);
+                    pixel[k][l] += (_fractalnoise ? result : fabs(result)) / ratio;
+                }
+            }
+
+            for (int l = 0; l < Lanes; ++l) {
+                x[l] *= 2;
+                y[l] *= 2;
+            }
+            ratio *= 2;
+
+            if(_stitchTiles)
+            {
+                // Update stitch values. Subtracting PerlinOffset before the multiplication and
+                // adding it afterward simplifies to subtracting it once.
+                wrapw *= 2;
+                wraph *= 2;
+                wrapx = wrapx*2 - PerlinOffset;
+                wrapy = wrapy*2 - PerlinOffset;
+            }
+        }
+
+        for (int l = 0; l < Lanes; ++l) {
+            guint32 r, g, b, a;
+            if (_fractalnoise) {
+                r = CLAMP_D_TO_U8((pixel[0][l]*255.0 + 255.0) / 2);
+                g = CLAMP_D_TO_U8((pixel[1][l]*255.0 + 255.0) / 2);
+                b = CLAMP_D_TO_U8((pixel[2][l]*255.0 + 255.0) / 2);
+                a = CLAMP_D_TO_U8((pixel[3][l]*255.0 + 255.0) / 2);
+            } else {
+                r = CLAMP_D_TO_U8(pixel[0][l]*255.0);
+                g = CLAMP_D_TO_U8(pixel[1][l]*255.0);
+                b = CLAMP_D_TO_U8(pixel[2][l]*255.0);
+                a = CLAMP_D_TO_U8(pixel[3][l]*255.0);
+            }
+            r = premul_alpha(r, a);
+            g = premul_alpha(g, a);
+            b = premul_alpha(b, a);
+            ASSEMBLE_ARGB32(pxout, a,r,g,b);
+            out[l] = pxout;
+        }
+    }
+
     void _setupSeed(long seed)
     {
         _seed = seed;
@@ -311,6 +339,7 @@ private:
 
 FilterTurbulence::FilterTurbulence()
     : gen(std::make_unique<TurbulenceGenerator>())
+    , cache(std::make_unique<TurbulenceCache>())
     , XbaseFrequency(0)
     , YbaseFrequency(0)
     , numOctaves(1)
@@ -360,24 +389,211 @@ void FilterTurbulence::set_updated(bool /*u*/)
 {
 }
 
-struct Turbulence
+namespace {
+
+/**
+ * The blocks of noise of all TurbulenceCaches, kept within one budget for the whole process.
+ * Like the pattern tile cache, it is split into independently locked shards, each of which
+ * drops its least recently used blocks.
+ */
+class TurbulenceBlocks
 {
-    Turbulence(TurbulenceGenerator const &gen, Geom::Affine const &trans, int x0, int y0)
-        : _gen(gen)
-        , _trans(trans)
-        , _x0(x0), _y0(y0) {}
+public:
+    static int constexpr BlockSize = 64;
+    using Block = std::array<guint32, BlockSize * BlockSize>;
+
+    struct Key
+    {
+        std::uint64_t owner; ///< The cache, and the generator and transform it was filled for.
+        int x, y;
+        bool operator==(Key const &) const = default;
+    };
+
+    static TurbulenceBlocks &get()
+    {
+        static TurbulenceBlocks instance;
+        return instance;
+    }
+
+    std::shared_ptr<Block const> find(Key const &key)
+    {
+        auto &shard = _shard(key);
+        auto lock = std::lock_guard(shard.mutex);
+        auto const it = shard.map.find(key);
+        if (it == shard.map.end()) {
+            return {};
+        }
+        shard.order.splice(shard.order.begin(), shard.order, it->second);
+        return it->second->block;
+    }
 
-    guint32 operator()(int x, int y)
+    /// Add a block, unless another thread got there first. Returns the block kept.
+    std::shared_ptr<Block const> insert(Key const &key, std::shared_ptr<Block const> block)
     {
-        Geom::Point point(x + _x0, y + _y0);
-        point *= _trans;
-        return _gen.turbulencePixel(point);
+        auto &shard = _shard(key);
+        auto lock = std::lock_guard(shard.mutex);
+        if (auto const it = shard.map.find(key); it != shard.map.end()) {
+            return it->second->block;
+        }
+        shard.order.push_front({key, std::move(block)});
+        shard.map.emplace(key, shard.order.begin());
+        if (shard.map.size() > SHARD_BLOCKS) {
+            shard.map.erase(shard.order.back().key);
+            shard.order.pop_back();
+        }
+        return shard.order.front().block;
     }
 
 private:
-    TurbulenceGenerator const &_gen;
+    static constexpr int SHARDS = 16;
+    static constexpr std::size_t SHARD_BLOCKS = 4096 / SHARDS; ///< 64 MiB in all.
+
+    struct KeyHash
+    {
+        std::size_t operator()(Key const &key) const
+        {
+            std::size_t seed = 0;
+            auto const combine = [&] (auto value) {
+                seed ^= std::hash<decltype(value)>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            };
+            combine(key.owner);
+            combine(key.x);
+            combine(key.y);
+            return seed;
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        std::shared_ptr<Block const> block;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::list<Entry> order; ///< Most recently used first.
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> map;
+    };
+
+    Shard &_shard(Key const &key) { return _shards[KeyHash()(key) % SHARDS]; }
+
+    std::array<Shard, SHARDS> _shards;
+};
+
+} // namespace
+
+/**
+ * Noise made by a TurbulenceGenerator, kept in blocks of pixels so that the canvas tiles and
+ * export strips rendered with the same transform don't generate it again. Blocks are aligned to
+ * whole pixels counted from the origin of the transform, so they are only used when the filter
+ * surface is at a whole pixel offset too. They are stored in TurbulenceBlocks, which bounds the
+ * memory used by the noise of all filters together.
+ */
+class TurbulenceCache
+{
+public:
+    std::mutex mutex;
+
+    /// Forget all noise, e.g. when the generator changes. Expects the mutex to be held.
+    /// The blocks already stored are no longer found, and age out of TurbulenceBlocks.
+    void clear()
+    {
+        _owner = _next_owner++;
+    }
+
+    /**
+     * Fills the image surface 'out' with noise at pixel offset (x0, y0) from the origin of
+     * 'trans', which maps the pixels to the coordinates of the noise.
+     */
+    void render(TurbulenceGenerator const &gen, cairo_surface_t *out, Geom::Affine const &trans, double x0, double y0)
+    {
+        int const w = cairo_image_surface_get_width(out);
+        int const h = cairo_image_surface_get_height(out);
+        int const stride = cairo_image_surface_get_stride(out);
+        unsigned char *data = cairo_image_surface_get_data(out);
+        cairo_surface_flush(out);
+
+        #if HAVE_OPENMP
+        int limit = w * h;
+        int numOfThreads = get_num_filter_threads();
+        #endif
+
+        if (x0 != std::floor(x0) || y0 != std::floor(y0) || std::abs(x0) > MaxOffset || std::abs(y0) > MaxOffset) {
+            #if HAVE_OPENMP
+            #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
+            #endif
+            for (int i = 0; i < h; ++i) {
+                auto row = reinterpret_cast<guint32 *>(data + i * stride);
+                gen.turbulenceRow(trans, Geom::Point(x0, i + y0), w, row);
+            }
+            cairo_surface_mark_dirty(out);
+            return;
+        }
+
+        int const px0 = x0, py0 = y0;
+        int const bx0 = _floor_div(px0), bx1 = _floor_div(px0 + w - 1);
+        int const by0 = _floor_div(py0), by1 = _floor_div(py0 + h - 1);
+        int const cols = bx1 - bx0 + 1;
+        int const num_blocks = cols * (by1 - by0 + 1);
+
+        #if HAVE_OPENMP
+        #pragma omp parallel for if(limit > OPENMP_THRESHOLD) num_threads(numOfThreads)
+        #endif
+        for (int n = 0; n < num_blocks; ++n) {
+            int const bx = bx0 + n % cols, by = by0 + n / cols;
+            auto const block = _get(gen, trans, bx, by);
+
+            // Copy the part of the block that overlaps the surface.
+            int const left = std::max(bx * BlockSize, px0), right = std::min((bx + 1) * BlockSize, px0 + w);
+            int const top = std::max(by * BlockSize, py0), bottom = std::min((by + 1) * BlockSize, py0 + h);
+            for (int y = top; y < bottom; ++y) {
+                auto src = block->data() + (y - by * BlockSize) * BlockSize + (left - bx * BlockSize);
+                auto dest = reinterpret_cast<guint32 *>(data + (y - py0) * stride) + (left - px0);
+                std::memcpy(dest, src, (right - left) * sizeof(guint32));
+            }
+        }
+        cairo_surface_mark_dirty(out);
+    }
+
+private:
+    static int constexpr BlockSize = TurbulenceBlocks::BlockSize;
+    static int constexpr MaxOffset = 1 << 24; ///< Keeps block coordinates from overflowing.
+
+    using Block = TurbulenceBlocks::Block;
+
+    static int _floor_div(int p) { return p >= 0 ? p / BlockSize : -((-p - 1) / BlockSize) - 1; }
+
+    std::shared_ptr<Block const> _get(TurbulenceGenerator const &gen, Geom::Affine const &trans, int bx, int by)
+    {
+        std::uint64_t owner;
+        {
+            auto lock = std::lock_guard(mutex);
+            if (trans != _trans) {
+                clear();
+                _trans = trans;
+            }
+            owner = _owner;
+        }
+
+        auto &blocks = TurbulenceBlocks::get();
+        auto const key = TurbulenceBlocks::Key{owner, bx, by};
+        if (auto block = blocks.find(key)) {
+            return block;
+        }
+
+        // Generate outside any lock; should another thread do the same block meanwhile, one is kept.
+        auto block = std::make_shared<Block>();
+        for (int y = 0; y < BlockSize; ++y) {
+            gen.turbulenceRow(trans, Geom::Point(bx * BlockSize, by * BlockSize + y), BlockSize, block->data() + y * BlockSize);
+        }
+        return blocks.insert(key, std::move(block));
+    }
+
+    static inline std::atomic<std::uint64_t> _next_owner = 0;
+
     Geom::Affine _trans;
-    int _x0, _y0;
+    std::uint64_t _owner = _next_owner++;
 };
 
 void FilterTurbulence::render_cairo(FilterSlot &slot) const
@@ -401,19 +617,24 @@ void FilterTurbulence::render_cairo(FilterSlot &slot) const
     // color_interpolation_filter is determined by CSS value (see spec. Turbulence).
     set_cairo_surface_ci(out, color_interpolation);
 
-    if (!gen->ready()) {
-        Geom::Point ta(fTileX, fTileY);
-        Geom::Point tb(fTileX + fTileWidth, fTileY + fTileHeight);
-        gen->init(seed, Geom::Rect(ta, tb),
-                  Geom::Point(XbaseFrequency, YbaseFrequency), stitchTiles,
-                  type == TURBULENCE_FRACTALNOISE, numOctaves);
+    {
+        // Tiles of the canvas may be rendered at the same time.
+        auto lock = std::lock_guard(cache->mutex);
+        if (!gen->ready()) {
+            Geom::Point ta(fTileX, fTileY);
+            Geom::Point tb(fTileX + fTileWidth, fTileY + fTileHeight);
+            gen->init(seed, Geom::Rect(ta, tb),
+                      Geom::Point(XbaseFrequency, YbaseFrequency), stitchTiles,
+                      type == TURBULENCE_FRACTALNOISE, numOctaves);
+            cache->clear();
+        }
     }
 
     Geom::Affine unit_trans = slot.get_units().get_matrix_primitiveunits2pb().inverse();
     Geom::Rect slot_area = slot.get_slot_area();
     double x0 = slot_area.min()[Geom::X];
     double y0 = slot_area.min()[Geom::Y];
-    ink_cairo_surface_synthesize(temp, Turbulence(*gen, unit_trans, x0, y0));
+    cache->render(*gen, temp, unit_trans, x0, y0);
 
     // cairo_surface_write_to_png( temp, "turbulence0.png" );
 
@@ -40,6 +40,7 @@ enum FilterTurbulenceType
 };
 
 class TurbulenceGenerator;
+class TurbulenceCache;
 
 class FilterTurbulence : public FilterPrimitive
 {
@@ -62,6 +63,7 @@ public:
 
 private:
     std::unique_ptr<TurbulenceGenerator> gen;
+    std::unique_ptr<TurbulenceCache> cache; ///< Noise already generated, shared by all renders.
 
     void turbulenceInit(long seed);
 
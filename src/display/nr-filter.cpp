@@ -11,12 +11,20 @@
  */
 
 #include <glib.h>
+#include <algorithm>
 #include <cmath>
+#include <condition_variable>
 #include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <boost/asio/post.hpp>
 #include <cairo.h>
 
 #include "display/nr-filter.h"
+#include "async/thread-pool.h"
 #include "display/nr-filter-primitive.h"
 #include "display/nr-filter-slot.h"
 #include "display/nr-filter-types.h"
@@ -55,6 +63,252 @@ namespace Filters {
 using Geom::X;
 using Geom::Y;
 
+namespace {
+
+/**
+ * The primitives of a filter as a dependency graph. A primitive depends on those whose results
+ * it reads, and on those reading or writing the slot it overwrites. Primitives are run as soon
+ * as what they depend on is done, so independent branches of a filter render at the same time,
+ * and results are dropped as soon as the last primitive reading them is done.
+ */
+class PrimitiveGraph : public std::enable_shared_from_this<PrimitiveGraph>
+{
+public:
+    PrimitiveGraph(std::vector<std::unique_ptr<FilterPrimitive>> const &primitives, int output_slot);
+
+    /// The slot holding the result of the filter after run().
+    int result_slot() const { return _result_slot; }
+
+    /**
+     * Render all primitives into the given slots, on the calling thread and on up to
+     * max_helpers threads of the helper pool. Returns when all are done.
+     */
+    void run(FilterSlot &slot, int max_helpers);
+
+private:
+    struct Node
+    {
+        FilterPrimitive const *primitive;
+        int last_out; ///< The slot NR_FILTER_SLOT_NOT_SET stands for when rendering it.
+        int output;
+        std::vector<int> reads; ///< Versions of slots read.
+        int writes;             ///< Version of the output slot written.
+        std::vector<int> dependents;
+        int num_deps = 0;
+    };
+
+    /// The contents of a slot from one write until the next.
+    struct Version
+    {
+        int slot;
+        int num_readers = 0;
+        bool keep = false; ///< Whether this is the result of the filter.
+    };
+
+    std::vector<Node> _nodes;
+    std::vector<Version> _versions;
+    int _result_slot;
+
+    // State of run(), guarded by _mutex.
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    FilterSlot *_slot = nullptr;
+    std::vector<int> _ready;
+    std::vector<int> _deps_left;
+    std::vector<int> _readers_left;
+    int _unfinished = 0;
+    int _helpers = 0;
+    int _max_helpers = 0;
+    std::exception_ptr _error;
+
+    void _work(bool caller);
+    void _finish(int node);
+    void _post_helpers();
+};
+
+PrimitiveGraph::PrimitiveGraph(std::vector<std::unique_ptr<FilterPrimitive>> const &primitives, int output_slot)
+{
+    std::map<int, int> current; // The version each slot holds.
+    std::vector<int> producers; // The node writing each version, -1 for what slots hold to begin with.
+    std::vector<std::vector<int>> readers;
+
+    auto version_of = [&] (int slot) {
+        auto [it, inserted] = current.try_emplace(slot, _versions.size());
+        if (inserted) {
+            _versions.push_back({slot});
+            producers.push_back(-1);
+            readers.emplace_back();
+        }
+        return it->second;
+    };
+
+    int last_out = NR_FILTER_SOURCEGRAPHIC;
+    _nodes.reserve(primitives.size());
+
+    for (auto const &primitive : primitives) {
+        int const i = _nodes.size();
+        auto &node = _nodes.emplace_back();
+        node.primitive = primitive.get();
+        node.last_out = last_out;
+
+        std::set<int> deps;
+        for (int input : primitive->get_inputs()) {
+            int const v = version_of(input == NR_FILTER_SLOT_NOT_SET ? last_out : input);
+            if (std::find(node.reads.begin(), node.reads.end(), v) != node.reads.end()) {
+                continue;
+            }
+            node.reads.push_back(v);
+            readers[v].push_back(i);
+            if (producers[v] >= 0) {
+                deps.insert(producers[v]);
+            }
+        }
+
+        int const output = primitive->get_output();
+        node.output = output == NR_FILTER_SLOT_NOT_SET ? NR_FILTER_UNNAMED_SLOT : output;
+        if (auto it = current.find(node.output); it != current.end()) {
+            // Overwriting a slot waits for everything reading or writing its old contents.
+            if (producers[it->second] >= 0) {
+                deps.insert(producers[it->second]);
+            }
+            for (int r : readers[it->second]) {
+                if (r != i) {
+                    deps.insert(r);
+                }
+            }
+        }
+        node.writes = current[node.output] = _versions.size();
+        _versions.push_back({node.output});
+        producers.push_back(i);
+        readers.emplace_back();
+
+        for (int d : deps) {
+            _nodes[d].dependents.push_back(i);
+        }
+        node.num_deps = deps.size();
+        last_out = node.output;
+    }
+
+    _result_slot = output_slot == NR_FILTER_SLOT_NOT_SET ? last_out : output_slot;
+    _versions[version_of(_result_slot)].keep = true;
+
+    for (std::size_t v = 0; v < _versions.size(); v++) {
+        _versions[v].num_readers = readers[v].size();
+    }
+}
+
+void PrimitiveGraph::run(FilterSlot &slot, int max_helpers)
+{
+    auto lock = std::unique_lock(_mutex);
+
+    _slot = &slot;
+    _max_helpers = max_helpers;
+    _unfinished = _nodes.size();
+    _deps_left.clear();
+    _readers_left.clear();
+    for (auto const &node : _nodes) {
+        _deps_left.push_back(node.num_deps);
+    }
+    for (auto const &version : _versions) {
+        _readers_left.push_back(version.num_readers);
+    }
+
+    // Ready nodes are taken from the back, so that they start in document order.
+    for (int i = _nodes.size() - 1; i >= 0; i--) {
+        if (_nodes[i].num_deps == 0) {
+            _ready.push_back(i);
+        }
+    }
+    _post_helpers();
+
+    lock.unlock();
+    _work(true);
+
+    if (_error) {
+        std::rethrow_exception(_error);
+    }
+}
+
+void PrimitiveGraph::_work(bool caller)
+{
+    SurfacePoolScope pool_scope;
+    auto lock = std::unique_lock(_mutex);
+
+    while (true) {
+        if (_ready.empty()) {
+            // Helpers leave when out of work, the caller stays until everything is done.
+            if (!caller || _unfinished == 0) {
+                break;
+            }
+            _cond.wait(lock);
+            continue;
+        }
+
+        int const i = _ready.back();
+        _ready.pop_back();
+
+        // After an error, what remains is only gone through without rendering.
+        if (!_error) {
+            lock.unlock();
+            try {
+                FilterSlot view(*_slot, _nodes[i].last_out);
+                _nodes[i].primitive->render_cairo(view);
+            } catch (...) {
+                lock.lock();
+                if (!_error) {
+                    _error = std::current_exception();
+                }
+                lock.unlock();
+            }
+            lock.lock();
+        }
+
+        _finish(i);
+    }
+
+    if (!caller) {
+        _helpers--;
+    }
+}
+
+void PrimitiveGraph::_finish(int i)
+{
+    auto const &node = _nodes[i];
+
+    for (int v : node.reads) {
+        // Unless overwritten by this very primitive, nothing can have written the slot since.
+        if (--_readers_left[v] == 0 && !_versions[v].keep && _versions[v].slot != node.output) {
+            _slot->release(_versions[v].slot);
+        }
+    }
+    if (_versions[node.writes].num_readers == 0 && !_versions[node.writes].keep) {
+        _slot->release(node.output);
+    }
+
+    for (int d : node.dependents) {
+        if (--_deps_left[d] == 0) {
+            _ready.push_back(d);
+        }
+    }
+    _unfinished--;
+
+    if (!_ready.empty() || _unfinished == 0) {
+        _cond.notify_all();
+    }
+    _post_helpers();
+}
+
+void PrimitiveGraph::_post_helpers()
+{
+    // The thread that called run() takes one ready node, helpers take the rest.
+    while (_helpers < _max_helpers && _helpers + 1 < static_cast<int>(_ready.size())) {
+        _helpers++;
+        boost::asio::post(Inkscape::Async::helper_pool(), [self = shared_from_this()] { self->_work(false); });
+    }
+}
+
+} // namespace
+
 Filter::Filter()
 {
     _common_init();
@@ -149,14 +403,15 @@ int Filter::render(Inkscape::DrawingItem const *item, DrawingContext &graphic, D
         }
     }
 
+    // Intermediate results are short-lived and of the same few sizes, so take their buffers from a pool.
+    SurfacePoolScope pool_scope;
     auto slot = FilterSlot(bgdc, graphic, units, rc, blurquality);
 
-    for (auto &i : primitives) {
-        i->render_cairo(slot);
-    }
+    auto graph = std::make_shared<PrimitiveGraph>(primitives, _output_slot);
+    graph->run(slot, get_num_filter_threads() - 1);
 
     Geom::Point origin = graphic.targetLogicalBounds().min();
-    cairo_surface_t *result = slot.get_result(_output_slot);
+    cairo_surface_t *result = slot.get_result(graph->result_slot());
 
     // Assume for the moment that we paint the filter in sRGB
     set_cairo_surface_ci(result, SP_CSS_COLOR_INTERPOLATION_SRGB);
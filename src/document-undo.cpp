@@ -53,6 +53,7 @@
 #include "document.h"                       // for SPDocument
 #include "event.h"                          // for Event
 #include "inkscape.h"                       // for Application, INKSCAPE
+#include "preferences.h"                    // for Preferences
 #include "composite-undo-stack-observer.h"  // for CompositeUndoStackObserver
 
 #include "debug/event-tracker.h"            // for EventTracker
@@ -119,6 +120,26 @@ using Inkscape::Debug::timestamp;
 
 typedef SimpleEvent<Event::INTERACTION> InteractionEvent;
 
+/// The most recent steps are never packed, as they are the likeliest to be undone.
+constexpr std::size_t KEEP_UNPACKED = 10;
+
+std::size_t log_memory_use(Inkscape::XML::Event const *log)
+{
+    std::size_t memory = 0;
+    for (auto event = log; event; event = event->next) {
+        memory += event->memoryUse();
+    }
+    return memory;
+}
+
+/// Update the bookkeeping of an undo step after more changes were added to it.
+void step_extended(Inkscape::Event &step)
+{
+    step.memory = log_memory_use(step.event);
+    step.packed = false;
+    step.spilled = false;
+}
+
 class CommitEvent : public InteractionEvent {
 public:
 
@@ -178,8 +199,10 @@ void Inkscape::DocumentUndo::maybeDone(SPDocument *doc,
 	if (key && !doc->actionkey.empty() && (doc->actionkey == key) && !doc->undo.empty()) {
                 (doc->undo.back())->event =
                     sp_repr_coalesce_log ((doc->undo.back())->event, log);
+                step_extended(*doc->undo.back());
 	} else {
         Inkscape::Event *event = new Inkscape::Event(log, event_description, icon_name);
+        event->memory = log_memory_use(log);
         doc->undo.push_back(event);
 		doc->history_size++;
 		doc->undoStackObservers.notifyUndoCommitEvent(event);
@@ -194,6 +217,8 @@ void Inkscape::DocumentUndo::maybeDone(SPDocument *doc,
 	doc->virgin = FALSE;
     doc->setModifiedSinceSave();
 
+    limit_history_memory(*doc);
+
 	sp_repr_begin_transaction (doc->rdoc);
 
   doc->commit_signal.emit();
@@ -220,6 +245,7 @@ void Inkscape::DocumentUndo::finish_incomplete_transaction(SPDocument &doc) {
         if (!doc.undo.empty()) {
             Inkscape::Event* undo_stack_top = doc.undo.back();
             undo_stack_top->event = sp_repr_coalesce_log(undo_stack_top->event, doc.partial);
+            step_extended(*undo_stack_top);
         } else {
             sp_repr_free_log(doc.partial);
         }
@@ -243,12 +269,66 @@ void Inkscape::DocumentUndo::perform_document_update(SPDocument &doc) {
         if (!doc.undo.empty()) {
             Inkscape::Event* undo_stack_top = doc.undo.back();
             undo_stack_top->event = sp_repr_coalesce_log(undo_stack_top->event, update_log);
+            step_extended(*undo_stack_top);
         } else {
             sp_repr_free_log(update_log);
         }
     }
 }
 
+/**
+ * Keep the memory held by the undo history within the limit set in the preferences. Older steps
+ * are first packed to keep only the parts of values that changed, see XML::ValueDelta, and if
+ * that is not enough, the oldest steps move even those parts to a temporary file, from which
+ * they are read back when the steps are undone or redone. Nothing is written to the file before
+ * then.
+ */
+void Inkscape::DocumentUndo::limit_history_memory(SPDocument &doc)
+{
+    auto const limit = Inkscape::Preferences::get()->getIntLimited("/options/undo/memorylimit", 512, 0, 65536);
+    if (limit == 0) {
+        return; // unlimited
+    }
+    std::size_t const budget = std::size_t(limit) << 20;
+
+    std::size_t total = 0;
+    for (auto step : doc.undo) {
+        total += step->memory;
+    }
+    for (auto step : doc.redo) {
+        total += step->memory;
+    }
+
+    auto const end = doc.undo.size() > KEEP_UNPACKED ? doc.undo.end() - KEEP_UNPACKED : doc.undo.begin();
+    auto const compact = [&] (bool spill) {
+        for (auto it = doc.undo.begin(); it != end && total > budget; ++it) {
+            auto const step = *it;
+            if (spill ? step->spilled || !step->packed : step->packed) {
+                continue;
+            }
+            // In the order the changes were made, so that those of the same value are chained.
+            std::vector<Inkscape::XML::Event *> events;
+            for (auto event = step->event; event; event = event->next) {
+                events.push_back(event);
+            }
+            for (auto event = events.rbegin(); event != events.rend(); ++event) {
+                spill ? (*event)->spill() : (*event)->pack();
+            }
+            (spill ? step->spilled : step->packed) = true;
+            total -= step->memory;
+            step->memory = log_memory_use(step->event);
+            total += step->memory;
+        }
+    };
+
+    if (total > budget) {
+        compact(false);
+    }
+    if (total > budget) {
+        compact(true);
+    }
+}
+
 gboolean Inkscape::DocumentUndo::undo(SPDocument *doc)
 {
     using Inkscape::Debug::EventTracker;
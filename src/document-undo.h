@@ -47,6 +47,8 @@ private:
 
     static void perform_document_update(SPDocument &document);
 
+    static void limit_history_memory(SPDocument &document);
+
 public:
     static void resetKey(SPDocument *document);
 
@@ -35,6 +35,8 @@
 
 #include "document.h"
 
+#include <algorithm>
+#include <chrono>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -57,6 +59,7 @@
 #include "colors/document-cms.h"
 #include "rdf.h"
 #include "selection.h"
+#include "stylesheet-index.h"
 
 #include "3rdparty/adaptagrams/libavoid/router.h"
 #include "3rdparty/libcroco/src/cr-sel-eng.h"
@@ -70,6 +73,7 @@
 #include "display/drawing.h"
 #include "io/dir-util.h"
 #include "live_effects/lpeobject.h"
+#include "object/item-index.h"
 #include "object/persp3d.h"
 #include "object/sp-defs.h"
 #include "object/sp-factory.h"
@@ -124,6 +128,7 @@ SPDocument::SPDocument() :
 
     _event_log = std::make_unique<Inkscape::EventLog>(this);
     _selection = std::make_unique<Inkscape::Selection>(this);
+    _item_index = std::make_unique<Inkscape::ItemIndex>();
 
     _desktop_activated_connection = INKSCAPE.signal_activate_desktop.connect(
                 sigc::hide(sigc::bind(
@@ -190,6 +195,7 @@ SPDocument::~SPDocument() {
     resources.clear();
 
     // This also destroys all attached stylesheets
+    _style_sheet_index.reset();
     cr_cascade_unref(style_cascade);
     style_cascade = nullptr;
 
@@ -664,6 +670,7 @@ SPDocument *SPDocument::_searchForChild(std::string const &filename, SPDocument
 
 void SPDocument::update_lpobjs() {
     Inkscape::DocumentUndo::ScopedInsensitive tmp(this);
+    SPLPEItem::precomputePathEffects(getRoot());
     sp_lpe_item_update_patheffect(getRoot(), false, true, true);
 }
 
@@ -1269,18 +1276,22 @@ std::vector<SPObject*> SPDocument::getObjectsByElement(Glib::ustring const &elem
 
 static void _getObjectsBySelectorRecursive(SPObject *parent,
                                            CRSelEng *sel_eng, CRSimpleSel *simple_sel,
+                                           Inkscape::StyleSheetIndex::Key const &key,
                                            std::vector<SPObject*> &objects)
 {
     if (parent) {
-        gboolean result = false;
-        cr_sel_eng_matches_node(sel_eng, simple_sel, parent->getRepr(), &result);
-        if (result) {
-            objects.push_back(parent);
+        // Only run the full selector engine on objects that pass the cheap test.
+        if (Inkscape::StyleSheetIndex::mayMatch(key, parent->getRepr())) {
+            gboolean result = false;
+            cr_sel_eng_matches_node(sel_eng, simple_sel, parent->getRepr(), &result);
+            if (result) {
+                objects.push_back(parent);
+            }
         }
 
         // Check children
         for (auto &child : parent->children) {
-            _getObjectsBySelectorRecursive(&child, sel_eng, simple_sel, objects);
+            _getObjectsBySelectorRecursive(&child, sel_eng, simple_sel, key, objects);
         }
     }
 }
@@ -1298,14 +1309,41 @@ std::vector<SPObject*> SPDocument::getObjectsBySelector(Glib::ustring const &sel
 
     std::vector<SPObject*> objects;
     for (auto cur = cr_selector; cur; cur = cur->next) {
-        if (cur->simple_sel) {
-            _getObjectsBySelectorRecursive(root, sel_eng, cur->simple_sel, objects);
+        if (!cur->simple_sel) {
+            continue;
+        }
+        auto const key = Inkscape::StyleSheetIndex::keyOf(cur->simple_sel);
+        if (key.kind == Inkscape::StyleSheetIndex::Key::ID) {
+            // Ids are unique, no need to walk the tree.
+            auto const object = getObjectById(key.name);
+            gboolean result = false;
+            if (object && object->document == this && object->getRepr()) {
+                cr_sel_eng_matches_node(sel_eng, cur->simple_sel, object->getRepr(), &result);
+            }
+            if (result) {
+                objects.push_back(object);
+            }
+        } else {
+            _getObjectsBySelectorRecursive(root, sel_eng, cur->simple_sel, key, objects);
         }
     }
     cr_selector_destroy(cr_selector);
     return objects;
 }
 
+Inkscape::StyleSheetIndex const &SPDocument::getStyleSheetIndex()
+{
+    if (!_style_sheet_index) {
+        _style_sheet_index = std::make_unique<Inkscape::StyleSheetIndex>(style_cascade);
+    }
+    return *_style_sheet_index;
+}
+
+void SPDocument::invalidateStyleSheetIndex()
+{
+    _style_sheet_index.reset();
+}
+
 // Note: Despite appearances, this implementation is allocation-free thanks to SSO.
 std::string SPDocument::generate_unique_id(char const *prefix)
 {
@@ -1335,7 +1373,6 @@ void SPDocument::bindObjectToRepr(Inkscape::XML::Node *repr, SPObject *object)
         g_assert(it != reprdef.end());
         reprdef.erase(it);
     }
-    clearNodeCache();
 }
 
 SPObject *SPDocument::getObjectByRepr(Inkscape::XML::Node *repr) const
@@ -1433,6 +1470,7 @@ SPDocument::_updateDocument(int update_flags)
 {
     /* Process updates */
     if (this->root->uflags || this->root->mflags) {
+        auto const start = std::chrono::steady_clock::now();
         if (this->root->uflags) {
             SPItemCtx ctx;
             setupViewport(&ctx);
@@ -1442,6 +1480,8 @@ SPDocument::_updateDocument(int update_flags)
             this->root->updateDisplay((SPCtx *)&ctx, update_flags);
         }
         this->_emitModified();
+        update_stats.passes++;
+        update_stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     }
 
     return !(this->root->uflags || this->root->mflags);
@@ -1460,6 +1500,7 @@ gint SPDocument::ensureUpToDate()
     //   1a) Process all document updates.
     //   1b) When completed, process connector routing changes.
     //   2a) Process any updates resulting from connector reroutings.
+    update_stats = {};
     int counter = 32;
     for (unsigned int pass = 1; pass <= 2; ++pass) {
         // Process document updates.
@@ -1497,6 +1538,7 @@ gint SPDocument::ensureUpToDate()
 bool
 SPDocument::idle_handler()
 {
+    update_stats = {};
     bool status = !_updateDocument(0); // method TRUE if it does NOT need further modification, so invert
     if (!status) {
         modified_connection.disconnect();
@@ -1531,10 +1573,33 @@ static bool overlaps(Geom::Rect const &area, Geom::Rect const &box)
 }
 
 /**
- * Return a vector list of items in a given area.
+ * Check whether the recursive group traversal used by the area searches would reach an item,
+ * i.e. whether every ancestor up to the document root is a group that gets entered.
+ */
+static bool is_reachable(SPItem const *item, SPRoot const *root, unsigned int dkey,
+                         bool take_hidden, bool take_insensitive, bool enter_groups, bool enter_layers)
+{
+    for (auto parent = item->parent; parent != root; parent = parent->parent) {
+        auto group = cast<SPGroup>(parent);
+        if (!group) {
+            return false;
+        }
+        if ((!take_insensitive && group->isLocked()) || (!take_hidden && group->isHidden())) {
+            return false;
+        }
+        bool const is_layer = group->effectiveLayerMode(dkey) == SPGroup::LAYER;
+        if (!(enter_layers && is_layer) && !enter_groups) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Return a vector list of items in a given area, in document order.
  *
- * @param s The returned list
- * @param group The starting group
+ * @param index The spatial index of the document
+ * @param root The document root
  * @param dkey The display control group to traverse
  * @param area Area in document coordinates
  * @param test A function called for each item's bbox
@@ -1544,43 +1609,46 @@ static bool overlaps(Geom::Rect const &area, Geom::Rect const &box)
  * @param enter_groups (false) traverse into regular groups
  * @param enter_layers (true) traverse into layer groups
  */
-static std::vector<SPItem*> &find_items_in_area(std::vector<SPItem*> &s,
-                                                SPGroup *group, unsigned int dkey,
-                                                Geom::Rect const &area,
-                                                bool (*test)(Geom::Rect const &, Geom::Rect const &),
-                                                bool take_hidden = false,
-                                                bool take_insensitive = false,
-                                                bool take_groups = true,
-                                                bool enter_groups = false,
-                                                bool enter_layers = true)
-{
-    g_return_val_if_fail(group, s);
-
-    for (auto& o: group->children) {
-        if (auto item = cast<SPItem>(&o)) {
-            if (!take_insensitive && item->isLocked()) {
-                continue;
-            }
+static std::vector<SPItem*> find_items_in_area(Inkscape::ItemIndex &index,
+                                               SPRoot const *root, unsigned int dkey,
+                                               Geom::Rect const &area,
+                                               bool (*test)(Geom::Rect const &, Geom::Rect const &),
+                                               bool take_hidden = false,
+                                               bool take_insensitive = false,
+                                               bool take_groups = true,
+                                               bool enter_groups = false,
+                                               bool enter_layers = true)
+{
+    std::vector<SPItem*> s;
+    g_return_val_if_fail(root, s);
+
+    // Both tests imply that the bounding box intersects the area.
+    for (auto item : index.intersecting(area)) {
+        if (!take_insensitive && item->isLocked()) {
+            continue;
+        }
 
-            if (!take_hidden && item->isHidden()) {
-                continue;
-            }
+        if (!take_hidden && item->isHidden()) {
+            continue;
+        }
 
-            if (auto childgroup = cast<SPGroup>(item)) {
-                bool is_layer = childgroup->effectiveLayerMode(dkey) == SPGroup::LAYER;
-                if ((enter_layers && is_layer) || (enter_groups)) {
-                    s = find_items_in_area(s, childgroup, dkey, area, test, take_hidden, take_insensitive, take_groups, enter_groups, enter_layers);
-                }
-                if (!take_groups || (enter_layers && is_layer)) {
-                    continue;
-                }
-            }
-            Geom::OptRect box = item->documentVisualBounds();
-            if (box && test(area, *box)) {
-                s.push_back(item);
+        if (!is_reachable(item, root, dkey, take_hidden, take_insensitive, enter_groups, enter_layers)) {
+            continue;
+        }
+
+        if (auto childgroup = cast<SPGroup>(item)) {
+            bool is_layer = childgroup->effectiveLayerMode(dkey) == SPGroup::LAYER;
+            if (!take_groups || (enter_layers && is_layer)) {
+                continue;
             }
         }
+        Geom::OptRect box = item->documentVisualBounds();
+        if (box && test(area, *box)) {
+            s.push_back(item);
+        }
     }
+
+    std::sort(s.begin(), s.end(), sp_object_compare_position_bool);
     return s;
 }
 
@@ -1620,39 +1688,61 @@ SPItem *SPDocument::getItemFromListAtPointBottom(unsigned dkey, SPGroup *group,
     return nullptr;
 }
 
-void _build_flat_item_list(std::deque<SPItem*> &cache, SPGroup *group, unsigned int dkey, bool into_groups, bool active_only)
+/**
+ * Check whether an item belongs to the flat list of pickable items, which contains the
+ * descendants of layers (and of all groups if into_groups is set), but not the groups
+ * that are entered themselves.
+ */
+static bool is_in_flat_item_list(SPItem const *item, SPRoot const *root, unsigned int dkey, bool into_groups, bool active_only)
 {
-    for (auto& o: group->children) {
-        if (!is<SPItem>(&o)) {
-            continue;
-        }
+    auto is_entered = [&] (SPGroup const *group) {
+        return group->effectiveLayerMode(dkey) == SPGroup::LAYER || into_groups;
+    };
 
-        if (is<SPGroup>(&o) && (cast<SPGroup>(&o)->effectiveLayerMode(dkey) == SPGroup::LAYER || into_groups)) {
-            _build_flat_item_list(cache, cast<SPGroup>(&o), dkey, into_groups, active_only);
-        } else {
-            auto child = cast<SPItem>(&o);
-            if (!active_only || child->isVisibleAndUnlocked(dkey)) {
-                cache.push_front(child);
-            }
+    if (auto group = cast<SPGroup>(item); group && is_entered(group)) {
+        return false;
+    }
+
+    for (auto parent = item->parent; parent != root; parent = parent->parent) {
+        auto group = cast<SPGroup>(parent);
+        if (!group || !is_entered(group)) {
+            return false;
         }
     }
+
+    return !active_only || item->isVisibleAndUnlocked(dkey);
 }
 
 /**
-Turn the SVG DOM into a cached flat list of nodes that can be searched from top-down.
-The list can be persisted, which improves "find at multiple points" speed.
+Return the flat list of items that can be picked at the point p (in window coordinates),
+sorted from the top down. Only the items whose bounding box is close enough to p
+are considered, which are looked up in the spatial index of the document.
 */
-std::deque<SPItem*> const &SPDocument::get_flat_item_list(unsigned int dkey, bool into_groups, bool active_only) const
+std::vector<SPItem*> SPDocument::get_flat_item_list(unsigned int dkey, Geom::Point const &p, bool into_groups, bool active_only) const
 {
-    // Build a caching key from our inputs
-    using key_t = decltype(_node_cache)::key_type;
-    auto const key = (key_t{dkey} << 2) | (into_groups << 1) | active_only;
+    std::vector<SPItem*> result;
+
+    auto const root_item = root->get_arenaitem(dkey);
+    if (!root_item || !root_item->ctm().isInvertible()) {
+        return result;
+    }
 
-    auto const [it, inserted] = _node_cache.try_emplace(key);
-    if (inserted) {
-        _build_flat_item_list(it->second, root, dkey, into_groups, active_only);
+    // Picking honours the cursor tolerance and draws hairlines and outlines at a minimum
+    // width on screen, so widen the search by a pixel on top of the tolerance.
+    auto const &doc2win = root_item->ctm();
+    double const delta = Inkscape::Preferences::get()->getDouble("/options/cursortolerance/value", 1.0);
+    double const tolerance = (delta + 1.0) / doc2win.descrim();
+
+    for (auto item : _item_index->around(p * doc2win.inverse(), tolerance)) {
+        if (is_in_flat_item_list(item, root, dkey, into_groups, active_only)) {
+            result.push_back(item);
+        }
     }
-    return it->second;
+
+    std::sort(result.begin(), result.end(), [] (SPItem const *a, SPItem const *b) {
+        return sp_object_compare_position(a, b) > 0;
+    });
+    return result;
 }
 
 /**
@@ -1661,10 +1751,10 @@ point p, or NULL if none. Honors into_groups on whether to recurse into non-laye
 groups or not. Honors take_insensitive on whether to return insensitive items.
 If upto != NULL, then if item upto is encountered (at any level), stops searching
 upwards in z-order and returns what it has found so far (i.e. the found items are
-guaranteed to be lower than upto). Requires a list of nodes built by build_flat_item_list.
+guaranteed to be lower than upto). Requires a list of nodes built by get_flat_item_list.
 If items_count > 0, it'll return the topmost (in z-order) items_count items.
  */
-static std::vector<SPItem*> find_items_at_point(std::deque<SPItem*> const &nodes, unsigned dkey,
+static std::vector<SPItem*> find_items_at_point(std::vector<SPItem*> const &nodes, unsigned dkey,
                                                 Geom::Point const &p, int items_count = 0, SPItem *upto = nullptr)
 {
     double const delta = Inkscape::Preferences::get()->getDouble("/options/cursortolerance/value", 1.0);
@@ -1672,12 +1762,8 @@ static std::vector<SPItem*> find_items_at_point(std::deque<SPItem*> const &nodes
 
     std::vector<SPItem*> result;
 
-    bool seen_upto = !upto;
     for (auto node : nodes) {
-        if (!seen_upto) {
-            if (node == upto) {
-                seen_upto = true;
-            }
+        if (upto && sp_object_compare_position(node, upto) >= 0) {
             continue;
         }
         if (auto di = node->get_arenaitem(dkey)) {
@@ -1699,7 +1785,7 @@ static std::vector<SPItem*> find_items_at_point(std::deque<SPItem*> const &nodes
     return result;
 }
 
-static SPItem *find_item_at_point(std::deque<SPItem*> const &nodes, unsigned dkey, Geom::Point const &p, SPItem *upto = nullptr)
+static SPItem *find_item_at_point(std::vector<SPItem*> const &nodes, unsigned dkey, Geom::Point const &p, SPItem *upto = nullptr)
 {
     auto items = find_items_at_point(nodes, dkey, p, 1, upto);
     if (items.empty()) {
@@ -1748,8 +1834,7 @@ static SPItem *find_group_at_point(unsigned dkey, SPGroup *group, Geom::Point co
 
 std::vector<SPItem*> SPDocument::getItemsInBox(unsigned int dkey, Geom::Rect const &box, bool take_hidden, bool take_insensitive, bool take_groups, bool enter_groups, bool enter_layers) const
 {
-    std::vector<SPItem*> x;
-    return find_items_in_area(x, this->root, dkey, box, is_within, take_hidden, take_insensitive, take_groups, enter_groups, enter_layers);
+    return find_items_in_area(*_item_index, root, dkey, box, is_within, take_hidden, take_insensitive, take_groups, enter_groups, enter_layers);
 }
 
 /**
@@ -1765,8 +1850,7 @@ std::vector<SPItem*> SPDocument::getItemsInBox(unsigned int dkey, Geom::Rect con
 
 std::vector<SPItem*> SPDocument::getItemsPartiallyInBox(unsigned int dkey, Geom::Rect const &box, bool take_hidden, bool take_insensitive, bool take_groups, bool enter_groups, bool enter_layers) const
 {
-    std::vector<SPItem*> x;
-    return find_items_in_area(x, this->root, dkey, box, overlaps, take_hidden, take_insensitive, take_groups, enter_groups, enter_layers);
+    return find_items_in_area(*_item_index, root, dkey, box, overlaps, take_hidden, take_insensitive, take_groups, enter_groups, enter_layers);
 }
 
 std::vector<SPItem*> SPDocument::getItemsAtPoints(unsigned const key, std::vector<Geom::Point> points, bool all_layers, bool topmost_only, size_t limit, bool active_only) const
@@ -1780,8 +1864,6 @@ std::vector<SPItem*> SPDocument::getItemsAtPoints(unsigned const key, std::vecto
     gdouble saved_delta = prefs->getDouble("/options/cursortolerance/value", 1.0);
     prefs->setDouble("/options/cursortolerance/value", 0.25);
 
-    auto &node_cache = get_flat_item_list(key, true, active_only);
-
     SPObject *current_layer = nullptr;
     SPDesktop *desktop = SP_ACTIVE_DESKTOP;
     if(desktop){
@@ -1789,7 +1871,8 @@ std::vector<SPItem*> SPDocument::getItemsAtPoints(unsigned const key, std::vecto
     }
     size_t item_counter = 0;
     for(auto point : points) {
-        std::vector<SPItem*> items = find_items_at_point(node_cache, key, point, topmost_only);
+        auto const candidates = get_flat_item_list(key, point, true, active_only);
+        std::vector<SPItem*> items = find_items_at_point(candidates, key, point, topmost_only);
         for (SPItem *item : items) {
             if (item && result.end()==find(result.begin(), result.end(), item))
                 if(all_layers || (desktop && desktop->layerManager().layerForObject(item) == current_layer)){
@@ -1813,7 +1896,7 @@ std::vector<SPItem*> SPDocument::getItemsAtPoints(unsigned const key, std::vecto
 SPItem *SPDocument::getItemAtPoint( unsigned const key, Geom::Point const &p,
                                     bool const into_groups, SPItem *upto) const
 {
-    return find_item_at_point(get_flat_item_list(key, into_groups, true), key, p, upto);
+    return find_item_at_point(get_flat_item_list(key, p, into_groups, true), key, p, upto);
 }
 
 SPItem *SPDocument::getGroupAtPoint(unsigned int key, Geom::Point const &p) const
@@ -2258,7 +2341,6 @@ void SPDocument::_emitModified() {
     static guint const flags = SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG | SP_OBJECT_PARENT_MODIFIED_FLAG;
     root->emitModified(0);
     modified_signal.emit(flags);
-    clearNodeCache();
 }
 
 void
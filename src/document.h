@@ -19,6 +19,7 @@
  */
 
 #include <cstddef>                             // for size_t
+#include <cstdint>                             // for uint64_t
 #include <deque>                               // for deque
 #include <map>                                 // for map
 #include <memory>                              // for unique_ptr, default_de...
@@ -82,11 +83,13 @@ namespace Inkscape {
     class DocumentUndo;
     class Event;
     class EventLog;
+    class ItemIndex;
     class PageManager;
     namespace Colors {
         class DocumentCMS;
     }
     class Selection;
+    class StyleSheetIndex;
     class UndoStackObserver;
     namespace XML {
         struct Document;
@@ -106,6 +109,17 @@ public:
     /// For sanity check in SPObject::requestDisplayUpdate
     unsigned update_in_progress = 0;
 
+    struct UpdateStats
+    {
+        unsigned passes;                ///< Update and modification passes over the changed objects.
+        std::uint64_t objects_updated;  ///< Objects whose update() ran.
+        std::uint64_t objects_modified; ///< Objects whose modified() ran.
+        double seconds;                 ///< Time taken by all the passes.
+    };
+
+    /// Statistics of the last time the document was brought up to date. Counted by SPObject.
+    UpdateStats update_stats = {};
+
 protected:
     // Protect against allocation of SPDocument in non-GC-scanned memory.
     // Necessary while SPDocument still contains GC-managed pointers.
@@ -146,7 +160,7 @@ public:
     bool isModifiedSinceSave() const { return modified_since_save; }
     bool isModifiedSinceAutoSave() const { return modified_since_autosave; }
     void setModifiedSinceSave(bool const modified = true);
-    void setModifiedSinceAutoSaveFalse() { modified_since_autosave = false; };
+    void setModifiedSinceAutoSave(bool const modified) { modified_since_autosave = modified; }
 
     bool idle_handler();
     bool rerouting_handler();
@@ -183,12 +197,11 @@ private:
     std::queue<GQuark> pending_resource_changes;
 
     // Find items by geometry --------------------
-    std::deque<SPItem*> const &get_flat_item_list(unsigned int dkey, bool into_groups, bool active_only) const;
+    std::vector<SPItem*> get_flat_item_list(unsigned int dkey, Geom::Point const &p, bool into_groups, bool active_only) const;
 
     SPDocument *_searchForChild(std::string const &filename, SPDocument const *avoid = nullptr);
 
 public:
-    void clearNodeCache() { _node_cache.clear(); }
     void importDefs(SPDocument *source);
 
     unsigned int vacuumDocument();
@@ -221,8 +234,15 @@ public:
 
     Inkscape::Selection *getSelection() { return _selection.get(); }
 
+    /** Spatial index of the document's items, used by the geometric searches below. */
+    Inkscape::ItemIndex &getItemIndex() { return *_item_index; }
+
     // Styling
     CRCascade    *getStyleCascade() { return style_cascade; }
+    /** Indexed rules of the style cascade, compiled on first use after any style sheet change. */
+    Inkscape::StyleSheetIndex const &getStyleSheetIndex();
+    /** Must be called whenever a style sheet of the cascade is added, modified or removed. */
+    void invalidateStyleSheetIndex();
 
     // File information --------------------
 
@@ -399,6 +419,7 @@ private:
 
     // Styling
     CRCascade *style_cascade;
+    std::unique_ptr<Inkscape::StyleSheetIndex> _style_sheet_index;
 
     // Desktop geometry
     mutable Geom::Affine _doc2dt;
@@ -413,7 +434,7 @@ private:
     std::map<Inkscape::XML::Node *, SPObject *> reprdef;
 
     // Find items by geometry --------------------
-    mutable std::map<unsigned long, std::deque<SPItem*>> _node_cache; // Used to speed up search.
+    std::unique_ptr<Inkscape::ItemIndex> _item_index;
 
     // Box tool ----------------------------
     Persp3D *current_persp3d; /**< Currently 'active' perspective (to which, e.g., newly created boxes are attached) */
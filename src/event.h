@@ -17,6 +17,7 @@
 
 #include <glibmm/ustring.h>
 
+#include <cstddef>
 #include <utility>
 
 #include "xml/event-fns.h"
@@ -42,6 +43,11 @@ public:
     unsigned int type = 0;
     Glib::ustring description; // The description to use in the Undo dialog.
     Glib::ustring icon_name;   // The icon to use in the Undo dialog.
+
+    // Kept up to date by DocumentUndo, to bound the memory held by the undo history.
+    std::size_t memory = 0;    // Approximate bytes held by the event's log, see XML::Event::memoryUse().
+    bool packed = false;       // Whether the log was packed to save memory.
+    bool spilled = false;      // Whether the log was moved to disk as far as possible.
 };
 
 } // namespace Inkscape
@@ -0,0 +1,341 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Long-lived worker process for script extensions that support it.
+ */
+
+#include "script-host.h"
+
+#include <csignal>
+#include <string_view>
+#include <glib.h>
+#include <glibmm/iochannel.h>
+#include <glibmm/main.h>
+#include <glibmm/miscutils.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#endif
+
+namespace Inkscape::Extension::Implementation {
+
+namespace {
+
+/**
+ * Split the next field off the front of @a data, if it holds a complete one.
+ * Sets @a malformed if @a data does not start with a field length.
+ */
+std::optional<std::string_view> take_field(std::string_view &data, bool &malformed)
+{
+    auto const newline = data.find('\n');
+    if (newline == data.npos) {
+        return {};
+    }
+
+    std::size_t length = 0;
+    for (std::size_t i = 0; i < newline; i++) {
+        if (!g_ascii_isdigit(data[i]) || length > data.max_size() / 10) {
+            malformed = true;
+            return {};
+        }
+        length = length * 10 + (data[i] - '0');
+    }
+
+    if (data.size() - newline - 1 < length) {
+        return {};
+    }
+
+    auto const field = data.substr(newline + 1, length);
+    data.remove_prefix(newline + 1 + length);
+    return field;
+}
+
+} // namespace
+
+ScriptHost::ScriptHost(std::vector<std::string> argv, std::string working_directory)
+    : _argv(std::move(argv))
+    , _working_directory(std::move(working_directory))
+{
+}
+
+ScriptHost::~ScriptHost()
+{
+    _stop();
+}
+
+bool ScriptHost::_start()
+{
+    int stdin_pipe, stdout_pipe;
+
+    // Inkscape's own environment, plus the variable that tells the script to serve requests
+    // instead of running once.
+    std::vector<std::string> envp;
+    for (auto const &name : Glib::listenv()) {
+        if (name != "INKSCAPE_EXTENSION_HOST") {
+            envp.emplace_back(name + "=" + Glib::getenv(name));
+        }
+    }
+    envp.emplace_back("INKSCAPE_EXTENSION_HOST=1");
+
+    try {
+        Glib::spawn_async_with_pipes(_working_directory,
+                                     _argv,
+                                     envp,
+                                     static_cast<Glib::SpawnFlags>(0),
+                                     sigc::slot<void ()>(),
+                                     &_pid,
+                                     &stdin_pipe,
+                                     &stdout_pipe,
+                                     nullptr); // stderr is shared with Inkscape; messages go through the protocol.
+    } catch (Glib::Error const &e) {
+        g_warning("ScriptHost: failed to start '%s': %s", _argv.front().c_str(), e.what());
+        return false;
+    }
+
+    _in = Glib::IOChannel::create_from_fd(stdin_pipe);
+    _in->set_close_on_unref(true);
+    _in->set_encoding();
+    // Requests are written from the main loop of run(), so that a script that stops reading
+    // cannot block Inkscape, and a run can be cancelled at any point.
+    _in->set_buffered(false);
+    _in->set_flags(Glib::IOFlags::NONBLOCK);
+    _out = Glib::IOChannel::create_from_fd(stdout_pipe);
+    _out->set_close_on_unref(true);
+    _out->set_encoding();
+    // Likewise, replies are read as they come; a buffered read would wait for a full buffer,
+    // which a process that keeps its output open may never send.
+    _out->set_buffered(false);
+    _out->set_flags(Glib::IOFlags::NONBLOCK);
+
+    _buffer.clear();
+    _eof = false;
+    _alive = true;
+    return true;
+}
+
+/**
+ * Close the pipes, upon which a well-behaved script exits.
+ */
+void ScriptHost::_stop()
+{
+    if (!_alive) {
+        return;
+    }
+    _in.reset();
+    _out.reset();
+    Glib::spawn_close_pid(_pid);
+    _buffer.clear();
+    _alive = false;
+}
+
+/**
+ * Stop the process at once, whatever it is doing, and make a run() in progress return.
+ */
+void ScriptHost::cancel()
+{
+    if (_alive) {
+#ifdef _WIN32
+        TerminateProcess(_pid, 1);
+#else
+        kill(_pid, SIGKILL);
+#endif
+    }
+    _eof = true;
+    if (_main_loop) {
+        _main_loop->quit();
+    }
+}
+
+/**
+ * Write as much of the pending request as the pipe takes; returns false once there is nothing
+ * more to write, either because it is all written or because the process cannot take it.
+ */
+bool ScriptHost::_onWritable()
+{
+    try {
+        while (_written < _request.size()) {
+            gsize count = 0;
+            auto const status = _in->write(_request.data() + _written, _request.size() - _written, count);
+            _written += count;
+            if (status == Glib::IOStatus::AGAIN) {
+                return true;
+            }
+            if (status != Glib::IOStatus::NORMAL) {
+                _eof = true;
+                break;
+            }
+        }
+    } catch (Glib::Error const &e) {
+        g_warning("ScriptHost: failed to send request: %s", e.what());
+        _eof = true;
+    }
+    _request.clear();
+    return false;
+}
+
+/**
+ * Read whatever the process has written so far; returns false once nothing more can be read.
+ */
+bool ScriptHost::_onReadable()
+{
+    char buf[1 << 16];
+    gsize count = 0;
+    try {
+        auto const status = _out->read(buf, sizeof(buf), count);
+        _buffer.append(buf, count);
+        if (status == Glib::IOStatus::AGAIN) {
+            return true;
+        }
+        if (status == Glib::IOStatus::ENDOFFILE || status == Glib::IOStatus::ERROR) {
+            _eof = true;
+        }
+    } catch (Glib::Error const &e) {
+        g_warning("ScriptHost: failed to read reply: %s", e.what());
+        _eof = true;
+    }
+    return !_eof;
+}
+
+/**
+ * Remove the next complete field from the read buffer, if there is one.
+ */
+std::optional<std::string> ScriptHost::_takeField()
+{
+    std::string_view data = _buffer;
+    bool malformed = false;
+    auto const field = take_field(data, malformed);
+    if (malformed) {
+        g_warning("ScriptHost: malformed reply from '%s'", _argv.back().c_str());
+        _eof = true;
+        return {};
+    }
+    if (!field) {
+        return {};
+    }
+
+    std::string result{*field};
+    _buffer.erase(0, _buffer.size() - data.size());
+    return result;
+}
+
+std::optional<ScriptHost::Reply> ScriptHost::run(std::vector<std::string> const &args,
+                                                 std::string const &document_path,
+                                                 std::string const &document)
+{
+    if (!_alive && !_start()) {
+        return {};
+    }
+
+    std::string request;
+    auto const add_field = [&] (std::string const &data) {
+        request += std::to_string(data.size());
+        request += '\n';
+        request += data;
+    };
+    _eof = false;
+    add_field("1");
+    add_field(std::to_string(args.size()));
+    for (auto const &arg : args) {
+        add_field(arg);
+    }
+    add_field(document_path);
+    add_field(document);
+    _request = std::move(request);
+    _written = 0;
+
+    // Send the request and wait for the reply in a private main loop, so that only the pipes are
+    // serviced, like Script::execute() does.
+    std::vector<std::string> fields;
+    auto const collect = [&] {
+        while (fields.size() < 3) {
+            if (auto field = _takeField()) {
+                fields.emplace_back(std::move(*field));
+            } else {
+                break;
+            }
+        }
+        return fields.size() == 3;
+    };
+
+    // A script that died would otherwise take Inkscape down with it.
+#if !defined(_WIN32) && !defined(__WIN32__)
+    auto const old_handler = std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+    auto context = Glib::MainContext::create();
+    _main_loop = Glib::MainLoop::create(context, false);
+    auto write_conn = context->signal_io().connect([&] (Glib::IOCondition) {
+        bool const more = _onWritable();
+        if (_eof) {
+            _main_loop->quit();
+        }
+        return more;
+    }, _in, Glib::IOCondition::IO_OUT | Glib::IOCondition::IO_HUP | Glib::IOCondition::IO_ERR);
+    auto read_conn = context->signal_io().connect([&] (Glib::IOCondition) {
+        bool const more = _onReadable();
+        if (collect() || !more) {
+            _main_loop->quit();
+            return false;
+        }
+        return true;
+    }, _out, Glib::IOCondition::IO_IN | Glib::IOCondition::IO_HUP | Glib::IOCondition::IO_ERR);
+    _main_loop->run();
+    write_conn.disconnect();
+    read_conn.disconnect();
+    _main_loop.reset();
+    _request.clear();
+
+#if !defined(_WIN32) && !defined(__WIN32__)
+    std::signal(SIGPIPE, old_handler);
+#endif
+
+    if (fields.size() < 3) {
+        // Died, cancelled or out of sync; start afresh next time.
+        _stop();
+        return {};
+    }
+
+    Reply reply;
+    reply.messages = std::move(fields[1]);
+    if (fields[0] == "0") {
+        reply.changed = true;
+        reply.document = std::move(fields[2]);
+    } else if (fields[0] == "2") {
+        std::string_view data = fields[2];
+        bool malformed = false;
+        while (!data.empty() && !malformed) {
+            if (auto const field = take_field(data, malformed)) {
+                reply.changes.emplace_back(*field);
+            } else {
+                malformed = true;
+            }
+        }
+        if (malformed) {
+            g_warning("ScriptHost: malformed changes from '%s'", _argv.back().c_str());
+            reply.changes.clear();
+            if (!reply.messages.empty()) {
+                reply.messages += '\n';
+            }
+            reply.messages += "Extension sent malformed changes";
+        } else {
+            reply.changed = true;
+        }
+    } else if (fields[0] != "1" && reply.messages.empty()) {
+        reply.messages = "Extension failed with status " + fields[0];
+    }
+    return reply;
+}
+
+} // namespace Inkscape::Extension::Implementation
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
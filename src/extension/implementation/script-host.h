@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Long-lived worker process for script extensions that support it.
+ */
+
+#ifndef INKSCAPE_EXTENSION_IMPLEMENTATION_SCRIPT_HOST_H
+#define INKSCAPE_EXTENSION_IMPLEMENTATION_SCRIPT_HOST_H
+
+#include <optional>
+#include <string>
+#include <vector>
+#include <glibmm/refptr.h>
+#include <glibmm/spawn.h>
+
+namespace Glib {
+class IOChannel;
+class MainLoop;
+} // namespace Glib
+
+namespace Inkscape::Extension::Implementation {
+
+/**
+ * A script extension process that stays alive between invocations.
+ *
+ * Extensions opt in with persistent="true" on the command element of their .inx file. The
+ * script is then started once, with INKSCAPE_EXTENSION_HOST=1 in its environment, and receives
+ * every invocation on its standard input instead of being spawned with a temporary file.
+ * This saves the interpreter startup and the file round trips.
+ *
+ * The streams carry fields, each written as its length in bytes in decimal, a newline, and
+ * the bytes themselves. A request is the fields
+ *
+ *     protocol version ("1"), argument count N, N arguments, document path, SVG document
+ *
+ * and the script answers with
+ *
+ *     status, messages, SVG document or changes
+ *
+ * where status is "0" if the last field holds the changed document, "2" if it holds only the
+ * changes made to it, "1" if the document was left alone (the last field is then empty) and
+ * anything else for a failure. Messages are shown to the user like the standard error output
+ * of a regular script.
+ *
+ * Changes are themselves a sequence of fields, making up operations on the elements of the
+ * document, which are named by their id, the empty id naming the root:
+ *
+ *     "set", id, attribute name, value
+ *     "unset", id, attribute name
+ *     "insert", parent id, id of the previous sibling or empty for the first child, element
+ *     "move", id, new parent id, id of the new previous sibling or empty
+ *     "replace", id, element
+ *     "remove", id
+ *
+ * where an element is written as an XML document whose root is the new element. They apply in
+ * order, so later operations can name elements inserted by earlier ones. Text content, and
+ * nodes without an id, are changed by replacing the closest element that has one.
+ */
+class ScriptHost
+{
+public:
+    struct Reply
+    {
+        bool changed = false;
+        std::string document; ///< The changed document, if sent whole.
+        std::vector<std::string> changes; ///< The fields of the changes, if sent as such.
+        std::string messages;
+    };
+
+    ScriptHost(std::vector<std::string> argv, std::string working_directory);
+    ScriptHost(ScriptHost const &) = delete;
+    ScriptHost &operator=(ScriptHost const &) = delete;
+    ~ScriptHost();
+
+    /// Whether the process is running and in a known protocol state.
+    bool alive() const { return _alive; }
+
+    /**
+     * Send one invocation and wait for the answer.
+     * Returns nothing if the process failed or was cancelled, after which the host is no longer alive.
+     */
+    std::optional<Reply> run(std::vector<std::string> const &args, std::string const &document_path,
+                             std::string const &document);
+
+    /// Abort a run() in progress, killing the process.
+    void cancel();
+
+private:
+    bool _start();
+    void _stop();
+    bool _onWritable();
+    bool _onReadable();
+    std::optional<std::string> _takeField();
+
+    std::vector<std::string> _argv;
+    std::string _working_directory;
+
+    bool _alive = false;
+    Glib::Pid _pid{};
+    Glib::RefPtr<Glib::IOChannel> _in;
+    Glib::RefPtr<Glib::IOChannel> _out;
+    Glib::RefPtr<Glib::MainLoop> _main_loop;
+    std::string _request; ///< The request being sent.
+    std::size_t _written = 0; ///< How much of it has been sent.
+    std::string _buffer; ///< Data read from the process but not consumed yet.
+    bool _eof = false;
+};
+
+} // namespace Inkscape::Extension::Implementation
+
+#endif // INKSCAPE_EXTENSION_IMPLEMENTATION_SCRIPT_HOST_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -16,6 +16,8 @@
 #include "script.h"
 
 #include <memory>
+#include <string_view>
+#include <unordered_map>
 #include <glib/gstdio.h>
 #include <glibmm/convert.h>
 #include <glibmm/fileutils.h>
@@ -47,6 +49,7 @@
 #include "object/sp-root.h"
 #include "path-prefix.h"
 #include "preferences.h"
+#include "script-host.h"
 #include "selection.h"
 #include "io/dir-util.h"
 #include "ui/desktop/menubar.h"
@@ -199,6 +202,7 @@ bool Script::load(Inkscape::Extension::Extension *module)
         if (!strcmp(child_repr->name(), INKSCAPE_EXTENSION_NS "script")) {
             for (child_repr = child_repr->firstChild(); child_repr != nullptr; child_repr = child_repr->next()) {
                 if (!strcmp(child_repr->name(), INKSCAPE_EXTENSION_NS "command")) {
+                    _persistent = child_repr->getAttributeBoolean("persistent", false);
                     const gchar *interpretstr = child_repr->attribute("interpreter");
                     if (interpretstr != nullptr) {
                         std::string interpString = resolveInterpreterExecutable(interpretstr);
@@ -239,6 +243,8 @@ bool Script::load(Inkscape::Extension::Extension *module)
 */
 void Script::unload(Inkscape::Extension::Extension */*module*/)
 {
+    _host.reset();
+    _persistent = false;
     command.clear();
     helper_extension = "";
 }
@@ -596,6 +602,10 @@ void Script::_change_extension(Inkscape::Extension::Extension *module, SPDocumen
         parent_window = env->get_working_dialog();
     }
 
+    if (_persistent && _change_with_host(doc, params, ignore_stderr)) {
+        return;
+    }
+
     auto tempfile_out = Inkscape::IO::TempFilename("ink_ext_XXXXXX.svg");
     auto tempfile_in = Inkscape::IO::TempFilename("ink_ext_XXXXXX.svg");
 
@@ -632,6 +642,293 @@ void Script::_change_extension(Inkscape::Extension::Extension *module, SPDocumen
     }
 }
 
+static bool same_node(Inkscape::XML::Node const *a, Inkscape::XML::Node const *b)
+{
+    return a->type() == b->type() && a->code() == b->code() && !g_strcmp0(a->attribute("id"), b->attribute("id"));
+}
+
+/**
+ * Make @a target equal to @a source by changing only what differs, so that an extension that
+ * touches a few objects does not rebuild the whole document.
+ *
+ * For the root, this follows SPDocument::rebase(): its attributes are only added or changed, and
+ * the named view is merged into the existing one rather than replaced.
+ */
+static void sync_node(Inkscape::XML::Node *target, Inkscape::XML::Node const *source, bool is_root = false)
+{
+    if (g_strcmp0(target->content(), source->content())) {
+        target->setContent(source->content());
+    }
+
+    if (!is_root) {
+        std::vector<GQuark> removed;
+        for (auto const &attr : target->attributeList()) {
+            if (!source->attribute(g_quark_to_string(attr.key))) {
+                removed.emplace_back(attr.key);
+            }
+        }
+        for (auto key : removed) {
+            target->removeAttribute(g_quark_to_string(key));
+        }
+    }
+    for (auto const &attr : source->attributeList()) {
+        auto const key = g_quark_to_string(attr.key);
+        if (g_strcmp0(target->attribute(key), attr.value)) {
+            target->setAttribute(key, attr.value);
+        }
+    }
+
+    auto const is_namedview = [&] (Inkscape::XML::Node const *node) {
+        return is_root && !g_strcmp0(node->name(), "sodipodi:namedview");
+    };
+
+    // Pair children up by id where they have one, otherwise in order of appearance.
+    std::unordered_map<std::string, Inkscape::XML::Node *> by_id;
+    std::vector<Inkscape::XML::Node *> unmatched;
+    Inkscape::XML::Node *namedview = nullptr;
+    for (auto child = target->firstChild(); child; child = child->next()) {
+        if (is_namedview(child)) {
+            namedview = child;
+        } else if (auto const id = child->attribute("id"); id && !by_id.count(id)) {
+            by_id.emplace(id, child);
+        } else {
+            unmatched.emplace_back(child);
+        }
+    }
+    std::size_t cursor = 0;
+
+    Inkscape::XML::Node *prev = nullptr;
+    for (auto child = source->firstChild(); child; child = child->next()) {
+        Inkscape::XML::Node *match = nullptr;
+        if (is_namedview(child) && namedview) {
+            namedview->mergeFrom(child, "id", true, true);
+            match = namedview;
+        } else if (auto const id = child->attribute("id")) {
+            if (auto const it = by_id.find(id); it != by_id.end() && same_node(it->second, child)) {
+                match = it->second;
+                by_id.erase(it);
+            }
+        } else {
+            for (auto i = cursor; i < unmatched.size(); i++) {
+                if (same_node(unmatched[i], child)) {
+                    match = unmatched[i];
+                    unmatched[i] = nullptr;
+                    cursor = i + 1;
+                    break;
+                }
+            }
+        }
+
+        if (match) {
+            if (match->prev() != prev) {
+                target->changeOrder(match, prev);
+            }
+            if (match != namedview) {
+                sync_node(match, child);
+            }
+        } else {
+            match = child->duplicate(target->document());
+            target->addChild(match, prev);
+            Inkscape::GC::release(match);
+        }
+        prev = match;
+    }
+
+    for (auto const &entry : by_id) {
+        target->removeChild(entry.second);
+    }
+    for (auto child : unmatched) {
+        if (child) {
+            target->removeChild(child);
+        }
+    }
+}
+
+/**
+ * Apply the changes sent by the persistent process of an extension, as described for ScriptHost.
+ * Returns false if an operation does not fit the document; the operations before it stay applied.
+ */
+static bool apply_changes(Inkscape::XML::Document *xml_doc, std::vector<std::string> const &changes)
+{
+    auto const root = xml_doc->root();
+
+    // Elements by id, kept up to date as operations add, remove and rename them.
+    std::unordered_map<std::string, Inkscape::XML::Node *> by_id;
+    auto const index = [&] (Inkscape::XML::Node *node, bool add, auto &self) -> void {
+        if (auto const id = node->attribute("id")) {
+            if (add) {
+                by_id.emplace(id, node);
+            } else if (auto const it = by_id.find(id); it != by_id.end() && it->second == node) {
+                by_id.erase(it);
+            }
+        }
+        for (auto child = node->firstChild(); child; child = child->next()) {
+            self(child, add, self);
+        }
+    };
+    index(root, true, index);
+
+    auto const find = [&] (std::string const &id) -> Inkscape::XML::Node * {
+        if (id.empty()) {
+            return root;
+        }
+        auto const it = by_id.find(id);
+        return it != by_id.end() ? it->second : nullptr;
+    };
+    // The previous sibling, which must be a child of parent; null for the first place.
+    auto const find_after = [&] (Inkscape::XML::Node *parent, std::string const &id, Inkscape::XML::Node *&after) {
+        after = id.empty() ? nullptr : find(id);
+        return id.empty() || (after && after->parent() == parent);
+    };
+    auto const parse = [&] (std::string const &data) -> Inkscape::XML::Node * {
+        auto const fragment = sp_repr_read_buf(data, SP_SVG_NS_URI);
+        if (!fragment) {
+            return nullptr;
+        }
+        auto const node = fragment->root()->duplicate(xml_doc);
+        Inkscape::GC::release(fragment);
+        return node;
+    };
+
+    static std::unordered_map<std::string_view, std::size_t> const arities = {
+        {"set", 3}, {"unset", 2}, {"insert", 3}, {"move", 3}, {"replace", 2}, {"remove", 1}};
+
+    for (std::size_t i = 0; i < changes.size();) {
+        auto const arity = arities.find(changes[i]);
+        if (arity == arities.end() || changes.size() - i - 1 < arity->second) {
+            return false;
+        }
+        auto const &op = changes[i];
+        auto const args = &changes[i + 1];
+        i += 1 + arity->second;
+
+        auto const node = find(args[0]);
+        if (!node) {
+            return false;
+        }
+
+        if (op == "set" || op == "unset") {
+            bool const is_id = args[1] == "id";
+            if (is_id) {
+                index(node, false, index);
+            }
+            if (op == "set") {
+                node->setAttribute(args[1], args[2]);
+            } else {
+                node->removeAttribute(args[1]);
+            }
+            if (is_id) {
+                index(node, true, index);
+            }
+        } else if (op == "insert") {
+            Inkscape::XML::Node *after;
+            if (!find_after(node, args[1], after)) {
+                return false;
+            }
+            auto const child = parse(args[2]);
+            if (!child) {
+                return false;
+            }
+            node->addChild(child, after);
+            index(child, true, index);
+            Inkscape::GC::release(child);
+        } else if (node == root) {
+            return false;
+        } else if (op == "move") {
+            auto const parent = find(args[1]);
+            Inkscape::XML::Node *after;
+            if (!parent || !find_after(parent, args[2], after) || after == node) {
+                return false;
+            }
+            for (auto ancestor = parent; ancestor; ancestor = ancestor->parent()) {
+                if (ancestor == node) {
+                    return false;
+                }
+            }
+            if (node->parent() == parent) {
+                parent->changeOrder(node, after);
+            } else {
+                Inkscape::GC::anchor(node);
+                node->parent()->removeChild(node);
+                parent->addChild(node, after);
+                Inkscape::GC::release(node);
+            }
+        } else if (op == "replace") {
+            auto const replacement = parse(args[1]);
+            if (!replacement) {
+                return false;
+            }
+            index(node, false, index);
+            node->parent()->addChild(replacement, node);
+            node->parent()->removeChild(node);
+            index(replacement, true, index);
+            Inkscape::GC::release(replacement);
+        } else {
+            index(node, false, index);
+            node->parent()->removeChild(node);
+        }
+    }
+    return true;
+}
+
+/**
+ * Run the effect in the persistent process of the extension, starting it if needed.
+ * Returns false if that failed and the script has to be run the regular way.
+ */
+bool Script::_change_with_host(SPDocument *doc, std::list<std::string> const &params, bool ignore_stderr)
+{
+    if (!_host) {
+        std::vector<std::string> argv{command.front()};
+        std::string working_directory;
+        if (command.size() == 2) {
+            // Same as execute(): run interpreted scripts from their own directory.
+            working_directory = Glib::path_get_dirname(command.back());
+            argv.push_back(Glib::path_get_basename(command.back()));
+        }
+        _host = std::make_unique<ScriptHost>(std::move(argv), std::move(working_directory));
+    }
+
+    auto const filename = doc->getDocumentFilename();
+    _canceled = false;
+    auto reply = _host->run({params.begin(), params.end()}, filename ? filename : "",
+                            sp_repr_save_buf(doc->getReprDoc()).raw());
+    if (_canceled) {
+        return true;
+    }
+    if (!reply) {
+        g_warning("Script: persistent process of '%s' failed, running it the regular way.", command.back().c_str());
+        _host.reset();
+        return false;
+    }
+
+    if (!ignore_stderr) {
+        _report_stderr(reply->messages);
+    }
+    if (!reply->changed) {
+        return true;
+    }
+
+    pump_events();
+    if (reply->document.empty()) {
+        // Announced like SPDocument::rebase(), so that tools and dialogs let go of the objects first.
+        doc->emitReconstructionStart();
+        bool const applied = apply_changes(doc->getReprDoc(), reply->changes);
+        doc->emitReconstructionFinish();
+        if (!applied) {
+            Inkscape::UI::gui_warning(_("The changes made by the extension could not be applied."), parent_window);
+        }
+    } else if (auto new_xmldoc = sp_repr_read_buf(reply->document, SP_SVG_NS_URI)) {
+        // Announced like SPDocument::rebase(), so that tools and dialogs let go of the objects first.
+        doc->emitReconstructionStart();
+        sync_node(doc->getReprRoot(), new_xmldoc->root(), true);
+        doc->emitReconstructionFinish();
+        Inkscape::GC::release(new_xmldoc);
+    } else {
+        Inkscape::UI::gui_warning(_("The output from the extension could not be parsed."), parent_window);
+    }
+    return true;
+}
+
 /**  \brief  This function checks the stderr file, and if it has data,
              shows it in a warning dialog to the user
      \param  filename  Filename of the stderr file
@@ -671,6 +968,9 @@ bool Script::cancelProcessing () {
     if (_main_loop) {
         _main_loop->quit();
     }
+    if (_host) {
+        _host->cancel();
+    }
     Glib::spawn_close_pid(_pid);
 
     return true;
@@ -793,21 +1093,28 @@ int Script::execute (const std::list<std::string> &in_command,
         return 0;
     }
 
-    Glib::ustring stderr_data = fileerr.string();
-    if (!stderr_data.empty() && !ignore_stderr) {
-        if (INKSCAPE.use_gui()) {
-            showPopupError(stderr_data, Gtk::MessageType::INFO,
-                                 _("Inkscape has received additional data from the script executed.  "
-                                   "The script did not return an error, but this may indicate the results will not be as expected."));
-        } else {
-            std::cerr << "Script Error\n----\n" << stderr_data.c_str() << "\n----\n";
-        }
+    if (!ignore_stderr) {
+        _report_stderr(fileerr.string());
     }
 
     Glib::ustring stdout_data = fileout.string();
     return stdout_data.length();
 }
 
+void Script::_report_stderr(Glib::ustring const &data)
+{
+    if (data.empty()) {
+        return;
+    }
+    if (INKSCAPE.use_gui()) {
+        showPopupError(data, Gtk::MessageType::INFO,
+                             _("Inkscape has received additional data from the script executed.  "
+                               "The script did not return an error, but this may indicate the results will not be as expected."));
+    } else {
+        std::cerr << "Script Error\n----\n" << data.c_str() << "\n----\n";
+    }
+}
+
 Script::file_listener::~file_listener() = default;
 
 void Script::file_listener::init(int fd, Glib::RefPtr<Glib::MainLoop> main) {
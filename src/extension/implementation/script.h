@@ -16,6 +16,7 @@
 
 #include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <glibmm/iochannel.h>
@@ -44,6 +45,8 @@ class Node;
 
 namespace Extension::Implementation {
 
+class ScriptHost;
+
 /**
  * Utility class used for loading and launching script extensions
  */
@@ -73,6 +76,12 @@ private:
     Glib::RefPtr<Glib::MainLoop> _main_loop;
 
     void _change_extension(Inkscape::Extension::Extension *mod, SPDocument *doc, std::list<std::string> &params, bool ignore_stderr);
+    bool _change_with_host(SPDocument *doc, std::list<std::string> const &params, bool ignore_stderr);
+    void _report_stderr(Glib::ustring const &data);
+
+    /// Whether the script can serve several invocations from one process, see ScriptHost.
+    bool _persistent = false;
+    std::unique_ptr<ScriptHost> _host;
 
     /**
      * The command that has been derived from
@@ -14,14 +14,34 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
 
 #include <2geom/rect.h>
 #include <2geom/transforms.h>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
 
 #include <png.h>
 
+#ifdef HAVE_TIFF
+#include <tiffio.h>
+#endif
+
 #include "document.h"
 #include "png-write.h"
+#include "preferences.h"
 #include "rdf.h"
 
 #include "display/cairo-utils.h"
@@ -34,6 +54,8 @@
 #include "object/sp-item.h"
 #include "object/sp-root.h"
 
+#include "async/progress.h"
+
 #include "ui/interface.h"
 
 /* This is an example of how to use libpng to read and write PNG files.
@@ -48,13 +70,25 @@
  * working PNG reader/writer, see pngtest.c, included in this distribution.
  */
 
+class RenderAhead;
+class ExportProgress;
+
+/// Size of the squares rendered at a time, as far as the export is large enough.
+static constexpr int EXPORT_TILE_SIZE = 256;
+
+/// Rendered rows kept in memory ahead of the encoder, in bytes, unless a single strip needs more.
+static constexpr std::size_t EXPORT_RENDER_AHEAD_BYTES = 256 << 20;
+
 struct SPEBP {
     unsigned long int width, height, sheight;
     guint32 background;
-    Inkscape::Drawing *drawing; // it is assumed that all unneeded items are hidden
-    guchar *px;
+    Inkscape::Drawing *drawing; // it is assumed that all unneeded items are hidden and it is up to date
+    Geom::IntPoint origin;      // top left corner of the exported area in the drawing
+    int color_type, bit_depth;
     unsigned (*status)(float, void *);
     void *data;
+    RenderAhead *ahead = nullptr; // renders the next strips on other threads, if set
+    ExportProgress *progress = nullptr;
 };
 
 /* write a png file */
@@ -70,6 +104,8 @@ struct SPPNGBD {
 class PngTextList {
 public:
     PngTextList() : count(0), textItems(nullptr) {}
+    PngTextList(PngTextList const &) = delete;
+    PngTextList &operator=(PngTextList const &) = delete;
     ~PngTextList();
 
     void add(gchar const* key, gchar const* text);
@@ -120,8 +156,54 @@ void PngTextList::add(gchar const* key, gchar const* text)
     }
 }
 
+/**
+ * Collect the document metadata that goes into the text chunks of the PNG.
+ */
+static void
+sp_png_text_from_metadata(SPDocument *doc, PngTextList &textList)
+{
+    textList.add("Software", "www.inkscape.org"); // Made by Inkscape comment
+    {
+        const gchar* pngToDc[] = {"Title", "title",
+                               "Author", "creator",
+                               "Description", "description",
+                               //"Copyright", "",
+                               "Creation Time", "date",
+                               //"Disclaimer", "",
+                               //"Warning", "",
+                               "Source", "source"
+                               //"Comment", ""
+        };
+        for (size_t i = 0; i < G_N_ELEMENTS(pngToDc); i += 2) {
+            struct rdf_work_entity_t * entity = rdf_find_entity ( pngToDc[i + 1] );
+            if (entity) {
+                gchar const* data = rdf_get_work_entity(doc, entity);
+                if (data && *data) {
+                    textList.add(pngToDc[i], data);
+                }
+            } else {
+                g_warning("Unable to find entity [%s]", pngToDc[i + 1]);
+            }
+        }
+
+
+        struct rdf_license_t *license =  rdf_get_license(doc, true);
+        if (license) {
+            if (license->name && license->uri) {
+                gchar* tmp = g_strdup_printf("%s %s", license->name, license->uri);
+                textList.add("Copyright", tmp);
+                g_free(tmp);
+            } else if (license->name) {
+                textList.add("Copyright", license->name);
+            } else if (license->uri) {
+                textList.add("Copyright", license->uri);
+            }
+        }
+    }
+}
+
 static bool
-sp_png_write_rgba_striped(SPDocument *doc,
+sp_png_write_rgba_striped(PngTextList &textList,
                           gchar const *filename, unsigned long int width, unsigned long int height, double xdpi, double ydpi,
                           int (* get_rows)(guchar const **rows, void **to_free, int row, int num_rows, void *data, int color_type, int bit_depth),
                           void *data, bool interlace, int color_type, int bit_depth, int zlib)
@@ -207,46 +289,6 @@ sp_png_write_rgba_striped(SPDocument *doc,
         png_set_sBIT(png_ptr, info_ptr, &sig_bit);
     }
 
-    PngTextList textList;
-
-    textList.add("Software", "www.inkscape.org"); // Made by Inkscape comment
-    {
-        const gchar* pngToDc[] = {"Title", "title",
-                               "Author", "creator",
-                               "Description", "description",
-                               //"Copyright", "",
-                               "Creation Time", "date",
-                               //"Disclaimer", "",
-                               //"Warning", "",
-                               "Source", "source"
-                               //"Comment", ""
-        };
-        for (size_t i = 0; i < G_N_ELEMENTS(pngToDc); i += 2) {
-            struct rdf_work_entity_t * entity = rdf_find_entity ( pngToDc[i + 1] );
-            if (entity) {
-                gchar const* data = rdf_get_work_entity(doc, entity);
-                if (data && *data) {
-                    textList.add(pngToDc[i], data);
-                }
-            } else {
-                g_warning("Unable to find entity [%s]", pngToDc[i + 1]);
-            }
-        }
-
-
-        struct rdf_license_t *license =  rdf_get_license(doc, true);
-        if (license) {
-            if (license->name && license->uri) {
-                gchar* tmp = g_strdup_printf("%s %s", license->name, license->uri);
-                textList.add("Copyright", tmp);
-                g_free(tmp);
-            } else if (license->name) {
-                textList.add("Copyright", license->name);
-            } else if (license->uri) {
-                textList.add("Copyright", license->uri);
-            }
-        }
-    }
     if (textList.getCount() > 0) {
         png_set_text(png_ptr, info_ptr, textList.getPtext(), textList.getCount());
     }
@@ -315,59 +357,405 @@ sp_png_write_rgba_striped(SPDocument *doc,
     return true;
 }
 
+bool sp_export_tiff_supported()
+{
+#ifdef HAVE_TIFF
+    return true;
+#else
+    return false;
+#endif
+}
 
+#ifdef HAVE_TIFF
 /**
- *
+ * Write a TIFF file with the same rows as sp_png_write_rgba_striped() would write, switching to
+ * BigTIFF when the image may not fit into 4 GiB.
  */
-static int
-sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, void *data, int color_type, int bit_depth)
+static bool
+sp_tiff_write_striped(PngTextList &textList,
+                      gchar const *filename, unsigned long int width, unsigned long int height, double xdpi, double ydpi,
+                      int (* get_rows)(guchar const **rows, void **to_free, int row, int num_rows, void *data, int color_type, int bit_depth),
+                      void *data, int color_type, int bit_depth, int zlib)
 {
+    g_return_val_if_fail(filename != nullptr, false);
+    g_return_val_if_fail(data != nullptr, false);
+
     struct SPEBP *ebp = (struct SPEBP *) data;
 
-    if (ebp->status) {
-        if (!ebp->status((float) row / ebp->height, ebp->data)) return 0;
+    int const n_fields = 1 + (color_type&2) + (color_type&4)/4;
+    guint64 const row_bytes = ((guint64)n_fields * bit_depth * width + 7) / 8;
+    // Leave room for the directory and strip offsets; few readers support BigTIFF.
+    char const *mode = row_bytes * height > G_GUINT64_CONSTANT(0xF0000000) ? "w8" : "w";
+
+    Inkscape::IO::dump_fopen_call(filename, "T");
+#ifdef _WIN32
+    auto wname = reinterpret_cast<wchar_t *>(g_utf8_to_utf16(filename, -1, nullptr, nullptr, nullptr));
+    TIFF *tif = wname ? TIFFOpenW(wname, mode) : nullptr;
+    g_free(wname);
+#else
+    gchar *native = g_filename_from_utf8(filename, -1, nullptr, nullptr, nullptr);
+    TIFF *tif = native ? TIFFOpen(native, mode) : nullptr;
+    g_free(native);
+#endif
+    if (!tif) {
+        return false;
     }
 
-    num_rows = MIN(num_rows, static_cast<int>(ebp->sheight));
-    num_rows = MIN(num_rows, static_cast<int>(ebp->height - row));
+    TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, (uint32_t)width);
+    TIFFSetField(tif, TIFFTAG_IMAGELENGTH, (uint32_t)height);
+    TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, bit_depth);
+    TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, n_fields);
+    TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+    TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, (color_type&2) ? PHOTOMETRIC_RGB : PHOTOMETRIC_MINISBLACK);
+    if (color_type&4) {
+        uint16_t const extra = EXTRASAMPLE_UNASSALPHA;
+        TIFFSetField(tif, TIFFTAG_EXTRASAMPLES, 1, &extra);
+    }
+    if (zlib > 0) {
+        TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_ADOBE_DEFLATE);
+        TIFFSetField(tif, TIFFTAG_ZIPQUALITY, zlib);
+        if (bit_depth >= 8) {
+            TIFFSetField(tif, TIFFTAG_PREDICTOR, PREDICTOR_HORIZONTAL);
+        }
+    } else {
+        TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
+    }
+    // Strips of about 256 KiB compress well without holding much memory.
+    auto const rows_per_strip = std::clamp<guint64>((1 << 18) / row_bytes, 1, height);
+    TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, (uint32_t)rows_per_strip);
+    TIFFSetField(tif, TIFFTAG_RESOLUTIONUNIT, RESUNIT_INCH);
+    TIFFSetField(tif, TIFFTAG_XRESOLUTION, (float)xdpi);
+    TIFFSetField(tif, TIFFTAG_YRESOLUTION, (float)ydpi);
+
+    static std::map<std::string, int> const text_tags = {
+        {"Software", TIFFTAG_SOFTWARE},
+        {"Title", TIFFTAG_DOCUMENTNAME},
+        {"Author", TIFFTAG_ARTIST},
+        {"Description", TIFFTAG_IMAGEDESCRIPTION},
+        {"Copyright", TIFFTAG_COPYRIGHT},
+    };
+    for (int i = 0; i < textList.getCount(); i++) {
+        auto const &item = textList.getPtext()[i];
+        auto const tag = text_tags.find(item.key);
+        if (tag != text_tags.end()) {
+            TIFFSetField(tif, tag->second, item.text);
+        }
+    }
 
-    /* Set area of interest */
-    // bbox is now set to the entire image to prevent discontinuities
-    // in the image when blur is used (the borders may still be a bit
-    // off, but that's less noticeable).
-    Geom::IntRect bbox = Geom::IntRect::from_xywh(0, row, ebp->width, num_rows);
+    // PNG rows are big-endian; libtiff wants samples in host order.
+    bool const swap = bit_depth == 16 && G_BYTE_ORDER == G_LITTLE_ENDIAN;
+    std::vector<guchar> scanline(row_bytes);
+    auto row_pointers = std::vector<guchar const *>(ebp->sheight);
+    bool ok = true;
+
+    unsigned long r = 0;
+    while (ok && r < height) {
+        void *to_free;
+        int n = get_rows(row_pointers.data(), &to_free, r, height - r, data, color_type, bit_depth);
+        if (!n) break;
+        for (int i = 0; i < n && ok; i++) {
+            std::copy_n(row_pointers[i], row_bytes, scanline.data());
+            if (swap) {
+                for (std::size_t k = 0; k + 1 < row_bytes; k += 2) {
+                    std::swap(scanline[k], scanline[k + 1]);
+                }
+            }
+            ok = TIFFWriteScanline(tif, scanline.data(), r + i, 0) == 1;
+        }
+        g_free(to_free);
+        r += n;
+    }
+
+    TIFFClose(tif);
+    return ok;
+}
+#endif // HAVE_TIFF
 
-    /* Update to renderable state */
-    ebp->drawing->update(bbox);
 
-    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, ebp->width);
-    unsigned char *px = g_new(guchar, num_rows * stride);
+/// Rows of the exported image, converted to the pixel format of the PNG file.
+struct Strip {
+    guchar const *data = nullptr; // to be released with g_free()
+    std::vector<guchar const *> rows;
+};
+
+/// Rendered pixels of a strip, before conversion.
+struct StripPixels {
+    guchar *px;
+    int stride;
+    int num_rows;
+    std::atomic<int> tiles_left;
+};
+
+/**
+ * Render the columns [col, col + num_cols) of the strip starting at @a row. Filters only enlarge
+ * the area rendered by their own margin around the tile, which bounds the memory needed however
+ * wide the export is.
+ */
+static void
+sp_export_render_tile(SPEBP const &ebp, StripPixels &pixels, int row, int col, int num_cols)
+{
+    Geom::IntRect bbox = Geom::IntRect::from_xywh(ebp.origin.x() + col, ebp.origin.y() + row, num_cols, pixels.num_rows);
 
     cairo_surface_t *s = cairo_image_surface_create_for_data(
-        px, CAIRO_FORMAT_ARGB32, ebp->width, num_rows, stride);
+        pixels.px + 4 * col, CAIRO_FORMAT_ARGB32, num_cols, pixels.num_rows, pixels.stride);
     Inkscape::DrawingContext dc(s, bbox.min());
-    dc.setSource(ebp->background);
+    dc.setSource(ebp.background);
     dc.setOperator(CAIRO_OPERATOR_SOURCE);
     dc.paint();
     dc.setOperator(CAIRO_OPERATOR_OVER);
 
     /* Render */
-    ebp->drawing->render(dc, bbox, 0);
+    ebp.drawing->render(dc, bbox, 0);
     cairo_surface_destroy(s);
+}
 
+static Strip
+sp_export_convert_strip(SPEBP const &ebp, StripPixels &pixels)
+{
     // PNG stores data as unpremultiplied big-endian RGBA, which means
     // it's identical to the GdkPixbuf format.
-    convert_pixels_argb32_to_pixbuf(px, ebp->width, num_rows, stride,
-                                    /* RGBA to ARGB with A=0 */ ebp->background >> 8);
-    
+    convert_pixels_argb32_to_pixbuf(pixels.px, ebp.width, pixels.num_rows, pixels.stride,
+                                    /* RGBA to ARGB with A=0 */ ebp.background >> 8);
+
     // If a custom bit depth or color type is asked, then convert rgb to grayscale, etc.
-    const guchar* new_data = pixbuf_to_png(rows, px, num_rows, ebp->width, stride, color_type, bit_depth);
-    *to_free = (void*) new_data;
-    free(px);
+    Strip strip;
+    strip.rows.resize(pixels.num_rows);
+    strip.data = pixbuf_to_png(strip.rows.data(), pixels.px, pixels.num_rows, ebp.width, pixels.stride, ebp.color_type, ebp.bit_depth);
+    g_free(pixels.px);
+    pixels.px = nullptr;
+
+    return strip;
+}
+
+static std::unique_ptr<StripPixels>
+sp_export_alloc_strip(SPEBP const &ebp, int num_rows)
+{
+    int stride = cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, ebp.width);
+    auto pixels = std::make_unique<StripPixels>();
+    pixels->px = g_new(guchar, (gsize)num_rows * stride);
+    pixels->stride = stride;
+    pixels->num_rows = num_rows;
+    pixels->tiles_left = (ebp.width + EXPORT_TILE_SIZE - 1) / EXPORT_TILE_SIZE;
+    return pixels;
+}
+
+static Strip
+sp_export_render_strip(SPEBP const &ebp, int row, int num_rows)
+{
+    auto pixels = sp_export_alloc_strip(ebp, num_rows);
+    for (unsigned long col = 0; col < ebp.width; col += EXPORT_TILE_SIZE) {
+        sp_export_render_tile(ebp, *pixels, row, col, std::min<unsigned long>(EXPORT_TILE_SIZE, ebp.width - col));
+    }
+    return sp_export_convert_strip(ebp, *pixels);
+}
+
+/**
+ * Renders the tiles of the strips of an export on a thread pool ahead of the encoder, so that
+ * rendering runs in parallel and overlaps with compression. Only a window of strips is rendered
+ * ahead, which bounds memory use. The drawing must not change meanwhile.
+ */
+class RenderAhead
+{
+public:
+    RenderAhead(SPEBP const &ebp, boost::asio::thread_pool &pool, int window)
+        : _ebp(ebp)
+        , _pool(pool)
+        , _window(window)
+    {}
+
+    ~RenderAhead()
+    {
+        std::unique_lock lock(_mutex);
+        _cond.wait(lock, [this] { return _in_flight == 0; });
+        for (auto &entry : _strips) {
+            if (entry.second) {
+                g_free((void *) entry.second->data);
+            }
+        }
+    }
+
+    Strip take(int row, int num_rows)
+    {
+        std::unique_lock lock(_mutex);
+        _schedule();
+
+        auto const it = _strips.find(row);
+        if (it == _strips.end()) {
+            // Asked for again, as happens for interlaced images.
+            lock.unlock();
+            return sp_export_render_strip(_ebp, row, num_rows);
+        }
+
+        _cond.wait(lock, [&] { return it->second.has_value(); });
+        auto strip = std::move(*it->second);
+        _strips.erase(it);
+        _schedule();
+        return strip;
+    }
+
+private:
+    void _schedule()
+    {
+        while (_next_row < _ebp.height && _strips.size() < _window) {
+            int const row = _next_row;
+            int const num_rows = std::min(_ebp.sheight, _ebp.height - _next_row);
+            _next_row += num_rows;
+            _strips.emplace(row, std::nullopt);
+            _in_flight++;
+
+            // The last tile to finish converts the strip.
+            std::shared_ptr<StripPixels> pixels = sp_export_alloc_strip(_ebp, num_rows);
+            for (unsigned long col = 0; col < _ebp.width; col += EXPORT_TILE_SIZE) {
+                int const num_cols = std::min<unsigned long>(EXPORT_TILE_SIZE, _ebp.width - col);
+                boost::asio::post(_pool, [this, pixels, row, col, num_cols] {
+                    sp_export_render_tile(_ebp, *pixels, row, col, num_cols);
+                    if (--pixels->tiles_left > 0) {
+                        return;
+                    }
+                    auto strip = sp_export_convert_strip(_ebp, *pixels);
+                    std::lock_guard lock(_mutex);
+                    _strips[row] = std::move(strip);
+                    _in_flight--;
+                    _cond.notify_all();
+                });
+            }
+        }
+    }
+
+    SPEBP const &_ebp;
+    boost::asio::thread_pool &_pool;
+    std::size_t const _window;
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::map<int, std::optional<Strip>> _strips; // by first row; empty while being rendered
+    unsigned long _next_row = 0;
+    int _in_flight = 0;
+};
+
+/**
+ * Shares one Async::Progress between the files of an export, which may be encoded on different
+ * threads, measuring progress in rows written.
+ */
+class ExportProgress
+{
+public:
+    ExportProgress(Inkscape::Async::Progress<double> &progress, double total_rows)
+        : _progress(progress)
+        , _total_rows(total_rows)
+    {}
+
+    /// Count rows about to be written; returns false if cancelled.
+    bool advance(unsigned long rows)
+    {
+        std::lock_guard lock(_mutex);
+        if (!_cancelled) {
+            _rows += rows;
+            _cancelled = !_progress.report(std::min(_rows / _total_rows, 1.0));
+        }
+        return !_cancelled;
+    }
+
+    bool cancelled()
+    {
+        std::lock_guard lock(_mutex);
+        _cancelled = _cancelled || !_progress.keepgoing();
+        return _cancelled;
+    }
+
+private:
+    Inkscape::Async::Progress<double> &_progress;
+    double const _total_rows;
+    double _rows = 0;
+    bool _cancelled = false;
+    std::mutex _mutex;
+};
+
+/**
+ *
+ */
+static int
+sp_export_get_rows(guchar const **rows, void **to_free, int row, int num_rows, void *data, int /*color_type*/, int /*bit_depth*/)
+{
+    struct SPEBP *ebp = (struct SPEBP *) data;
+
+    if (ebp->status) {
+        if (!ebp->status((float) row / ebp->height, ebp->data)) return 0;
+    }
+
+    num_rows = MIN(num_rows, static_cast<int>(ebp->sheight));
+    num_rows = MIN(num_rows, static_cast<int>(ebp->height - row));
+
+    if (ebp->progress && !ebp->progress->advance(num_rows)) {
+        return 0;
+    }
+
+    auto strip = ebp->ahead ? ebp->ahead->take(row, num_rows) : sp_export_render_strip(*ebp, row, num_rows);
+    std::copy(strip.rows.begin(), strip.rows.end(), rows);
+    *to_free = (void *) strip.data;
 
     return num_rows;
 }
 
+static int
+sp_export_numthreads()
+{
+    int const fallback = std::max(1u, std::thread::hardware_concurrency());
+    return Inkscape::Preferences::get()->getIntLimited("/options/threading/numthreads", fallback, 1, 256);
+}
+
+/**
+ * Encode one area of an up-to-date drawing into a PNG (or TIFF) file.
+ *
+ * @param origin Top left corner of the area in the drawing.
+ * @param pool If given, strips are rendered in parallel on it while this thread encodes.
+ */
+static ExportResult
+sp_export_png_area(Inkscape::Drawing &drawing, PngExportJob const &job, Geom::IntPoint const &origin,
+                   PngTextList &textList, unsigned (*status)(float, void *), void *data,
+                   boost::asio::thread_pool *pool = nullptr, int numthreads = 1, ExportProgress *progress = nullptr)
+{
+    struct SPEBP ebp;
+    ebp.width  = job.width;
+    ebp.height = job.height;
+    ebp.sheight = EXPORT_TILE_SIZE;
+    ebp.background = job.bgcolor;
+    ebp.drawing = &drawing;
+    ebp.origin = origin;
+    ebp.color_type = job.color_type;
+    ebp.bit_depth = job.bit_depth;
+    ebp.status = status;
+    ebp.data   = data;
+    ebp.progress = progress;
+
+    std::optional<RenderAhead> ahead;
+    if (pool) {
+        // Keep the threads busy, within the memory budget. Each strip is held twice, before and
+        // after conversion.
+        std::size_t const strip_bytes = 8 * ebp.width * ebp.sheight;
+        int const window = std::clamp<std::size_t>(EXPORT_RENDER_AHEAD_BYTES / strip_bytes, 1, 2 * numthreads);
+        ahead.emplace(ebp, *pool, window);
+        ebp.ahead = &*ahead;
+    }
+
+    bool write_status = false;
+    if (job.tiff) {
+#ifdef HAVE_TIFF
+        write_status = sp_tiff_write_striped(textList, job.filename.c_str(), job.width, job.height, job.xdpi, job.ydpi,
+                                             sp_export_get_rows, &ebp, job.color_type, job.bit_depth, job.zlib);
+#else
+        g_warning("Unable to export %s: built without TIFF support.", job.filename.c_str());
+#endif
+    } else {
+        write_status = sp_png_write_rgba_striped(textList, job.filename.c_str(), job.width, job.height, job.xdpi, job.ydpi,
+                                                 sp_export_get_rows, &ebp, job.interlace, job.color_type, job.bit_depth, job.zlib);
+    }
+    if (progress && progress->cancelled()) {
+        return EXPORT_ABORTED;
+    }
+    return write_status ? EXPORT_OK : EXPORT_ERROR;
+}
+
 ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
                                 double x0, double y0, double x1, double y1,
                                 unsigned long int width, unsigned long int height, double xdpi, double ydpi,
@@ -429,11 +817,6 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
                             * Geom::Scale(width / area.width(),
                                         height / area.height()));
 
-    struct SPEBP ebp;
-    ebp.width  = width;
-    ebp.height = height;
-    ebp.background = bgcolor;
-
     /* Create new drawing */
     Inkscape::Drawing drawing;
     unsigned const dkey = SPItem::display_key_new(1);
@@ -442,33 +825,156 @@ ExportResult sp_export_png_file(SPDocument *doc, gchar const *filename,
     drawing.setExact(); // export with maximum blur rendering quality
     drawing.setAntialiasingOverride(static_cast<Inkscape::Antialiasing>(antialiasing));
 
-    ebp.drawing = &drawing;
-
     // We show all and then hide all items we don't want, instead of showing only requested items,
     // because that would not work if the shown item references something in defs
     if (!items_only.empty()) {
         doc->getRoot()->invoke_hide_except(dkey, items_only);
     }
 
-    ebp.status = status;
-    ebp.data   = data;
-
-    bool write_status = false;;
-
-    ebp.sheight = 64;
-    ebp.px = g_try_new(guchar, 4 * ebp.sheight * width);
+    /* Update to renderable state */
+    drawing.update(Geom::IntRect::from_xywh(0, 0, width, height));
 
-    if (ebp.px) {
-        write_status = sp_png_write_rgba_striped(doc, filename, width, height, xdpi, ydpi, sp_export_get_rows, &ebp, interlace, color_type, bit_depth, zlib);
-        g_free(ebp.px);
+    PngTextList textList;
+    sp_png_text_from_metadata(doc, textList);
+
+    PngExportJob job;
+    job.filename = filename;
+    job.width = width;
+    job.height = height;
+    job.xdpi = xdpi;
+    job.ydpi = ydpi;
+    job.bgcolor = bgcolor;
+    job.interlace = interlace;
+    job.color_type = color_type;
+    job.bit_depth = bit_depth;
+    job.zlib = zlib;
+
+    ExportResult result;
+    if (status) {
+        // The progress callback may run the main loop, which could change the document under
+        // the feet of render threads.
+        result = sp_export_png_area(drawing, job, {0, 0}, textList, status, data);
+    } else {
+        int const numthreads = sp_export_numthreads();
+        boost::asio::thread_pool pool(numthreads);
+        result = sp_export_png_area(drawing, job, {0, 0}, textList, nullptr, nullptr, &pool, numthreads);
     }
 
     // Hide items, this releases arenaitem
     doc->getRoot()->invoke_hide(dkey);
 
-    return write_status ? EXPORT_OK : EXPORT_ERROR;
+    return result;
 }
 
+std::vector<ExportResult> sp_export_png_files(SPDocument *doc, std::vector<PngExportJob> const &jobs,
+                                              Inkscape::Async::Progress<double> *progress)
+{
+    std::vector<ExportResult> results(jobs.size(), EXPORT_ERROR);
+    g_return_val_if_fail(doc != nullptr, results);
+
+    std::optional<ExportProgress> shared_progress;
+    if (progress) {
+        double total_rows = 0;
+        for (auto const &job : jobs) {
+            total_rows += job.height * (job.interlace && !job.tiff ? 7 : 1); // Adam7 makes seven passes.
+        }
+        shared_progress.emplace(*progress, std::max(total_rows, 1.0));
+    }
+
+    doc->ensureUpToDate();
+
+    PngTextList textList;
+    sp_png_text_from_metadata(doc, textList);
+
+    // Jobs can share a drawing if they use the same scale and the same fraction of a pixel
+    // offset, so that each of them covers a whole-pixel area of the drawing.
+    struct Group {
+        Geom::Scale scale;
+        Geom::Point offset;
+        int antialiasing;
+        std::vector<SPItem const *> const *items_only;
+        std::vector<std::size_t> jobs;
+    };
+    std::vector<Group> groups;
+    std::vector<Geom::IntPoint> origins;
+
+    for (std::size_t i = 0; i < jobs.size(); i++) {
+        auto const &job = jobs[i];
+        if (job.width < 1 || job.height < 1 || job.area.hasZeroArea()) {
+            origins.emplace_back(0, 0);
+            continue;
+        }
+        auto const scale = Geom::Scale(job.width / job.area.width(), job.height / job.area.height());
+        auto const corner = job.area.min() * scale;
+        auto const origin = corner.floor();
+        auto const offset = corner - Geom::Point(origin);
+        origins.emplace_back(origin);
+
+        auto const group = std::find_if(groups.begin(), groups.end(), [&] (Group const &g) {
+            return Geom::are_near(g.scale[Geom::X], scale[Geom::X]) && Geom::are_near(g.scale[Geom::Y], scale[Geom::Y])
+                && Geom::are_near(g.offset, offset) && g.antialiasing == job.antialiasing && *g.items_only == job.items_only;
+        });
+        if (group != groups.end()) {
+            group->jobs.emplace_back(i);
+        } else {
+            groups.push_back({scale, offset, job.antialiasing, &job.items_only, {i}});
+        }
+    }
+
+    int const numthreads = sp_export_numthreads();
+    boost::asio::thread_pool pool(numthreads);
+
+    // Drawings are built and released on this thread, one at a time, while the object tree is
+    // left alone; only rendering and encoding run on the pool.
+    for (auto const &group : groups) {
+        if (shared_progress && shared_progress->cancelled()) {
+            for (auto i : group.jobs) {
+                results[i] = EXPORT_ABORTED;
+            }
+            continue;
+        }
+
+        Inkscape::Drawing drawing;
+        unsigned const dkey = SPItem::display_key_new(1);
+        drawing.setRoot(doc->getRoot()->invoke_show(drawing, dkey, SP_ITEM_SHOW_DISPLAY));
+        drawing.root()->setTransform(group.scale * Geom::Translate(-group.offset));
+        drawing.setExact(); // export with maximum blur rendering quality
+        drawing.setAntialiasingOverride(static_cast<Inkscape::Antialiasing>(group.antialiasing));
+        if (!group.items_only->empty()) {
+            doc->getRoot()->invoke_hide_except(dkey, *group.items_only);
+        }
+
+        Geom::OptIntRect bounds;
+        for (auto i : group.jobs) {
+            bounds.unionWith(Geom::IntRect::from_xywh(origins[i].x(), origins[i].y(), jobs[i].width, jobs[i].height));
+        }
+        drawing.update(*bounds);
+
+        if (group.jobs.size() == 1) {
+            // Split a lone job into strips rendered in parallel.
+            auto const i = group.jobs.front();
+            results[i] = sp_export_png_area(drawing, jobs[i], origins[i], textList, nullptr, nullptr, &pool, numthreads,
+                                            shared_progress ? &*shared_progress : nullptr);
+        } else {
+            std::vector<std::future<ExportResult>> futures;
+            for (auto i : group.jobs) {
+                auto task = std::make_shared<std::packaged_task<ExportResult ()>>([&, i] {
+                    return sp_export_png_area(drawing, jobs[i], origins[i], textList, nullptr, nullptr, nullptr, 1,
+                                              shared_progress ? &*shared_progress : nullptr);
+                });
+                futures.emplace_back(task->get_future());
+                boost::asio::post(pool, [task] { (*task)(); });
+            }
+            for (std::size_t k = 0; k < futures.size(); k++) {
+                results[group.jobs[k]] = futures[k].get();
+            }
+        }
+
+        doc->getRoot()->invoke_hide(dkey);
+    }
+
+    return results;
+}
 
 /*
   Local Variables:
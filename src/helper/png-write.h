@@ -16,13 +16,18 @@
  */
 
 #include <glib.h> // Only for gchar.
+#include <string>
 #include <vector>
 
-#include <2geom/forward.h>
+#include <2geom/rect.h>
 
 class SPDocument;
 class SPItem;
 
+namespace Inkscape::Async {
+template <typename... T> class Progress;
+} // namespace Inkscape::Async
+
 enum ExportResult {
     EXPORT_ERROR = 0,
     EXPORT_OK,
@@ -70,4 +75,41 @@ ExportResult sp_export_png_file(SPDocument *doc,
                                 int zlib = 6,
                                 int antialiasing = 2);
 
+/// One area to export with sp_export_png_files().
+struct PngExportJob
+{
+    std::string filename;
+    Geom::Rect area; ///< In document coordinates.
+    unsigned long int width = 0;
+    unsigned long int height = 0;
+    double xdpi = 96.0;
+    double ydpi = 96.0;
+    unsigned long bgcolor = 0;
+    std::vector<SPItem const *> items_only;
+    bool interlace = false;
+    int color_type = 6;
+    int bit_depth = 8;
+    int zlib = 6;
+    int antialiasing = 2;
+    bool tiff = false; ///< Write a TIFF file instead, BigTIFF if needed; see sp_export_tiff_supported().
+};
+
+/// Whether TIFF files can be written, which needs libtiff at build time.
+bool sp_export_tiff_supported();
+
+/**
+ * Export several areas of a document to PNG files at once, e.g. its pages or the objects of a
+ * sprite sheet. Files are rendered and encoded on worker threads, and jobs at the same scale
+ * that hide the same items share one drawing of the document. Existing files are overwritten.
+ *
+ * Images are rendered in tiles of bounded size and streamed to the encoder, so even very large
+ * exports only need memory for a few rows of tiles.
+ *
+ * @param progress If given, receives the fraction done from worker threads, one call at a time,
+ *                 and can cancel the remaining jobs, which then end as EXPORT_ABORTED.
+ * @return The result of each job, in order.
+ */
+std::vector<ExportResult> sp_export_png_files(SPDocument *doc, std::vector<PngExportJob> const &jobs,
+                                              Inkscape::Async::Progress<double> *progress = nullptr);
+
 #endif // SEEN_SP_PNG_WRITE_H
@@ -41,6 +41,7 @@
 # include "config.h"      // Defines ENABLE_NLS
 #endif
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
@@ -92,6 +93,7 @@
 #include "extension/init.h"
 #include "extension/input.h"
 #include "inkgc/gc-core.h"          // Garbage Collecting init
+#include "io/export-server.h"       // Export jobs (command line).
 #include "io/file.h"                // File open (command line).
 #include "io/fix-broken-links.h"    // Fix up references.
 #include "io/resource.h"            // TEMPLATE
@@ -739,6 +741,9 @@ InkscapeApplication::InkscapeApplication()
     gapp->add_main_option_entry(T::OptionType::STRING,   "export-png-compression", '\0', N_("Compression level for PNG export (0 to 9); default is 6"), N_("LEVEL"));
     // FIXME: Antialias should really be an INT, but an upstream bug means 0 is detected as NULL
     gapp->add_main_option_entry(T::OptionType::STRING,   "export-png-antialias",   '\0', N_("Antialias level for PNG export (0 to 3); default is 2"),   N_("LEVEL"));
+    gapp->add_main_option_entry(T::OptionType::BOOL,     "export-server",         '\0', N_("Keep running and export the files of jobs read as JSON lines from standard input"), "");
+    gapp->add_main_option_entry(T::OptionType::FILENAME, "export-server-socket",  '\0', N_("Read export jobs from connections to this UNIX socket instead of standard input"), N_("FILENAME"));
+    gapp->add_main_option_entry(T::OptionType::INT,      "export-server-workers", '\0', N_("Number of processes serving the export socket; default is the number of CPUs"), N_("COUNT"));
 
     // Query - Geometry
     _start_main_option_section(_("Query object/document geometry"));
@@ -1035,6 +1040,21 @@ InkscapeApplication::on_activate()
 {
     std::string output;
 
+    if (_use_export_server) {
+        startup_close();
+        Inkscape::IO::ExportServer server(_file_export);
+        if (_export_server_socket.empty()) {
+            server.serveStdio();
+        } else {
+            int workers = _export_server_workers;
+            if (workers <= 0) {
+                workers = std::max(1u, std::thread::hardware_concurrency());
+            }
+            server.serveSocket(_export_server_socket, workers);
+        }
+        return;
+    }
+
     // Create new document, either from pipe or from template.
     SPDocument *document = nullptr;
     auto prefs = Inkscape::Preferences::get();
@@ -1534,7 +1554,9 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
         options->contains("action-list")           ||
         options->contains("actions")               ||
         options->contains("actions-file")          ||
-        options->contains("shell")
+        options->contains("shell")                 ||
+        options->contains("export-server")         ||
+        options->contains("export-server-socket")
         ) {
         _with_gui = false;
     }
@@ -1550,6 +1572,11 @@ InkscapeApplication::on_handle_local_options(const Glib::RefPtr<Glib::VariantDic
     if (options->contains("batch-process"))  _batch_process = true;
     if (options->contains("shell"))          _use_shell = true;
     if (options->contains("pipe"))           _use_pipe  = true;
+    if (options->contains("export-server") || options->contains("export-server-socket")) {
+        _use_export_server = true;
+        options->lookup_value("export-server-socket", _export_server_socket);
+        options->lookup_value("export-server-workers", _export_server_workers);
+    }
 
     // Enable auto-export
     if (options->contains("export-filename")  ||
@@ -22,6 +22,7 @@
 
 #include "inkscape-application.h"
 #include "path-prefix.h"
+#include "io/export-server.h"
 #include "io/resource.h"
 #include "util/statics.h"
 
@@ -209,6 +210,9 @@ int main(int argc, char *argv[])
     set_themes_env();
     set_extensions_env();
 
+    // Workers of the export service are started with the same command line.
+    Inkscape::IO::ExportServer::setCommandLine(argc, argv);
+
     auto ret = InkscapeApplication().gio_app()->run(argc, argv);
 
     Inkscape::Util::StaticsBin::get().destroy();
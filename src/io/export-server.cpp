@@ -0,0 +1,654 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Long-running export service for batch conversions.
+ */
+
+#include "export-server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <giomm/file.h>
+#include <glib/gstdio.h>
+#include <glibmm/miscutils.h>
+#include <glibmm/spawn.h>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "document.h"
+#include "io/file.h"
+
+namespace Inkscape::IO {
+
+std::vector<std::string> ExportServer::_command_line;
+
+namespace {
+
+/// Tells a worker process started by serveSocket() which descriptor to accept connections on.
+constexpr char const *WORKER_FD_VARIABLE = "INKSCAPE_EXPORT_SERVER_FD";
+
+/// A problem with a job, reported back to the client.
+struct JobError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+struct Value
+{
+    enum Type { STRING, NUMBER, BOOLEAN, NONE } type = NONE;
+    std::string text; ///< The unescaped string, or the literal as written.
+    double number = 0.0;
+};
+
+struct Field
+{
+    std::string key;
+    Value value;
+
+    std::string const &string() const
+    {
+        if (value.type != Value::STRING) {
+            throw JobError("\"" + key + "\" must be a string");
+        }
+        return value.text;
+    }
+
+    double number() const
+    {
+        if (value.type != Value::NUMBER) {
+            throw JobError("\"" + key + "\" must be a number");
+        }
+        return value.number;
+    }
+
+    int integer() const { return static_cast<int>(number()); }
+
+    bool flag() const
+    {
+        if (value.type != Value::BOOLEAN) {
+            throw JobError("\"" + key + "\" must be true or false");
+        }
+        return value.text == "true";
+    }
+};
+
+/**
+ * Just enough JSON for jobs: a single object whose values are strings, numbers, booleans or null.
+ */
+class JobParser
+{
+public:
+    explicit JobParser(std::string_view text)
+        : _p(text.data())
+        , _end(text.data() + text.size())
+    {}
+
+    std::vector<Field> parse()
+    {
+        std::vector<Field> fields;
+        _expect('{');
+        if (_peek() == '}') {
+            _p++;
+        } else {
+            while (true) {
+                auto key = _string();
+                _expect(':');
+                fields.push_back({std::move(key), _value()});
+                if (_peek() == ',') {
+                    _p++;
+                    continue;
+                }
+                _expect('}');
+                break;
+            }
+        }
+        if (_peek() != '\0') {
+            throw JobError("trailing characters after the job");
+        }
+        return fields;
+    }
+
+private:
+    char _peek()
+    {
+        while (_p < _end && g_ascii_isspace(*_p)) {
+            _p++;
+        }
+        return _p < _end ? *_p : '\0';
+    }
+
+    void _expect(char c)
+    {
+        if (_peek() != c) {
+            throw JobError(std::string("expected '") + c + "' in job");
+        }
+        _p++;
+    }
+
+    unsigned _hex4()
+    {
+        if (_end - _p < 4) {
+            throw JobError("truncated \\u escape in job");
+        }
+        unsigned code = 0;
+        for (int i = 0; i < 4; i++) {
+            int const digit = g_ascii_xdigit_value(*_p++);
+            if (digit < 0) {
+                throw JobError("invalid \\u escape in job");
+            }
+            code = code * 16 + digit;
+        }
+        return code;
+    }
+
+    std::string _string()
+    {
+        _expect('"');
+        std::string result;
+        while (true) {
+            if (_p == _end) {
+                throw JobError("unterminated string in job");
+            }
+            char const c = *_p++;
+            if (c == '"') {
+                return result;
+            }
+            if (c != '\\') {
+                result += c;
+                continue;
+            }
+            if (_p == _end) {
+                throw JobError("unterminated string in job");
+            }
+            switch (char const escape = *_p++) {
+                case 'b': result += '\b'; break;
+                case 'f': result += '\f'; break;
+                case 'n': result += '\n'; break;
+                case 'r': result += '\r'; break;
+                case 't': result += '\t'; break;
+                case 'u': {
+                    gunichar code = _hex4();
+                    if (code >= 0xd800 && code < 0xdc00 && _end - _p >= 6 && _p[0] == '\\' && _p[1] == 'u') {
+                        _p += 2;
+                        code = 0x10000 + ((code - 0xd800) << 10) + (_hex4() - 0xdc00);
+                    }
+                    char utf8[6];
+                    result.append(utf8, g_unichar_to_utf8(code, utf8));
+                    break;
+                }
+                default:
+                    result += escape;
+                    break;
+            }
+        }
+    }
+
+    Value _value()
+    {
+        Value value;
+        auto const c = _peek();
+        if (c == '"') {
+            value.type = Value::STRING;
+            value.text = _string();
+            return value;
+        }
+
+        auto const start = _p;
+        while (_p < _end && (g_ascii_isalnum(*_p) || *_p == '-' || *_p == '+' || *_p == '.')) {
+            _p++;
+        }
+        value.text.assign(start, _p);
+
+        if (value.text == "true" || value.text == "false") {
+            value.type = Value::BOOLEAN;
+        } else if (value.text == "null") {
+            value.type = Value::NONE;
+        } else {
+            char *end = nullptr;
+            value.number = g_ascii_strtod(value.text.c_str(), &end);
+            if (value.text.empty() || *end != '\0') {
+                throw JobError("invalid value in job");
+            }
+            value.type = Value::NUMBER;
+        }
+        return value;
+    }
+
+    char const *_p;
+    char const *_end;
+};
+
+void append_string(std::string &out, std::string_view text)
+{
+    out += '"';
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    g_snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+                break;
+        }
+    }
+    out += '"';
+}
+
+using Setter = void (*)(InkFileExportCmd &, Field const &);
+
+/// The command line export options that jobs may set, under the same names.
+std::unordered_map<std::string_view, Setter> const job_options = {
+    {"export-filename",           [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_filename = f.string(); }},
+    {"export-overwrite",          [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_overwrite = f.flag(); }},
+    {"export-type",               [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_type = f.string(); }},
+    {"export-extension",          [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_extension = Glib::ustring(f.string()).lowercase(); }},
+    {"export-page",               [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_page = f.string(); }},
+    {"export-area",               [] (InkFileExportCmd &cmd, Field const &f) { cmd.set_export_area(f.string()); }},
+    {"export-area-page",          [] (InkFileExportCmd &cmd, Field const &f) { if (f.flag()) cmd.set_export_area_type(ExportAreaType::Page); }},
+    {"export-area-drawing",       [] (InkFileExportCmd &cmd, Field const &f) { if (f.flag()) cmd.set_export_area_type(ExportAreaType::Drawing); }},
+    {"export-area-snap",          [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_area_snap = f.flag(); }},
+    {"export-margin",             [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_margin = f.integer(); }},
+    {"export-dpi",                [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_dpi = f.number(); }},
+    {"export-width",              [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_width = f.integer(); }},
+    {"export-height",             [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_height = f.integer(); }},
+    {"export-id",                 [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_id = f.string(); }},
+    {"export-id-only",            [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_id_only = f.flag(); }},
+    {"export-plain-svg",          [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_plain_svg = f.flag(); }},
+    {"export-ps-level",           [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_ps_level = f.integer(); }},
+    {"export-pdf-version",        [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_pdf_level = f.string(); }},
+    {"export-text-to-path",       [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_text_to_path = f.flag(); }},
+    {"export-latex",              [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_latex = f.flag(); }},
+    {"export-ignore-filters",     [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_ignore_filters = f.flag(); }},
+    {"export-use-hints",          [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_use_hints = f.flag(); }},
+    {"export-background",         [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_background = f.string(); }},
+    {"export-background-opacity", [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_background_opacity = f.number(); }},
+    {"export-png-color-mode",     [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_png_color_mode = f.string(); }},
+    {"export-png-use-dithering",  [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_png_use_dithering = f.flag(); }},
+    {"export-png-compression",    [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_png_compression = f.integer(); }},
+    {"export-png-antialias",      [] (InkFileExportCmd &cmd, Field const &f) { cmd.export_png_antialias = f.integer(); }},
+};
+
+/**
+ * Whether the job only renders the document, so that it can run on the cached document itself.
+ * All other exports may modify the document (fitting the page, converting text) and get a copy.
+ */
+bool renders_only(InkFileExportCmd const &cmd)
+{
+    if (!cmd.export_extension.empty()) {
+        return false;
+    }
+    if (cmd.export_use_hints) {
+        return true;
+    }
+
+    auto type = cmd.export_type.raw();
+    if (type.empty()) {
+        auto const dot = cmd.export_filename.find_last_of('.');
+        if (dot == std::string::npos || cmd.export_filename.find_first_of("/\\", dot) != std::string::npos) {
+            return false;
+        }
+        type = cmd.export_filename.substr(dot + 1);
+    }
+    return g_ascii_strcasecmp(type.c_str(), "png") == 0;
+}
+
+bool is_blank(std::string const &line)
+{
+    return std::all_of(line.begin(), line.end(), [] (char c) { return g_ascii_isspace(c); });
+}
+
+} // namespace
+
+ExportServer::ExportServer(InkFileExportCmd defaults)
+    : _defaults(std::move(defaults))
+{
+}
+
+ExportServer::~ExportServer() = default;
+
+std::string ExportServer::handle(std::string const &line)
+{
+    auto const start = std::chrono::steady_clock::now();
+    _jobs++;
+
+    std::string reply = "{";
+    try {
+        auto const fields = JobParser(line).parse();
+
+        // Echo the id first, so that even a job with a bad option can be told apart.
+        for (auto const &field : fields) {
+            if (field.key == "id") {
+                reply += "\"id\": ";
+                if (field.value.type == Value::STRING) {
+                    append_string(reply, field.value.text);
+                } else {
+                    reply += field.value.text;
+                }
+                reply += ", ";
+                break;
+            }
+        }
+
+        auto cmd = _defaults;
+        std::string input;
+        for (auto const &field : fields) {
+            if (field.key == "id") {
+                continue;
+            } else if (field.key == "input") {
+                input = field.string();
+            } else if (auto const it = job_options.find(field.key); it != job_options.end()) {
+                it->second(cmd, field);
+            } else {
+                throw JobError("unknown option \"" + field.key + "\"");
+            }
+        }
+
+        if (input.empty()) {
+            throw JobError("no \"input\" given");
+        }
+        if (cmd.export_filename == "-") {
+            throw JobError("cannot export to standard output in server mode");
+        }
+
+        auto const path = Gio::File::create_for_commandline_arg(input)->get_path();
+        auto const document = _load(path);
+        int failed;
+        if (renders_only(cmd)) {
+            failed = cmd.do_export(document, path);
+        } else {
+            auto const copy = document->copy();
+            failed = cmd.do_export(copy.get(), path);
+        }
+        if (failed) {
+            throw JobError("export failed, see the error output for details");
+        }
+
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+        char seconds[G_ASCII_DTOSTR_BUF_SIZE];
+        reply += "\"ok\": true, \"seconds\": ";
+        reply += g_ascii_formatd(seconds, sizeof(seconds), "%.3f", elapsed.count());
+    } catch (JobError const &e) {
+        reply += "\"ok\": false, \"error\": ";
+        append_string(reply, e.what());
+    } catch (Glib::Error const &e) {
+        // From opening the document or writing the export; the service goes on regardless.
+        reply += "\"ok\": false, \"error\": ";
+        append_string(reply, e.what());
+    } catch (std::exception const &e) {
+        reply += "\"ok\": false, \"error\": ";
+        append_string(reply, e.what());
+    }
+    reply += "}";
+    return reply;
+}
+
+/**
+ * Get a document from the cache, or load it if it isn't there or changed on disk since.
+ */
+SPDocument *ExportServer::_load(std::string const &path)
+{
+    GStatBuf info;
+    if (g_stat(path.c_str(), &info) != 0) {
+        throw JobError("cannot read " + path);
+    }
+
+    auto it = _documents.find(path);
+    if (it != _documents.end() && it->second.mtime == info.st_mtime && it->second.size == info.st_size) {
+        it->second.last_used = _jobs;
+        return it->second.document.get();
+    }
+
+    auto document = ink_file_open(Gio::File::create_for_path(path)).first;
+    if (!document) {
+        throw JobError("failed to open " + path);
+    }
+    document->ensureUpToDate();
+
+    if (it == _documents.end()) {
+        if (_documents.size() >= MAX_DOCUMENTS) {
+            _documents.erase(std::min_element(_documents.begin(), _documents.end(), [] (auto const &a, auto const &b) {
+                return a.second.last_used < b.second.last_used;
+            }));
+        }
+        it = _documents.emplace(path, CachedDocument{}).first;
+    }
+    it->second = CachedDocument{std::move(document), info.st_mtime, info.st_size, _jobs};
+    return it->second.document.get();
+}
+
+int ExportServer::serveStdio()
+{
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (!is_blank(line)) {
+            std::cout << handle(line) << std::endl;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+void ExportServer::setCommandLine(int argc, char const *const *argv)
+{
+    _command_line.assign(argv, argv + argc);
+}
+
+#ifndef _WIN32
+
+namespace {
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+extern "C" void request_stop(int)
+{
+    stop_requested = 1;
+}
+
+bool write_all(int fd, std::string const &data)
+{
+    std::size_t done = 0;
+    while (done < data.size()) {
+        auto const written = write(fd, data.data() + done, data.size() - done);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        done += written;
+    }
+    return true;
+}
+
+} // namespace
+
+void ExportServer::_serveConnection(int fd)
+{
+    std::string buffer;
+    char chunk[4096];
+    while (true) {
+        auto const count = read(fd, chunk, sizeof(chunk));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return;
+        }
+        buffer.append(chunk, count);
+
+        std::size_t start = 0;
+        for (auto newline = buffer.find('\n'); newline != std::string::npos; newline = buffer.find('\n', start)) {
+            auto const line = buffer.substr(start, newline - start);
+            start = newline + 1;
+            if (!is_blank(line) && !write_all(fd, handle(line) + '\n')) {
+                return;
+            }
+        }
+        buffer.erase(0, start);
+    }
+}
+
+void ExportServer::_serveWorker(int fd)
+{
+    std::signal(SIGPIPE, SIG_IGN);
+    while (true) {
+        int const connection = accept(fd, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+        _serveConnection(connection);
+        close(connection);
+    }
+}
+
+int ExportServer::serveSocket(std::string const &path, int workers)
+{
+    if (auto const worker_fd = Glib::getenv(WORKER_FD_VARIABLE); !worker_fd.empty()) {
+        _serveWorker(std::atoi(worker_fd.c_str()));
+        return EXIT_FAILURE;
+    }
+    if (_command_line.empty()) {
+        std::cerr << "ExportServer: the command line to start workers with is unknown" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "ExportServer: socket path is too long: " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        std::cerr << "ExportServer: cannot listen on " << path << ": " << g_strerror(errno) << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return EXIT_FAILURE;
+    }
+
+    // Without SA_RESTART, so that waitpid() below returns on a stop request.
+    struct sigaction action{};
+    action.sa_handler = request_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+
+    // Workers are fresh processes running the same command line, which inherit the socket. This
+    // process may already have GLib and GIO threads, so forking it without exec is not safe.
+    std::vector<std::string> envp;
+    for (auto const &name : Glib::listenv()) {
+        if (name != WORKER_FD_VARIABLE) {
+            envp.emplace_back(name + "=" + Glib::getenv(name));
+        }
+    }
+    envp.emplace_back(std::string(WORKER_FD_VARIABLE) + "=" + std::to_string(fd));
+
+    auto const spawn = [&] {
+        Glib::Pid pid = 0;
+        try {
+            Glib::spawn_async("", _command_line, envp,
+                              Glib::SpawnFlags::DO_NOT_REAP_CHILD | Glib::SpawnFlags::LEAVE_DESCRIPTORS_OPEN,
+                              {}, &pid);
+        } catch (Glib::Error const &e) {
+            std::cerr << "ExportServer: cannot start a worker: " << e.what() << std::endl;
+            return Glib::Pid(-1);
+        }
+        return pid;
+    };
+
+    std::vector<pid_t> children;
+    for (int i = 0; i < std::max(workers, 1); i++) {
+        if (auto const pid = spawn(); pid > 0) {
+            children.push_back(pid);
+        }
+    }
+    std::cerr << "ExportServer: listening on " << path << " with " << children.size() << " workers" << std::endl;
+
+    while (!stop_requested && !children.empty()) {
+        int status = 0;
+        auto const pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        auto const it = std::find(children.begin(), children.end(), pid);
+        if (it == children.end()) {
+            continue;
+        }
+        // A job that crashes its worker must not take the service down with it.
+        if (WIFSIGNALED(status) && !stop_requested) {
+            std::cerr << "ExportServer: worker " << pid << " died, starting a new one" << std::endl;
+            if (auto const replacement = spawn(); replacement > 0) {
+                *it = replacement;
+                continue;
+            }
+        }
+        children.erase(it);
+    }
+
+    for (auto pid : children) {
+        kill(pid, SIGTERM);
+    }
+    for (auto pid : children) {
+        waitpid(pid, nullptr, 0);
+    }
+    close(fd);
+    unlink(path.c_str());
+    return EXIT_SUCCESS;
+}
+
+#else
+
+void ExportServer::_serveConnection(int)
+{
+}
+
+int ExportServer::serveSocket(std::string const &, int)
+{
+    std::cerr << "ExportServer: sockets are not supported on this platform, pass jobs on standard input instead." << std::endl;
+    return EXIT_FAILURE;
+}
+
+#endif
+
+} // namespace Inkscape::IO
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
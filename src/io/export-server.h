@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Long-running export service for batch conversions.
+ */
+
+#ifndef INKSCAPE_IO_EXPORT_SERVER_H
+#define INKSCAPE_IO_EXPORT_SERVER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glib.h>
+
+#include "io/file-export-cmd.h"
+
+class SPDocument;
+
+namespace Inkscape::IO {
+
+/**
+ * Runs export jobs in a process that stays up, so that fonts, extensions, color profiles and
+ * recently used documents (with the documents they link to) are loaded only once instead of
+ * once per file.
+ *
+ * Jobs are JSON objects, one per line, with the input file and any of the --export-* command
+ * line options, which default to those given on the command line:
+ *
+ *     {"id": 42, "input": "in.svg", "export-filename": "out.png", "export-dpi": 192}
+ *
+ * Each job is answered with one line, echoing "id" if present:
+ *
+ *     {"id": 42, "ok": true, "seconds": 0.153}
+ *     {"id": 42, "ok": false, "error": "..."}
+ */
+class ExportServer
+{
+public:
+    explicit ExportServer(InkFileExportCmd defaults);
+    ~ExportServer();
+
+    /// Serve jobs from standard input, in order, until it is closed.
+    int serveStdio();
+
+    /**
+     * Listen on a UNIX domain socket, where each connection carries jobs like standard input.
+     * Connections are served concurrently by @a workers processes, each started with the
+     * command line given to setCommandLine() and inheriting the socket.
+     */
+    int serveSocket(std::string const &path, int workers);
+
+    /// Remember the command line of Inkscape, to start the workers of serveSocket() with.
+    static void setCommandLine(int argc, char const *const *argv);
+
+    /// Run the job on one line of input and return the reply line, without newline.
+    std::string handle(std::string const &line);
+
+private:
+    struct CachedDocument
+    {
+        std::unique_ptr<SPDocument> document;
+        gint64 mtime = 0;
+        gint64 size = 0;
+        std::size_t last_used = 0;
+    };
+
+    SPDocument *_load(std::string const &path);
+    void _serveConnection(int fd);
+    void _serveWorker(int fd);
+
+    static std::vector<std::string> _command_line;
+
+    InkFileExportCmd _defaults;
+    std::unordered_map<std::string, CachedDocument> _documents;
+    std::size_t _jobs = 0;
+
+    /// Number of parsed documents kept around for later jobs on the same file.
+    static constexpr std::size_t MAX_DOCUMENTS = 8;
+};
+
+} // namespace Inkscape::IO
+
+#endif // INKSCAPE_IO_EXPORT_SERVER_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
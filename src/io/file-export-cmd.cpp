@@ -14,7 +14,9 @@
 
 #include "file-export-cmd.h"
 
+#include <cstdio>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <boost/algorithm/string.hpp>
 #include <giomm/file.h>
@@ -23,7 +25,13 @@
 #include <glibmm/miscutils.h>
 #include <glibmm/regex.h>
 #include <png.h> // PNG export
+#ifdef _WIN32
+#include <io.h> // _isatty
+#else
+#include <unistd.h> // isatty
+#endif
 
+#include "async/progress.h"
 #include "colors/color.h"
 #include "colors/manager.h"
 #include "document.h"
@@ -56,6 +64,49 @@ namespace filesystem = std::filesystem;
 namespace filesystem = boost::filesystem;
 #endif
 
+namespace {
+
+/**
+ * Shows how far a raster export has come on a terminal. Reports arrive from the threads of the
+ * export, one at a time.
+ */
+class ConsoleProgress final : public Inkscape::Async::Progress<double>
+{
+public:
+    ~ConsoleProgress()
+    {
+        if (_percent >= 0) {
+            std::cerr << std::endl;
+        }
+    }
+
+private:
+    int _percent = -1;
+
+    bool _keepgoing() const override { return true; }
+
+    bool _report(double const &fraction) override
+    {
+        int const percent = fraction * 100;
+        if (percent != _percent) {
+            _percent = percent;
+            std::cerr << "\rExporting: " << percent << "%" << std::flush;
+        }
+        return true;
+    }
+};
+
+bool stderr_is_terminal()
+{
+#ifdef _WIN32
+    return _isatty(_fileno(stderr));
+#else
+    return isatty(fileno(stderr));
+#endif
+}
+
+} // namespace
+
 InkFileExportCmd::InkFileExportCmd()
     : export_overwrite(false)
     , export_margin(0)
@@ -77,7 +128,7 @@ InkFileExportCmd::InkFileExportCmd()
 {
 }
 
-void
+int
 InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
 {
     std::string export_type_filename;
@@ -100,7 +151,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
                 std::cerr << "InkFileExportCmd::do_export: No export type specified. "
                           << "Append a supported file extension to filename provided with --export-filename or "
                           << "provide one or more extensions separately using --export-type" << std::endl;
-                return;
+                return 1;
             } else {
                 // no extension is fine if --export-type is given
                 // explicitly stated extensions are handled later
@@ -124,7 +175,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
         if (export_id.empty() && export_area_type != ExportAreaType::Drawing) {
             std::cerr << "InkFileExportCmd::do_export: "
                       << "--export-use-hints can only be used with --export-id or --export-area-drawing." << std::endl;
-            return;
+            return 1;
         }
         if (export_type_list.size() > 1 || (export_type_list.size() == 1 && export_type_list[0] != "png")) {
             std::cerr << "InkFileExportCmd::do_export: --export-use-hints can only be used with PNG export! "
@@ -148,7 +199,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
                 std::cerr << "InkFileExportCmd::do_export: "
                           << "The supplied --export-extension was not found. Specify a file extension "
                           << "to get a list of available extensions for this file type.";
-                return;
+                return 1;
             }
         } else {
             export_type_list.emplace_back("svg"); // fall-back to SVG by default
@@ -158,7 +209,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
     if (!export_extension.empty() && export_type_list.size() != 1) {
         std::cerr
             << "InkFileExportCmd::do_export: You may only specify one export type if --export-extension is supplied";
-        return;
+        return 1;
     }
     Inkscape::Extension::DB::OutputList extension_list;
     Inkscape::Extension::db.get_output_list(extension_list);
@@ -166,6 +217,8 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
     // Export filename should be used when specified as the output file
     auto const filename_out = !export_filename.empty() ? export_filename : filename_in;
 
+    int failed = 0;
+
     for (auto const &Type : export_type_list) {
         // use lowercase type for following comparisons
         auto type = Type.lowercase();
@@ -181,12 +234,14 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
         }
         bool export_extension_forced = !export_extension.empty();
         // For PNG export, there is no extension, so the method below can not be used.
-        if (type == "png") {
+        // TIFF goes through the PNG export, which can write either.
+        if (type == "png" || ((type == "tif" || type == "tiff") && sp_export_tiff_supported())) {
             if (!export_extension_forced) {
-                do_export_png(doc, filename_out);
+                failed += do_export_png(doc, filename_out) != 0;
             } else {
                 std::cerr << "InkFileExportCmd::do_export: "
-                          << "The parameter --export-extension is invalid for PNG export" << std::endl;
+                          << "The parameter --export-extension is invalid for " << type.uppercase().raw() << " export" << std::endl;
+                failed++;
             }
             continue;
         }
@@ -194,7 +249,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
         // an extension ID was explicitly given. This makes handling of --export-plain-svg easier (which
         // should also work when multiple file types are given, unlike --export-extension)
         if (type == "svg" && !export_extension_forced) {
-            do_export_svg(doc, filename_out);
+            failed += do_export_svg(doc, filename_out) != 0;
             continue;
         }
 
@@ -216,15 +271,15 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
                 if (!export_extension_forced ||
                     (export_extension == Glib::ustring(oext->get_id()).lowercase())) {
                     if (type == "svg") {
-                        do_export_vector(doc, filename_out, *oext);
+                        failed += do_export_vector(doc, filename_out, *oext) != 0;
                     } else if (type == "ps") {
-                        do_export_ps_pdf(doc, filename_out, "image/x-postscript", *oext);
+                        failed += do_export_ps_pdf(doc, filename_out, "image/x-postscript", *oext) != 0;
                     } else if (type == "eps") {
-                        do_export_ps_pdf(doc, filename_out, "image/x-e-postscript", *oext);
+                        failed += do_export_ps_pdf(doc, filename_out, "image/x-e-postscript", *oext) != 0;
                     } else if (type == "pdf") {
-                        do_export_ps_pdf(doc, filename_out, "application/pdf", *oext);
+                        failed += do_export_ps_pdf(doc, filename_out, "application/pdf", *oext) != 0;
                     } else {
-                        do_export_extension(doc, filename_out, oext);
+                        failed += do_export_extension(doc, filename_out, oext) != 0;
                     }
                     exported = true;
                     break;
@@ -232,6 +287,7 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
             }
         }
         if (!exported) {
+            failed++;
             if (export_extension_forced && extension_for_fn_exists) {
                 // the located extension for this file type did not match the provided --export-extension parameter
                 std::cerr << "InkFileExportCmd::do_export: "
@@ -250,6 +306,8 @@ InkFileExportCmd::do_export(SPDocument* doc, std::string filename_in)
             }
         }
     }
+
+    return failed;
 }
 
 // File names use std::string. HTML5 and presumably SVG 2 allows UTF-8 characters. Do we need to convert "object_id" here?
@@ -516,6 +574,26 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &export_filen
         objects_found.push_back(object_id);
     }
 
+    // Everything is rendered at the end, in parallel.
+    std::vector<PngExportJob> jobs;
+    int failed = 0;
+    auto const export_jobs = [&] {
+        std::optional<ConsoleProgress> progress;
+        if (stderr_is_terminal()) {
+            progress.emplace();
+        }
+        auto const results = sp_export_png_files(doc, jobs, progress ? &*progress : nullptr);
+        progress.reset();
+        for (std::size_t i = 0; i < jobs.size(); i++) {
+            if (results[i] != EXPORT_OK) {
+                std::cerr << "InkFileExport::do_export_png: Failed to export to " << jobs[i].filename << std::endl;
+                failed++;
+            }
+        }
+        prefs->setBool("/options/dithering/value", old_dither);
+        return failed;
+    };
+
     // Export pages instead of objects
     if (!export_page.empty()) {
         auto &pm = doc->getPageManager();
@@ -527,14 +605,15 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &export_filen
 
         auto pages = Inkscape::parseIntRange(export_page);
         for (auto page_num : pages) {
-            // We always use the png extension and ignore the extension given by the user
+            // We always use the extension of the export type and ignore the extension given by the user
             // And if only one page is selected then we assume the user knows the filename they intended.
-            std::string filename_out = base + (pages.size() > 1 ? "_p" + std::to_string(page_num) : "") + ".png";
+            std::string filename_out = base + (pages.size() > 1 ? "_p" + std::to_string(page_num) : "") + "."
+                                     + Glib::filename_from_utf8(export_type_current);
             if (auto page = pm.getPage(page_num - 1)) {
-                do_export_png_now(doc, filename_out, page->getDesktopRect(), dpi, items);
+                failed += !add_png_job(doc, filename_out, page->getDesktopRect(), dpi, items, jobs);
             }
         }
-        return 0;
+        return export_jobs();
     }
 
     if (objects.empty()) {
@@ -664,15 +743,19 @@ InkFileExportCmd::do_export_png(SPDocument *doc, std::string const &export_filen
             area = area.roundOutwards();
         }
         // End finding area.
-        do_export_png_now(doc, filename_out, area, dpi, items);
+        failed += !add_png_job(doc, filename_out, area, dpi, items, jobs);
 
     } // End loop over objects.
-    prefs->setBool("/options/dithering/value", old_dither);
-    return 0;
+    return export_jobs();
 }
 
-void
-InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename_out, Geom::Rect area, double dpi_in, const std::vector<SPItem const *> &items)
+/**
+ * Work out the pixel size and format of one PNG export and add it to @a jobs.
+ * Returns false, after telling why, if the options don't allow the export.
+ */
+bool
+InkFileExportCmd::add_png_job(SPDocument *doc, std::string const &filename_out, Geom::Rect area, double dpi_in,
+                              std::vector<SPItem const *> const &items, std::vector<PngExportJob> &jobs)
 {
     // -------------------------- DPI -------------------------------
 
@@ -684,7 +767,7 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
             std::cerr << "InkFileExport::do_export_png: "
                       << "DPI value " << export_dpi
                       << " out of range [0.1 - 10000.0]. Skipping.";
-            return;
+            return false;
         }
     }
 
@@ -705,7 +788,7 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
             if ((height < 1) || (height > PNG_UINT_31_MAX)) {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Export height " << height << " out of range (1 to " << PNG_UINT_31_MAX << ")" << std::endl;
-                return;
+                return false;
             }
             ydpi = Inkscape::Util::Quantity::convert(height, "in", "px") / area.height();
             xdpi = ydpi;
@@ -717,7 +800,7 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
             if ((width < 1) || (width > PNG_UINT_31_MAX)) {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Export width " << width << " out of range (1 to " << PNG_UINT_31_MAX << ")." << std::endl;
-                return;
+                return false;
             }
             xdpi = Inkscape::Util::Quantity::convert(width, "in", "px") / area.width();
             ydpi = export_height ? ydpi : xdpi;
@@ -734,7 +817,7 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
 
         if ((width < 1) || (height < 1) || (width > PNG_UINT_31_MAX) || (height > PNG_UINT_31_MAX)) {
             std::cerr << "InkFileExport::do_export_png: Dimensions " << width << "x" << height << " are out of range (1 to " << PNG_UINT_31_MAX << ")." << std::endl;
-            return;
+            return false;
         }
 
         // -------------------------- Bit Depth and Color Type --------------------
@@ -761,7 +844,7 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
             if (it == color_modes.end()) {
                 std::cerr << "InkFileExport::do_export_png: "
                           << "Color mode " << export_png_color_mode.raw() << " is invalid. It must be one of Gray_1/Gray_2/Gray_4/Gray_8/Gray_16/RGB_8/RGB_16/GrayAlpha_8/GrayAlpha_16/RGBA_8/RGBA_16." << std::endl;
-                return;
+                return false;
             } else {
                 std::tie(color_type, bit_depth) = it->second;
             }
@@ -783,7 +866,7 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
             std::cerr << "InkFileExport::do_export_png: "
                       << "Compression level " << export_png_compression
                       << " out of range [0 - 9]. Skipping.";
-            return;
+            return false;
         }
 
         // ---------------------------- Antialias level ---------------------------
@@ -792,15 +875,27 @@ InkFileExportCmd::do_export_png_now(SPDocument *doc, std::string const &filename
             std::cerr << "InkFileExport::do_export_png: "
                       << "Antialias level " << export_png_antialias
                       << " out of range [0 - 3]. Skipping.";
-            return;
+            return false;
         }
 
-        if( sp_export_png_file(doc, filename_out.c_str(), area, width, height, xdpi, ydpi,
-                               bgcolor, nullptr, nullptr, true, export_id_only ? items : std::vector<SPItem const *>(),
-                               false, color_type, bit_depth, export_png_compression, export_png_antialias) == 1 ) {
-        } else {
-            std::cerr << "InkFileExport::do_export_png: Failed to export to " << filename_out << std::endl;
+        PngExportJob job;
+        job.filename = filename_out;
+        job.area = area;
+        job.width = width;
+        job.height = height;
+        job.xdpi = xdpi;
+        job.ydpi = ydpi;
+        job.bgcolor = bgcolor;
+        if (export_id_only) {
+            job.items_only = items;
         }
+        job.color_type = color_type;
+        job.bit_depth = bit_depth;
+        job.zlib = export_png_compression;
+        job.antialiasing = export_png_antialias;
+        job.tiff = export_type_current != "png";
+        jobs.emplace_back(std::move(job));
+        return true;
 }
 
 
@@ -21,6 +21,7 @@
 
 class SPDocument;
 class SPItem;
+struct PngExportJob;
 namespace Inkscape::Extension {
 class Output;
 } // namespace Inkscape::Extension
@@ -37,7 +38,8 @@ class InkFileExportCmd {
 public:
     InkFileExportCmd();
 
-    void do_export(SPDocument* doc, std::string filename_in="");
+    /// Export the document in every requested type; returns the number of types that failed.
+    int do_export(SPDocument* doc, std::string filename_in="");
 
 private:
     ExportAreaType export_area_type{ExportAreaType::Unset};
@@ -52,7 +54,8 @@ private:
                          Inkscape::Extension::Output &extension);
     int do_export_extension(SPDocument *doc, std::string const &filename_in, Inkscape::Extension::Output *extension);
     Glib::ustring export_type_current;
-    void do_export_png_now(SPDocument *doc, std::string const &filename_out, Geom::Rect area, double dpi_in, const std::vector<SPItem const *> &items);
+    bool add_png_job(SPDocument *doc, std::string const &filename_out, Geom::Rect area, double dpi_in,
+                     std::vector<SPItem const *> const &items, std::vector<PngExportJob> &jobs);
 
 public:
     // Should be private, but this is just temporary code (I hope!).
@@ -23,6 +23,8 @@
 
 #include "bufferstream.h"
 
+#include <algorithm>
+
 namespace Inkscape
 {
 namespace IO
@@ -83,6 +85,19 @@ int BufferInputStream::get()
     return ch;
 }
 
+/**
+ * Reads a block of data from the input stream.  0 if EOF
+ */
+std::size_t BufferInputStream::read(std::span<char> dest)
+{
+    if (closed || position >= (long)buffer.size())
+        return 0;
+    std::size_t len = std::min<std::size_t>(dest.size(), buffer.size() - position);
+    std::copy_n(buffer.begin() + position, len, dest.begin());
+    position += len;
+    return len;
+}
+
 
 
 
@@ -133,6 +148,16 @@ int BufferOutputStream::put(char ch)
     return 1;
 }
 
+/**
+ * Writes the specified bytes to this output stream.
+ */
+void BufferOutputStream::write(std::span<char const> data)
+{
+    if (closed)
+        return;
+    buffer.insert(buffer.end(), data.begin(), data.end());
+}
+
 
 
 
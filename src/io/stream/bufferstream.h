@@ -47,6 +47,7 @@ public:
     int available() override;
     void close() override;
     int get() override;
+    std::size_t read(std::span<char> buffer) override;
 
 private:
     const std::vector<unsigned char> &buffer;
@@ -76,6 +77,7 @@ public:
     void close() override;
     void flush() override;
     int put(char ch) override;
+    void write(std::span<char const> data) override;
     virtual std::vector<unsigned char> &getBuffer()
         { return buffer; }
 
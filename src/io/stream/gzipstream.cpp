@@ -17,10 +17,12 @@
  */
 
 #include "gzipstream.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <string>
+#include <glib.h>
 
 namespace Inkscape
 {
@@ -31,7 +33,7 @@ namespace IO
 //# G Z I P    I N P U T    S T R E A M
 //#########################################################################
 
-#define OUT_SIZE 4000
+#define OUT_SIZE 65536
 
 /**
  *
@@ -132,6 +134,36 @@ int GzipInputStream::get()
     return ch;
 }
 
+/**
+ * Reads a block of data from the input stream.  0 if EOF
+ */ 
+std::size_t GzipInputStream::read(std::span<char> buffer)
+{
+    if (closed) {
+        return 0;
+    }
+    if (!loaded && !load()) {
+        closed = true;
+        return 0;
+    }
+    loaded = true;
+
+    std::size_t len = 0;
+    while (len < buffer.size()) {
+        if (outputBufPos >= outputBufLen) {
+            fetchMore();
+            if (outputBufLen == 0) {
+                break;
+            }
+        }
+        auto const n = std::min<std::size_t>(buffer.size() - len, outputBufLen - outputBufPos);
+        memcpy(buffer.data() + len, outputBuf + outputBufPos, n);
+        outputBufPos += n;
+        len += n;
+    }
+    return len;
+}
+
 #define FTEXT 0x01
 #define FHCRC 0x02
 #define FEXTRA 0x04
@@ -145,10 +177,12 @@ bool GzipInputStream::load()
     std::vector<Byte> inputBuf;
     while (true)
         {
-        int ch = source.get();
-        if (ch<0)
+        auto const pos = inputBuf.size();
+        inputBuf.resize(pos + OUT_SIZE);
+        auto const len = source.read({reinterpret_cast<char *>(inputBuf.data() + pos), OUT_SIZE});
+        inputBuf.resize(pos + len);
+        if (len < OUT_SIZE)
             break;
-        inputBuf.push_back(static_cast<Byte>(ch & 0xff));
         }
     long inputBufLen = inputBuf.size();
     
@@ -171,12 +205,7 @@ bool GzipInputStream::load()
     }
     outputBufLen = 0; // Not filled in yet
 
-    std::vector<unsigned char>::iterator iter;
-    Bytef *p = srcBuf;
-    for (iter=inputBuf.begin() ; iter != inputBuf.end() ; ++iter)
-	{
-        *p++ = *iter;
-	}
+    memcpy(srcBuf, inputBuf.data(), srcLen);
 
     size_t headerLen = 10;
 
@@ -293,6 +322,13 @@ int GzipInputStream::fetchMore()
 //# G Z I P   O U T P U T    S T R E A M
 //#########################################################################
 
+/**
+ * Bytes gathered before they are compressed, and compressed bytes
+ * sent to the destination at once.
+ */
+#define DEFLATE_IN_SIZE (1 << 18)
+#define DEFLATE_OUT_SIZE (1 << 16)
+
 /**
  *
  */ 
@@ -303,6 +339,20 @@ GzipOutputStream::GzipOutputStream(OutputStream &destinationStream)
     totalIn         = 0;
     totalOut        = 0;
     crc             = crc32(0L, Z_NULL, 0);
+    unflushed       = false;
+
+    inputBuf.reserve(DEFLATE_IN_SIZE);
+    outputBuf.resize(DEFLATE_OUT_SIZE);
+
+    //raw deflate data, as the gzip header and trailer are our own
+    memset(&d_stream, 0, sizeof(d_stream));
+    int zerr = deflateInit2(&d_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                            -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    if (zerr != Z_OK)
+        {
+        g_warning("deflateInit2: Some kind of problem: %d", zerr);
+        throw StreamException("cannot start compression");
+        }
 
     //Gzip header
     destination.put(0x1f);
@@ -335,7 +385,14 @@ GzipOutputStream::GzipOutputStream(OutputStream &destinationStream)
  */ 
 GzipOutputStream::~GzipOutputStream()
 {
-    close();
+    try
+        {
+        close();
+        }
+    catch (StreamException const &)
+        {
+        // Too late to tell anyone; close() explicitly to find out.
+        }
 }
 
 /**
@@ -347,7 +404,8 @@ void GzipOutputStream::close()
     if (closed)
         return;
 
-    flush();
+    deflateInput(Z_FINISH);
+    deflateEnd(&d_stream);
 
     //# Send the CRC
     uLong outlong = crc;
@@ -374,51 +432,13 @@ void GzipOutputStream::close()
  */ 
 void GzipOutputStream::flush()
 {
-    if (closed || inputBuf.empty())
+    if (closed || (inputBuf.empty() && !unflushed))
 	{
         return;
     }
-	
-    uLong srclen = inputBuf.size();
-    Bytef *srcbuf = new (std::nothrow) Bytef [srclen];
-    if (!srcbuf)
-        {
-        return;
-        }
-        
-    uLong destlen = srclen;
-    Bytef *destbuf = new (std::nothrow) Bytef [(destlen + (srclen/100) + 13)];
-    if (!destbuf)
-        {
-        delete[] srcbuf;
-        return;
-        }
-        
-    std::vector<unsigned char>::iterator iter;
-    Bytef *p = srcbuf;
-    for (iter=inputBuf.begin() ; iter != inputBuf.end() ; ++iter)
-        *p++ = *iter;
-        
-    crc = crc32(crc, const_cast<const Bytef *>(srcbuf), srclen);
-    
-    int zerr = compress(destbuf, static_cast<uLongf *>(&destlen), srcbuf, srclen);
-    if (zerr != Z_OK)
-        {
-        printf("Some kind of problem\n");
-        }
 
-    totalOut += destlen;
-    //skip the redundant zlib header and checksum
-    for (uLong i=2; i<destlen-4 ; i++)
-        {
-        destination.put((int)destbuf[i]);
-        }
-        
+    deflateInput(Z_SYNC_FLUSH);
     destination.flush();
-
-    inputBuf.clear();
-    delete[] srcbuf;
-    delete[] destbuf;
 }
 
 
@@ -438,9 +458,81 @@ int GzipOutputStream::put(char ch)
     //Add char to buffer
     inputBuf.push_back(ch);
     totalIn++;
+    if (inputBuf.size() >= DEFLATE_IN_SIZE)
+        deflateInput(Z_NO_FLUSH);
     return 1;
 }
 
+/**
+ * Writes the specified bytes to this output stream, compressing
+ * large blocks without copying them.
+ */ 
+void GzipOutputStream::write(std::span<char const> data)
+{
+    if (closed)
+        return;
+
+    totalIn += data.size();
+    if (inputBuf.size() + data.size() < DEFLATE_IN_SIZE)
+        {
+        inputBuf.insert(inputBuf.end(), data.begin(), data.end());
+        return;
+        }
+
+    deflateInput(Z_NO_FLUSH);
+    deflateBlock(reinterpret_cast<Bytef const *>(data.data()), data.size(), Z_NO_FLUSH);
+}
+
+/**
+ * Compresses the gathered bytes.
+ */ 
+void GzipOutputStream::deflateInput(int flush)
+{
+    deflateBlock(inputBuf.data(), inputBuf.size(), flush);
+    inputBuf.clear();
+}
+
+/**
+ * Compresses a block of bytes and sends what is ready of the result
+ * to the destination.
+ */ 
+void GzipOutputStream::deflateBlock(Bytef const *data, std::size_t len, int flush)
+{
+    do
+        {
+        // zlib takes at most 4 GiB at once
+        uInt const chunk = std::min<std::size_t>(len, 1 << 30);
+        crc = crc32(crc, data, chunk);
+        d_stream.next_in  = const_cast<Bytef *>(data);
+        d_stream.avail_in = chunk;
+        data += chunk;
+        len  -= chunk;
+
+        int const chunkFlush = len ? Z_NO_FLUSH : flush;
+        do
+            {
+            d_stream.next_out  = outputBuf.data();
+            d_stream.avail_out = outputBuf.size();
+            int zerr = deflate(&d_stream, chunkFlush);
+            if (zerr == Z_STREAM_ERROR)
+                {
+                g_warning("deflate: Some kind of problem: %d", zerr);
+                // The output is incomplete, so nothing more may be written.
+                deflateEnd(&d_stream);
+                closed = true;
+                throw StreamException("compression failed");
+                }
+            std::size_t have = outputBuf.size() - d_stream.avail_out;
+            destination.write({reinterpret_cast<char const *>(outputBuf.data()), have});
+            totalOut += have;
+            }
+        while (d_stream.avail_out == 0);
+        }
+    while (len > 0);
+
+    unflushed = flush == Z_NO_FLUSH;
+}
+
 
 
 } // namespace IO
@@ -49,6 +49,8 @@ public:
     void close() override;
     
     int get() override;
+
+    std::size_t read(std::span<char> buffer) override;
     
 private:
 
@@ -97,13 +99,21 @@ public:
     
     int put(char ch) override;
 
+    void write(std::span<char const> data) override;
+
 private:
 
+    void deflateInput(int flush);
+    void deflateBlock(Bytef const *data, std::size_t len, int flush);
+
     std::vector<unsigned char> inputBuf;
+    std::vector<unsigned char> outputBuf;
 
     long totalIn;
     long totalOut;
     unsigned long crc;
+    bool unflushed;
+    z_stream d_stream;
 
 }; // class GzipOutputStream
 
@@ -26,16 +26,51 @@ namespace IO
 
 void pipeStream(InputStream &source, OutputStream &dest)
 {
+    char buf[65536];
     for (;;)
         {
-        int ch = source.get();
-        if (ch<0)
+        auto len = source.read(buf);
+        dest.write({buf, len});
+        if (len < sizeof(buf))
             break;
-        dest.put(ch);
         }
     dest.flush();
 }
 
+
+//#########################################################################
+//# I N P U T    S T R E A M
+//#########################################################################
+
+/**
+ * Reads bytes one at a time until the buffer is full or EOF
+ */
+std::size_t InputStream::read(std::span<char> buffer)
+{
+    std::size_t len = 0;
+    while (len < buffer.size())
+        {
+        int ch = get();
+        if (ch < 0)
+            break;
+        buffer[len++] = ch;
+        }
+    return len;
+}
+
+//#########################################################################
+//# O U T P U T    S T R E A M
+//#########################################################################
+
+/**
+ * Writes the bytes one at a time
+ */
+void OutputStream::write(std::span<char const> data)
+{
+    for (char ch : data)
+        put(ch);
+}
+
 //#########################################################################
 //# B A S I C    I N P U T    S T R E A M
 //#########################################################################
@@ -84,6 +119,16 @@ int BasicInputStream::get()
         return -1;
     return source.get();
 }
+
+/**
+ * Reads a block of data from the input stream.  0 if EOF
+ */ 
+std::size_t BasicInputStream::read(std::span<char> buffer)
+{
+    if (closed)
+        return 0;
+    return source.read(buffer);
+}
    
 
 
@@ -134,6 +179,16 @@ int BasicOutputStream::put(char ch)
     return 1;
 }
 
+/**
+ * Writes the specified bytes to this output stream.
+ */ 
+void BasicOutputStream::write(std::span<char const> data)
+{
+    if (closed)
+        return;
+    destination.write(data);
+}
+
 
 
 //#########################################################################
@@ -428,6 +483,20 @@ char StdReader::get()
 
 
 
+//#########################################################################
+//# W R I T E R
+//#########################################################################
+
+/**
+ * Writes the characters one at a time
+ */
+void Writer::write(std::string_view str)
+{
+    for (char ch : str)
+        put(ch);
+}
+
+
 //#########################################################################
 //# B A S I C    W R I T E R
 //#########################################################################
@@ -508,9 +577,7 @@ Writer &BasicWriter::writeUString(const Glib::ustring &str)
  */ 
 Writer &BasicWriter::writeStdString(const std::string &str)
 {
-    for (char it : str) {
-        put(it);
-    }
+    write(str);
     return *this;
 }
 
@@ -519,12 +586,7 @@ Writer &BasicWriter::writeStdString(const std::string &str)
  */ 
 Writer &BasicWriter::writeString(const char *str)
 {
-    std::string tmp;
-    if (str)
-        tmp = str;
-    else
-        tmp = "null";
-    writeStdString(tmp);
+    write(str ? str : "null");
     return *this;
 }
 
@@ -740,6 +802,14 @@ void OutputStreamWriter::put(char ch)
     outputStream.put(ch);
 }
 
+/**
+ *  Overloaded to send blocks of characters to the OutputStream in one go.
+ */
+void OutputStreamWriter::write(std::string_view str)
+{
+    outputStream.write(str);
+}
+
 //#########################################################################
 //# S T D    W R I T E R
 //#########################################################################
@@ -790,6 +860,14 @@ void StdWriter::put(char ch)
     outputStream->put(ch);
 }
 
+/**
+ *  Overloaded to send blocks of characters to the OutputStream in one go.
+ */
+void StdWriter::write(std::string_view str)
+{
+    outputStream->write(str);
+}
+
 
 } // namespace IO
 } // namespace Inkscape
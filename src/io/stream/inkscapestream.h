@@ -11,6 +11,8 @@
  */
 
 #include <cstdio>
+#include <span>
+#include <string_view>
 #include <glibmm/ustring.h>
 
 #ifdef printf
@@ -87,6 +89,15 @@ public:
      * This call returns -1 on end-of-file.
      */
     virtual int get() = 0;
+
+    /**
+     * Read bytes into @a buffer until it is full or the end of the
+     * stream is reached, blocking like get().  The default reads
+     * them one at a time with get().
+     * Returns the number of bytes read, less than the size of
+     * the buffer only at end-of-file.
+     */
+    virtual std::size_t read(std::span<char> buffer);
     
 }; // class InputStream
 
@@ -113,6 +124,8 @@ public:
     
     int get() override;
     
+    std::size_t read(std::span<char> buffer) override;
+    
 protected:
 
     bool closed;
@@ -141,6 +154,9 @@ public:
     
     int get() override
         {  return getchar(); }
+    
+    std::size_t read(std::span<char> buffer) override
+        { return fread(buffer.data(), 1, buffer.size(), stdin); }
 
 };
 
@@ -194,6 +210,12 @@ public:
      */
     virtual int put(char ch) = 0;
 
+    /**
+     * Send a block of bytes to the destination stream.  The
+     * default sends them one at a time with put().
+     */
+    virtual void write(std::span<char const> data);
+
 
 }; // class OutputStream
 
@@ -217,6 +239,8 @@ public:
     
     int put(char ch) override;
 
+    void write(std::span<char const> data) override;
+
 protected:
 
     bool closed;
@@ -243,6 +267,9 @@ public:
     
     int put(char ch) override
         {return  putchar(ch); }
+    
+    void write(std::span<char const> data) override
+        { fwrite(data.data(), 1, data.size(), stdout); }
 
 };
 
@@ -474,6 +501,12 @@ public:
     virtual void flush() = 0;
     
     virtual void put(char ch) = 0;
+
+    /**
+     * Write a block of characters.  The default writes them
+     * one at a time with put().
+     */
+    virtual void write(std::string_view str);
     
     /* Formatted output */
     virtual Writer& printf(char const *fmt, ...) G_GNUC_PRINTF(2,3) = 0;
@@ -620,6 +653,8 @@ public:
     
     void put(char ch) override;
 
+    void write(std::string_view str) override;
+
 
 private:
 
@@ -648,6 +683,8 @@ public:
     
     void put(char ch) override;
 
+    void write(std::string_view str) override;
+
 
 private:
 
@@ -88,6 +88,16 @@ int FileInputStream::get()
     return retVal;
 }
 
+/**
+ * Reads a block of data from the input stream.  0 if EOF
+ */
+std::size_t FileInputStream::read(std::span<char> buffer)
+{
+    if (!inf)
+        return 0;
+    return fread(buffer.data(), 1, buffer.size(), inf);
+}
+
 
 
 
@@ -156,6 +166,19 @@ int FileOutputStream::put(char ch)
     return 1;
 }
 
+/**
+ * Writes the specified bytes to this output stream.
+ */
+void FileOutputStream::write(std::span<char const> data)
+{
+    if (!outf)
+        return;
+    if (fwrite(data.data(), 1, data.size(), outf) != data.size()) {
+        Glib::ustring err = "ERROR writing to file ";
+        throw StreamException(err);
+    }
+}
+
 
 
 
@@ -50,6 +50,8 @@ public:
 
     int get() override;
 
+    std::size_t read(std::span<char> buffer) override;
+
 private:
     FILE *inf;           //for file: uris
 
@@ -80,6 +82,8 @@ public:
 
     int put(char ch) override;
 
+    void write(std::span<char const> data) override;
+
 private:
 
     bool ownsFile;
@@ -16,6 +16,7 @@
 #include "style.h"
 #include "font-instance.h"
 #include "font-factory.h"
+#include "shaping-cache.h"
 #include "svg/svg-length.h"
 #include "object/sp-object.h"
 #include "object/sp-flowdiv.h"
@@ -1333,6 +1334,7 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
     TRACE(("itemizing para, first input %d\n", para->first_input_index));
 
     PangoAttrList *attributes_list = pango_attr_list_new();
+    ShapingCache::ItemizeKey cache_key;
     for (unsigned input_index = para->first_input_index ; input_index < _flow._input_stream.size() ; input_index++) {
         if (_flow._input_stream[input_index]->Type() == CONTROL_CODE) {
             Layout::InputStreamControlCode const *control_code = static_cast<Layout::InputStreamControlCode const *>(_flow._input_stream[input_index]);
@@ -1353,8 +1355,9 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
             PangoAttribute *attribute_font_description = pango_attr_font_desc_new(font->get_descr());
             attribute_font_description->start_index = para->text.bytes();
 
+            auto const font_features = text_source->style->getFontFeatureString();
             PangoAttribute *attribute_font_features =
-                pango_attr_font_features_new( text_source->style->getFontFeatureString().c_str());
+                pango_attr_font_features_new(font_features.c_str());
             attribute_font_features->start_index = para->text.bytes();
             para->text.append(&*text_source->text_begin.base(), text_source->text_length);     // build the combined text
 
@@ -1366,11 +1369,15 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
 
             // Set language
             SPObject * object = text_source->source;
+            PangoLanguage *language = nullptr;
             if (!object->lang.empty()) {
-                PangoLanguage* language = pango_language_from_string(object->lang.c_str());
+                language = pango_language_from_string(object->lang.c_str());
                 PangoAttribute *attribute_language = pango_attr_language_new( language );
                 pango_attr_list_insert(attributes_list, attribute_language);
             }
+
+            cache_key.add_run(attribute_font_description->start_index, attribute_font_description->end_index,
+                              font->get_descr(), font_features, language);
         }
     }
 
@@ -1378,35 +1385,56 @@ void  Layout::Calculator::_buildPangoItemizationForPara(ParagraphInfo *para) con
 //    TRACE(("%d input sources used\n", input_index - para->first_input_index));
 
     // Pango Itemize
-    GList *pango_items_glist = nullptr;
     para->direction = LEFT_TO_RIGHT; // CSS default
+    PangoDirection pango_direction = PANGO_DIRECTION_NEUTRAL;
     if (_flow._input_stream[para->first_input_index]->Type() == TEXT_SOURCE) {
         Layout::InputStreamTextSource const *text_source = static_cast<Layout::InputStreamTextSource *>(_flow._input_stream[para->first_input_index]);
 
-        para->direction =                (text_source->style->direction.computed == SP_CSS_DIRECTION_LTR) ? LEFT_TO_RIGHT : RIGHT_TO_LEFT;
-        PangoDirection pango_direction = (text_source->style->direction.computed == SP_CSS_DIRECTION_LTR) ? PANGO_DIRECTION_LTR : PANGO_DIRECTION_RTL;
-        pango_items_glist = pango_itemize_with_base_dir(_pango_context, pango_direction, para->text.data(), 0, para->text.bytes(), attributes_list, nullptr);
+        para->direction = (text_source->style->direction.computed == SP_CSS_DIRECTION_LTR) ? LEFT_TO_RIGHT : RIGHT_TO_LEFT;
+        pango_direction = (text_source->style->direction.computed == SP_CSS_DIRECTION_LTR) ? PANGO_DIRECTION_LTR : PANGO_DIRECTION_RTL;
     }
 
-    if( pango_items_glist == nullptr ) {
-        // Type wasn't TEXT_SOURCE or direction was not set.
-        pango_items_glist = pango_itemize(_pango_context, para->text.data(), 0, para->text.bytes(), attributes_list, nullptr);
+    // Paragraphs that have not changed since the last layout, or that repeat another one, were itemized before.
+    auto &shaping_cache = ShapingCache::get();
+    cache_key.set_paragraph(para->text.raw(), pango_direction);
+    std::vector<PangoItem *> items;
+    std::vector<std::shared_ptr<FontInstance>> fonts;
+
+    if (!shaping_cache.find_items(cache_key, items, fonts)) {
+        GList *pango_items_glist = nullptr;
+        if (pango_direction != PANGO_DIRECTION_NEUTRAL) {
+            pango_items_glist = pango_itemize_with_base_dir(_pango_context, pango_direction, para->text.data(), 0, para->text.bytes(), attributes_list, nullptr);
+        }
+
+        if( pango_items_glist == nullptr ) {
+            // Type wasn't TEXT_SOURCE or direction was not set.
+            pango_items_glist = pango_itemize(_pango_context, para->text.data(), 0, para->text.bytes(), attributes_list, nullptr);
+        }
+
+        // make the FontInstance for each PangoItem
+        for (GList *current_pango_item = pango_items_glist ; current_pango_item != nullptr ; current_pango_item = current_pango_item->next) {
+            auto item = (PangoItem*)current_pango_item->data;
+            PangoFontDescription *font_description = pango_font_describe(item->analysis.font);
+            items.push_back(item);
+            fonts.push_back(FontFactory::get().Face(font_description));
+            pango_font_description_free(font_description);   // Face() makes a copy
+        }
+        g_list_free(pango_items_glist);
+
+        shaping_cache.add_items(std::move(cache_key), items, fonts);
     }
 
     pango_attr_list_unref(attributes_list);
 
-    // convert the GList to our vector<> and make the FontInstance for each PangoItem at the same time
-    para->pango_items.reserve(g_list_length(pango_items_glist));
-    TRACE(("para itemizes to %d sections\n", g_list_length(pango_items_glist)));
-    for (GList *current_pango_item = pango_items_glist ; current_pango_item != nullptr ; current_pango_item = current_pango_item->next) {
+    // convert to our vector<>
+    para->pango_items.reserve(items.size());
+    TRACE(("para itemizes to %d sections\n", (int)items.size()));
+    for (std::size_t i = 0; i < items.size(); i++) {
         PangoItemInfo new_item;
-        new_item.item = (PangoItem*)current_pango_item->data;
-        PangoFontDescription *font_description = pango_font_describe(new_item.item->analysis.font);
-        new_item.font = FontFactory::get().Face(font_description);
-        pango_font_description_free(font_description);   // Face() makes a copy
+        new_item.item = items[i];
+        new_item.font = std::move(fonts[i]);
         para->pango_items.push_back(new_item);
     }
-    g_list_free(pango_items_glist);
 
     // and get the character attributes on everything
     para->char_attributes.resize(para->text.length() + 1);
@@ -1589,7 +1617,6 @@ unsigned Layout::Calculator::_buildSpansForPara(ParagraphInfo *para) const
                 // now we know the length, do some final calculations and add the UnbrokenSpan to the list
                 new_span.font_size = text_source->style->font_size.computed * _flow.getTextLengthMultiplierDue();
                 if (new_span.text_bytes) {
-                    new_span.glyph_string = pango_glyph_string_new();
                     /* Some assertions intended to help diagnose bug #1277746. */
                     g_assert( 0 < new_span.text_bytes );
                     g_assert( span_start_byte_in_source < text_source->text->bytes() );
@@ -1610,54 +1637,65 @@ unsigned Layout::Calculator::_buildSpansForPara(ParagraphInfo *para) const
                     auto gnew = std::string_view(para->text.data()         + para_text_index,           new_span.text_bytes);
                     assert (gold == gnew);
 
-                    // Convert characters to glyphs
-                    pango_shape_full(para->text.data() + para_text_index,
-                                     new_span.text_bytes,
-                                     para->text.data(),
-                                     -1,
-                                     &para->pango_items[pango_item_index].item->analysis,
-                                     new_span.glyph_string);
-
-                    if (para->pango_items[pango_item_index].item->analysis.level & 1) {
-                        // Right to left text (Arabic, Hebrew, etc.)
-
-                        // pango_shape() will reorder glyphs in rtl sections into visual order
-                        // (start offsets in accending order) which messes us up because the svg
-                        // spec requires us to draw glyphs in logical order so let's reverse the
-                        // glyphstring.
-
-                        const unsigned nglyphs = new_span.glyph_string->num_glyphs;
-                        std::vector<PangoGlyphInfo> infos(nglyphs);
-                        std::vector<gint>           clusters(nglyphs);
-
-                        for (int i = 0; i < nglyphs; ++i) {
-                            std::copy(&new_span.glyph_string->glyphs[i],       &new_span.glyph_string->glyphs[i+1],       infos.end() - i - 1);
-                            std::copy(&new_span.glyph_string->log_clusters[i], &new_span.glyph_string->log_clusters[i+1], clusters.end() - i - 1);
-                        }
+                    // Reuse the glyphs from an earlier layout of the same text
+                    PangoAnalysis const &analysis = para->pango_items[pango_item_index].item->analysis;
+                    ShapingCache::ShapeKey cache_key(para->text.raw(), para_text_index, new_span.text_bytes, analysis);
+                    if (auto const glyphs = ShapingCache::get().find_glyphs(cache_key)) {
+                        new_span.glyph_string = glyphs;
+                    } else {
+                        new_span.glyph_string = pango_glyph_string_new();
+
+                        // Convert characters to glyphs
+                        pango_shape_full(para->text.data() + para_text_index,
+                                         new_span.text_bytes,
+                                         para->text.data(),
+                                         -1,
+                                         &analysis,
+                                         new_span.glyph_string);
+
+                        if (analysis.level & 1) {
+                            // Right to left text (Arabic, Hebrew, etc.)
+
+                            // pango_shape() will reorder glyphs in rtl sections into visual order
+                            // (start offsets in accending order) which messes us up because the svg
+                            // spec requires us to draw glyphs in logical order so let's reverse the
+                            // glyphstring.
+
+                            const unsigned nglyphs = new_span.glyph_string->num_glyphs;
+                            std::vector<PangoGlyphInfo> infos(nglyphs);
+                            std::vector<gint>           clusters(nglyphs);
+
+                            for (int i = 0; i < nglyphs; ++i) {
+                                std::copy(&new_span.glyph_string->glyphs[i],       &new_span.glyph_string->glyphs[i+1],       infos.end() - i - 1);
+                                std::copy(&new_span.glyph_string->log_clusters[i], &new_span.glyph_string->log_clusters[i+1], clusters.end() - i - 1);
+                            }
 
-                        std::copy(infos.begin(), infos.end(), new_span.glyph_string->glyphs);
-                        std::copy(clusters.begin(), clusters.end(), new_span.glyph_string->log_clusters);
+                            std::copy(infos.begin(), infos.end(), new_span.glyph_string->glyphs);
+                            std::copy(clusters.begin(), clusters.end(), new_span.glyph_string->log_clusters);
 
-                        // We've messed up the flag that tells a glyph it is first in a cluster.
-                        for (int i = 0; i < nglyphs; ++i) {
+                            // We've messed up the flag that tells a glyph it is first in a cluster.
+                            for (int i = 0; i < nglyphs; ++i) {
 
-                            // Set flag for start of cluster, we skip all other glyphs in cluster below.
-                            new_span.glyph_string->glyphs[i].attr.is_cluster_start = 1;
+                                // Set flag for start of cluster, we skip all other glyphs in cluster below.
+                                new_span.glyph_string->glyphs[i].attr.is_cluster_start = 1;
 
-                            // Find index of first glyph in next cluster
-                            int j = i + 1;
-                            while( (j < nglyphs) &&
-                                   (new_span.glyph_string->log_clusters[j] == new_span.glyph_string->log_clusters[i])
-                                ) {
-                                new_span.glyph_string->glyphs[j].attr.is_cluster_start = 0; // Zero
-                                j++;
+                                // Find index of first glyph in next cluster
+                                int j = i + 1;
+                                while( (j < nglyphs) &&
+                                       (new_span.glyph_string->log_clusters[j] == new_span.glyph_string->log_clusters[i])
+                                    ) {
+                                    new_span.glyph_string->glyphs[j].attr.is_cluster_start = 0; // Zero
+                                    j++;
+                                }
+
+                                // Move on to next cluster.
+                                i = j;
                             }
 
-                            // Move on to next cluster.
-                            i = j;
-                        }
+                        } // End right to left text.
 
-                    } // End right to left text.
+                        ShapingCache::get().add_glyphs(std::move(cache_key), new_span.glyph_string);
+                    }
 
                     //  The following sorting doesn't seem to be necessary, and causes
                     //  https://gitlab.com/inkscape/inkscape/-/issues/394 ...
@@ -42,6 +42,7 @@
 #include "libnrtype/font-factory.h"
 #include "libnrtype/font-instance.h"
 #include "libnrtype/OpenTypeUtil.h"
+#include "libnrtype/shaping-cache.h"
 
 #include "util/statics.h"
 
@@ -229,6 +230,7 @@ FontFactory::~FontFactory()
 void FontFactory::refreshConfig()
 {
     pango_fc_font_map_config_changed(PANGO_FC_FONT_MAP(fontServer));
+    Inkscape::Text::ShapingCache::get().clear();
 }
 
 Glib::ustring FontFactory::ConstructFontSpecification(PangoFontDescription *font)
@@ -738,6 +740,7 @@ void FontFactory::AddFontsDir(char const *utf8dir)
     if (res == FcTrue) {
         g_info("Fonts dir '%s' added successfully.", utf8dir);
         pango_fc_font_map_config_changed(PANGO_FC_FONT_MAP(fontServer));
+        Inkscape::Text::ShapingCache::get().clear();
     } else {
         g_warning("Could not add fonts dir '%s'.", utf8dir);
     }
@@ -765,6 +768,7 @@ void FontFactory::AddFontFile(char const *utf8file)
     if (res == FcTrue) {
         g_info("Font file '%s' added successfully.", utf8file);
         pango_fc_font_map_config_changed(PANGO_FC_FONT_MAP(fontServer));
+        Inkscape::Text::ShapingCache::get().clear();
     } else {
         g_warning("Could not add font file '%s'.", utf8file);
     }
@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Cache of itemized and shaped text, shared by all text layouts.
+ */
+
+#include "shaping-cache.h"
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "font-instance.h"
+
+namespace Inkscape::Text {
+namespace {
+
+/// The number of characters HarfBuzz looks at on either side of a run for contextual shaping.
+constexpr int SHAPING_CONTEXT = 5;
+
+/// Limits on what is kept, in glyphs and in bytes of paragraph text.
+constexpr std::size_t MAX_GLYPHS = 1 << 18;
+constexpr std::size_t MAX_ITEMIZED_BYTES = 1 << 22;
+
+template <typename T>
+void append(std::string &str, T const &value)
+{
+    str.append(reinterpret_cast<char const *>(&value), sizeof(value));
+}
+
+void append(std::string &str, std::string_view value)
+{
+    append(str, value.size());
+    str.append(value);
+}
+
+struct GlyphStringFree
+{
+    void operator()(PangoGlyphString *glyphs) const { pango_glyph_string_free(glyphs); }
+};
+
+struct ItemFree
+{
+    void operator()(PangoItem *item) const { pango_item_free(item); }
+};
+
+struct ObjectUnref
+{
+    void operator()(gpointer object) const { g_object_unref(object); }
+};
+
+struct Itemized
+{
+    std::vector<std::unique_ptr<PangoItem, ItemFree>> items;
+    std::vector<std::shared_ptr<FontInstance>> fonts;
+};
+
+struct Shaped
+{
+    std::unique_ptr<PangoGlyphString, GlyphStringFree> glyphs;
+    std::unique_ptr<PangoFont, ObjectUnref> font; ///< Keeps the font in the key from being reused.
+};
+
+/// Map from keys to values with a bound on the total cost of the values, least recently used first out.
+template <typename Value>
+class LruMap
+{
+public:
+    explicit LruMap(std::size_t max_cost) : _max_cost{max_cost} {}
+
+    Value const *find(std::string const &key)
+    {
+        auto const it = _map.find(key);
+        if (it == _map.end()) {
+            return nullptr;
+        }
+        _order.splice(_order.begin(), _order, it->second);
+        return &it->second->value;
+    }
+
+    void insert(std::string key, Value value, std::size_t cost)
+    {
+        if (cost > _max_cost || _map.count(key)) {
+            return;
+        }
+        while (_cost + cost > _max_cost) {
+            _cost -= _order.back().cost;
+            _map.erase(*_order.back().key);
+            _order.pop_back();
+        }
+        auto const it = _map.emplace(std::move(key), _order.end()).first;
+        _order.push_front({&it->first, std::move(value), cost});
+        it->second = _order.begin();
+        _cost += cost;
+    }
+
+    void clear()
+    {
+        _map.clear();
+        _order.clear();
+        _cost = 0;
+    }
+
+private:
+    struct Entry
+    {
+        std::string const *key; ///< Owned by the map.
+        Value value;
+        std::size_t cost;
+    };
+
+    std::list<Entry> _order;
+    std::unordered_map<std::string, typename std::list<Entry>::iterator> _map;
+    std::size_t _cost = 0;
+    std::size_t const _max_cost;
+};
+
+} // namespace
+
+struct ShapingCache::Data
+{
+    std::mutex mutex;
+    LruMap<Itemized> itemized{MAX_ITEMIZED_BYTES};
+    LruMap<Shaped> shaped{MAX_GLYPHS};
+};
+
+ShapingCache::ShapingCache()
+    : _data{std::make_unique<Data>()}
+{}
+
+ShapingCache::~ShapingCache() = default;
+
+void ShapingCache::ItemizeKey::add_run(unsigned start, unsigned end, PangoFontDescription const *descr,
+                                       std::string_view features, PangoLanguage const *language)
+{
+    auto const descr_str = pango_font_description_to_string(descr);
+    append(_str, start);
+    append(_str, end);
+    append(_str, std::string_view{descr_str});
+    append(_str, features);
+    append(_str, language);
+    g_free(descr_str);
+}
+
+void ShapingCache::ItemizeKey::set_paragraph(std::string_view text, PangoDirection base_dir)
+{
+    append(_str, base_dir);
+    _str.append(text);
+}
+
+ShapingCache::ShapeKey::ShapeKey(std::string_view paragraph, unsigned offset, unsigned bytes,
+                                 PangoAnalysis const &analysis)
+    : _font{analysis.font}
+{
+    auto const begin = paragraph.data();
+    auto const end = begin + paragraph.size();
+
+    char const *before = begin + offset;
+    for (int i = 0; i < SHAPING_CONTEXT && before > begin; i++) {
+        before = g_utf8_find_prev_char(begin, before);
+    }
+    char const *after = begin + offset + bytes;
+    for (int i = 0; i < SHAPING_CONTEXT && after < end; i++) {
+        after = g_utf8_next_char(after);
+    }
+
+    append(_str, analysis.font);
+    append(_str, analysis.level);
+    append(_str, analysis.gravity);
+    append(_str, analysis.flags);
+    append(_str, analysis.script);
+    append(_str, analysis.language);
+    for (auto l = analysis.extra_attrs; l; l = l->next) {
+        auto const attr = static_cast<PangoAttribute const *>(l->data);
+        append(_str, attr->klass->type);
+        if (attr->klass->type == PANGO_ATTR_FONT_FEATURES) {
+            append(_str, std::string_view{reinterpret_cast<PangoAttrFontFeatures const *>(attr)->features});
+        }
+    }
+    append(_str, unsigned(begin + offset - before));
+    append(_str, bytes);
+    _str.append(before, std::min(after, end));
+}
+
+bool ShapingCache::find_items(ItemizeKey const &key, std::vector<PangoItem *> &items,
+                              std::vector<std::shared_ptr<FontInstance>> &fonts)
+{
+    auto lock = std::lock_guard{_data->mutex};
+    auto const itemized = _data->itemized.find(key._str);
+    if (!itemized) {
+        return false;
+    }
+    items.clear();
+    for (auto const &item : itemized->items) {
+        items.push_back(pango_item_copy(item.get()));
+    }
+    fonts = itemized->fonts;
+    return true;
+}
+
+void ShapingCache::add_items(ItemizeKey key, std::vector<PangoItem *> const &items,
+                             std::vector<std::shared_ptr<FontInstance>> const &fonts)
+{
+    Itemized itemized;
+    itemized.fonts = fonts;
+    for (auto const item : items) {
+        itemized.items.emplace_back(pango_item_copy(item));
+    }
+    auto const cost = key._str.size() + items.size() * sizeof(PangoItem);
+
+    auto lock = std::lock_guard{_data->mutex};
+    _data->itemized.insert(std::move(key._str), std::move(itemized), cost);
+}
+
+PangoGlyphString *ShapingCache::find_glyphs(ShapeKey const &key)
+{
+    auto lock = std::lock_guard{_data->mutex};
+    auto const shaped = _data->shaped.find(key._str);
+    return shaped ? pango_glyph_string_copy(shaped->glyphs.get()) : nullptr;
+}
+
+void ShapingCache::add_glyphs(ShapeKey key, PangoGlyphString const *glyphs)
+{
+    if (!key._font) {
+        return;
+    }
+
+    Shaped shaped;
+    shaped.glyphs.reset(pango_glyph_string_copy(const_cast<PangoGlyphString *>(glyphs)));
+    shaped.font.reset(static_cast<PangoFont *>(g_object_ref(key._font)));
+    auto const cost = std::max(glyphs->num_glyphs, 1);
+
+    auto lock = std::lock_guard{_data->mutex};
+    _data->shaped.insert(std::move(key._str), std::move(shaped), cost);
+}
+
+void ShapingCache::clear()
+{
+    auto lock = std::lock_guard{_data->mutex};
+    _data->itemized.clear();
+    _data->shaped.clear();
+}
+
+} // namespace Inkscape::Text
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
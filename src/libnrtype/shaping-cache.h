@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Cache of itemized and shaped text, shared by all text layouts.
+ */
+
+#ifndef SEEN_LIBNRTYPE_SHAPING_CACHE_H
+#define SEEN_LIBNRTYPE_SHAPING_CACHE_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <pango/pango.h>
+
+#include "font-factory.h"
+#include "util/statics.h"
+
+class FontInstance;
+
+namespace Inkscape::Text {
+
+/**
+ * Keeps the results of pango_itemize() and pango_shape_full() for reuse by later layouts.
+ *
+ * A relayout after an edit itemizes and shapes the untouched paragraphs exactly as before, and
+ * documents often repeat the same labels many times over, so most of this work can be skipped.
+ * Shaped glyphs are keyed on the text, the font (which includes its variation settings), the
+ * font features, the language and the bidi level, together with the few characters on either
+ * side that HarfBuzz looks at for contextual shaping.
+ *
+ * The cache is bounded, dropping the least recently used entries first, and is emptied when the
+ * font configuration changes. It may be used from any thread.
+ */
+class ShapingCache : public Util::EnableSingleton<ShapingCache, Util::Depends<FontFactory>>
+{
+public:
+    /// Identifies the itemization of a paragraph. Add its runs of attributes in order.
+    class ItemizeKey
+    {
+    public:
+        void add_run(unsigned start, unsigned end, PangoFontDescription const *descr,
+                     std::string_view features, PangoLanguage const *language);
+
+        /// Finish the key with the paragraph text and its base direction, PANGO_DIRECTION_NEUTRAL if none.
+        void set_paragraph(std::string_view text, PangoDirection base_dir);
+
+    private:
+        std::string _str;
+        friend ShapingCache;
+    };
+
+    /// Identifies the glyphs for a part of the text of a paragraph, with the analysis of its item.
+    class ShapeKey
+    {
+    public:
+        ShapeKey(std::string_view paragraph, unsigned offset, unsigned bytes, PangoAnalysis const &analysis);
+
+    private:
+        std::string _str;
+        PangoFont *_font;
+        friend ShapingCache;
+    };
+
+    /**
+     * Look up the items of a paragraph.
+     *
+     * @return Whether they were found, in which case @a items receives copies for the caller to
+     *         free, and @a fonts the font of each item.
+     */
+    bool find_items(ItemizeKey const &key, std::vector<PangoItem *> &items,
+                    std::vector<std::shared_ptr<FontInstance>> &fonts);
+    void add_items(ItemizeKey key, std::vector<PangoItem *> const &items,
+                   std::vector<std::shared_ptr<FontInstance>> const &fonts);
+
+    /// Look up shaped glyphs, returning a copy for the caller to free, or nullptr.
+    PangoGlyphString *find_glyphs(ShapeKey const &key);
+    void add_glyphs(ShapeKey key, PangoGlyphString const *glyphs);
+
+    /// Forget everything, e.g. because the available fonts have changed.
+    void clear();
+
+protected:
+    ShapingCache();
+    ~ShapingCache();
+
+private:
+    struct Data;
+    std::unique_ptr<Data> _data;
+};
+
+} // namespace Inkscape::Text
+
+#endif // SEEN_LIBNRTYPE_SHAPING_CACHE_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -18,6 +18,7 @@
 #include <2geom/path-intersection.h>
 #include <2geom/path-sink.h>
 #include <memory>
+#include <numeric>
 
 #include "desktop.h"
 #include "display/curve.h"
@@ -189,6 +190,35 @@ void Inkscape::ObjectSnapper::_collectNodes(SnapSourceType const &t,
                 }
             }
         }
+
+        _points_index.reset(getSnapperTolerance());
+        _indexPoints(0);
+    }
+}
+
+/**
+ * Add the points from @a first on of _points_to_snap_to to the index.
+ */
+void Inkscape::ObjectSnapper::_indexPoints(std::size_t first) const
+{
+    for (auto i = first; i < _points_to_snap_to->size(); i++) {
+        _points_index.insert((*_points_to_snap_to)[i].getPoint());
+    }
+}
+
+/**
+ * Add the paths of the path vectors from @a first on of _paths_to_snap_to to the index.
+ */
+void Inkscape::ObjectSnapper::_indexPaths(std::size_t first) const
+{
+    for (auto i = first; i < _paths_to_snap_to->size(); i++) {
+        auto const &path_vector = (*_paths_to_snap_to)[i].path_vector;
+        for (unsigned j = 0; j < path_vector.size(); j++) {
+            if (auto bounds = path_vector[j].boundsFast()) {
+                _paths_index.insert(*bounds);
+                _indexed_paths.emplace_back(i, j);
+            }
+        }
     }
 }
 
@@ -198,20 +228,28 @@ void Inkscape::ObjectSnapper::_snapNodes(IntermSnapResults &isr,
                                          SnapConstraint const &c,
                                          Geom::Point const &p_proj_on_constraint) const
 {
-    // Iterate through all nodes, find out which one is the closest to p, and snap to it!
+    // Look up the nodes within snapping range of p, find out which one is the closest to p, and snap to it!
 
-    _collectNodes(p.getSourceType(), p.getSourceNum() <= 0);
+    bool const first_point = p.getSourceNum() <= 0;
+    _collectNodes(p.getSourceType(), first_point);
 
-    if (unselected_nodes != nullptr && unselected_nodes->size() > 0) {
+    // The unselected nodes are the same for all points being snapped, so they are added only once
+    if (first_point && unselected_nodes != nullptr && unselected_nodes->size() > 0) {
         g_assert(_points_to_snap_to != nullptr);
+        auto const first = _points_to_snap_to->size();
         _points_to_snap_to->insert(_points_to_snap_to->end(), unselected_nodes->begin(), unselected_nodes->end());
+        _indexPoints(first);
     }
 
     SnappedPoint s;
     bool success = false;
     bool strict_snapping = _snapmanager->snapprefs.getStrictSnapping();
 
-    for (const auto & k : *_points_to_snap_to) {
+    std::vector<unsigned> nearby;
+    _points_index.query(c.isUndefined() ? p.getPoint() : p_proj_on_constraint, getSnapperTolerance(), nearby);
+
+    for (auto i : nearby) {
+        auto const &k = (*_points_to_snap_to)[i];
         if (_allowSourceToSnapToTarget(p.getSourceType(), k.getTargetType(), strict_snapping)) {
             Geom::Point target_pt = k.getPoint();
             Geom::Coord dist = Geom::L2(target_pt - p.getPoint()); // Default: free (unconstrained) snapping
@@ -256,7 +294,17 @@ void Inkscape::ObjectSnapper::_snapTranslatingGuide(IntermSnapResults &isr,
     Geom::Coord tol = getSnapperTolerance();
     bool always = getSnapperAlwaysSnap(SNAPSOURCE_GUIDE);
 
-    for (const auto & k : *_points_to_snap_to) {
+    // Nodes within tol of both the guide and the mouse location are within sqrt(2) * tol of the latter
+    std::vector<unsigned> nearby;
+    if (always) {
+        nearby.resize(_points_to_snap_to->size());
+        std::iota(nearby.begin(), nearby.end(), 0);
+    } else {
+        _points_index.query(p, M_SQRT2 * tol, nearby);
+    }
+
+    for (auto i : nearby) {
+        auto const &k = (*_points_to_snap_to)[i];
         Geom::Point target_pt = k.getPoint();
         // Project each node (*k) on the guide line (running through point p)
         Geom::Point p_proj = Geom::projection(target_pt, Geom::Line(p, p + Geom::rot90(guide_normal)));
@@ -392,6 +440,10 @@ void Inkscape::ObjectSnapper::_collectPaths(Geom::Point /*p*/,
                 }
             }
         }
+
+        _paths_index.reset(getSnapperTolerance());
+        _indexed_paths.clear();
+        _indexPaths(0);
     }
 }
 
@@ -421,83 +473,83 @@ void Inkscape::ObjectSnapper::_snapPaths(IntermSnapResults &isr,
             if (auto curve = curve_for_item(const_cast<SPPath *>(selected_path))) {
                 _paths_to_snap_to->emplace_back(curve->get_pathvector() * selected_path->i2doc_affine(),
                                                 SNAPTARGET_PATH, Geom::OptRect(), true);
+                _indexPaths(_paths_to_snap_to->size() - 1);
             }
         }
     }
 
-    int num_path = 0; // _paths_to_snap_to contains multiple path_vectors, each containing multiple paths.
-                      // num_path will count the paths, and will not be zeroed for each path_vector. It will
-                      // continue counting
-
     bool strict_snapping = _snapmanager->snapprefs.getStrictSnapping();
     bool snap_perp = _snapmanager->snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_PATH_PERPENDICULAR);
     bool snap_tang = _snapmanager->snapprefs.isTargetSnappable(Inkscape::SNAPTARGET_PATH_TANGENTIAL);
 
+    // Only paths whose bounding box is within snapping range can have a point within it
+    std::vector<unsigned> nearby;
+    _paths_index.query(p_doc, getSnapperTolerance(), nearby);
+
     //dt->getSnapIndicator()->remove_debugging_points();
-    for (const auto & it_p : *_paths_to_snap_to) {
+    for (auto num_path : nearby) { // The index entry uniquely identifies each path of all path vectors
+        auto const &it_p = (*_paths_to_snap_to)[_indexed_paths[num_path].first];
         if (_allowSourceToSnapToTarget(p.getSourceType(), it_p.target_type, strict_snapping)) {
             bool const being_edited = node_tool_active && it_p.currently_being_edited;
             //if true then this pathvector it_pv is currently being edited in the node tool
 
-            for (auto &it_pv : it_p.path_vector) {
-                // Find a nearest point for each curve within this path
-                // n curves will return n time values with 0 <= t <= 1
-                std::vector<double> anp = it_pv.nearestTimePerCurve(p_doc);
-
-                //std::cout << "#nearest points = " << anp.size() << " | p = " << p.getPoint() << std::endl;
-                // Now we will examine each of the nearest points, and determine whether it's within snapping range and if we should snap to it
-                std::vector<double>::const_iterator np = anp.begin();
-                unsigned int index = 0;
-                for (; np != anp.end(); ++np, index++) {
-                    Geom::Curve const *curve = &it_pv.at(index);
-                    Geom::Point const sp_doc = curve->pointAt(*np);
-                    //dt->getSnapIndicator()->set_new_debugging_point(sp_doc*dt->doc2dt());
-                    bool c1 = true;
-                    bool c2 = true;
-                    if (being_edited) {
-                        /* If the path is being edited, then we should only snap though to stationary pieces of the path
-                         * and not to the pieces that are being dragged around. This way we avoid
-                         * self-snapping. For this we check whether the nodes at both ends of the current
-                         * piece are unselected; if they are then this piece must be stationary
-                         */
-                        g_assert(unselected_nodes != nullptr);
-                        Geom::Point start_pt = dt->doc2dt(curve->pointAt(0));
-                        Geom::Point end_pt = dt->doc2dt(curve->pointAt(1));
-                        c1 = isUnselectedNode(start_pt, unselected_nodes);
-                        c2 = isUnselectedNode(end_pt, unselected_nodes);
-                        /* Unfortunately, this might yield false positives for coincident nodes. Inkscape might therefore mistakenly
-                         * snap to path segments that are not stationary. There are at least two possible ways to overcome this:
-                         * - Linking the individual nodes of the SPPath we have here, to the nodes of the NodePath::SubPath class as being
-                         *   used in sp_nodepath_selected_nodes_move. This class has a member variable called "selected". For this the nodes
-                         *   should be in the exact same order for both classes, so we can index them
-                         * - Replacing the SPPath being used here by the NodePath::SubPath class; but how?
-                         */
-                    }
+            auto const &it_pv = it_p.path_vector[_indexed_paths[num_path].second];
+            // Find a nearest point for each curve within this path
+            // n curves will return n time values with 0 <= t <= 1
+            std::vector<double> anp = it_pv.nearestTimePerCurve(p_doc);
+
+            //std::cout << "#nearest points = " << anp.size() << " | p = " << p.getPoint() << std::endl;
+            // Now we will examine each of the nearest points, and determine whether it's within snapping range and if we should snap to it
+            std::vector<double>::const_iterator np = anp.begin();
+            unsigned int index = 0;
+            for (; np != anp.end(); ++np, index++) {
+                Geom::Curve const *curve = &it_pv.at(index);
+                Geom::Point const sp_doc = curve->pointAt(*np);
+                //dt->getSnapIndicator()->set_new_debugging_point(sp_doc*dt->doc2dt());
+                bool c1 = true;
+                bool c2 = true;
+                if (being_edited) {
+                    /* If the path is being edited, then we should only snap though to stationary pieces of the path
+                     * and not to the pieces that are being dragged around. This way we avoid
+                     * self-snapping. For this we check whether the nodes at both ends of the current
+                     * piece are unselected; if they are then this piece must be stationary
+                     */
+                    g_assert(unselected_nodes != nullptr);
+                    Geom::Point start_pt = dt->doc2dt(curve->pointAt(0));
+                    Geom::Point end_pt = dt->doc2dt(curve->pointAt(1));
+                    c1 = isUnselectedNode(start_pt, unselected_nodes);
+                    c2 = isUnselectedNode(end_pt, unselected_nodes);
+                    /* Unfortunately, this might yield false positives for coincident nodes. Inkscape might therefore mistakenly
+                     * snap to path segments that are not stationary. There are at least two possible ways to overcome this:
+                     * - Linking the individual nodes of the SPPath we have here, to the nodes of the NodePath::SubPath class as being
+                     *   used in sp_nodepath_selected_nodes_move. This class has a member variable called "selected". For this the nodes
+                     *   should be in the exact same order for both classes, so we can index them
+                     * - Replacing the SPPath being used here by the NodePath::SubPath class; but how?
+                     */
+                }
 
-                    Geom::Point const sp_dt = dt->doc2dt(sp_doc);
-                    if (!being_edited || (c1 && c2)) {
-                        Geom::Coord dist = Geom::distance(sp_doc, p_doc);
-                        // std::cout << "  dist -> " << dist << std::endl;
-                        if (dist < getSnapperTolerance()) {
-                            // Add the curve we have snapped to
-                            Geom::Point sp_tangent_dt = Geom::Point(0,0);
-                            if (p.getSourceType() == Inkscape::SNAPSOURCE_GUIDE_ORIGIN) {
-                                // We currently only use the tangent when snapping guides, so only in this case we will
-                                // actually calculate the tangent to avoid wasting CPU cycles
-                                Geom::Point sp_tangent_doc = curve->unitTangentAt(*np);
-                                sp_tangent_dt = dt->doc2dt(sp_tangent_doc) - dt->doc2dt(Geom::Point(0,0));
-                            }
-                            bool always = getSnapperAlwaysSnap(p.getSourceType());
-                            isr.curves.emplace_back(sp_dt, sp_tangent_dt, num_path, index, dist, getSnapperTolerance(), always, false, curve, p.getSourceType(), p.getSourceNum(), it_p.target_type, it_p.target_bbox);
-                            if (snap_tang || snap_perp) {
-                                // For each curve that's within snapping range, we will now also search for tangential and perpendicular snaps
-                                _snapPathsTangPerp(snap_tang, snap_perp, isr, p, curve, dt);
-                            }
+                Geom::Point const sp_dt = dt->doc2dt(sp_doc);
+                if (!being_edited || (c1 && c2)) {
+                    Geom::Coord dist = Geom::distance(sp_doc, p_doc);
+                    // std::cout << "  dist -> " << dist << std::endl;
+                    if (dist < getSnapperTolerance()) {
+                        // Add the curve we have snapped to
+                        Geom::Point sp_tangent_dt = Geom::Point(0,0);
+                        if (p.getSourceType() == Inkscape::SNAPSOURCE_GUIDE_ORIGIN) {
+                            // We currently only use the tangent when snapping guides, so only in this case we will
+                            // actually calculate the tangent to avoid wasting CPU cycles
+                            Geom::Point sp_tangent_doc = curve->unitTangentAt(*np);
+                            sp_tangent_dt = dt->doc2dt(sp_tangent_doc) - dt->doc2dt(Geom::Point(0,0));
+                        }
+                        bool always = getSnapperAlwaysSnap(p.getSourceType());
+                        isr.curves.emplace_back(sp_dt, sp_tangent_dt, num_path, index, dist, getSnapperTolerance(), always, false, curve, p.getSourceType(), p.getSourceNum(), it_p.target_type, it_p.target_bbox);
+                        if (snap_tang || snap_perp) {
+                            // For each curve that's within snapping range, we will now also search for tangential and perpendicular snaps
+                            _snapPathsTangPerp(snap_tang, snap_perp, isr, p, curve, dt);
                         }
                     }
                 }
-                num_path++;
-            } // End of: for (Geom::PathVector::iterator ....)
+            }
         }
     }
 }
@@ -579,24 +631,35 @@ void Inkscape::ObjectSnapper::_snapPathsConstrained(IntermSnapResults &isr,
             // TODO fix the function to be const correct:
             if (auto curve = curve_for_item(const_cast<SPPath *>(selected_path))) {
                 _paths_to_snap_to->emplace_back(curve->get_pathvector() * selected_path->i2doc_affine(), SNAPTARGET_PATH, Geom::OptRect(), true);
+                _indexPaths(_paths_to_snap_to->size() - 1);
             }
         }
     }
 
     bool strict_snapping = _snapmanager->snapprefs.getStrictSnapping();
 
+    // Intersections further than the tolerance from p are discarded below, so only paths whose
+    // bounding box is within that range need to be intersected
+    std::vector<unsigned> nearby;
+    _paths_index.query(dt->dt2doc(p.getPoint()), tolerance, nearby);
+
     // Find all intersections of the constrained path with the snap target candidates
-    for (const auto & k : *_paths_to_snap_to) {
+    for (auto entry : nearby) {
+        auto const &k = (*_paths_to_snap_to)[_indexed_paths[entry].first];
         if (_allowSourceToSnapToTarget(p.getSourceType(), k.target_type, strict_snapping)) {
             // Do the intersection math
-            std::vector<Geom::PVIntersection> inters = constraint_path.intersect(k.path_vector);
+            Geom::Path const &target_path = k.path_vector[_indexed_paths[entry].second];
+            std::vector<Geom::PathIntersection> inters;
+            for (auto const &constraint : constraint_path) {
+                auto const found = constraint.intersect(target_path);
+                inters.insert(inters.end(), found.begin(), found.end());
+            }
 
             bool const being_edited = node_tool_active && k.currently_being_edited;
 
             // Convert the collected intersections to snapped points
             for (const auto & inter : inters) {
-                int index = inter.second.path_index; // index on the second path, which is the target path that we snapped to
-                Geom::Curve const *curve = &k.path_vector.at(index).at(inter.second.curve_index);
+                Geom::Curve const *curve = &target_path.at(inter.second.curve_index);
 
                 bool c1 = true;
                 bool c2 = true;
@@ -14,6 +14,7 @@
 #include <memory>
 #include "snapper.h"
 #include "snap-candidate.h"
+#include "snap-index.h"
 
 class SPDesktop;
 class SPNamedView;
@@ -63,6 +64,11 @@ private:
     std::unique_ptr<std::vector<SnapCandidatePoint>> _points_to_snap_to;
     std::unique_ptr<std::vector<SnapCandidatePath >> _paths_to_snap_to;
 
+    // Spatial indices of the above, built along with them for each snapping operation
+    mutable SnapIndex _points_index;
+    mutable SnapIndex _paths_index; // of each path of each path vector
+    mutable std::vector<std::pair<unsigned, unsigned>> _indexed_paths; // entries of _paths_index, as (path vector, path)
+
     void _snapNodes(IntermSnapResults &isr,
                       Inkscape::SnapCandidatePoint const &p, // in desktop coordinates
                       std::vector<SnapCandidatePoint> *unselected_nodes,
@@ -105,6 +111,8 @@ private:
                       bool const &first_point) const;
 
     void _clear_paths() const;
+    void _indexPoints(std::size_t first) const;
+    void _indexPaths(std::size_t first) const;
     Geom::PathVector _getBorderPathv() const;
     Geom::PathVector _getPathvFromRect(Geom::Rect const rect) const;
     bool _allowSourceToSnapToTarget(SnapSourceType source, SnapTargetType target, bool strict_snapping) const;
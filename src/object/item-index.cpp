@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Spatial index of the items in a document.
+ */
+
+#include "item-index.h"
+
+#include <iterator>
+#include <boost/geometry.hpp>
+
+#include "object/sp-item.h"
+
+namespace bgi = boost::geometry::index;
+
+namespace Inkscape {
+
+ItemIndex::ItemIndex() = default;
+ItemIndex::~ItemIndex() = default;
+
+void ItemIndex::invalidate(SPItem *item)
+{
+    // The root is never searched for, and clones live outside the document's item tree.
+    if (!item->parent || item->cloned) {
+        return;
+    }
+    _dirty.emplace(item);
+}
+
+void ItemIndex::invalidateSubtree(SPItem *item)
+{
+    invalidate(item);
+    for (auto &child : item->children) {
+        if (auto child_item = cast<SPItem>(&child)) {
+            invalidateSubtree(child_item);
+        }
+    }
+}
+
+void ItemIndex::remove(SPItem *item)
+{
+    _dirty.erase(item);
+    if (auto it = _entries.find(item); it != _entries.end()) {
+        _tree.remove(Value{it->second, item});
+        _entries.erase(it);
+    }
+}
+
+void ItemIndex::clear()
+{
+    _tree.clear();
+    _entries.clear();
+    _dirty.clear();
+}
+
+std::vector<SPItem *> ItemIndex::intersecting(Geom::Rect const &area)
+{
+    return _query(Box{{area.left(), area.top()}, {area.right(), area.bottom()}});
+}
+
+std::vector<SPItem *> ItemIndex::around(Geom::Point const &point, double tolerance)
+{
+    return _query(Box{{point.x() - tolerance, point.y() - tolerance}, {point.x() + tolerance, point.y() + tolerance}});
+}
+
+std::vector<SPItem *> ItemIndex::_query(Box const &box)
+{
+    _flush();
+
+    std::vector<Value> found;
+    _tree.query(bgi::intersects(box), std::back_inserter(found));
+
+    std::vector<SPItem *> result;
+    result.reserve(found.size());
+    for (auto const &value : found) {
+        result.emplace_back(value.second);
+    }
+    return result;
+}
+
+/**
+ * Re-read the bounding boxes of all items invalidated since the last query.
+ */
+void ItemIndex::_flush()
+{
+    if (_dirty.empty()) {
+        return;
+    }
+
+    // Bulk loading is both much faster than one-by-one insertion and yields a better
+    // balanced tree, so use it whenever a large part of the document has changed,
+    // which in particular covers the first query on a freshly loaded document.
+    bool const rebuild = _dirty.size() * 2 >= _entries.size();
+
+    for (auto item : _dirty) {
+        auto const it = _entries.find(item);
+        if (it != _entries.end()) {
+            if (!rebuild) {
+                _tree.remove(Value{it->second, item});
+            }
+            _entries.erase(it);
+        }
+
+        if (auto const bbox = item->documentVisualBounds()) {
+            auto const box = Box{{bbox->left(), bbox->top()}, {bbox->right(), bbox->bottom()}};
+            _entries.emplace(item, box);
+            if (!rebuild) {
+                _tree.insert(Value{box, item});
+            }
+        }
+    }
+    _dirty.clear();
+
+    if (rebuild) {
+        std::vector<Value> values;
+        values.reserve(_entries.size());
+        for (auto const &[item, box] : _entries) {
+            values.emplace_back(box, item);
+        }
+        _tree = Tree(values.begin(), values.end());
+    }
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Spatial index of the items in a document.
+ */
+
+#ifndef INKSCAPE_OBJECT_ITEM_INDEX_H
+#define INKSCAPE_OBJECT_ITEM_INDEX_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <boost/geometry/geometries/box.hpp>
+#include <boost/geometry/geometries/point.hpp>
+#include <boost/geometry/index/rtree.hpp>
+#include <2geom/point.h>
+#include <2geom/rect.h>
+
+class SPItem;
+
+namespace Inkscape {
+
+/**
+ * R-tree over the document visual bounding boxes of the items of a document.
+ *
+ * Items report themselves through invalidate() as soon as their geometry, style or
+ * transform is changed, and again on every update that may move them, so that queries
+ * made before the next update already see the new boxes. A change of transform moves
+ * the whole subtree, which is reported through invalidateSubtree(). The tree itself is
+ * only brought up to date by the next query, so a burst of changes costs no more than
+ * a hash insertion per item until somebody actually searches the document.
+ *
+ * Queries return candidates whose bounding box satisfies the search in arbitrary order;
+ * filtering by visibility, layer structure and z-order is left to the caller.
+ */
+class ItemIndex
+{
+public:
+    ItemIndex();
+    ItemIndex(ItemIndex const &) = delete;
+    ItemIndex &operator=(ItemIndex const &) = delete;
+    ~ItemIndex();
+
+    /// Schedule the bounding box of an item to be (re)read on the next query.
+    void invalidate(SPItem *item);
+    /// Schedule the bounding boxes of an item and all items below it to be (re)read.
+    void invalidateSubtree(SPItem *item);
+    /// Forget about an item; must be called before the item is destroyed.
+    void remove(SPItem *item);
+    void clear();
+
+    /// Items whose bounding box intersects the given area (in document coordinates).
+    std::vector<SPItem *> intersecting(Geom::Rect const &area);
+    /// Items whose bounding box lies within @a tolerance of the given point.
+    std::vector<SPItem *> around(Geom::Point const &point, double tolerance = 0.0);
+
+    std::size_t size() const { return _entries.size() + _dirty.size(); }
+
+private:
+    using Point = boost::geometry::model::point<double, 2, boost::geometry::cs::cartesian>;
+    using Box = boost::geometry::model::box<Point>;
+    using Value = std::pair<Box, SPItem *>;
+    using Tree = boost::geometry::index::rtree<Value, boost::geometry::index::rstar<16>>;
+
+    void _flush();
+    std::vector<SPItem *> _query(Box const &box);
+
+    Tree _tree;
+    std::unordered_map<SPItem *, Box> _entries; ///< The boxes currently stored in the tree.
+    std::unordered_set<SPItem *> _dirty;        ///< Items whose box has to be recomputed.
+};
+
+} // namespace Inkscape
+
+#endif // INKSCAPE_OBJECT_ITEM_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
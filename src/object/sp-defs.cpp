@@ -46,7 +46,7 @@ void SPDefs::update(SPCtx *ctx, guint flags) {
     }
 
     flags &= SP_OBJECT_MODIFIED_CASCADE;
-    std::vector<SPObject*> l(this->childList(true));
+    std::vector<SPObject*> l(this->dirtyChildList(flags));
     for(auto child : l){
         if (flags || (child->uflags & (SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG))) {
             child->updateDisplay(ctx, flags);
@@ -61,12 +61,7 @@ void SPDefs::modified(unsigned int flags) {
     }
 
     flags &= SP_OBJECT_MODIFIED_CASCADE;
-    std::vector<SPObject *> l;
-    for (auto& child: children) {
-        sp_object_ref(&child);
-        l.push_back(&child);
-    }
-
+    std::vector<SPObject *> l = dirtyChildList(flags);
     for (auto child:l) {
         if (flags || (child->mflags & (SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG))) {
             child->emitModified(flags);
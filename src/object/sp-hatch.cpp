@@ -560,6 +560,11 @@ Inkscape::DrawingPattern *SPHatch::show(Inkscape::Drawing &drawing, unsigned key
     auto &v = views.back();
     auto ai = v.drawingitem.get();
 
+    // Views of the same pattern render identical tiles whenever their resolutions agree.
+    if (views.size() > 1) {
+        ai->shareTilesWith(*views.front().drawingitem);
+    }
+
     auto children = hatchPaths();
 
     Geom::OptInterval extents = _calculateStripExtents(bbox);
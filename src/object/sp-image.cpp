@@ -18,7 +18,11 @@
 
 #include <cstring>
 #include <algorithm>
+#include <future>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <boost/asio/post.hpp>
 
 #include <giomm/error.h>
 #include <glib/gstdio.h>
@@ -29,6 +33,7 @@
 
 // Added for preserveAspectRatio support -- EAF
 #include "attributes.h"
+#include "async/thread-pool.h"
 #include "document.h"
 #include "print.h"
 #include "snap-candidate.h"
@@ -68,6 +73,49 @@ static void sp_image_set_curve(SPImage *image);
 static void sp_image_update_arenaitem (SPImage *img, Inkscape::DrawingImage *ai);
 static void sp_image_update_canvas_image (SPImage *image);
 
+namespace {
+
+std::optional<std::string> copy_of(char const *str)
+{
+    return str ? std::optional<std::string>{str} : std::nullopt;
+}
+
+double read_svg_dpi(Inkscape::XML::Node const *repr)
+{
+    auto const value = repr->attribute("inkscape:svg-dpi");
+    return value ? g_ascii_strtod(value, nullptr) : 96;
+}
+
+/**
+ * Whether a reference to an image might be to an SVG document, which is read into an
+ * SPDocument and so only on the main thread.
+ */
+bool may_be_svg(char const *ref)
+{
+    if (!ref) {
+        return false;
+    }
+    bool const data = g_ascii_strncasecmp(ref, "data:", 5) == 0;
+    auto const comma = data ? std::strchr(ref, ',') : nullptr;
+    auto lower = std::string(comma ? std::string_view(ref, comma - ref) : std::string_view(ref));
+    std::transform(lower.begin(), lower.end(), lower.begin(), g_ascii_tolower);
+    return lower.find(data ? "svg" : ".svg") != std::string::npos;
+}
+
+} // namespace
+
+/**
+ * An image read on a helper thread, with what it was read from.
+ */
+struct SPImage::Decoding
+{
+    std::string href;
+    std::optional<std::string> absref;
+    std::optional<std::string> base;
+    double svgdpi;
+    std::future<std::shared_ptr<Inkscape::Pixbuf const>> result;
+};
+
 #ifdef DEBUG_LCMS
 extern guint update_in_progress;
 #define DEBUG_MESSAGE_SCISLAC(key, ...) \
@@ -131,10 +179,43 @@ void SPImage::build(SPDocument *document, Inkscape::XML::Node *repr) {
     this->readAttr(SPAttr::PRESERVEASPECTRATIO);
     this->readAttr(SPAttr::COLOR_PROFILE);
 
+    _startDecoding();
+
     /* Register */
     document->addResource("image", this);
 }
 
+/**
+ * Start reading the image on a helper thread, for update() to pick up, so that the images of a
+ * document being loaded are read at the same time. SVG images and images with a color profile
+ * are left to update().
+ */
+void SPImage::_startDecoding()
+{
+    _decoding.reset();
+
+    auto const repr = getRepr();
+    auto const href = Inkscape::getHrefAttribute(*repr).second;
+    auto const absref = repr->attribute("sodipodi:absref");
+    if (!href || color_profile || may_be_svg(href) || may_be_svg(absref)) {
+        return;
+    }
+
+    _decoding = std::make_unique<Decoding>();
+    _decoding->href = href;
+    _decoding->absref = copy_of(absref);
+    _decoding->base = copy_of(document->getDocumentBase());
+    _decoding->svgdpi = read_svg_dpi(repr);
+
+    auto task = std::make_shared<std::packaged_task<std::shared_ptr<Inkscape::Pixbuf const> ()>>(
+        [href = _decoding->href, absref = _decoding->absref, base = _decoding->base, svgdpi = _decoding->svgdpi] {
+            return readSharedImage(href.c_str(), absref ? absref->c_str() : nullptr,
+                                   base ? base->c_str() : nullptr, svgdpi);
+        });
+    _decoding->result = task->get_future();
+    boost::asio::post(Inkscape::Async::helper_pool(), [task] { (*task)(); });
+}
+
 void SPImage::release() {
     if (this->document) {
         // Unregister ourselves
@@ -147,6 +228,7 @@ void SPImage::release() {
     }
 
     pixbuf.reset();
+    _decoding.reset();
 
     if (this->color_profile) {
         g_free (this->color_profile);
@@ -245,15 +327,26 @@ void SPImage::update(SPCtx *ctx, unsigned int flags) {
         pixbuf.reset();
         if (href) {
             Inkscape::Pixbuf *pb = nullptr;
-            double svgdpi = 96;
-            if (getRepr()->attribute("inkscape:svg-dpi")) {
-                svgdpi = g_ascii_strtod(getRepr()->attribute("inkscape:svg-dpi"), nullptr);
-            }
+            std::shared_ptr<Inkscape::Pixbuf const> shared;
+            double svgdpi = read_svg_dpi(getRepr());
             dpi = svgdpi;
-            pb = readImage(Inkscape::getHrefAttribute(*getRepr()).second,
-                           getRepr()->attribute("sodipodi:absref"),
-                           document->getDocumentBase(), svgdpi);
-            if (!pb) {
+            auto const ref = Inkscape::getHrefAttribute(*getRepr()).second;
+            auto const absref = getRepr()->attribute("sodipodi:absref");
+            auto const base = document->getDocumentBase();
+            if (color_profile) {
+                pb = readImage(ref, absref, base, svgdpi);
+            } else if (_decoding && ref && _decoding->href == ref && _decoding->absref == copy_of(absref) &&
+                       _decoding->base == copy_of(base) && _decoding->svgdpi == svgdpi)
+            {
+                shared = _decoding->result.get();
+            } else {
+                shared = readSharedImage(ref, absref, base, svgdpi);
+            }
+            _decoding.reset();
+            if (shared) {
+                missing = false;
+                pixbuf = std::move(shared);
+            } else if (!pb) {
                 missing = true;
                 // Passing in our previous size allows us to preserve the image's expected size.
                 auto broken_width = width._set ? width.computed : 640;
@@ -553,6 +646,27 @@ Inkscape::Pixbuf *SPImage::readImage(gchar const *href, gchar const *absref, gch
     return inkpb;
 }
 
+/**
+ * Read an image for sharing, in PF_CAIRO format. Images embedded as data URIs are decoded only
+ * once for all the images using the same data.
+ */
+std::shared_ptr<Inkscape::Pixbuf const> SPImage::readSharedImage(gchar const *href, gchar const *absref, gchar const *base, double svgdpi)
+{
+    if (href && g_ascii_strncasecmp(href, "data:", 5) == 0) {
+        if (auto shared = Inkscape::Pixbuf::get_shared_from_data_uri(href + 5, svgdpi)) {
+            return shared;
+        }
+        href = nullptr;
+    }
+
+    auto const pb = readImage(href, absref, base, svgdpi);
+    if (!pb) {
+        return nullptr;
+    }
+    pb->ensurePixelFormat(Inkscape::Pixbuf::PF_CAIRO);
+    return std::shared_ptr<Inkscape::Pixbuf const>(pb);
+}
+
 static std::string broken_image_svg = R"A(
 <svg xmlns:xlink="http://www.w3.org/1999/xlink" xmlns="http://www.w3.org/2000/svg" width="{width}" height="{height}">
   <defs>
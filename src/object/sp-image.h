@@ -73,7 +73,12 @@ public:
     bool cropToArea(Geom::Rect area);
     bool cropToArea(const Geom::IntRect &area);
 private:
+    struct Decoding;
+    std::unique_ptr<Decoding> _decoding; ///< The image being read in the background, if any.
+    void _startDecoding();
+
     static Inkscape::Pixbuf *readImage(gchar const *href, gchar const *absref, gchar const *base, double svgdpi = 0);
+    static std::shared_ptr<Inkscape::Pixbuf const> readSharedImage(gchar const *href, gchar const *absref, gchar const *base, double svgdpi = 0);
     static Inkscape::Pixbuf *getBrokenImage(double width, double height);
 };
 
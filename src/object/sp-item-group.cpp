@@ -148,7 +148,7 @@ void SPGroup::update(SPCtx *ctx, unsigned int flags) {
       childflags |= SP_OBJECT_PARENT_MODIFIED_FLAG;
     }
     childflags &= SP_OBJECT_MODIFIED_CASCADE;
-    std::vector<SPObject*> l=this->childList(true, SPObject::ActionUpdate);
+    std::vector<SPObject*> l = this->dirtyChildList(childflags);
     for(auto child : l){
         if (childflags || (child->uflags & (SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG))) {
             auto item = cast<SPItem>(child);
@@ -197,7 +197,7 @@ void SPGroup::modified(guint flags) {
         }
     }
 
-    std::vector<SPObject*> l=this->childList(true);
+    std::vector<SPObject*> l = this->dirtyChildList(flags);
     for(auto child : l){
         if (flags || (child->mflags & (SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG))) {
             child->emitModified(flags);
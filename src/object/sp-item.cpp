@@ -36,6 +36,7 @@
 #include "enums.h"
 #include "filter-chemistry.h"
 
+#include "item-index.h"
 #include "sp-clippath.h"
 #include "sp-desc.h"
 #include "sp-guide.h"
@@ -527,6 +528,8 @@ void SPItem::release()
     delete avoidRef;
     avoidRef = nullptr;
 
+    document->getItemIndex().remove(this);
+
     // we do NOT disconnect from the changed signal of those before deletion.
     // The destructor will call *_ref_changed with NULL as the new value,
     // which will cause the set_visible(false) function to be called.
@@ -771,6 +774,7 @@ void SPItem::update(SPCtx *ctx, unsigned flags)
     // Any of the modifications defined in sp-object.h might change bbox,
     // so we invalidate it unconditionally
     bbox_valid = false;
+    document->getItemIndex().invalidate(this);
 
     viewport = ictx->viewport; // Cache viewport
 
@@ -1760,6 +1764,7 @@ void SPItem::set_item_transform(Geom::Affine const &transform_matrix)
 {
     if (!Geom::are_near(transform_matrix, transform, 1e-18)) {
         transform = transform_matrix;
+        document->getItemIndex().invalidateSubtree(this);
         /* The SP_OBJECT_USER_MODIFIED_FLAG_B is used to mark the fact that it's only a
            transformation.  It's apparently not used anywhere else. */
         requestDisplayUpdate(SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_USER_MODIFIED_FLAG_B);
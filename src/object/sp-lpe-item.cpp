@@ -14,15 +14,23 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
 #include <iterator>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <type_traits>
 #include <utility>
+#include <boost/asio/post.hpp>
 #include <glibmm/i18n.h>
 #include <sigc++/adaptors/bind.h>
 
 #include "bad-uri-exception.h"
 #include "attributes.h"
+#include "async/thread-pool.h"
 #include "desktop.h"
 #include "display/curve.h"
 #include "inkscape.h"
@@ -30,6 +38,7 @@
 #include "live_effects/lpe-lattice2.h"
 #include "live_effects/lpe-measure-segments.h"
 #include "live_effects/lpeobject-reference.h"
+#include "live_effects/parameter/path.h"
 #include "message-stack.h"
 #include "preferences.h"
 #include "sp-clippath.h"
@@ -63,8 +72,175 @@ void clear_path_effect_list(PathEffectList* const l) {
     }
 }
 
+/**
+ * Whether the result of an effect depends only on the path it is given, its parameters, the
+ * transform of the item and the document scale, so that it can be reused while none of those
+ * change. Effects that look at other objects, or at the style of the item, are left out.
+ */
+bool is_cacheable(Inkscape::LivePathEffect::Effect const &lpe)
+{
+    using namespace Inkscape::LivePathEffect;
+
+    switch (lpe.effectType()) {
+        case BSPLINE:
+        case SPIRO:
+        case POWERSTROKE:
+        case PATTERN_ALONG_PATH:
+        case SIMPLIFY:
+        case ROUGHEN:
+        case SKETCH:
+        case TAPER_STROKE:
+        case FILLET_CHAMFER:
+        case DASHED_STROKE:
+        case JOIN_TYPE:
+        case TRANSFORM_2PTS:
+        case ENVELOPE:
+        case LATTICE2:
+        case PERSPECTIVE_ENVELOPE:
+        case CURVE_STITCH:
+        case VONKOCH:
+        case ROUGH_HATCHES:
+        case INTERPOLATE_POINTS:
+        case ELLIPSE_5PTS:
+        case PTS2ELLIPSE:
+        case GEARS:
+        case CONSTRUCT_GRID:
+            break;
+        default:
+            return false;
+    }
+
+    if (lpe.acceptsNumClicks() > 0 && !lpe.isReady()) {
+        return false;
+    }
+
+    for (auto const param : lpe.param_vector) {
+        switch (param->paramType()) {
+            case ORIGINAL_PATH:
+            case ORIGINAL_SATELLITE:
+            case PATH_ARRAY:
+            case PATH_REFERENCE:
+            case SATELLITE:
+            case SATELLITE_ARRAY:
+                return false;
+            case PATH:
+                // The path may be taken from another object.
+                if (static_cast<PathParam const *>(param)->getItem()) {
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Whether doEffect() of an effect for which is_cacheable() holds may run on another thread,
+ * because it only works on its own members. The others use rand(), the preferences or the desktop.
+ */
+bool is_thread_safe(Inkscape::LivePathEffect::Effect const &lpe)
+{
+    using namespace Inkscape::LivePathEffect;
+
+    switch (lpe.effectType()) {
+        case BSPLINE:
+        case ROUGHEN:
+        case SIMPLIFY:
+        case SKETCH:
+            return false;
+        default:
+            return true;
+    }
+}
+
+/**
+ * Call f(i) for each i below count, on the calling thread and on the helper pool. Helpers that
+ * start only once every call has been taken leave at once, so this never waits for the pool to
+ * get round to them.
+ */
+template <typename F>
+void parallel_for(std::size_t count, F const &f)
+{
+    struct State
+    {
+        std::atomic<std::size_t> next = 0;
+        std::size_t done = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto const state = std::make_shared<State>();
+
+    // f is only called for an index taken before all calls are done, so while it still exists.
+    auto const work = [state, count, &f] {
+        std::size_t calls = 0;
+        std::exception_ptr error;
+        for (auto i = state->next++; i < count; i = state->next++) {
+            try {
+                f(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            calls++;
+        }
+        if (calls > 0) {
+            std::lock_guard lock(state->mutex);
+            if (error && !state->error) {
+                state->error = error;
+            }
+            state->done += calls;
+            if (state->done == count) {
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    auto const num_threads = std::min<std::size_t>(count, std::max(std::thread::hardware_concurrency(), 2u));
+    for (std::size_t i = 1; i < num_threads; i++) {
+        boost::asio::post(Inkscape::Async::helper_pool(), work);
+    }
+    work();
+
+    std::unique_lock lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done == count; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+std::atomic<std::uint64_t> lpe_cache_hits = 0;
+std::atomic<std::uint64_t> lpe_cache_misses = 0;
+std::atomic<std::uint64_t> lpe_cache_uncacheable = 0;
+
 } // unnamed namespace
 
+struct SPLPEItem::PathEffectCache
+{
+    Geom::PathVector input;
+    Geom::Affine i2doc;
+    Geom::Scale document_scale;
+    std::string params; ///< The parameters of all the effects in the stack.
+    std::vector<Geom::PathVector> outputs; ///< The result of each effect in the stack.
+
+    bool sameInputs(PathEffectCache const &other) const
+    {
+        return input == other.input && i2doc == other.i2doc && document_scale == other.document_scale &&
+               params == other.params;
+    }
+};
+
+SPLPEItem::PathEffectCacheStats SPLPEItem::pathEffectCacheStats()
+{
+    return {
+        .hits = lpe_cache_hits.load(std::memory_order_relaxed),
+        .misses = lpe_cache_misses.load(std::memory_order_relaxed),
+        .uncacheable = lpe_cache_uncacheable.load(std::memory_order_relaxed)
+    };
+}
+
 SPLPEItem::SPLPEItem()
     : SPItem()
     , path_effects_enabled(1)
@@ -195,6 +371,42 @@ bool SPLPEItem::isOnSymbol() const {
     auto p = cast<SPLPEItem>(parent);
     return (p && p->onsymbol) || is<SPSymbol>(this);
 }
+
+/**
+ * Describe everything the result of the path effect stack depends on, or return null if that
+ * cannot be done, because some of the effects depend on other objects.
+ */
+std::unique_ptr<SPLPEItem::PathEffectCache> SPLPEItem::_pathEffectCacheKey(Geom::PathVector const &input)
+{
+    // Effects may also be applied to the clip path and mask, and leave their state behind.
+    if (getClipObject() || getMaskObject()) {
+        return {};
+    }
+
+    auto key = std::make_unique<PathEffectCache>();
+    for (auto const &lperef : *path_effect_list) {
+        auto const lpeobj = lperef->lpeobject;
+        auto const lpe = lpeobj ? lpeobj->get_lpe() : nullptr;
+        // An effect shared with other items holds the state of whichever item it last ran on.
+        if (!lpe || lpeobj->hrefList.size() != 1 || !is_cacheable(*lpe)) {
+            return {};
+        }
+        key->params += std::to_string(reinterpret_cast<std::uintptr_t>(lpe));
+        key->params += '\n';
+        for (auto const param : lpe->param_vector) {
+            key->params += param->param_key.raw();
+            key->params += '=';
+            key->params += param->param_getSVGValue().raw();
+            key->params += '\n';
+        }
+    }
+
+    key->input = input;
+    key->i2doc = i2doc_affine();
+    key->document_scale = document->getDocumentScale();
+    return key;
+}
+
 /**
  * returns true when LPE was successful.
  */
@@ -205,6 +417,40 @@ bool SPLPEItem::performPathEffect(SPCurve *curve, SPShape *current, bool is_clip
     }
 
     if (this->hasPathEffect() && this->pathEffectsEnabled()) {
+        std::unique_ptr<PathEffectCache> key;
+        if (current == this && !is_clip_or_mask) {
+            key = _pathEffectCacheKey(curve->get_pathvector());
+        }
+        if (!key) {
+            lpe_cache_uncacheable.fetch_add(1, std::memory_order_relaxed);
+        } else if (_lpe_cache && _lpe_cache->sameInputs(*key)) {
+            // Nothing has changed since the stack last ran, so leave the effects as they are.
+            lpe_cache_hits.fetch_add(1, std::memory_order_relaxed);
+            auto before = &_lpe_cache->input;
+            auto output = _lpe_cache->outputs.begin();
+            for (auto &lperef : *this->path_effect_list) {
+                auto lpe = lperef->lpeobject->get_lpe();
+                if (document->isSeeking()) {
+                    lpe->refresh_widgets = true;
+                }
+                lpe->setCurrentShape(current);
+                lpe->sp_lpe_item = this;
+                if (lpe->isVisible()) {
+                    lpe->pathvector_before_effect = *before;
+                    lpe->pathvector_after_effect = *output;
+                }
+                before = &*output++;
+            }
+            curve->set_pathvector(*before);
+            current->setCurveInsync(curve);
+            current->bbox_vis_cache_is_valid = false;
+            current->bbox_geom_cache_is_valid = false;
+            return true;
+        } else {
+            lpe_cache_misses.fetch_add(1, std::memory_order_relaxed);
+        }
+        _lpe_cache.reset();
+
         PathEffectList path_effect_list(*this->path_effect_list);
         auto const path_effect_list_size = path_effect_list.size();
         for (auto &lperef : path_effect_list) {
@@ -221,17 +467,145 @@ bool SPLPEItem::performPathEffect(SPCurve *curve, SPShape *current, bool is_clip
             if (!lpe || !performOnePathEffect(curve, current, lpe, is_clip_or_mask)) {
                 return false;
             }
+            if (key) {
+                key->outputs.push_back(curve->get_pathvector());
+            }
             auto hreflist = lpeobj->hrefList;
             if (hreflist.size()) { // lpe can be removed on perform (eg: clone lpe on copy)
                 if (path_effect_list_size != this->path_effect_list->size()) {
+                    key.reset();
                     break;
                 }
             }
         }
+
+        if (key) {
+            _lpe_cache = std::move(key);
+        }
     }
     return true;
 }
 
+/**
+ * Run the path effect stacks of the shapes below @a root on several threads at once, and keep
+ * the results for the next update of each shape to reuse, as if it had run its stack itself.
+ * Meant for updating the effects of a whole document.
+ *
+ * Only shapes with effects that depend on nothing but their own path and parameters are
+ * included, and only doEffect() runs in parallel: the effects are prepared and finished on this
+ * thread, one stage of all the stacks at a time.
+ */
+void SPLPEItem::precomputePathEffects(SPItem *root)
+{
+    struct Job
+    {
+        SPShape *shape = nullptr;
+        std::unique_ptr<PathEffectCache> key;
+        std::vector<Inkscape::LivePathEffect::Effect *> effects;
+        SPCurve curve;
+        bool failed = false;
+    };
+    std::vector<Job> jobs;
+    std::size_t num_stages = 0;
+
+    std::vector<SPItem *> pending{root};
+    while (!pending.empty()) {
+        auto const item = pending.back();
+        pending.pop_back();
+
+        auto const lpeitem = cast<SPLPEItem>(item);
+        if (!lpeitem || !lpeitem->pathEffectsEnabled()) {
+            continue;
+        }
+
+        auto const shape = cast<SPShape>(item);
+        if (!shape) {
+            // The effects of a group act on the results of those of its children.
+            if (is<SPGroup>(item) && !lpeitem->hasPathEffect()) {
+                for (auto &child : item->children) {
+                    if (auto const child_item = cast<SPItem>(&child)) {
+                        pending.push_back(child_item);
+                    }
+                }
+            }
+            continue;
+        }
+
+        if (!shape->hasPathEffect() || shape->cloned || !shape->curveForEdit()) {
+            continue;
+        }
+        auto key = shape->_pathEffectCacheKey(shape->curveForEdit()->get_pathvector());
+        if (!key || (shape->_lpe_cache && shape->_lpe_cache->sameInputs(*key))) {
+            continue;
+        }
+
+        Job job;
+        job.shape = shape;
+        job.key = std::move(key);
+        for (auto const &lperef : *shape->path_effect_list) {
+            job.effects.push_back(lperef->lpeobject->get_lpe());
+        }
+        if (!std::all_of(job.effects.begin(), job.effects.end(), [] (auto lpe) { return is_thread_safe(*lpe); })) {
+            continue;
+        }
+        job.curve = *shape->curveForEdit();
+        num_stages = std::max(num_stages, job.effects.size());
+        jobs.push_back(std::move(job));
+    }
+
+    // One shape is quicker done by itself.
+    if (jobs.size() < 2) {
+        return;
+    }
+
+    std::vector<Job *> running;
+    for (std::size_t stage = 0; stage < num_stages; stage++) {
+        running.clear();
+        for (auto &job : jobs) {
+            if (job.failed || stage >= job.effects.size()) {
+                continue;
+            }
+            auto const lpe = job.effects[stage];
+            if (job.shape->document->isSeeking()) {
+                lpe->refresh_widgets = true;
+            }
+            if (lpe->isVisible()) {
+                job.shape->_beginOnePathEffect(&job.curve, job.shape, lpe, false);
+                running.push_back(&job);
+            }
+        }
+
+        parallel_for(running.size(), [&] (std::size_t i) {
+            auto const job = running[i];
+            try {
+                job->effects[stage]->doEffect(&job->curve);
+            } catch (std::exception const &) {
+                // Leave it to the shape to run its stack again and report the error.
+                job->failed = true;
+            }
+        });
+
+        for (auto &job : jobs) {
+            if (job.failed || stage >= job.effects.size()) {
+                continue;
+            }
+            auto const lpe = job.effects[stage];
+            if (lpe->isVisible()) {
+                lpe->has_exception = false;
+                job.shape->_endOnePathEffect(&job.curve, job.shape, lpe);
+            }
+            job.key->outputs.push_back(job.curve.get_pathvector());
+        }
+    }
+
+    for (auto &job : jobs) {
+        if (!job.failed) {
+            lpe_cache_misses.fetch_add(1, std::memory_order_relaxed);
+            job.shape->_lpe_cache = std::move(job.key);
+        }
+    }
+}
+
 /**
  * returns true when LPE was successful.
  */
@@ -256,21 +630,7 @@ bool SPLPEItem::performOnePathEffect(SPCurve *curve, SPShape *current, Inkscape:
         if (!is_clip_or_mask || lpe->apply_to_clippath_and_mask) {
             // Uncomment to get updates
             // g_debug("LPE running:: %s",Inkscape::LivePathEffect::LPETypeConverter.get_key(lpe->effectType()).c_str());
-            lpe->setCurrentShape(current);
-            if (!is<SPGroup>(this)) {
-                lpe->pathvector_before_effect = curve->get_pathvector();
-            }
-            // To Calculate BBox on shapes and nested LPE
-            current->setCurveInsync(curve);
-            // Groups have their doBeforeEffect called elsewhere
-            if (lpe->lpeversion.param_getSVGValue() != "0") { // we are on 1 or up
-                current->bbox_vis_cache_is_valid = false;
-                current->bbox_geom_cache_is_valid = false;
-            }
-            auto group = cast<SPGroup>(this);
-            if (!group && !is_clip_or_mask) {
-                lpe->doBeforeEffect_impl(this);
-            }
+            _beginOnePathEffect(curve, current, lpe, is_clip_or_mask);
 
             try {
                 lpe->doEffect(curve);
@@ -287,19 +647,49 @@ bool SPLPEItem::performOnePathEffect(SPCurve *curve, SPShape *current, Inkscape:
                 return false;
             }
 
-            if (!group) {
-                // To have processed the shape to doAfterEffect
-                current->setCurveInsync(curve);
-                if (curve) {
-                    lpe->pathvector_after_effect = curve->get_pathvector();
-                }
-                lpe->doAfterEffect_impl(this, curve);
-            }
+            _endOnePathEffect(curve, current, lpe);
         }
     }
     return true;
 }
 
+/**
+ * Get an effect ready to run on a curve: everything performOnePathEffect() does before calling doEffect().
+ */
+void SPLPEItem::_beginOnePathEffect(SPCurve *curve, SPShape *current, Inkscape::LivePathEffect::Effect *lpe,
+                                    bool is_clip_or_mask)
+{
+    lpe->setCurrentShape(current);
+    if (!is<SPGroup>(this)) {
+        lpe->pathvector_before_effect = curve->get_pathvector();
+    }
+    // To Calculate BBox on shapes and nested LPE
+    current->setCurveInsync(curve);
+    // Groups have their doBeforeEffect called elsewhere
+    if (lpe->lpeversion.param_getSVGValue() != "0") { // we are on 1 or up
+        current->bbox_vis_cache_is_valid = false;
+        current->bbox_geom_cache_is_valid = false;
+    }
+    if (!is<SPGroup>(this) && !is_clip_or_mask) {
+        lpe->doBeforeEffect_impl(this);
+    }
+}
+
+/**
+ * Everything performOnePathEffect() does after a successful call of doEffect().
+ */
+void SPLPEItem::_endOnePathEffect(SPCurve *curve, SPShape *current, Inkscape::LivePathEffect::Effect *lpe)
+{
+    if (!is<SPGroup>(this)) {
+        // To have processed the shape to doAfterEffect
+        current->setCurveInsync(curve);
+        if (curve) {
+            lpe->pathvector_after_effect = curve->get_pathvector();
+        }
+        lpe->doAfterEffect_impl(this, curve);
+    }
+}
+
 /**
  * returns false when LPE write unoptimiced
  */
@@ -16,6 +16,7 @@
 #define SP_LPE_ITEM_H_SEEN
 
 #include <cstddef>
+#include <cstdint>
 #include <list>
 #include <memory>
 #include <string>
@@ -49,7 +50,28 @@ class SPLPEItem : public SPItem {
     // this list contains the connections for listening to lpeobject parameter changes
     std::list<Inkscape::auto_connection> lpe_modified_connection_list;
 
+    // The last result of the path effect stack, reused while nothing it depends on changes.
+    struct PathEffectCache;
+    std::unique_ptr<PathEffectCache> _lpe_cache;
+    std::unique_ptr<PathEffectCache> _pathEffectCacheKey(Geom::PathVector const &input);
+
+    void _beginOnePathEffect(SPCurve *curve, SPShape *current, Inkscape::LivePathEffect::Effect *lpe,
+                             bool is_clip_or_mask);
+    void _endOnePathEffect(SPCurve *curve, SPShape *current, Inkscape::LivePathEffect::Effect *lpe);
+
 public:
+    struct PathEffectCacheStats
+    {
+        std::uint64_t hits;        ///< Runs of a path effect stack skipped because nothing had changed.
+        std::uint64_t misses;      ///< Runs of a path effect stack that could have been skipped, but were not.
+        std::uint64_t uncacheable; ///< Runs of a path effect stack with effects that depend on other objects.
+    };
+
+    /// Counts of the runs of path effect stacks of all items, since the program started.
+    static PathEffectCacheStats pathEffectCacheStats();
+
+    static void precomputePathEffects(SPItem *root);
+
     SPLPEItem();
     ~SPLPEItem() override;
 
@@ -16,6 +16,7 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <vector>
@@ -32,6 +33,7 @@
 #include "preferences.h"
 #include "style.h"
 #include "live_effects/lpeobject.h"
+#include "item-index.h"
 #include "sp-factory.h"
 #include "sp-font.h"
 #include "sp-paint-server.h"
@@ -412,6 +414,41 @@ std::vector<SPObject*> SPObject::childList(bool add_ref, Action) {
     return l;
 }
 
+std::vector<SPObject*> SPObject::dirtyChildList(unsigned int childflags)
+{
+    constexpr unsigned DIRTY = SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG;
+
+    std::erase_if(_dirty_children, [] (SPObject *child) {
+        if ((child->uflags | child->mflags) & DIRTY) {
+            return false;
+        }
+        child->_in_dirty_children = false;
+        return true;
+    });
+
+    // Sorting only pays off for a small part of the children.
+    if (childflags || _dirty_children.size() * 8 >= children.size() ||
+        std::any_of(_dirty_children.begin(), _dirty_children.end(), [] (SPObject *child) { return !child->repr; }))
+    {
+        return childList(true);
+    }
+
+    std::vector<SPObject*> l = _dirty_children;
+    std::sort(l.begin(), l.end(), [] (SPObject *a, SPObject *b) { return a->repr->position() < b->repr->position(); });
+    for (auto child : l) {
+        sp_object_ref(child);
+    }
+    return l;
+}
+
+void SPObject::_markDirty()
+{
+    if (parent && !_in_dirty_children) {
+        parent->_dirty_children.push_back(this);
+        _in_dirty_children = true;
+    }
+}
+
 std::vector<SPObject*> SPObject::ancestorList(bool root_to_tip)
 {
     std::vector<SPObject *> ancestors;
@@ -630,6 +667,10 @@ void SPObject::attach(SPObject *object, SPObject *prev)
     }
     children.insert(it, *object);
 
+    if ((object->uflags | object->mflags) & (SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG)) {
+        object->_markDirty();
+    }
+
     if (!object->xml_space.set)
         object->xml_space.value = this->xml_space.value;
 }
@@ -655,6 +696,10 @@ void SPObject::detach(SPObject *object)
     g_return_if_fail(object->parent == this);
 
     children.erase(children.iterator_to(*object));
+    if (object->_in_dirty_children) {
+        std::erase(_dirty_children, object);
+        object->_in_dirty_children = false;
+    }
     object->releaseReferences();
 
     object->parent = nullptr;
@@ -1425,6 +1470,16 @@ void SPObject::requestDisplayUpdate(unsigned int flags)
     if ((this->uflags & flags) !=  flags ) {
         this->uflags |= flags;
     }
+    _markDirty();
+
+    // The geometry or style may have changed, so the bounding box must not be looked up in the
+    // index before it has been read again.
+    if (flags & SP_OBJECT_MODIFIED_FLAG) {
+        if (auto item = cast<SPItem>(this)) {
+            document->getItemIndex().invalidate(item);
+        }
+    }
+
     /* If requestModified has already been called on this object or one of its children, then we
      * don't need to set CHILD_MODIFIED on our ancestors because it's already been done.
      */
@@ -1453,6 +1508,7 @@ void SPObject::updateDisplay(SPCtx *ctx, unsigned int flags)
 #endif
 
     assert(++(document->update_in_progress));
+    document->update_stats.objects_updated++;
 
 #ifdef SP_OBJECT_DEBUG_CASCADE
     g_print("Update %s:%s %x %x %x\n", g_type_name_from_instance((GTypeInstance *) this), getId(), flags, this->uflags, this->mflags);
@@ -1519,6 +1575,7 @@ void SPObject::requestModified(unsigned int flags)
     bool already_propagated = (!(this->mflags & (SP_OBJECT_MODIFIED_FLAG | SP_OBJECT_CHILD_MODIFIED_FLAG)));
 
     this->mflags |= flags;
+    _markDirty();
 
     /* If requestModified has already been called on this object or one of its children, then we
      * don't need to set CHILD_MODIFIED on our ancestors because it's already been done.
@@ -1548,6 +1605,10 @@ void SPObject::emitModified(unsigned int flags)
     g_print("Modified %s:%s %x %x %x\n", g_type_name_from_instance((GTypeInstance *) this), getId(), flags, this->uflags, this->mflags);
 #endif
 
+    if (document) {
+        document->update_stats.objects_modified++;
+    }
+
     flags |= this->mflags;
     /* We have to clear mflags beforehand, as signal handlers may
      * make changes and therefore queue new modification notifications
@@ -315,6 +315,14 @@ public:
      */
     std::vector<SPObject*> childList(bool add_ref, Action action = ActionGeneral);
 
+    /**
+     * Retrieves, ref'd, the children an update or modification pass needs to visit: all of them
+     * if flags are passed down to them, otherwise those that have update or modification flags
+     * of their own, in document order. This saves going through all the children of a large
+     * group when only a few of them have changed.
+     */
+    std::vector<SPObject*> dirtyChildList(unsigned int childflags);
+
 
     /**
      * Retrieves a list of ancestors of the object, as an easy to use vector
@@ -882,6 +890,12 @@ protected:
     typedef boost::intrusive::list_member_hook<> ListHook;
     ListHook _child_hook;
 
+    // The children which have asked for an update or have modifications to emit, as a worklist
+    // for the update and modification passes. Clean children are dropped by dirtyChildList().
+    std::vector<SPObject *> _dirty_children;
+    bool _in_dirty_children{false};
+    void _markDirty();
+
 public:
     using ChildrenList = boost::intrusive::list<
         SPObject,
@@ -688,6 +688,11 @@ Inkscape::DrawingPattern *SPPattern::show(Inkscape::Drawing &drawing, unsigned k
     auto &v = views.back();
     auto root = v.drawingitem.get();
 
+    // Views of the same pattern render identical tiles whenever their resolutions agree.
+    if (views.size() > 1) {
+        root->shareTilesWith(*views.front().drawingitem);
+    }
+
     if (shown) {
         shown->attach_view(root, key);
     }
@@ -362,6 +362,7 @@ static char const preferences_skeleton[] =
     </group>
     <group id="forkgradientvectors" value="1"/>
     <group id="autosave" enable="1" interval="10" path="" max="50"/>
+    <group id="undo" memorylimit="512"/>
     <group id="grids"
       no_emphasize_when_zoomedout="0">
       <group id="xy"
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Spatial index of snap targets.
+ */
+
+#include "snap-index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace Inkscape {
+
+void SnapIndex::reset(Geom::Coord cell_size)
+{
+    _cell_size = cell_size > 0 && std::isfinite(cell_size) ? cell_size : 1.0;
+    _bounds.clear();
+    _cells.clear();
+    _large.clear();
+}
+
+SnapIndex::Cell SnapIndex::_cell(Geom::Coord x) const
+{
+    // Keep far away or invalid coordinates from overflowing the cell keys.
+    auto const c = std::floor(x / _cell_size);
+    return std::isnan(c) ? 0 : static_cast<Cell>(std::clamp(c, -1e9, 1e9));
+}
+
+void SnapIndex::insert(Geom::Rect const &bounds)
+{
+    unsigned const entry = _bounds.size();
+    _bounds.push_back(bounds);
+
+    auto const x0 = _cell(bounds.left()), x1 = _cell(bounds.right());
+    auto const y0 = _cell(bounds.top()), y1 = _cell(bounds.bottom());
+    if (x1 - x0 >= MAX_SPAN || y1 - y0 >= MAX_SPAN) {
+        _large.push_back(entry);
+        return;
+    }
+
+    for (auto x = x0; x <= x1; x++) {
+        for (auto y = y0; y <= y1; y++) {
+            _cells[_key(x, y)].push_back(entry);
+        }
+    }
+}
+
+void SnapIndex::query(Geom::Point const &point, Geom::Coord radius, std::vector<unsigned> &result) const
+{
+    result.clear();
+    auto const radius_sq = radius * radius;
+    auto const near = [&] (unsigned entry) { return _bounds[entry].distanceSq(point) <= radius_sq; };
+
+    auto const x0 = _cell(point.x() - radius), x1 = _cell(point.x() + radius);
+    auto const y0 = _cell(point.y() - radius), y1 = _cell(point.y() + radius);
+
+    // With a tolerance far larger than the cells, going through everything is quicker.
+    if (double(x1 - x0 + 1) * double(y1 - y0 + 1) > std::max<std::size_t>(_cells.size(), 64)) {
+        for (unsigned entry = 0; entry < _bounds.size(); entry++) {
+            if (near(entry)) {
+                result.push_back(entry);
+            }
+        }
+        return;
+    }
+
+    for (auto x = x0; x <= x1; x++) {
+        for (auto y = y0; y <= y1; y++) {
+            auto const cell = _cells.find(_key(x, y));
+            if (cell != _cells.end()) {
+                std::copy_if(cell->second.begin(), cell->second.end(), std::back_inserter(result), near);
+            }
+        }
+    }
+    std::copy_if(_large.begin(), _large.end(), std::back_inserter(result), near);
+
+    // Entries spanning several cells are found more than once.
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
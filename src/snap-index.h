@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Spatial index of snap targets.
+ */
+
+#ifndef SEEN_SNAP_INDEX_H
+#define SEEN_SNAP_INDEX_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <2geom/rect.h>
+
+namespace Inkscape {
+
+/**
+ * Uniform grid over the bounding boxes of snap targets, for finding the targets near the pointer
+ * without testing every one of them. Entries are numbered in the order they are inserted.
+ *
+ * The cell size should be about the snap tolerance, so that a query only looks at a few cells.
+ * Entries much larger than a cell, like page borders, are kept aside and tested on every query.
+ */
+class SnapIndex
+{
+public:
+    /// Remove all entries and start over with the given cell size.
+    void reset(Geom::Coord cell_size);
+
+    void insert(Geom::Rect const &bounds);
+    void insert(Geom::Point const &point) { insert(Geom::Rect(point, point)); }
+
+    std::size_t size() const { return _bounds.size(); }
+
+    /**
+     * Find the entries whose bounds come within @a radius of @a point.
+     *
+     * @param result Receives the numbers of the entries, in ascending order.
+     */
+    void query(Geom::Point const &point, Geom::Coord radius, std::vector<unsigned> &result) const;
+
+private:
+    using Cell = std::int64_t;
+    Cell _cell(Geom::Coord x) const;
+    static std::uint64_t _key(Cell x, Cell y) { return std::uint64_t(x) << 32 ^ std::uint32_t(y); }
+
+    Geom::Coord _cell_size = 1.0;
+    std::vector<Geom::Rect> _bounds;
+    std::unordered_map<std::uint64_t, std::vector<unsigned>> _cells;
+    std::vector<unsigned> _large;
+
+    /// Entries spanning more cells than this in either direction are kept in _large.
+    static constexpr Cell MAX_SPAN = 16;
+};
+
+} // namespace Inkscape
+
+#endif // SEEN_SNAP_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -34,6 +34,7 @@
 #include "colors/manager.h"
 #include "document.h"
 #include "preferences.h"
+#include "stylesheet-index.h"
 
 #include "3rdparty/libcroco/src/cr-sel-eng.h"
 #include "object/sp-paint-server.h"
@@ -965,20 +966,6 @@ SPStyle::_mergeDecl(  CRDeclaration const *const decl, SPStyleSrc const &source
     }
 }
 
-void
-SPStyle::_mergeProps( CRPropList *const props ) {
-
-    // std::cout << "SPStyle::_mergeProps" << std::endl;
-
-    // In reverse order, as later declarations to take precedence over earlier ones.
-    if (props) {
-        _mergeProps( cr_prop_list_get_next( props ) );
-        CRDeclaration *decl = nullptr;
-        cr_prop_list_get_decl(props, &decl);
-        _mergeDecl( decl, SPStyleSrc::STYLE_SHEET );
-    }
-}
-
 void
 SPStyle::_mergeObjectStylesheet( SPObject const *const object ) {
 
@@ -998,19 +985,12 @@ SPStyle::_mergeObjectStylesheet( SPObject const *const object, SPDocument *const
         _mergeObjectStylesheet(object, parent);
     }
 
-    CRPropList *props = nullptr;
-
     //XML Tree being directly used here while it shouldn't be.
-    CRStatus status =
-        cr_sel_eng_get_matched_properties_from_cascade(sel_eng,
-                                                       document->getStyleCascade(),
-                                                       object->getRepr(),
-                                                       &props);
-    g_return_if_fail(status == CR_OK);
-    /// \todo Check what errors can occur, and handle them properly.
-    if (props) {
-        _mergeProps(props);
-        cr_prop_list_destroy(props);
+    auto const props = document->getStyleSheetIndex().match(sel_eng, object->getRepr());
+
+    // In reverse order, as later declarations to take precedence over earlier ones.
+    for (auto it = props.rbegin(); it != props.rend(); ++it) {
+        _mergeDecl(*it, SPStyleSrc::STYLE_SHEET);
     }
 }
 
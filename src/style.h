@@ -74,7 +74,6 @@ private:
     void _mergeString(char const *p);
     void _mergeDeclList(CRDeclaration const *decl_list, SPStyleSrc const &source);
     void _mergeDecl(    CRDeclaration const *decl,      SPStyleSrc const &source);
-    void _mergeProps(CRPropList *props);
     void _mergeObjectStylesheet(SPObject const *object);
     void _mergeObjectStylesheet(SPObject const *object, SPDocument *document);
 
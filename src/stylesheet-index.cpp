@@ -0,0 +1,270 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Compiled form of a document style cascade for fast selector matching.
+ */
+
+#include "stylesheet-index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <glib.h>
+
+#include "xml/node.h"
+
+namespace Inkscape {
+
+static char const *local_part(char const *qname)
+{
+    auto const colon = std::strrchr(qname, ':');
+    return colon ? colon + 1 : qname;
+}
+
+/// Whether the whitespace separated list @a classes contains @a name.
+static bool has_class(char const *classes, char const *name)
+{
+    auto const len = std::strlen(name);
+    for (auto p = classes; *p;) {
+        while (g_ascii_isspace(*p)) {
+            p++;
+        }
+        auto const start = p;
+        while (*p && !g_ascii_isspace(*p)) {
+            p++;
+        }
+        if (std::size_t(p - start) == len && std::strncmp(start, name, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static char const *str(CRString const *s)
+{
+    return s && s->stryng ? s->stryng->str : nullptr;
+}
+
+StyleSheetIndex::StyleSheetIndex(CRCascade *cascade)
+{
+    for (int origin = ORIGIN_UA; origin < NB_ORIGINS; origin++) {
+        for (auto sheet = cr_cascade_get_sheet(cascade, static_cast<CRStyleOrigin>(origin)); sheet; sheet = sheet->next) {
+            _addSheet(sheet);
+        }
+    }
+}
+
+void StyleSheetIndex::_addSheet(CRStyleSheet *sheet)
+{
+    for (auto statement = sheet->statements; statement; statement = statement->next) {
+        if (statement->type == AT_IMPORT_RULE_STMT) {
+            if (statement->kind.import_rule && statement->kind.import_rule->sheet) {
+                _addSheet(statement->kind.import_rule->sheet);
+            }
+        } else if (statement->type == RULESET_STMT && statement->kind.ruleset) {
+            for (auto selector = statement->kind.ruleset->sel_list; selector; selector = selector->next) {
+                if (selector->simple_sel) {
+                    _addRule(statement, selector->simple_sel);
+                }
+            }
+        }
+    }
+}
+
+void StyleSheetIndex::_addRule(CRStatement *statement, CRSimpleSel *selector)
+{
+    cr_simple_sel_compute_specificity(selector);
+    auto rule = Rule{statement, selector, selector->specificity, _size++};
+
+    auto const key = keyOf(selector);
+    switch (key.kind) {
+        case Key::ID:
+            _by_id[key.name].emplace_back(rule);
+            break;
+        case Key::CLASS:
+            _by_class[key.name].emplace_back(rule);
+            break;
+        case Key::ELEMENT:
+            _by_element[key.name].emplace_back(rule);
+            break;
+        default:
+            _any.emplace_back(rule);
+            break;
+    }
+}
+
+/**
+ * Pick the most selective condition of the compound selector that has to match the
+ * element itself, i.e. the last one of the chain: an id, else a class, else an element name.
+ */
+StyleSheetIndex::Key StyleSheetIndex::keyOf(CRSimpleSel const *selector)
+{
+    while (selector->next) {
+        selector = selector->next;
+    }
+
+    Key key;
+    for (auto add_sel = selector->add_sel; add_sel; add_sel = add_sel->next) {
+        if (add_sel->type == ID_ADD_SELECTOR) {
+            if (auto const name = str(add_sel->content.id_name)) {
+                return {Key::ID, name};
+            }
+        } else if (add_sel->type == CLASS_ADD_SELECTOR && key.kind != Key::CLASS) {
+            if (auto const name = str(add_sel->content.class_name)) {
+                key = {Key::CLASS, name};
+            }
+        }
+    }
+    if (key.kind == Key::ANY && (selector->type_mask & TYPE_SELECTOR)) {
+        if (auto const name = str(selector->name)) {
+            key = {Key::ELEMENT, name};
+        }
+    }
+    return key;
+}
+
+bool StyleSheetIndex::mayMatch(Key const &key, XML::Node const *node)
+{
+    if (key.kind == Key::ANY) {
+        return true;
+    }
+    if (node->type() != XML::NodeType::ELEMENT_NODE) {
+        return false;
+    }
+
+    switch (key.kind) {
+        case Key::ID: {
+            auto const id = node->attribute("id");
+            return id && std::strcmp(id, key.name) == 0;
+        }
+        case Key::CLASS: {
+            auto const classes = node->attribute("class");
+            return classes && has_class(classes, key.name);
+        }
+        default:
+            return std::strcmp(local_part(node->name()), key.name) == 0;
+    }
+}
+
+/**
+ * Gather the rules that may match a node, in cascade order.
+ */
+void StyleSheetIndex::_collect(XML::Node const *node, std::vector<Rule const *> &candidates) const
+{
+    auto const add = [&] (Buckets const &buckets, std::string const &name) {
+        if (auto const it = buckets.find(name); it != buckets.end()) {
+            for (auto const &rule : it->second) {
+                candidates.emplace_back(&rule);
+            }
+        }
+    };
+
+    for (auto const &rule : _any) {
+        candidates.emplace_back(&rule);
+    }
+
+    if (node->type() == XML::NodeType::ELEMENT_NODE) {
+        std::string name;
+        if (!_by_id.empty()) {
+            if (auto const id = node->attribute("id")) {
+                add(_by_id, name.assign(id));
+            }
+        }
+        if (!_by_class.empty()) {
+            if (auto const classes = node->attribute("class")) {
+                for (auto p = classes; *p;) {
+                    while (g_ascii_isspace(*p)) {
+                        p++;
+                    }
+                    auto const start = p;
+                    while (*p && !g_ascii_isspace(*p)) {
+                        p++;
+                    }
+                    if (p != start) {
+                        add(_by_class, name.assign(start, p));
+                    }
+                }
+            }
+        }
+        if (!_by_element.empty()) {
+            add(_by_element, name.assign(local_part(node->name())));
+        }
+    }
+
+    // Buckets are each in cascade order; merge them, dropping duplicates from repeated classes.
+    std::sort(candidates.begin(), candidates.end(), [] (Rule const *a, Rule const *b) { return a->order < b->order; });
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+}
+
+std::vector<CRDeclaration *> StyleSheetIndex::match(CRSelEng *sel_eng, XML::Node const *node) const
+{
+    std::vector<Rule const *> candidates;
+    _collect(node, candidates);
+
+    // Like libcroco, a ruleset counts once for each of its selectors that match, and takes
+    // the specificity of the last one. Keep that here instead of writing it to the statement.
+    std::vector<std::pair<CRStatement *, unsigned long>> matched;
+    auto const specificity = [&] (CRStatement const *statement) {
+        for (auto it = matched.rbegin(); it != matched.rend(); ++it) {
+            if (it->first == statement) {
+                return it->second;
+            }
+        }
+        return 0UL;
+    };
+
+    for (auto rule : candidates) {
+        gboolean result = FALSE;
+        if (cr_sel_eng_matches_node(sel_eng, rule->selector, const_cast<XML::Node *>(node), &result) == CR_OK && result) {
+            matched.emplace_back(rule->statement, rule->specificity);
+        }
+    }
+
+    // Same precedence rules as put_css_properties_in_props_list() in libcroco.
+    std::vector<CRDeclaration *> props;
+    for (auto const &entry : matched) {
+        auto const statement = entry.first;
+        auto const origin = statement->parent_sheet->origin;
+        auto const spec = specificity(statement);
+
+        for (auto decl = statement->kind.ruleset->decl_list; decl; decl = decl->next) {
+            auto const property = str(decl->property);
+            if (!property) {
+                continue;
+            }
+
+            auto const it = std::find_if(props.begin(), props.end(), [=] (CRDeclaration const *prev) {
+                return std::strcmp(str(prev->property), property) == 0;
+            });
+            if (it != props.end()) {
+                auto const prev = *it;
+                auto const prev_origin = prev->parent_statement->parent_sheet->origin;
+                if (prev_origin < origin) {
+                    // An !important author or user declaration beats anything from a later origin.
+                    if (prev->important && prev_origin != ORIGIN_UA) {
+                        continue;
+                    }
+                } else if (prev_origin > origin) {
+                    continue;
+                } else if (spec < specificity(prev->parent_statement) || (prev->important && !decl->important)) {
+                    continue;
+                }
+                props.erase(it);
+            }
+            props.emplace_back(decl);
+        }
+    }
+    return props;
+}
+
+} // namespace Inkscape
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
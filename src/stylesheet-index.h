@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Compiled form of a document style cascade for fast selector matching.
+ */
+
+#ifndef INKSCAPE_STYLESHEET_INDEX_H
+#define INKSCAPE_STYLESHEET_INDEX_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "3rdparty/inkscape_libcroco/src/cr-cascade.h"
+#include "3rdparty/inkscape_libcroco/src/cr-declaration.h"
+#include "3rdparty/inkscape_libcroco/src/cr-sel-eng.h"
+#include "3rdparty/inkscape_libcroco/src/cr-simple-sel.h"
+
+namespace Inkscape {
+namespace XML {
+class Node;
+} // namespace XML
+
+/**
+ * The rulesets of a style cascade, sorted into buckets by the id, class or element name
+ * that the rightmost part of their selector requires.
+ *
+ * Matching an element only runs the selectors of the buckets the element can fall into,
+ * instead of every selector of every style sheet as cr_sel_eng_get_matched_properties_from_cascade()
+ * does. Each candidate is still checked with libcroco's selector engine, and the winning
+ * declarations are resolved with the same precedence rules, so the result is identical.
+ *
+ * The index points into the statements owned by the cascade and must be dropped whenever
+ * a style sheet is added to, changed in or removed from the cascade.
+ */
+class StyleSheetIndex
+{
+public:
+    /// The cheapest condition the rightmost compound selector puts on the element it matches.
+    struct Key
+    {
+        enum Kind { ID, CLASS, ELEMENT, ANY } kind = ANY;
+        char const *name = nullptr;
+    };
+
+    explicit StyleSheetIndex(CRCascade *cascade);
+    StyleSheetIndex(StyleSheetIndex const &) = delete;
+    StyleSheetIndex &operator=(StyleSheetIndex const &) = delete;
+
+    /**
+     * The declarations that apply to a node, one per property and ordered like the
+     * property list built by libcroco: later entries take precedence over earlier ones.
+     */
+    std::vector<CRDeclaration *> match(CRSelEng *sel_eng, XML::Node const *node) const;
+
+    std::size_t size() const { return _size; }
+
+    static Key keyOf(CRSimpleSel const *selector);
+    /// Cheap necessary (but not sufficient) condition for a selector with the given key to match a node.
+    static bool mayMatch(Key const &key, XML::Node const *node);
+
+private:
+    struct Rule
+    {
+        CRStatement *statement;
+        CRSimpleSel *selector;
+        unsigned long specificity;
+        std::size_t order; ///< Position in the cascade, which is the order libcroco tries the rules in.
+    };
+    using Buckets = std::unordered_map<std::string, std::vector<Rule>>;
+
+    void _addSheet(CRStyleSheet *sheet);
+    void _addRule(CRStatement *statement, CRSimpleSel *selector);
+    void _collect(XML::Node const *node, std::vector<Rule const *> &candidates) const;
+
+    Buckets _by_id;
+    Buckets _by_class;
+    Buckets _by_element;
+    std::vector<Rule> _any;
+    std::size_t _size = 0;
+};
+
+} // namespace Inkscape
+
+#endif // INKSCAPE_STYLESHEET_INDEX_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
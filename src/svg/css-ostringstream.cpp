@@ -8,7 +8,7 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 #include "svg/css-ostringstream.h"
-#include "svg/strip-trailing-zeros.h"
+#include "svg/svg-number.h"
 #include "preferences.h"
 
 Inkscape::CSSOStringStream::CSSOStringStream()
@@ -34,22 +34,12 @@ Inkscape::CSSOStringStream &Inkscape::CSSOStringStream::operator<<(double d)
         return *this;
     }
 
-    char buf[32];  // haven't thought about how much is really required.
-    switch (precision()) {
-        case 9: g_ascii_formatd(buf, sizeof(buf), "%.9f", d); break;
-        case 8: g_ascii_formatd(buf, sizeof(buf), "%.8f", d); break;
-        case 7: g_ascii_formatd(buf, sizeof(buf), "%.7f", d); break;
-        case 6: g_ascii_formatd(buf, sizeof(buf), "%.6f", d); break;
-        case 5: g_ascii_formatd(buf, sizeof(buf), "%.5f", d); break;
-        case 4: g_ascii_formatd(buf, sizeof(buf), "%.4f", d); break;
-        case 3: g_ascii_formatd(buf, sizeof(buf), "%.3f", d); break;
-        case 2: g_ascii_formatd(buf, sizeof(buf), "%.2f", d); break;
-        case 1: g_ascii_formatd(buf, sizeof(buf), "%.1f", d); break;
-        case 0: g_ascii_formatd(buf, sizeof(buf), "%.0f", d); break;
-        case 10: default: g_ascii_formatd(buf, sizeof(buf), "%.10f", d); break;
-    }
+    // Fixed notation, as CSS does not allow exponents everywhere.
+    auto const p = precision();
+    std::string s;
+    Inkscape::SVG::append_fixed(s, d, p >= 0 && p <= 9 ? p : 10);
     auto &os = *this;
-    os << strip_trailing_zeros(buf);
+    os << s;
     return os;
 }
 
@@ -14,6 +14,7 @@
 #include "svg/path-string.h"
 #include "svg/stringstream.h"
 #include "svg/svg.h"
+#include "svg/svg-number.h"
 #include "preferences.h"
 
 // 1<=numericprecision<=16, doubles are only accurate upto (slightly less than) 16 digits (and less than one digit doesn't make sense)
@@ -160,15 +161,14 @@ void PathString::State::appendRelative(Geom::Coord v, Geom::Coord r) {
 }
 
 void PathString::State::appendNumber(double v, int precision, int minexp) {
-
-    str.append(sp_svg_number_write_de(v, precision, minexp));
+    append_number_de(str, v, precision, minexp);
 }
 
 void PathString::State::appendNumber(double v, double &rv) {
     size_t const oldsize = str.size();
     appendNumber(v, _precision, _minexp);
-    char* begin_of_num = const_cast<char*>(str.data()+oldsize); // Slightly evil, I know (but std::string should be storing its data in one big block of memory, so...)
-    sp_svg_number_read_d(begin_of_num, &rv);
+    // Read back the rounded value that was written.
+    read_number(str.data() + oldsize, str.data() + str.size(), rv);
 }
 
 }}
@@ -8,7 +8,7 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 #include "svg/stringstream.h"
-#include "svg/strip-trailing-zeros.h"
+#include "svg/svg-number.h"
 #include "preferences.h"
 #include <2geom/point.h>
 
@@ -40,12 +40,13 @@ Inkscape::SVGOStringStream::operator<<(double d)
         }
     }
 
-    std::ostringstream s;
-    s.imbue(std::locale::classic());
-    s.flags(os.setf(std::ios::showpoint));
-    s.precision(os.precision());
-    s << d;
-    os << strip_trailing_zeros(s.str());
+    std::string s;
+    if ((ostr.flags() & std::ios::floatfield) == std::ios::fixed) {
+        Inkscape::SVG::append_fixed(s, d, os.precision());
+    } else {
+        Inkscape::SVG::append_number(s, d, os.precision());
+    }
+    ostr << s;
     return os;
 }
 
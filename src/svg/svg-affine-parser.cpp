@@ -22,10 +22,11 @@
 #include <glib.h>
 #include <2geom/transforms.h>
 #include "svg.h"
+#include "svg-number.h"
 #include "preferences.h"
 
 
-#line 29 "svg-affine-parser.cpp"
+#line 30 "svg-affine-parser.cpp"
 static const char _svg_transform_actions[] = {
 	0, 1, 0, 1, 8, 1, 11, 1, 
 	12, 1, 14, 1, 15, 1, 16, 2, 
@@ -995,7 +996,7 @@ static const int svg_transform_first_final = 334;
 static const int svg_transform_en_main = 334;
 
 
-#line 28 "svg-affine-parser.rl"
+#line 29 "svg-affine-parser.rl"
 
 
 // https://www.w3.org/TR/css-transforms-1/#svg-syntax
@@ -1019,7 +1020,7 @@ bool sp_svg_transform_read(gchar const *str, Geom::Affine *transform)
     if (pe == p+1) return true; // ""
 
 
-#line 1023 "svg-affine-parser.cpp"
+#line 1024 "svg-affine-parser.cpp"
 	{
 	cs = svg_transform_start;
 	ts = 0;
@@ -1027,7 +1028,7 @@ bool sp_svg_transform_read(gchar const *str, Geom::Affine *transform)
 	act = 0;
 	}
 
-#line 1031 "svg-affine-parser.cpp"
+#line 1032 "svg-affine-parser.cpp"
 	{
 	int _klen;
 	unsigned int _trans;
@@ -1048,7 +1049,7 @@ _resume:
 #line 1 "NONE"
 	{ts = p;}
 	break;
-#line 1052 "svg-affine-parser.cpp"
+#line 1053 "svg-affine-parser.cpp"
 		}
 	}
 
@@ -1115,22 +1116,22 @@ _eof_trans:
 		switch ( *_acts++ )
 		{
 	case 0:
-#line 53 "svg-affine-parser.rl"
+#line 54 "svg-affine-parser.rl"
 	{
-      std::string buf(start_num, p); 
-      params.push_back(g_ascii_strtod(buf.c_str(), NULL));
+      params.emplace_back();
+      Inkscape::SVG::read_number(start_num, p, params.back());
     }
 	break;
 	case 1:
-#line 58 "svg-affine-parser.rl"
+#line 59 "svg-affine-parser.rl"
 	{ tmp_transform = Geom::Translate(params[0], params.size() == 1 ? 0 : params[1]); }
 	break;
 	case 2:
-#line 59 "svg-affine-parser.rl"
+#line 60 "svg-affine-parser.rl"
 	{ tmp_transform = Geom::Scale(params[0], params.size() == 1 ? params[0] : params[1]); }
 	break;
 	case 3:
-#line 60 "svg-affine-parser.rl"
+#line 61 "svg-affine-parser.rl"
 	{
         if (params.size() == 1) 
             tmp_transform = Geom::Rotate(Geom::rad_from_deg(params[0])); 
@@ -1142,23 +1143,23 @@ _eof_trans:
     }
 	break;
 	case 4:
-#line 69 "svg-affine-parser.rl"
+#line 70 "svg-affine-parser.rl"
 	{ tmp_transform = Geom::Affine(1, 0, tan(params[0] * M_PI / 180.0), 1, 0, 0); }
 	break;
 	case 5:
-#line 70 "svg-affine-parser.rl"
+#line 71 "svg-affine-parser.rl"
 	{ tmp_transform = Geom::Affine(1, tan(params[0] * M_PI / 180.0), 0, 1, 0, 0); }
 	break;
 	case 6:
-#line 71 "svg-affine-parser.rl"
+#line 72 "svg-affine-parser.rl"
 	{ tmp_transform = Geom::Affine(params[0], params[1], params[2], params[3], params[4], params[5]);}
 	break;
 	case 7:
-#line 72 "svg-affine-parser.rl"
+#line 73 "svg-affine-parser.rl"
 	{params.clear(); final_transform = tmp_transform * final_transform ;}
 	break;
 	case 8:
-#line 87 "svg-affine-parser.rl"
+#line 88 "svg-affine-parser.rl"
 	{start_num = p;}
 	break;
 	case 12:
@@ -1166,16 +1167,16 @@ _eof_trans:
 	{te = p+1;}
 	break;
 	case 13:
-#line 73 "svg-affine-parser.rl"
+#line 74 "svg-affine-parser.rl"
 	{act = 1;}
 	break;
 	case 14:
-#line 73 "svg-affine-parser.rl"
+#line 74 "svg-affine-parser.rl"
 	{te = p;p--;{ *transform = final_transform; /*printf("%p %p %p %p
 %d\n",p, pe, ts, te, cs);*/ return (te+1 == pe);}}
 	break;
 	case 15:
-#line 73 "svg-affine-parser.rl"
+#line 74 "svg-affine-parser.rl"
 	{{p = ((te))-1;}{ *transform = final_transform; /*printf("%p %p %p %p
 %d\n",p, pe, ts, te, cs);*/ return (te+1 == pe);}}
 	break;
@@ -1192,7 +1193,7 @@ _eof_trans:
 	}
 	}
 	break;
-#line 1196 "svg-affine-parser.cpp"
+#line 1197 "svg-affine-parser.cpp"
 		}
 	}
 
@@ -1209,7 +1210,7 @@ _again:
 #line 1 "NONE"
 	{act = 0;}
 	break;
-#line 1213 "svg-affine-parser.cpp"
+#line 1214 "svg-affine-parser.cpp"
 		}
 	}
 
@@ -1229,7 +1230,7 @@ _again:
 	_out: {}
 	}
 
-#line 117 "svg-affine-parser.rl"
+#line 118 "svg-affine-parser.rl"
 
     g_warning("could not parse transform attribute");
 
@@ -20,6 +20,7 @@
 #include <glib.h>
 #include <2geom/transforms.h>
 #include "svg.h"
+#include "svg-number.h"
 #include "preferences.h"
 
 %%{
@@ -51,8 +52,8 @@ bool sp_svg_transform_read(gchar const *str, Geom::Affine *transform)
     write init;
 
     action number {
-      std::string buf(start_num, p); 
-      params.push_back(g_ascii_strtod(buf.c_str(), NULL));
+      params.emplace_back();
+      Inkscape::SVG::read_number(start_num, p, params.back());
     }
 
     action translate { tmp_transform = Geom::Translate(params[0], params.size() == 1 ? 0 : params[1]); }
@@ -18,6 +18,7 @@
 #include <glib.h>
 
 #include "svg/svg-angle.h"
+#include "svg/svg-number.h"
 #include "util/units.h"
 
 
@@ -73,8 +74,8 @@ static bool sp_svg_angle_read_lff(gchar const *str, SVGAngle::Unit &unit, double
         return false;
     }
 
-    gchar const *e;
-    double const v = g_ascii_strtod(str, (char **) &e);
+    double v = 0.0;
+    gchar const *e = Inkscape::SVG::read_number(str, v);
     if (e == str) {
         return false;
     }
@@ -0,0 +1,228 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Locale-independent reading and writing of the numbers in SVG and CSS.
+ *
+ * Numbers are converted with std::from_chars() and std::to_chars() where the standard library
+ * supports them for floating point, which avoids the locale handling and the allocations of
+ * streams and of g_ascii_strtod(), and gives correctly rounded results.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"  // only include where actually required!
+#endif
+
+#include "svg-number.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <glib.h>
+
+namespace Inkscape::SVG {
+namespace {
+
+/// Enough for any double in fixed notation with the number of decimals limited to MAX_DIGITS.
+constexpr int BUFFER_SIZE = 400;
+constexpr int MAX_DIGITS = 40;
+
+/// Format a number as printf() does with "%.*f", "%.*e" or "%.*g", returning its length.
+int format(char *buf, double value, std::chars_format fmt, int precision)
+{
+    precision = std::clamp(precision, 0, MAX_DIGITS);
+#ifdef HAVE_FLOAT_CHARCONV
+    auto const [ptr, ec] = std::to_chars(buf, buf + BUFFER_SIZE, value, fmt, precision);
+    return ec == std::errc{} ? ptr - buf : 0;
+#else
+    char const conversion = fmt == std::chars_format::fixed ? 'f' : fmt == std::chars_format::scientific ? 'e' : 'g';
+    char spec[16];
+    g_snprintf(spec, sizeof(spec), "%%.%d%c", precision, conversion);
+    g_ascii_formatd(buf, BUFFER_SIZE, spec, value);
+    return std::strlen(buf);
+#endif
+}
+
+/// Drop the trailing zeros after a decimal point, and the point itself if nothing is left after it.
+int strip_zeros(char const *buf, int len)
+{
+    if (!std::memchr(buf, '.', len)) {
+        return len;
+    }
+    while (buf[len - 1] == '0') {
+        len--;
+    }
+    if (buf[len - 1] == '.') {
+        len--;
+    }
+    return len;
+}
+
+/// Read the exponent of a number formatted in scientific notation, given the position of its 'e'.
+int read_exponent(char const *e, char const *end)
+{
+    auto p = e + 1;
+    if (p != end && *p == '+') {
+        p++;
+    }
+    int exponent = 0;
+    std::from_chars(p, end, exponent);
+    return exponent;
+}
+
+bool is_number_char(char c)
+{
+    return g_ascii_isdigit(c) || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E';
+}
+
+/// Append a number rounded to @a precision digits, significant or, for numbers below one, fractional.
+void append_plain(std::string &str, double value, int precision)
+{
+    char buf[BUFFER_SIZE];
+    auto const magnitude = std::fabs(value);
+    int const int_digits = magnitude >= 1.0 ? static_cast<int>(std::floor(std::log10(magnitude))) + 1 : 0;
+
+    if (int_digits <= precision) {
+        auto const len = format(buf, value, std::chars_format::fixed, precision - int_digits);
+        str.append(buf, strip_zeros(buf, len));
+        return;
+    }
+
+    // Round to the significant digits and pad with zeros up to the decimal point.
+    auto const len = format(buf, value, std::chars_format::scientific, precision - 1);
+    auto const e = std::find(buf, buf + len, 'e');
+    if (e == buf + len) {
+        return;
+    }
+    std::copy_if(buf, e, std::back_inserter(str), [] (char c) { return c != '.'; });
+    str.append(std::max(read_exponent(e, buf + len) + 1 - precision, 0), '0');
+}
+
+} // namespace
+
+char const *read_number(char const *begin, char const *end, double &value)
+{
+    auto p = begin;
+    if (p != end && *p == '+') {
+        p++;
+        if (p != end && (*p == '+' || *p == '-')) {
+            return begin;
+        }
+    }
+
+#ifdef HAVE_FLOAT_CHARCONV
+    double v;
+    auto const [ptr, ec] = std::from_chars(p, end, v);
+    if (ptr == p) {
+        return begin;
+    }
+    if (ec == std::errc::result_out_of_range) {
+        // Like strtod(), give infinity for overflow and zero for underflow.
+        v = g_ascii_strtod(std::string(p, ptr).c_str(), nullptr);
+    }
+    value = v;
+    return ptr;
+#else
+    if (p == end || g_ascii_isspace(*p)) {
+        return begin;
+    }
+    auto const copy = std::string(p, end);
+    char *e;
+    auto const v = g_ascii_strtod(copy.c_str(), &e);
+    if (e == copy.c_str()) {
+        return begin;
+    }
+    value = v;
+    return p + (e - copy.c_str());
+#endif
+}
+
+char const *read_number(char const *str, double &value)
+{
+    auto begin = str;
+    while (g_ascii_isspace(*begin)) {
+        begin++;
+    }
+    auto end = begin;
+    while (is_number_char(*end)) {
+        end++;
+    }
+
+    // Leave the rare forms, like "inf" or hexadecimal numbers, to GLib. The latter would
+    // otherwise be read as their leading zero.
+    auto const digits = begin + (*begin == '+' || *begin == '-');
+    if (digits[0] != '0' || (digits[1] != 'x' && digits[1] != 'X')) {
+        auto const next = read_number(begin, end, value);
+        if (next != begin) {
+            return next;
+        }
+    }
+
+    char *e;
+    auto const v = g_ascii_strtod(str, &e);
+    if (e != str) {
+        value = v;
+    }
+    return e;
+}
+
+void append_number(std::string &str, double value, int precision)
+{
+    char buf[BUFFER_SIZE];
+    str.append(buf, format(buf, value, std::chars_format::general, precision));
+}
+
+void append_fixed(std::string &str, double value, int decimals)
+{
+    char buf[BUFFER_SIZE];
+    auto const len = format(buf, value, std::chars_format::fixed, decimals);
+    str.append(buf, strip_zeros(buf, len));
+}
+
+void append_number_de(std::string &str, double value, unsigned precision, int min_exp)
+{
+    if (value == 0.0 || !std::isfinite(value)) {
+        str += '0';
+        return;
+    }
+
+    int const prec = std::clamp<int>(precision, 1, MAX_DIGITS);
+    int const exponent = std::floor(std::log10(std::fabs(value)));
+    if (exponent < min_exp) {
+        str += '0';
+        return;
+    }
+
+    // The longest each notation can get, not counting the sign. Larger exponents need not be
+    // considered, as the plain notation is then certainly longer.
+    int const max_plain = exponent < 0 ? prec - exponent + 1 : exponent + 1 < prec ? prec + 1 : exponent + 1;
+    int const max_exp = prec + (exponent < 0 ? 4 : 3);
+
+    if (max_plain <= max_exp) {
+        append_plain(str, value, prec);
+        return;
+    }
+
+    char buf[BUFFER_SIZE];
+    auto const len = format(buf, value, std::chars_format::scientific, prec - 1);
+    auto const e = std::find(buf, buf + len, 'e');
+    if (e == buf + len) {
+        return;
+    }
+    str.append(buf, strip_zeros(buf, e - buf));
+    str += 'e';
+    str += std::to_string(read_exponent(e, buf + len));
+}
+
+} // namespace Inkscape::SVG
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
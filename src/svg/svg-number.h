@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/** \file
+ * Locale-independent reading and writing of the numbers in SVG and CSS.
+ */
+
+#ifndef SEEN_SP_SVG_NUMBER_H
+#define SEEN_SP_SVG_NUMBER_H
+
+#include <string>
+
+namespace Inkscape::SVG {
+
+/**
+ * Read a number from the start of [begin, end), in the C locale. A leading '+' is accepted.
+ *
+ * @return A pointer just past the number, or @a begin if there is none, in which case @a value
+ *         is left alone.
+ */
+char const *read_number(char const *begin, char const *end, double &value);
+
+/**
+ * Read a number from the start of a null-terminated string, skipping leading white space, with
+ * the same results as g_ascii_strtod().
+ *
+ * @return A pointer just past the number, or @a str if there is none.
+ */
+char const *read_number(char const *str, double &value);
+
+/// Append a number rounded to @a precision significant digits, without trailing zeros, as "%.*g" does.
+void append_number(std::string &str, double value, int precision);
+
+/// Append a number rounded to @a decimals fractional digits, without trailing zeros.
+void append_fixed(std::string &str, double value, int decimals);
+
+/**
+ * Append a number as it is written in path data: rounded to @a precision significant digits
+ * (or fractional digits, if it is less than one), as zero if it is smaller than 10^min_exp,
+ * and in exponential notation whenever that is shorter.
+ */
+void append_number_de(std::string &str, double value, unsigned precision, int min_exp);
+
+} // namespace Inkscape::SVG
+
+#endif // SEEN_SP_SVG_NUMBER_H
+
+/*
+  Local Variables:
+  mode:c++
+  c-file-style:"stroustrup"
+  c-file-offsets:((innamespace . 0)(inline-open . 0)(case-label . +))
+  indent-tabs-mode:nil
+  fill-column:99
+  End:
+*/
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:fileencoding=utf-8:textwidth=99 :
@@ -17,7 +17,9 @@
 
 #include "export.h"
 
+#include <atomic>
 #include <set>
+#include <thread>
 
 #include <glibmm/convert.h>
 #include <glibmm/i18n.h>
@@ -34,6 +36,7 @@
 #include "message.h"                        // for MessageType
 #include "message-stack.h"
 
+#include "async/progress.h"
 #include "colors/utils.h"
 #include "colors/color.h"
 #include "colors/manager.h"
@@ -55,6 +58,39 @@
 
 namespace Inkscape::UI::Dialog {
 
+namespace {
+
+/**
+ * Passes the progress of a raster export to the callback of a dialog, which runs the main loop.
+ * Reports from the threads of the export only check whether it was interrupted.
+ */
+class CallbackProgress final : public Inkscape::Async::Progress<double>
+{
+public:
+    CallbackProgress(unsigned (*callback)(float, void *), void *data)
+        : _callback(callback)
+        , _data(data)
+    {}
+
+private:
+    unsigned (*_callback)(float, void *);
+    void *_data;
+    std::thread::id const _thread = std::this_thread::get_id();
+    std::atomic<bool> _cancelled = false;
+
+    bool _keepgoing() const override { return !_cancelled; }
+
+    bool _report(double const &fraction) override
+    {
+        if (_callback && std::this_thread::get_id() == _thread && !_callback(fraction, _data)) {
+            _cancelled = true;
+        }
+        return !_cancelled;
+    }
+};
+
+} // namespace
+
 Export::Export()
     : DialogBase("/dialogs/export/", "Export")
     , builder(create_builder("dialog-export.glade"))
@@ -252,15 +288,34 @@ bool Export::exportRaster(
     }
 
     // Export Start Here
-    std::vector<SPItem const *> selected;
-    if (items && items->size() > 0) {
-        selected = *items;
+    // The progress callback runs the main loop while other threads render, so render a copy of
+    // the document that edits cannot reach.
+    auto const copy = doc->copy();
+
+    PngExportJob job;
+    job.filename = png_filename;
+    job.area = area;
+    job.width = width;
+    job.height = height;
+    job.xdpi = pHYs; // previously xdpi, ydpi.
+    job.ydpi = pHYs;
+    job.bgcolor = bg_color;
+    job.interlace = use_interlacing;
+    job.color_type = color_type;
+    job.bit_depth = bit_depth;
+    job.zlib = zlib;
+    job.antialiasing = antialiasing;
+    if (items) {
+        // Items of a document always have an id, which the copy keeps.
+        for (auto item : *items) {
+            if (auto const copied = cast<SPItem>(copy->getObjectById(item->getId()))) {
+                job.items_only.push_back(copied);
+            }
+        }
     }
 
-    ExportResult result = sp_export_png_file(desktop->getDocument(), png_filename.c_str(), area, width, height, pHYs,
-                                             pHYs, // previously xdpi, ydpi.
-                                             bg_color, callback, data, true, selected,
-                                             use_interlacing, color_type, bit_depth, zlib, antialiasing);
+    CallbackProgress progress(callback, data);
+    ExportResult result = sp_export_png_files(copy.get(), {job}, &progress).front();
 
     bool failed = result == EXPORT_ERROR; // || prog_dialog->get_stopped();
 
@@ -2553,6 +2553,10 @@ void InkscapePreferences::initPageBehavior()
     _page_behavior.add_line( false, _("_Simplification threshold:"), _misc_simpl, "",
                            _("How strong is the Node tool's Simplify command by default. If you invoke this command several times in quick succession, it will act more and more aggressively; invoking it again after a pause restores the default threshold."), false);
 
+    _undo_memory_limit.init("/options/undo/memorylimit", 0.0, 65536.0, 1.0, 64.0, 512.0, true, false);
+    _page_behavior.add_line( false, _("_Undo history memory:"), _undo_memory_limit, C_("mebibyte (2^20 bytes) abbreviation","MiB"),
+                           _("Memory per document above which older undo steps are stored more compactly, using a temporary file; set to zero for no limit"), false);
+
     _markers_color_stock.init ( _("Color stock markers the same color as object"), "/options/markers/colorStockMarkers", true);
     _markers_color_custom.init ( _("Color custom markers the same color as object"), "/options/markers/colorCustomMarkers", false);
     _markers_color_update.init ( _("Update marker color when object color changes"), "/options/markers/colorUpdateMarkers", true);
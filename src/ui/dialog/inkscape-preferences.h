@@ -439,6 +439,7 @@ protected:
 
     // System page
     UI::Widget::PrefSpinButton  _misc_simpl;
+    UI::Widget::PrefSpinButton  _undo_memory_limit;
     Gtk::Entry                  _sys_user_prefs;
     Gtk::Entry                  _sys_tmp_files;
     Gtk::Entry                  _sys_extension_dir;
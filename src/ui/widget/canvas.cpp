@@ -16,6 +16,7 @@
 
 #include <algorithm> // Sort
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <iostream> // Logging
 #include <mutex>
@@ -135,6 +136,14 @@ struct Tile
     Fragment fragment;
     Cairo::RefPtr<Cairo::ImageSurface> surface;
     Cairo::RefPtr<Cairo::ImageSurface> outline_surface;
+    gint64 render_time; // Microseconds spent painting the tile.
+};
+
+// A queue of rectangles owned by one render thread, kept as a heap in order of priority.
+struct TileQueue
+{
+    std::mutex mutex;
+    std::vector<Geom::IntRect> rects;
 };
 
 // The urgency with which the async redraw process should exit.
@@ -151,6 +160,7 @@ struct RedrawData
     // Data on what/how to draw.
     Geom::IntPoint mouse_loc;
     Geom::IntRect visible;
+    Geom::IntPoint centre;
     Fragment store;
     bool decoupled_mode;
     Cairo::RefPtr<Cairo::Region> snapshot_drawn;
@@ -182,19 +192,28 @@ struct RedrawData
     Cairo::RefPtr<Cairo::Region> clean;
     bool interruptible;
     bool preemptible;
-    std::vector<Geom::IntRect> rects;
     int effective_tile_size;
 
+    // Work queues, one per render thread. Threads put the halves of the rectangles they bisect on their own queue,
+    // and take work from the other queues when theirs runs dry.
+    std::vector<TileQueue> queues;
+    std::atomic<int> pending; // Number of rectangles queued or being bisected. The redraw cycle can only advance at zero.
+
+    // The area still worth painting, kept up to date by the main thread as the view moves.
+    std::mutex view_mutex;
+    Geom::IntRect view;
+
     // Results
     std::mutex tiles_mutex;
     std::vector<Tile> tiles;
     bool timeoutflag;
 
-    // Return comparison object for sorting rectangles by distance from mouse point.
+    // Return comparison object for sorting rectangles by distance from the mouse point or the viewport centre, whichever is nearer.
     auto getcmp() const
     {
-        return [mouse_loc = mouse_loc] (Geom::IntRect const &a, Geom::IntRect const &b) {
-            return a.distanceSq(mouse_loc) > b.distanceSq(mouse_loc);
+        return [mouse_loc = mouse_loc, centre = centre] (Geom::IntRect const &a, Geom::IntRect const &b) {
+            auto const dist = [&] (Geom::IntRect const &r) { return std::min(r.distanceSq(mouse_loc), r.distanceSq(centre)); };
+            return dist(a) > dist(b);
         };
     }
 };
@@ -291,6 +310,10 @@ public:
     bool end_redraw(); // returns true to indicate further redraw cycles required
     void process_redraw(Geom::IntRect const &bounds, Cairo::RefPtr<Cairo::Region> clean, bool interruptible = true, bool preemptible = true);
     void render_tile(int debug_id);
+    void push_rect(int id, Geom::IntRect const &rect);
+    std::optional<Geom::IntRect> pop_rect(int id);
+    Geom::IntRect get_visible_in_store() const;
+    void update_view();
     void paint_rect(Geom::IntRect const &rect);
     void paint_single_buffer(const Cairo::RefPtr<Cairo::ImageSurface> &surface, const Geom::IntRect &rect, bool need_background, bool outline_pass);
     void paint_error_buffer(const Cairo::RefPtr<Cairo::ImageSurface> &surface);
@@ -662,10 +685,8 @@ void CanvasPrivate::launch_redraw()
     }
 
     // Get the visible rect.
-    rd.visible = q->get_area_world();
-    if (stores.mode() == Stores::Mode::Decoupled) {
-        rd.visible = (Geom::Parallelogram(rd.visible) * q->_affine.inverse() * stores.store().affine).bounds().roundOutwards();
-    }
+    rd.visible = get_visible_in_store();
+    rd.centre = rd.visible.midpoint();
 
     // Get other misc data.
     rd.store = Fragment{ stores.store().affine, stores.store().rect };
@@ -687,12 +708,35 @@ void CanvasPrivate::launch_redraw()
 
     rd.snapshot_drawn = stores.snapshot().drawn ? stores.snapshot().drawn->copy() : Cairo::RefPtr<Cairo::Region>();
     rd.cms_transform = q->_cms_active ? q->_cms_transform : nullptr;
+    rd.view = expandedBy(rd.visible, rd.margin);
 
     abort_flags.store((int)AbortFlags::None, std::memory_order_relaxed);
 
     boost::asio::post(*pool, [this] { init_tiler(); });
 }
 
+// Get the visible rect in the coordinate system of the store.
+Geom::IntRect CanvasPrivate::get_visible_in_store() const
+{
+    auto visible = q->get_area_world();
+    if (stores.mode() == Stores::Mode::Decoupled || q->_affine != stores.store().affine) {
+        visible = (Geom::Parallelogram(visible) * q->_affine.inverse() * stores.store().affine).bounds().roundOutwards();
+    }
+    return visible;
+}
+
+// Tell the render threads that the view has moved, so they can drop the rectangles that are no longer worth painting.
+void CanvasPrivate::update_view()
+{
+    if (!redraw_active || schedule_redraw_conn.connected()) {
+        return;
+    }
+
+    auto const view = expandedBy(get_visible_in_store(), prefs.prerender);
+    auto lock = std::lock_guard(rd.view_mutex);
+    rd.view = view;
+}
+
 void CanvasPrivate::after_redraw()
 {
     assert(redraw_active);
@@ -769,6 +813,16 @@ void CanvasPrivate::commit_tiles()
         tiles = std::move(rd.tiles);
     }
 
+    if (prefs.debug_logging && !tiles.empty()) {
+        gint64 total = 0, slowest = 0;
+        for (auto const &tile : tiles) {
+            total += tile.render_time;
+            slowest = std::max(slowest, tile.render_time);
+        }
+        std::cout << "Committing " << tiles.size() << " tiles, painted in " << total / 1000.0 << " ms"
+                  << " (slowest " << slowest / 1000.0 << " ms)" << std::endl;
+    }
+
     for (auto &tile : tiles) {
         // Paste tile content onto stores.
         graphics->draw_tile(tile.fragment, std::move(tile.surface), std::move(tile.outline_surface));
@@ -1667,6 +1721,7 @@ void Canvas::set_pos(Geom::IntPoint const &pos)
 
     _pos = pos;
 
+    d->update_view();
     d->schedule_redraw();
     queue_draw();
 }
@@ -1682,6 +1737,7 @@ void Canvas::set_affine(Geom::Affine const &affine)
 
     _affine = affine;
 
+    d->update_view();
     d->schedule_redraw();
     queue_draw();
 }
@@ -2112,6 +2168,11 @@ void CanvasPrivate::init_tiler()
     rd.phase = 0;
     rd.vis_store = (rd.visible & rd.store.rect).regularized();
 
+    if (rd.queues.size() != rd.numthreads) {
+        rd.queues = std::vector<TileQueue>(rd.numthreads);
+    }
+    rd.pending = 0;
+
     if (!init_redraw()) {
         sync.signalExit();
         return;
@@ -2131,7 +2192,7 @@ void CanvasPrivate::init_tiler()
 
 bool CanvasPrivate::init_redraw()
 {
-    assert(rd.rects.empty());
+    assert(rd.pending == 0);
 
     switch (rd.phase) {
         case 0:
@@ -2192,25 +2253,60 @@ void CanvasPrivate::process_redraw(Geom::IntRect const &bounds, Cairo::RefPtr<Ca
     region->subtract(rd.clean);
 
     // Get the list of rectangles to paint, coarsened to avoid fragmentation.
-    rd.rects = coarsen(region,
-                       std::min<int>(rd.coarsener_min_size, rd.tile_size / 2),
-                       std::min<int>(rd.coarsener_glue_size, rd.tile_size / 2),
-                       rd.coarsener_min_fullness);
-
-    // Put the rectangles into a heap sorted by distance from mouse.
-    std::make_heap(rd.rects.begin(), rd.rects.end(), rd.getcmp());
+    auto rects = coarsen(region,
+                         std::min<int>(rd.coarsener_min_size, rd.tile_size / 2),
+                         std::min<int>(rd.coarsener_glue_size, rd.tile_size / 2),
+                         rd.coarsener_min_fullness);
 
     // Adjust the effective tile size proportional to the painting area.
     double adjust = (double)cairo_to_geom(region->get_extents()).maxExtent() / rd.visible.maxExtent();
     adjust = std::clamp(adjust, 0.3, 1.0);
     rd.effective_tile_size = rd.tile_size * adjust;
+
+    // Deal the rectangles out to the render threads in order of priority, so they all start near the mouse,
+    // and put each thread's share into a heap sorted by the same priority.
+    auto const cmp = rd.getcmp();
+    std::sort(rects.begin(), rects.end(), [&] (Geom::IntRect const &a, Geom::IntRect const &b) { return cmp(b, a); });
+    rd.pending += rects.size();
+    for (int i = 0; i < rd.queues.size(); i++) {
+        auto &queue = rd.queues[i];
+        auto lock = std::lock_guard(queue.mutex);
+        for (int j = i; j < rects.size(); j += rd.queues.size()) {
+            queue.rects.emplace_back(rects[j]);
+        }
+        std::make_heap(queue.rects.begin(), queue.rects.end(), cmp);
+    }
+}
+
+// Put a rectangle on the queue of the given thread.
+void CanvasPrivate::push_rect(int id, Geom::IntRect const &rect)
+{
+    auto &queue = rd.queues[id];
+    auto lock = std::lock_guard(queue.mutex);
+    queue.rects.emplace_back(rect);
+    std::push_heap(queue.rects.begin(), queue.rects.end(), rd.getcmp());
+    rd.pending++;
+}
+
+// Take the most urgent rectangle from the queue of the given thread, or steal one from another thread if it is empty.
+std::optional<Geom::IntRect> CanvasPrivate::pop_rect(int id)
+{
+    for (int i = 0; i < rd.queues.size(); i++) {
+        auto &queue = rd.queues[(id + i) % rd.queues.size()];
+        auto lock = std::lock_guard(queue.mutex);
+        if (!queue.rects.empty()) {
+            std::pop_heap(queue.rects.begin(), queue.rects.end(), rd.getcmp());
+            auto rect = queue.rects.back();
+            queue.rects.pop_back();
+            return rect;
+        }
+    }
+    return {};
 }
 
 // Process rectangles until none left or timed out.
 void CanvasPrivate::render_tile(int debug_id)
 {
-    rd.mutex.lock();
-
     std::string fc_str;
     FrameCheck::Event fc;
     if (rd.debug_framecheck) {
@@ -2218,10 +2314,30 @@ void CanvasPrivate::render_tile(int debug_id)
         fc = FrameCheck::Event(fc_str.c_str());
     }
 
+    // Check for cancellation. Requires rd.mutex.
+    auto aborted = [this] {
+        auto const flags = abort_flags.load(std::memory_order_relaxed);
+        bool const soft = flags & (int)AbortFlags::Soft;
+        bool const hard = flags & (int)AbortFlags::Hard;
+        return hard || (rd.phase == 3 && soft);
+    };
+
     while (true) {
+        auto const popped = pop_rect(debug_id);
+
         // If we've run out of rects, try to start a new redraw cycle.
-        if (rd.rects.empty()) {
-            if (end_redraw()) {
+        if (!popped) {
+            // Rectangles being bisected by other threads will soon be up for grabs.
+            if (rd.pending > 0) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            auto lock = std::lock_guard(rd.mutex);
+            if (rd.pending > 0) {
+                // Another thread has already started the next cycle.
+                continue;
+            } else if (!aborted() && end_redraw()) {
                 // More redraw cycles to do.
                 continue;
             } else {
@@ -2230,79 +2346,84 @@ void CanvasPrivate::render_tile(int debug_id)
             }
         }
 
-        // Check for cancellation.
-        auto const flags = abort_flags.load(std::memory_order_relaxed);
-        bool const soft = flags & (int)AbortFlags::Soft;
-        bool const hard = flags & (int)AbortFlags::Hard;
-        if (hard || (rd.phase == 3 && soft)) {
-            break;
-        }
+        auto rect = *popped;
 
-        // Extract the closest rectangle to the mouse.
-        std::pop_heap(rd.rects.begin(), rd.rects.end(), rd.getcmp());
-        auto rect = rd.rects.back();
-        rd.rects.pop_back();
-
-        // Cull empty rectangles.
-        if (rect.hasZeroArea()) {
-            continue;
+        // Cull empty rectangles, and those that have scrolled out of view since the redraw began.
+        // (The latter stay dirty, so will be picked up again by a later redraw if they come back into view.)
+        bool culled = rect.hasZeroArea();
+        if (!culled) {
+            auto lock = std::lock_guard(rd.view_mutex);
+            culled = !rd.view.intersects(rect);
         }
-
-        // Cull rectangles that lie entirely inside the clean region.
-        // (These can be generated by coarsening; they must be discarded to avoid getting stuck re-rendering the same rectangles.)
-        if (rd.clean->contains_rectangle(geom_to_cairo(rect)) == Cairo::Region::Overlap::IN) {
+        if (culled) {
+            rd.pending--;
             continue;
         }
 
-        // Lambda to add a rectangle to the heap.
-        auto add_rect = [&] (Geom::IntRect const &rect) {
-            rd.rects.emplace_back(rect);
-            std::push_heap(rd.rects.begin(), rd.rects.end(), rd.getcmp());
-        };
+        bool interruptible;
 
-        // If the rectangle needs bisecting, bisect it and put it back on the heap.
-        if (auto axis = bisect(rect, rd.effective_tile_size)) {
-            int mid = rect[*axis].middle();
-            auto lo = rect; lo[*axis].setMax(mid); add_rect(lo);
-            auto hi = rect; hi[*axis].setMin(mid); add_rect(hi);
-            continue;
-        }
+        {
+            auto lock = std::lock_guard(rd.mutex);
+
+            if (aborted()) {
+                rd.pending--;
+                break;
+            }
 
-        // Extend thin rectangles at the edge of the bounds rect to at least some minimum size, being sure to keep them within the store.
-        // (This ensures we don't end up rendering one thin rectangle at the edge every frame while the view is moved continuously.)
-        if (rd.preemptible) {
-            if (rect.width() < rd.preempt) {
-                if (rect.left()  == rd.bounds.left() ) rect.setLeft (std::max(rect.right() - rd.preempt, rd.store.rect.left() ));
-                if (rect.right() == rd.bounds.right()) rect.setRight(std::min(rect.left()  + rd.preempt, rd.store.rect.right()));
+            // Cull rectangles that lie entirely inside the clean region.
+            // (These can be generated by coarsening; they must be discarded to avoid getting stuck re-rendering the same rectangles.)
+            if (rd.clean->contains_rectangle(geom_to_cairo(rect)) == Cairo::Region::Overlap::IN) {
+                rd.pending--;
+                continue;
             }
-            if (rect.height() < rd.preempt) {
-                if (rect.top()    == rd.bounds.top()   ) rect.setTop   (std::max(rect.bottom() - rd.preempt, rd.store.rect.top()   ));
-                if (rect.bottom() == rd.bounds.bottom()) rect.setBottom(std::min(rect.top()    + rd.preempt, rd.store.rect.bottom()));
+
+            // If the rectangle needs bisecting, bisect it and put the halves on our queue.
+            if (auto axis = bisect(rect, rd.effective_tile_size)) {
+                int mid = rect[*axis].middle();
+                auto lo = rect; lo[*axis].setMax(mid); push_rect(debug_id, lo);
+                auto hi = rect; hi[*axis].setMin(mid); push_rect(debug_id, hi);
+                rd.pending--;
+                continue;
+            }
+
+            // Extend thin rectangles at the edge of the bounds rect to at least some minimum size, being sure to keep them within the store.
+            // (This ensures we don't end up rendering one thin rectangle at the edge every frame while the view is moved continuously.)
+            if (rd.preemptible) {
+                if (rect.width() < rd.preempt) {
+                    if (rect.left()  == rd.bounds.left() ) rect.setLeft (std::max(rect.right() - rd.preempt, rd.store.rect.left() ));
+                    if (rect.right() == rd.bounds.right()) rect.setRight(std::min(rect.left()  + rd.preempt, rd.store.rect.right()));
+                }
+                if (rect.height() < rd.preempt) {
+                    if (rect.top()    == rd.bounds.top()   ) rect.setTop   (std::max(rect.bottom() - rd.preempt, rd.store.rect.top()   ));
+                    if (rect.bottom() == rd.bounds.bottom()) rect.setBottom(std::min(rect.top()    + rd.preempt, rd.store.rect.bottom()));
+                }
             }
-        }
 
-        // Mark the rectangle as clean.
-        updater->mark_clean(rect);
+            // Mark the rectangle as clean.
+            updater->mark_clean(rect);
 
-        rd.mutex.unlock();
+            interruptible = rd.interruptible;
+            rd.pending--;
+        }
 
         // Paint the rectangle.
         paint_rect(rect);
 
-        rd.mutex.lock();
-
         // Check for timeout.
-        if (rd.interruptible) {
+        if (interruptible) {
             auto now = g_get_monotonic_time();
             auto elapsed = now - rd.start_time;
             if (elapsed > rd.render_time_limit * 1000) {
                 // Timed out. Temporarily return to GTK main loop, and come back here when next idle.
+                auto lock = std::lock_guard(rd.mutex);
                 rd.timeoutflag = true;
                 break;
             }
         }
     }
 
+    rd.mutex.lock();
+
     if (rd.debug_framecheck && rd.timeoutflag) {
         fc.subtype = 1;
     }
@@ -2313,7 +2434,10 @@ void CanvasPrivate::render_tile(int debug_id)
     rd.mutex.unlock();
 
     if (done) {
-        rd.rects.clear();
+        for (auto &queue : rd.queues) {
+            queue.rects.clear();
+        }
+        rd.pending = 0;
         sync.signalExit();
     }
 }
@@ -2375,6 +2499,10 @@ void CanvasPrivate::paint_rect(Geom::IntRect const &rect)
         return surface;
     };
 
+    FrameCheck::Event fc;
+    if (rd.debug_framecheck) fc = FrameCheck::Event("paint_tile");
+    auto const start_time = g_get_monotonic_time();
+
     // Create and render the tile.
     Tile tile;
     tile.fragment.affine = rd.store.affine;
@@ -2383,6 +2511,7 @@ void CanvasPrivate::paint_rect(Geom::IntRect const &rect)
     if (outlines_enabled) {
         tile.outline_surface = paint(false, true);
     }
+    tile.render_time = g_get_monotonic_time() - start_time;
 
     // Introduce an artificial delay for each rectangle.
     if (rd.redraw_delay) g_usleep(*rd.redraw_delay);
@@ -15,7 +15,13 @@
  */
 
 #include <glib.h> // g_assert()
+#include <algorithm>
+#include <climits>
 #include <cstdio>
+#include <cstring>
+#include <map>
+#include <string_view>
+#include <vector>
 
 #include "event.h"
 #include "event-fns.h"
@@ -166,13 +172,31 @@ void Inkscape::XML::EventDel::_undoOne(
 void Inkscape::XML::EventChgAttr::_undoOne(
     Inkscape::XML::NodeObserver &observer
 ) const {
-    observer.notifyAttributeChanged(*this->repr, this->key, this->newval, this->oldval);
+    Inkscape::Util::ptr_shared oldval = this->oldval;
+    Inkscape::Util::ptr_shared newval = this->newval;
+    if (packed) {
+        newval = Inkscape::Util::share_unsafe(this->repr->attribute(g_quark_to_string(this->key)));
+        if (!packed->oldFromNew(newval, oldval)) {
+            g_warning("Cannot undo change of attribute %s: its old value could not be read back from the temporary file", g_quark_to_string(this->key));
+            return;
+        }
+    }
+    observer.notifyAttributeChanged(*this->repr, this->key, newval, oldval);
 }
 
 void Inkscape::XML::EventChgContent::_undoOne(
     Inkscape::XML::NodeObserver &observer
 ) const {
-    observer.notifyContentChanged(*this->repr, this->newval, this->oldval);
+    Inkscape::Util::ptr_shared oldval = this->oldval;
+    Inkscape::Util::ptr_shared newval = this->newval;
+    if (packed) {
+        newval = Inkscape::Util::share_unsafe(this->repr->content());
+        if (!packed->oldFromNew(newval, oldval)) {
+            g_warning("Cannot undo change of content: the old content could not be read back from the temporary file");
+            return;
+        }
+    }
+    observer.notifyContentChanged(*this->repr, newval, oldval);
 }
 
 void Inkscape::XML::EventChgOrder::_undoOne(
@@ -234,13 +258,31 @@ void Inkscape::XML::EventDel::_replayOne(
 void Inkscape::XML::EventChgAttr::_replayOne(
     Inkscape::XML::NodeObserver &observer
 ) const {
-    observer.notifyAttributeChanged(*this->repr, this->key, this->oldval, this->newval);
+    Inkscape::Util::ptr_shared oldval = this->oldval;
+    Inkscape::Util::ptr_shared newval = this->newval;
+    if (packed) {
+        oldval = Inkscape::Util::share_unsafe(this->repr->attribute(g_quark_to_string(this->key)));
+        if (!packed->newFromOld(oldval, newval)) {
+            g_warning("Cannot redo change of attribute %s: its new value could not be read back from the temporary file", g_quark_to_string(this->key));
+            return;
+        }
+    }
+    observer.notifyAttributeChanged(*this->repr, this->key, oldval, newval);
 }
 
 void Inkscape::XML::EventChgContent::_replayOne(
     Inkscape::XML::NodeObserver &observer
 ) const {
-    observer.notifyContentChanged(*this->repr, this->oldval, this->newval);
+    Inkscape::Util::ptr_shared oldval = this->oldval;
+    Inkscape::Util::ptr_shared newval = this->newval;
+    if (packed) {
+        oldval = Inkscape::Util::share_unsafe(this->repr->content());
+        if (!packed->newFromOld(oldval, newval)) {
+            g_warning("Cannot redo change of content: the new content could not be read back from the temporary file");
+            return;
+        }
+    }
+    observer.notifyContentChanged(*this->repr, oldval, newval);
 }
 
 void Inkscape::XML::EventChgOrder::_replayOne(
@@ -344,7 +386,7 @@ Inkscape::XML::Event *Inkscape::XML::EventChgAttr::_optimizeOne() {
     Inkscape::XML::EventChgAttr *chg_attr=dynamic_cast<Inkscape::XML::EventChgAttr *>(this->next);
 
     /* consecutive chgattrs on the same key can be combined */
-    if ( chg_attr) {
+    if ( chg_attr && !chg_attr->packed && !this->packed ) {
         if ( chg_attr->repr == this->repr &&
              chg_attr->key == this->key )
         {
@@ -364,7 +406,7 @@ Inkscape::XML::Event *Inkscape::XML::EventChgContent::_optimizeOne() {
     Inkscape::XML::EventChgContent *chg_content=dynamic_cast<Inkscape::XML::EventChgContent *>(this->next);
 
     /* consecutive content changes can be combined */
-    if (chg_content) {
+    if (chg_content && !chg_content->packed && !this->packed) {
         if (chg_content->repr == this->repr ) {
             /* replace our oldval with the prior action's */
             this->oldval = chg_content->oldval;
@@ -427,6 +469,404 @@ Inkscape::XML::Event* Inkscape::XML::EventChgElementName::_optimizeOne() {
 
 namespace {
 
+/**
+ * Temporary file holding the spilled parts of packed changes, shared by all documents. Space
+ * given back is kept in a free list and reused by later writes.
+ */
+class SpillFile {
+public:
+    static SpillFile &instance() {
+        // Never destroyed, so that events freed late during shutdown can still release their data.
+        static auto const singleton = new SpillFile;
+        return *singleton;
+    }
+
+    /// Store data in the file, returning where it went, or -1 on failure.
+    long write(std::string_view data) {
+        if (!_file && !_failed) {
+            _file = std::tmpfile();
+            if (!_file) {
+                g_warning("Could not create temporary file for undo history");
+                _failed = true;
+            }
+        }
+        if (!_file) {
+            return -1;
+        }
+        long const offset = _allocate(data.size());
+        if (offset < 0) {
+            return -1;
+        }
+        if (std::fseek(_file, offset, SEEK_SET) != 0 || std::fwrite(data.data(), 1, data.size(), _file) != data.size()) {
+            release(offset, data.size());
+            return -1;
+        }
+        return offset;
+    }
+
+    bool read(long offset, std::size_t length, std::string &data) {
+        data.resize(length);
+        return length == 0 || (_file && std::fseek(_file, offset, SEEK_SET) == 0 &&
+                               std::fread(data.data(), 1, length, _file) == length);
+    }
+
+    /// Note that data written earlier is no longer needed, so that its space can be reused.
+    void release(long offset, std::size_t length) {
+        if (length == 0) {
+            return;
+        }
+        auto it = _free.emplace(offset, length).first;
+        if (auto const next = std::next(it); next != _free.end() && it->first + long(it->second) == next->first) {
+            it->second += next->second;
+            _free.erase(next);
+        }
+        if (it != _free.begin()) {
+            if (auto const prev = std::prev(it); prev->first + long(prev->second) == it->first) {
+                prev->second += it->second;
+                _free.erase(it);
+                it = prev;
+            }
+        }
+        if (it->first + long(it->second) == _end) {
+            _end = it->first;
+            _free.erase(it);
+        }
+    }
+
+private:
+    long _allocate(std::size_t length) {
+        if (length == 0) {
+            return 0;
+        }
+        for (auto it = _free.begin(); it != _free.end(); ++it) {
+            if (it->second >= length) {
+                auto const [offset, available] = *it;
+                _free.erase(it);
+                if (available > length) {
+                    _free.emplace(offset + long(length), available - length);
+                }
+                return offset;
+            }
+        }
+        if (length > std::size_t(LONG_MAX - _end)) {
+            return -1;
+        }
+        long const offset = _end;
+        _end += length;
+        return offset;
+    }
+
+    std::FILE *_file = nullptr;
+    bool _failed = false;
+    long _end = 0;                       ///< End of the space in use or in the free list.
+    std::map<long, std::size_t> _free;   ///< Unused space below _end, by offset; never adjacent.
+};
+
+std::string_view value_view(Inkscape::Util::ptr_shared value) {
+    return value ? std::string_view(value.pointer()) : std::string_view();
+}
+
+std::size_t value_length(Inkscape::Util::ptr_shared value) {
+    return value ? std::strlen(value.pointer()) : 0;
+}
+
+/// A node and attribute, or the content of the node if the attribute is 0.
+using ValueKey = std::pair<Inkscape::XML::Node const *, GQuark>;
+
+/// The chains that packed changes were last added to.
+std::map<ValueKey, std::weak_ptr<Inkscape::XML::ValueChain>> &latest_chains() {
+    // Never destroyed, like the SpillFile.
+    static auto const chains = new std::map<ValueKey, std::weak_ptr<Inkscape::XML::ValueChain>>;
+    return *chains;
+}
+
+}
+
+/**
+ * @brief Packed changes of one value of one node, each starting from the value the one before left
+ *
+ * Only the value before the first change is kept whole. The values after each change are rebuilt
+ * from it when needed, which is only when the node was changed outside of the undo history and
+ * so no longer holds the value on the other side of a change.
+ */
+class Inkscape::XML::ValueChain {
+public:
+    ValueChain(ValueKey key, std::string base, bool base_null)
+        : _key(key), _base(std::move(base)), _base_null(base_null) {}
+
+    ~ValueChain() {
+        if (_base_offset >= 0) {
+            SpillFile::instance().release(_base_offset, _base_length);
+        }
+        auto &chains = latest_chains();
+        if (auto const it = chains.find(_key); it != chains.end() && it->second.expired()) {
+            chains.erase(it);
+        }
+    }
+
+    ValueChain(ValueChain const &) = delete;
+    ValueChain &operator=(ValueChain const &) = delete;
+
+    ValueKey const &key() const { return _key; }
+
+    /// The changes, oldest first.
+    std::vector<ValueDelta *> deltas;
+    /// Set if the base could not be rebuilt after the change it came before was dropped.
+    bool lost = false;
+
+    /// Rebuild the value before the change at @a index.
+    bool valueBefore(std::size_t index, std::string &value, bool &null) const {
+        if (lost) {
+            return false;
+        }
+        if (_base_offset < 0) {
+            value = _base;
+        } else if (!SpillFile::instance().read(_base_offset, _base_length, value)) {
+            return false;
+        }
+        null = _base_null;
+        for (std::size_t i = 0; i < index; i++) {
+            if (!deltas[i]->_forward(value, null)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Start from another value, after the first change was dropped.
+    void setBase(std::string base, bool null) {
+        if (_base_offset >= 0) {
+            SpillFile::instance().release(_base_offset, _base_length);
+            _base_offset = -1;
+        }
+        _base = std::move(base);
+        _base_null = null;
+    }
+
+    /// Move the value kept whole to the temporary file.
+    void spill() {
+        if (_base_offset < 0) {
+            _base_offset = SpillFile::instance().write(_base);
+            if (_base_offset >= 0) {
+                _base_length = _base.size();
+                std::string().swap(_base);
+            }
+        }
+    }
+
+    std::size_t memoryUse() const { return _base.size(); }
+
+private:
+    ValueKey _key;
+    std::string _base;
+    bool _base_null;
+    long _base_offset = -1; ///< Where the base is in the temporary file, once spilled.
+    std::size_t _base_length = 0;
+};
+
+Inkscape::XML::ValueDelta::ValueDelta(Node const *node, GQuark key,
+                                      Inkscape::Util::ptr_shared oldval, Inkscape::Util::ptr_shared newval)
+    : _old_null(!oldval), _new_null(!newval)
+{
+    auto const o = value_view(oldval);
+    auto const n = value_view(newval);
+
+    _prefix = std::mismatch(o.begin(), o.end(), n.begin(), n.end()).first - o.begin();
+    auto const max_suffix = std::min(o.size(), n.size()) - _prefix;
+    _suffix = std::mismatch(o.rbegin(), o.rbegin() + max_suffix, n.rbegin()).first - o.rbegin();
+
+    _old_length = o.size() - _prefix - _suffix;
+    _new_length = n.size() - _prefix - _suffix;
+    _old_middle = o.substr(_prefix, _old_length);
+    _new_middle = n.substr(_prefix, _new_length);
+    _old_hash = std::hash<std::string_view>()(o);
+    _new_hash = std::hash<std::string_view>()(n);
+
+    // Follow on from the last packed change of the same value, if it left the value this starts from.
+    auto &latest = latest_chains()[ValueKey(node, key)];
+    _chain = latest.lock();
+    if (_chain && !_chain->deltas.empty()) {
+        auto const last = _chain->deltas.back();
+        if (last->_new_null != _old_null || last->_new_hash != _old_hash ||
+            last->_prefix + last->_new_length + last->_suffix != o.size())
+        {
+            _chain.reset();
+        }
+    } else {
+        _chain.reset();
+    }
+    if (!_chain) {
+        _chain = std::make_shared<ValueChain>(ValueKey(node, key), std::string(o), _old_null);
+        latest = _chain;
+    }
+    _chain->deltas.push_back(this);
+}
+
+Inkscape::XML::ValueDelta::~ValueDelta() {
+    if (_file_offset >= 0) {
+        SpillFile::instance().release(_file_offset, _old_length + _new_length);
+    }
+
+    auto &deltas = _chain->deltas;
+    auto const it = std::find(deltas.begin(), deltas.end(), this);
+    if (it + 1 == deltas.end()) {
+        deltas.erase(it);
+        return;
+    }
+
+    // Later changes start from the value this one left, so that value is now kept whole instead.
+    std::size_t const index = it - deltas.begin();
+    std::string value;
+    bool null = false;
+    bool const lost = !_chain->valueBefore(index + 1, value, null);
+    if (lost) {
+        g_warning("Could not read undo history back from temporary file");
+    }
+    if (index == 0) {
+        _chain->setBase(std::move(value), null);
+        _chain->lost = lost;
+        deltas.erase(it);
+        if (deltas.front()->_file_offset >= 0) {
+            _chain->spill();
+        }
+    } else {
+        auto const rest = std::make_shared<ValueChain>(_chain->key(), std::move(value), null);
+        rest->lost = lost;
+        rest->deltas.assign(it + 1, deltas.end());
+        deltas.erase(it, deltas.end());
+        for (auto delta : rest->deltas) {
+            delta->_chain = rest;
+        }
+        if (rest->deltas.front()->_file_offset >= 0) {
+            rest->spill();
+        }
+        auto &latest = latest_chains()[rest->key()];
+        if (latest.expired() || latest.lock() == _chain) {
+            latest = rest;
+        }
+    }
+}
+
+void Inkscape::XML::ValueDelta::spill() {
+    if (_file_offset < 0) {
+        _file_offset = SpillFile::instance().write(_old_middle + _new_middle);
+        if (_file_offset >= 0) {
+            std::string().swap(_old_middle);
+            std::string().swap(_new_middle);
+        }
+    }
+    if (_chain->deltas.front() == this) {
+        _chain->spill();
+    }
+}
+
+std::size_t Inkscape::XML::ValueDelta::memoryUse() const {
+    return _old_middle.size() + _new_middle.size() + (_chain->deltas.front() == this ? _chain->memoryUse() : 0);
+}
+
+bool Inkscape::XML::ValueDelta::_middle(bool new_value, std::string &data) const {
+    if (_file_offset < 0) {
+        data = new_value ? _new_middle : _old_middle;
+        return true;
+    }
+    auto const offset = _file_offset + (new_value ? long(_old_length) : 0);
+    return SpillFile::instance().read(offset, new_value ? _new_length : _old_length, data);
+}
+
+bool Inkscape::XML::ValueDelta::_forward(std::string &value, bool &null) const {
+    if (null != _old_null || value.size() != _prefix + _old_length + _suffix) {
+        return false;
+    }
+    if (_new_null) {
+        value.clear();
+        null = true;
+        return true;
+    }
+    std::string middle;
+    if (!_middle(true, middle)) {
+        return false;
+    }
+    value.replace(_prefix, _old_length, middle);
+    null = false;
+    return true;
+}
+
+bool Inkscape::XML::ValueDelta::_apply(char const *current, bool forward, Inkscape::Util::ptr_shared &result) const {
+    bool const to_null = forward ? _new_null : _old_null;
+    std::size_t const to_length = forward ? _new_length : _old_length;
+
+    std::string_view const from = current ? current : "";
+    if ((forward ? _old_null : _new_null) != !current ||
+        from.size() != _prefix + (forward ? _old_length : _new_length) + _suffix ||
+        std::hash<std::string_view>()(from) != (forward ? _old_hash : _new_hash))
+    {
+        // The node was changed by other means since, so rebuild the whole value from the chain.
+        auto const &deltas = _chain->deltas;
+        std::size_t const index = std::find(deltas.begin(), deltas.end(), this) - deltas.begin();
+        std::string value;
+        bool null = false;
+        if (!_chain->valueBefore(index, value, null) || (forward && !_forward(value, null))) {
+            return false;
+        }
+        result = null ? Inkscape::Util::ptr_shared() : Inkscape::Util::share_string(value.data(), value.size());
+        return true;
+    }
+
+    if (to_null) {
+        result = Inkscape::Util::ptr_shared();
+        return true;
+    }
+
+    std::string middle;
+    if (!_middle(forward, middle)) {
+        return false;
+    }
+
+    std::string value;
+    value.reserve(_prefix + to_length + _suffix);
+    value.append(from.substr(0, _prefix));
+    value.append(middle);
+    value.append(from.substr(from.size() - _suffix));
+    result = Inkscape::Util::share_string(value.data(), value.size());
+    return true;
+}
+
+void Inkscape::XML::EventChgAttr::_pack() {
+    if (!packed) {
+        packed = std::make_unique<ValueDelta>(repr, key, oldval, newval);
+        oldval = newval = Inkscape::Util::ptr_shared();
+    }
+}
+
+void Inkscape::XML::EventChgContent::_pack() {
+    if (!packed) {
+        packed = std::make_unique<ValueDelta>(repr, 0, oldval, newval);
+        oldval = newval = Inkscape::Util::ptr_shared();
+    }
+}
+
+void Inkscape::XML::EventChgAttr::_spill() {
+    if (packed) {
+        packed->spill();
+    }
+}
+
+void Inkscape::XML::EventChgContent::_spill() {
+    if (packed) {
+        packed->spill();
+    }
+}
+
+std::size_t Inkscape::XML::EventChgAttr::_memoryUse() const {
+    return packed ? packed->memoryUse() : value_length(oldval) + value_length(newval);
+}
+
+std::size_t Inkscape::XML::EventChgContent::_memoryUse() const {
+    return packed ? packed->memoryUse() : value_length(oldval) + value_length(newval);
+}
+
+namespace {
+
 class LogPrinter : public Inkscape::XML::NodeObserver {
 public:
     typedef Inkscape::XML::Node Node;
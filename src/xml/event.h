@@ -16,7 +16,10 @@
 typedef unsigned int GQuark;
 #include <glibmm/ustring.h>
 
+#include <cstddef>
 #include <iterator>
+#include <memory>
+#include <string>
 #include "util/share.h"
 #include "util/forward-pointer-iterator.h"
 #include "inkgc/gc-managed.h"
@@ -105,6 +108,21 @@ public:
     void replayOne(NodeObserver &observer) const {
         _replayOne(observer);
     }
+    /**
+     * @brief Drop the parts of values that can be recovered from the node when needed
+     *
+     * This saves memory in old parts of the undo history, see ValueDelta. A packed event
+     * is no longer combined with others by optimizeOne().
+     */
+    void pack() { _pack(); }
+    /**
+     * @brief Move what a packed event still keeps in memory to a temporary file
+     */
+    void spill() { _spill(); }
+    /**
+     * @brief Approximate number of bytes of attribute values and content held by this event
+     */
+    std::size_t memoryUse() const { return _memoryUse(); }
 
 protected:
     Event(Node *r, Event *n)
@@ -113,6 +131,9 @@ protected:
     virtual Event *_optimizeOne()=0;
     virtual void _undoOne(NodeObserver &) const=0;
     virtual void _replayOne(NodeObserver &) const=0;
+    virtual void _pack() {}
+    virtual void _spill() {}
+    virtual std::size_t _memoryUse() const { return 0; }
 
 private:
     static int _next_serial;
@@ -156,6 +177,70 @@ private:
     void _replayOne(NodeObserver &observer) const override;
 };
 
+class ValueChain;
+
+/**
+ * @brief Compact record of a change from one string value to another
+ *
+ * Values such as path data are often long and differ only a little from one edit to the
+ * next, so only the parts in which the old and new value differ are kept. The common start
+ * and end are taken from the node when the change is undone or replayed, since the node then
+ * holds the value on the other side of the change.
+ *
+ * Successive packed changes of the same value of a node form a ValueChain, which keeps the
+ * value before the first of them whole. Should the node have been changed outside of the undo
+ * history, the value on either side of a change is rebuilt from there instead.
+ *
+ * Spilling moves the differing parts, and the whole value of the chain, to a temporary file.
+ */
+class ValueDelta {
+public:
+    ValueDelta(Node const *node, GQuark key, Inkscape::Util::ptr_shared oldval, Inkscape::Util::ptr_shared newval);
+    ~ValueDelta();
+    ValueDelta(ValueDelta const &) = delete;
+    ValueDelta &operator=(ValueDelta const &) = delete;
+
+    /**
+     * @brief Recover the old value, from the new one if @a current is still that
+     * @return False if the parts needed could not be read back from the temporary file.
+     */
+    bool oldFromNew(char const *current, Inkscape::Util::ptr_shared &result) const {
+        return _apply(current, false, result);
+    }
+    /**
+     * @brief Recover the new value, from the old one if @a current is still that
+     * @return False as for oldFromNew().
+     */
+    bool newFromOld(char const *current, Inkscape::Util::ptr_shared &result) const {
+        return _apply(current, true, result);
+    }
+
+    /// Move what is kept in memory to the temporary file.
+    void spill();
+    std::size_t memoryUse() const;
+
+private:
+    friend class ValueChain;
+
+    bool _apply(char const *current, bool forward, Inkscape::Util::ptr_shared &result) const;
+    bool _middle(bool new_value, std::string &data) const;
+    /// Turn the old value, whole, into the new one.
+    bool _forward(std::string &value, bool &null) const;
+
+    std::size_t _prefix;
+    std::size_t _suffix;
+    std::size_t _old_length; ///< Length of the differing part of the old value
+    std::size_t _new_length; ///< Length of the differing part of the new value
+    std::string _old_middle;
+    std::string _new_middle;
+    long _file_offset = -1;  ///< Where the differing parts are in the temporary file once spilled, old first
+    std::size_t _old_hash;
+    std::size_t _new_hash;
+    bool _old_null;
+    bool _new_null;
+    std::shared_ptr<ValueChain> _chain; ///< The packed changes of the same value this belongs to
+};
+
 /**
  * @brief Object representing attribute change
  */
@@ -174,11 +259,16 @@ public:
     Inkscape::Util::ptr_shared oldval;
     /// Value of the attribute after the change
     Inkscape::Util::ptr_shared newval;
+    /// Replaces oldval and newval once the event is packed
+    std::unique_ptr<ValueDelta> packed;
 
 private:
     Event *_optimizeOne() override;
     void _undoOne(NodeObserver &observer) const override;
     void _replayOne(NodeObserver &observer) const override;
+    void _pack() override;
+    void _spill() override;
+    std::size_t _memoryUse() const override;
 };
 
 /**
@@ -196,11 +286,16 @@ public:
     Inkscape::Util::ptr_shared oldval;
     /// Content of the node after the change
     Inkscape::Util::ptr_shared newval;
+    /// Replaces oldval and newval once the event is packed
+    std::unique_ptr<ValueDelta> packed;
 
 private:
     Event *_optimizeOne() override;
     void _undoOne(NodeObserver &observer) const override;
     void _replayOne(NodeObserver &observer) const override;
+    void _pack() override;
+    void _spill() override;
+    std::size_t _memoryUse() const override;
 };
 
 /**
@@ -59,11 +59,11 @@ static bool href_needs_rebasing(char const *href)
 AttributeVector
 Inkscape::XML::rebase_href_attrs(gchar const *const old_abs_base,
                                  gchar const *const new_abs_base,
-                                 const AttributeVector &attributes)
+                                 std::span<AttributeRecord const> attributes)
 {
     using Inkscape::Util::share_string;
 
-    auto ret = attributes; // copy
+    auto ret = AttributeVector(attributes.begin(), attributes.end()); // copy
 
     if (old_abs_base == new_abs_base) {
         return ret;
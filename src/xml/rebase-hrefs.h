@@ -10,6 +10,7 @@
 #ifndef REBASE_HREFS_H_SEEN
 #define REBASE_HREFS_H_SEEN
 
+#include <span>
 #include <vector>
 #include "xml/attribute-record.h"
 #include "xml/node.h"
@@ -46,7 +47,7 @@ void rebase_hrefs(SPDocument *doc, char const *new_base, bool spns);
 AttributeVector rebase_href_attrs(
     char const *old_abs_base,
     char const *new_abs_base,
-    const AttributeVector & attributes);
+    std::span<AttributeRecord const> attributes);
 
 
 // /**
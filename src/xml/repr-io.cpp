@@ -11,11 +11,20 @@
  * Released under GNU GPL v2+, read the file 'COPYING' for more information.
  */
 
+#include <algorithm>
 #include <cstring>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 #include <libxml/parser.h>
+#include <libxml/parserInternals.h> // xmlStringLenDecodeEntities
 #include <libxml/xinclude.h>
 
 #include "xml/repr.h"
@@ -48,7 +57,9 @@ using Inkscape::XML::AttributeVector;
 using Inkscape::XML::rebase_href_attrs;
 
 Document *sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns);
+static Document *sp_repr_read_sax(const gchar *default_ns, std::function<xmlDocPtr (xmlParserCtxtPtr)> const &parse);
 static Node *sp_repr_svg_read_node (Document *xml_doc, xmlNodePtr node, const gchar *default_ns, std::map<std::string, std::string> &prefix_map);
+static void sp_repr_fix_root(Node *root, const gchar *default_ns);
 static gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, const gchar *default_ns, std::map<std::string, std::string> &prefix_map);
 static void sp_repr_write_stream_root_element(Node *repr, Writer &out,
                                               bool add_whitespace, gchar const *default_ns,
@@ -59,7 +70,7 @@ static void sp_repr_write_stream_root_element(Node *repr, Writer &out,
 static void sp_repr_write_stream_element(Node *repr, Writer &out,
                                          gint indent_level, bool add_whitespace,
                                          Glib::QueryQuark elide_prefix,
-                                         const AttributeVector & attributes,
+                                         std::span<AttributeRecord const> attributes,
                                          int inlineattrs, int indent,
                                          gchar const *old_href_abs_base,
                                          gchar const *new_href_abs_base);
@@ -74,7 +85,9 @@ public:
           fp(nullptr),
           firstFewLen(0),
           instr(nullptr),
-          gzin(nullptr)
+          gzin(nullptr),
+          mapped(nullptr),
+          mappedPos(0)
     {
         for (unsigned char & k : firstFew)
         {
@@ -93,6 +106,7 @@ public:
     int setFile( char const * filename );
 
     xmlDocPtr readXml();
+    Document *readRepr(const gchar *default_ns);
 
     static int readCb( void * context, char * buffer, int len );
     static int closeCb( void * context );
@@ -108,6 +122,10 @@ private:
     int firstFewLen;
     Inkscape::IO::FileInputStream* instr;
     Inkscape::IO::GzipInputStream* gzin;
+    GMappedFile* mapped;
+    gsize mappedPos;
+
+    int parseOptions() const;
 };
 
 int XmlSource::setFile(char const *filename)
@@ -158,6 +176,21 @@ int XmlSource::setFile(char const *filename)
                 encSkip = 3;
             }
 
+            if ( !gzin && strcmp(filename, "-") != 0 ) {
+                // Plain files are read from a mapping, which spares the copies made by stdio;
+                // the first few bytes are replayed from firstFew as usual.
+                gchar *localFilename = g_filename_from_utf8(filename, -1, nullptr, nullptr, nullptr);
+                if ( localFilename ) {
+                    mapped = g_mapped_file_new(localFilename, FALSE, nullptr);
+                    g_free(localFilename);
+                }
+                if ( mapped ) {
+                    mappedPos = some;
+                    fclose(fp);
+                    fp = nullptr;
+                }
+            }
+
             if ( encSkip ) {
                 memmove( firstFew, firstFew + encSkip, (some - encSkip) );
                 some -= encSkip;
@@ -170,7 +203,7 @@ int XmlSource::setFile(char const *filename)
     return retVal;
 }
 
-xmlDocPtr XmlSource::readXml()
+int XmlSource::parseOptions() const
 {
     int parse_options = XML_PARSE_HUGE | XML_PARSE_RECOVER;
 
@@ -178,7 +211,22 @@ xmlDocPtr XmlSource::readXml()
     bool allowNetAccess = prefs->getBool("/options/externalresources/xml/allow_net_access", false);
     if (!allowNetAccess) parse_options |= XML_PARSE_NONET;
 
-    return xmlReadIO(readCb, closeCb, this, filename, getEncoding(), parse_options);
+    return parse_options;
+}
+
+xmlDocPtr XmlSource::readXml()
+{
+    return xmlReadIO(readCb, closeCb, this, filename, getEncoding(), parseOptions());
+}
+
+/**
+ * Parse straight into a Document, without making a libxml2 tree first.
+ */
+Document *XmlSource::readRepr(const gchar *default_ns)
+{
+    return sp_repr_read_sax(default_ns, [this] (xmlParserCtxtPtr ctxt) {
+        return xmlCtxtReadIO(ctxt, readCb, closeCb, this, filename, getEncoding(), parseOptions());
+    });
 }
 
 int XmlSource::readCb( void * context, char * buffer, int len )
@@ -215,21 +263,16 @@ int XmlSource::read( char *buffer, int len )
         firstFewLen -= some;
         got = some;
     } else if ( gzin ) {
-        int single = 0;
-        while ( (static_cast<int>(got) < len) && (single >= 0) )
-        {
-            single = gzin->get();
-            if ( single >= 0 ) {
-                buffer[got++] = 0x0ff & single;
-            } else {
-                break;
-            }
-        }
+        got = gzin->read({buffer, static_cast<size_t>(len)});
+    } else if ( mapped ) {
+        got = std::min<gsize>(len, g_mapped_file_get_length(mapped) - mappedPos);
+        memcpy( buffer, g_mapped_file_get_contents(mapped) + mappedPos, got );
+        mappedPos += got;
     } else {
         got = fread( buffer, 1, len, fp );
     }
 
-    if ( feof(fp) ) {
+    if ( !fp || feof(fp) ) {
         retVal = got;
     } else if ( ferror(fp) ) {
         retVal = -1;
@@ -257,6 +300,10 @@ int XmlSource::close()
         fclose(fp);
         fp = nullptr;
     }
+    if ( mapped ) {
+        g_mapped_file_unref(mapped);
+        mapped = nullptr;
+    }
     return 0;
 }
 
@@ -300,11 +347,16 @@ Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns, bo
     XmlSource src;
 
     if (src.setFile(filename) == 0) {
-        doc = src.readXml();
-        if (xinclude && doc && doc->properties && xmlXIncludeProcessFlags(doc, XML_PARSE_NOXINCNODE) < 0) {
-            g_warning("XInclude processing failed for %s", filename);
+        if (xinclude) {
+            // XInclude is processed on a libxml2 tree.
+            doc = src.readXml();
+            if (doc && doc->properties && xmlXIncludeProcessFlags(doc, XML_PARSE_NOXINCNODE) < 0) {
+                g_warning("XInclude processing failed for %s", filename);
+            }
+            rdoc = sp_repr_do_read(doc, default_ns);
+        } else {
+            rdoc = src.readRepr(default_ns);
         }
-        rdoc = sp_repr_do_read(doc, default_ns);
     }
 
     if (doc) {
@@ -323,9 +375,6 @@ Document *sp_repr_read_file (const gchar * filename, const gchar *default_ns, bo
  */
 Document *sp_repr_read_mem (const gchar * buffer, gint length, const gchar *default_ns)
 {
-    xmlDocPtr doc;
-    Document * rdoc;
-
     xmlSubstituteEntitiesDefault(1);
 
     g_return_val_if_fail (buffer != nullptr, NULL);
@@ -335,13 +384,9 @@ Document *sp_repr_read_mem (const gchar * buffer, gint length, const gchar *defa
                                        // proper solution would be to check the preference "/options/externalresources/xml/allow_net_access"
                                        // as done in XmlSource::readXml which gets called by the analogous sp_repr_read_file()
                                        // but sp_repr_read_mem() seems to be called in locations where Inkscape::Preferences::get() fails badly
-    doc = xmlReadMemory (const_cast<gchar *>(buffer), length, nullptr, nullptr, parser_options);
-
-    rdoc = sp_repr_do_read (doc, default_ns);
-    if (doc) {
-        xmlFreeDoc (doc);
-    }
-    return rdoc;
+    return sp_repr_read_sax(default_ns, [=] (xmlParserCtxtPtr ctxt) {
+        return xmlCtxtReadMemory(ctxt, buffer, length, nullptr, nullptr, parser_options);
+    });
 }
 
 /**
@@ -368,7 +413,10 @@ namespace {
 typedef std::map<Glib::QueryQuark, Glib::QueryQuark, Inkscape::compare_quark_ids> PrefixMap;
 
 Glib::QueryQuark qname_prefix(Glib::QueryQuark qname) {
+    // Documents may be written from other threads too; see sp_repr_save_snapshot().
+    static std::mutex mutex;
     static PrefixMap prefix_map;
+    auto lock = std::lock_guard{mutex};
     PrefixMap::iterator iter = prefix_map.find(qname);
     if ( iter != prefix_map.end() ) {
         return (*iter).second;
@@ -468,34 +516,42 @@ Document *sp_repr_do_read (xmlDocPtr doc, const gchar *default_ns)
     }
 
     if (root != nullptr) {
-        /* promote elements of some XML documents that don't use namespaces
-         * into their default namespace */
-        if (!strcmp(root->name(), "ns:svg") || !strcmp(root->name(), "svg0:svg")) {
-            g_warning("Detected broken namespace \"%s\" in the SVG file, attempting to work around it", root->name());
-            repair_namespace(root, "svg");
-        } else if ( default_ns && !strchr(root->name(), ':') ) {
-            if ( !strcmp(default_ns, SP_SVG_NS_URI) ) {
-                promote_to_namespace(root, "svg");
-            }
-            if ( !strcmp(default_ns, INKSCAPE_EXTENSION_URI) ) {
-                promote_to_namespace(root, INKSCAPE_EXTENSION_NS_NC);
-            }
-        }
+        sp_repr_fix_root(root, default_ns);
+    }
 
+    return rdoc;
+}
 
-        // Clean unnecessary attributes and style properties from SVG documents. (Controlled by
-        // preferences.)  Note: internal Inkscape svg files will also be cleaned (filters.svg,
-        // icons.svg). How can one tell if a file is internal?
-        if ( !strcmp(root->name(), "svg:svg" ) ) {
-            Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-            bool clean = prefs->getBool("/options/svgoutput/check_on_reading");
-            if( clean ) {
-                sp_attribute_clean_tree( root );
-            }
+/**
+ * Repair and clean up the root element of a document just read.
+ */
+static void sp_repr_fix_root(Node *root, const gchar *default_ns)
+{
+    /* promote elements of some XML documents that don't use namespaces
+     * into their default namespace */
+    if (!strcmp(root->name(), "ns:svg") || !strcmp(root->name(), "svg0:svg")) {
+        g_warning("Detected broken namespace \"%s\" in the SVG file, attempting to work around it", root->name());
+        repair_namespace(root, "svg");
+    } else if ( default_ns && !strchr(root->name(), ':') ) {
+        if ( !strcmp(default_ns, SP_SVG_NS_URI) ) {
+            promote_to_namespace(root, "svg");
+        }
+        if ( !strcmp(default_ns, INKSCAPE_EXTENSION_URI) ) {
+            promote_to_namespace(root, INKSCAPE_EXTENSION_NS_NC);
         }
     }
 
-    return rdoc;
+
+    // Clean unnecessary attributes and style properties from SVG documents. (Controlled by
+    // preferences.)  Note: internal Inkscape svg files will also be cleaned (filters.svg,
+    // icons.svg). How can one tell if a file is internal?
+    if ( !strcmp(root->name(), "svg:svg" ) ) {
+        Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+        bool clean = prefs->getBool("/options/svgoutput/check_on_reading");
+        if( clean ) {
+            sp_attribute_clean_tree( root );
+        }
+    }
 }
 
 gint sp_repr_qualified_name (gchar *p, gint len, xmlNsPtr ns, const xmlChar *name, const gchar */*default_ns*/, std::map<std::string, std::string> &prefix_map)
@@ -592,16 +648,247 @@ static Node *sp_repr_svg_read_node (Document *xml_doc, xmlNodePtr node, const gc
     return repr;
 }
 
+namespace {
 
-static void sp_repr_save_writer(Document *doc, Inkscape::IO::Writer *out,
-                    gchar const *default_ns,
-                    gchar const *old_href_abs_base,
-                    gchar const *new_href_abs_base)
+/**
+ * Builds a Document from the events of the libxml2 SAX2 parser as they come, following the
+ * rules of sp_repr_do_read() and sp_repr_svg_read_node(). Unlike reading into a libxml2 tree
+ * and copying that, this never holds the document twice.
+ *
+ * The default SAX2 handlers are kept for the DTD, so that entities are declared. Entities are not
+ * replaced by the parser, which would also load external ones: in text, libxml2 expands them
+ * through the handlers below, while attribute values are decoded here, as libxml2's own tree
+ * builder does.
+ */
+class ReprBuilder
 {
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-    bool inlineattrs = prefs->getBool("/options/svgoutput/inlineattrs");
-    int indent = prefs->getInt("/options/svgoutput/indent", 2);
+public:
+    ReprBuilder()
+        : _doc(new Inkscape::XML::SimpleDocument())
+    {}
+
+    ~ReprBuilder()
+    {
+        if (_doc) {
+            Inkscape::GC::release(_doc);
+        }
+    }
+
+    void install(xmlParserCtxtPtr ctxt)
+    {
+        ctxt->_private = this;
+        auto sax = ctxt->sax;
+        sax->startElement = nullptr;
+        sax->endElement = nullptr;
+        sax->startElementNs = startElementNs;
+        sax->endElementNs = endElementNs;
+        sax->characters = characters;
+        sax->ignorableWhitespace = characters;
+        sax->cdataBlock = cdataBlock;
+        sax->comment = comment;
+        sax->processingInstruction = processingInstruction;
+        sax->reference = nullptr;
+    }
+
+    /// The document, if it has a root element, which is returned in @a root unless there are several.
+    Document *finish(Node *&root)
+    {
+        _flushText();
+        if (!_roots) {
+            return nullptr;
+        }
+        root = _roots == 1 ? _root : nullptr;
+        return std::exchange(_doc, nullptr);
+    }
 
+private:
+    static ReprBuilder &_get(void *ctx) { return *static_cast<ReprBuilder *>(static_cast<xmlParserCtxtPtr>(ctx)->_private); }
+    static bool _inSubset(void *ctx) { return static_cast<xmlParserCtxtPtr>(ctx)->inSubset != 0; }
+
+    static std::string _qualifiedName(xmlChar const *localname, xmlChar const *prefix, xmlChar const *uri)
+    {
+        std::string name;
+        if (uri) {
+            if (auto p = sp_xml_ns_uri_prefix(reinterpret_cast<const gchar *>(uri), reinterpret_cast<const gchar *>(prefix))) {
+                name = p;
+                name += ':';
+            }
+        }
+        name += reinterpret_cast<const char *>(localname);
+        return name;
+    }
+
+    /**
+     * The value of an attribute as given to startElementNs(). Without entity replacement, it still
+     * holds entity references, and ampersands as "&#38;".
+     */
+    static std::string _attributeValue(void *ctx, xmlChar const *value, xmlChar const *end)
+    {
+        int const len = end - value;
+        if (!std::memchr(value, '&', len)) {
+            return {reinterpret_cast<const char *>(value), static_cast<std::size_t>(len)};
+        }
+        auto const decoded = xmlStringLenDecodeEntities(static_cast<xmlParserCtxtPtr>(ctx), value, len, XML_SUBSTITUTE_REF, 0, 0, 0);
+        if (!decoded) {
+            return {reinterpret_cast<const char *>(value), static_cast<std::size_t>(len)};
+        }
+        std::string result = reinterpret_cast<const char *>(decoded);
+        xmlFree(decoded);
+        return result;
+    }
+
+    static void startElementNs(void *ctx, xmlChar const *localname, xmlChar const *prefix, xmlChar const *uri,
+                               int /*nb_namespaces*/, xmlChar const ** /*namespaces*/,
+                               int nb_attributes, int /*nb_defaulted*/, xmlChar const **attributes)
+    {
+        auto &self = _get(ctx);
+        self._flushText();
+
+        Node *repr = self._doc->createElement(_qualifiedName(localname, prefix, uri).c_str());
+        bool preserve = !self._preserve.empty() && self._preserve.back();
+
+        for (int i = 0; i < nb_attributes; i++) {
+            auto const attr = attributes + 5 * i; // localname, prefix, URI, value, end
+            auto const value = _attributeValue(ctx, attr[3], attr[4]);
+            if (attr[2] && !strcmp(reinterpret_cast<const char *>(attr[2]), reinterpret_cast<const char *>(XML_XML_NAMESPACE))
+                && !strcmp(reinterpret_cast<const char *>(attr[0]), "space")) {
+                if (value == "preserve") {
+                    preserve = true;
+                } else if (value == "default") {
+                    preserve = false;
+                }
+            }
+            repr->setAttribute(_qualifiedName(attr[0], attr[1], attr[2]), value);
+        }
+
+        if (self._stack.empty()) {
+            self._root = self._root ? self._root : repr;
+            self._roots++;
+        }
+        self._append(repr);
+        self._stack.push_back(repr);
+        self._preserve.push_back(preserve);
+    }
+
+    static void endElementNs(void *ctx, xmlChar const *, xmlChar const *, xmlChar const *)
+    {
+        auto &self = _get(ctx);
+        self._flushText();
+        if (!self._stack.empty()) {
+            self._stack.pop_back();
+            self._preserve.pop_back();
+        }
+    }
+
+    static void characters(void *ctx, xmlChar const *ch, int len)
+    {
+        auto &self = _get(ctx);
+        if (self._text_cdata) {
+            self._flushText();
+        }
+        self._text.append(reinterpret_cast<const char *>(ch), len);
+    }
+
+    static void cdataBlock(void *ctx, xmlChar const *value, int len)
+    {
+        auto &self = _get(ctx);
+        if (!self._text_cdata) {
+            self._flushText();
+        }
+        self._text_cdata = true;
+        self._text.append(reinterpret_cast<const char *>(value), len);
+    }
+
+    static void comment(void *ctx, xmlChar const *value)
+    {
+        if (_inSubset(ctx)) {
+            return; // Part of the DTD.
+        }
+        auto &self = _get(ctx);
+        self._flushText();
+        self._append(self._doc->createComment(reinterpret_cast<const gchar *>(value)));
+    }
+
+    static void processingInstruction(void *ctx, xmlChar const *target, xmlChar const *data)
+    {
+        if (_inSubset(ctx)) {
+            return;
+        }
+        auto &self = _get(ctx);
+        self._flushText();
+        self._append(self._doc->createPI(reinterpret_cast<const gchar *>(target), reinterpret_cast<const gchar *>(data)));
+    }
+
+    void _append(Node *repr)
+    {
+        if (_stack.empty()) {
+            _doc->appendChild(repr);
+        } else {
+            _stack.back()->appendChild(repr);
+        }
+        Inkscape::GC::release(repr);
+    }
+
+    void _flushText()
+    {
+        bool const cdata = std::exchange(_text_cdata, false);
+        if (_text.empty()) {
+            return;
+        }
+        // Text outside the root element isn't kept, and neither is all-whitespace text unless
+        // asked to. SVG's specific rules are handled in sp-string.cpp.
+        if (!_stack.empty() && (_preserve.back() || !std::all_of(_text.begin(), _text.end(), [] (char c) { return g_ascii_isspace(c); }))) {
+            _append(_doc->createTextNode(_text.c_str(), cdata));
+        }
+        _text.clear();
+    }
+
+    Document *_doc;
+    std::vector<Node *> _stack;
+    std::vector<bool> _preserve; // xml:space="preserve" in effect, per element of _stack
+    std::string _text;           // pending character data
+    bool _text_cdata = false;
+    Node *_root = nullptr;
+    int _roots = 0;
+};
+
+} // namespace
+
+/**
+ * Read a document with the libxml2 SAX2 parser. @a parse runs the given parser context on the
+ * input, returning the libxml2 document, which then holds only the DTD, if any.
+ */
+static Document *sp_repr_read_sax(const gchar *default_ns, std::function<xmlDocPtr (xmlParserCtxtPtr)> const &parse)
+{
+    xmlParserCtxtPtr ctxt = xmlNewParserCtxt();
+    if (!ctxt) {
+        return nullptr;
+    }
+
+    ReprBuilder builder;
+    builder.install(ctxt);
+
+    xmlDocPtr doc = parse(ctxt);
+    xmlFreeParserCtxt(ctxt);
+    if (!doc) {
+        return nullptr;
+    }
+    xmlFreeDoc(doc);
+
+    Node *root = nullptr;
+    Document *rdoc = builder.finish(root);
+    if (root) {
+        sp_repr_fix_root(root, default_ns);
+    }
+    return rdoc;
+}
+
+
+static void sp_repr_write_document(Document *doc, Inkscape::IO::Writer *out,
+                                   gchar const *default_ns, int inlineattrs, int indent,
+                                   gchar const *old_href_abs_base,
+                                   gchar const *new_href_abs_base)
+{
     /* fixme: do this The Right Way */
     out->writeString( "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n" );
 
@@ -627,6 +914,31 @@ static void sp_repr_save_writer(Document *doc, Inkscape::IO::Writer *out,
     }
 }
 
+static void sp_repr_save_writer(Document *doc, Inkscape::IO::Writer *out,
+                    gchar const *default_ns,
+                    gchar const *old_href_abs_base,
+                    gchar const *new_href_abs_base)
+{
+    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
+    bool inlineattrs = prefs->getBool("/options/svgoutput/inlineattrs");
+    int indent = prefs->getInt("/options/svgoutput/indent", 2);
+
+    // Clean unnecessary attributes and stype properties. (Controlled by preferences.)
+    bool clean = prefs->getBool("/options/svgoutput/check_on_writing");
+
+    // Sort attributes in a canonical order (helps with "diffing" SVG files).only if not set disable optimizations
+    bool sort = !prefs->getBool("/options/svgoutput/disable_optimizations") && prefs->getBool("/options/svgoutput/sort_attributes");
+
+    for (Node *repr = sp_repr_document_first_child(doc); repr; repr = repr->next()) {
+        if (repr->type() == Inkscape::XML::NodeType::ELEMENT_NODE) {
+            if (clean) sp_attribute_clean_tree( repr );
+            if (sort) sp_attribute_sort_tree( *repr );
+        }
+    }
+
+    sp_repr_write_document(doc, out, default_ns, inlineattrs, indent, old_href_abs_base, new_href_abs_base);
+}
+
 
 Glib::ustring sp_repr_save_buf(Document *doc)
 {   
@@ -647,13 +959,30 @@ void sp_repr_save_stream(Document *doc, FILE *fp, gchar const *default_ns, bool
                     gchar const *const new_href_abs_base)
 {
     Inkscape::IO::FileOutputStream bout(fp);
-    Inkscape::IO::GzipOutputStream *gout = compress ? new Inkscape::IO::GzipOutputStream(bout) : nullptr;
-    Inkscape::IO::OutputStreamWriter *out  = compress ? new Inkscape::IO::OutputStreamWriter( *gout ) : new Inkscape::IO::OutputStreamWriter( bout );
+    std::optional<Inkscape::IO::GzipOutputStream> gout;
+    if (compress) {
+        gout.emplace(bout);
+    }
+    Inkscape::IO::OutputStreamWriter out(gout ? static_cast<Inkscape::IO::OutputStream &>(*gout) : bout);
 
-    sp_repr_save_writer(doc, out, default_ns, old_href_abs_base, new_href_abs_base);
+    sp_repr_save_writer(doc, &out, default_ns, old_href_abs_base, new_href_abs_base);
+    if (gout) {
+        gout->close();
+    }
+}
 
-    delete out;
-    delete gout;
+void sp_repr_save_snapshot(Document *doc, FILE *fp, gchar const *default_ns, bool compress,
+                           int inlineattrs, int indent)
+{
+    Inkscape::IO::FileOutputStream bout(fp);
+    std::optional<Inkscape::IO::GzipOutputStream> gout;
+    if (compress) {
+        gout.emplace(bout);
+    }
+    Inkscape::IO::OutputStreamWriter out(gout ? static_cast<Inkscape::IO::OutputStream &>(*gout) : bout);
+
+    sp_repr_write_document(doc, &out, default_ns, inlineattrs, indent, nullptr, nullptr);
+    out.close();
 }
 
 
@@ -685,6 +1014,8 @@ bool sp_repr_save_rebased_file(Document *doc, gchar const *const filename, gchar
     if (file == nullptr) {
         return false;
     }
+    // The writer emits a document in many small pieces; let stdio gather them into large writes.
+    setvbuf(file, nullptr, _IOFBF, 1 << 20);
 
     std::string old_href_abs_base;
     std::string new_href_abs_base;
@@ -709,13 +1040,19 @@ bool sp_repr_save_rebased_file(Document *doc, gchar const *const filename, gchar
          * to using sodipodi:absref instead of the xlink:href value,
          * then we should do `if streq() { free them and set both to NULL; }'. */
     }
-    sp_repr_save_stream(doc, file, default_ns, compress, old_href_abs_base.c_str(), new_href_abs_base.c_str());
+    bool saved = true;
+    try {
+        sp_repr_save_stream(doc, file, default_ns, compress, old_href_abs_base.c_str(), new_href_abs_base.c_str());
+    } catch (Inkscape::IO::StreamException const &e) {
+        g_warning("Could not save %s: %s", filename, e.what());
+        saved = false;
+    }
 
     if (fclose (file) != 0) {
         return false;
     }
 
-    return true;
+    return saved;
 }
 
 /**
@@ -732,6 +1069,15 @@ static void repr_quote_write (Writer &out, const gchar * val, bool attr)
 {
     if (val) {
         for (; *val != '\0'; val++) {
+            // Write the run of characters that need no escaping at once.
+            auto const run = std::strcspn(val, "\"&<>\n");
+            if (run > 0) {
+                out.write(std::string_view(val, run));
+                val += run;
+                if (*val == '\0') {
+                    break;
+                }
+            }
             switch (*val) {
                 case '"': out.writeString( "&quot;" ); break;
                 case '&': out.writeString( "&amp;" ); break;
@@ -836,15 +1182,6 @@ static void sp_repr_write_stream_root_element(Node *repr, Writer &out,
 
     g_assert(repr != nullptr);
 
-    // Clean unnecessary attributes and stype properties. (Controlled by preferences.)
-    Inkscape::Preferences *prefs = Inkscape::Preferences::get();
-    bool clean = prefs->getBool("/options/svgoutput/check_on_writing");
-    if (clean) sp_attribute_clean_tree( repr );
-
-    // Sort attributes in a canonical order (helps with "diffing" SVG files).only if not set disable optimizations
-    bool sort = !prefs->getBool("/options/svgoutput/disable_optimizations") && prefs->getBool("/options/svgoutput/sort_attributes");
-    if (sort) sp_attribute_sort_tree( *repr );
-
     Glib::QueryQuark xml_prefix=g_quark_from_static_string("xml");
 
     NSMap ns_map;
@@ -855,7 +1192,9 @@ static void sp_repr_write_stream_root_element(Node *repr, Writer &out,
         elide_prefix = g_quark_from_string(sp_xml_ns_uri_prefix(default_ns, nullptr));
     }
 
-    auto attributes = repr->attributeList(); // copy
+    // A copy, kept out of the collected heap so that this may run on any thread.
+    auto const &attribute_list = repr->attributeList();
+    auto attributes = std::vector<AttributeRecord>(attribute_list.begin(), attribute_list.end());
 
     using Inkscape::Util::share_string;
     for (auto iter : ns_map) 
@@ -935,7 +1274,7 @@ void sp_repr_write_stream( Node *repr, Writer &out, gint indent_level,
 void sp_repr_write_stream_element( Node * repr, Writer & out,
                                    gint indent_level, bool add_whitespace,
                                    Glib::QueryQuark elide_prefix,
-                                   const AttributeVector & attributes, 
+                                   std::span<AttributeRecord const> attributes,
                                    int inlineattrs, int indent,
                                    gchar const *old_href_base,
                                    gchar const *new_href_base )
@@ -982,8 +1321,13 @@ void sp_repr_write_stream_element( Node * repr, Writer & out,
         }
     }
 
-    const auto rbd = rebase_href_attrs(old_href_base, new_href_base, attributes);
-    for (const auto &iter : rbd) {
+    // Rebasing copies the attributes, so only do it when there is somewhere else to rebase to.
+    AttributeVector rebased;
+    if (old_href_base != new_href_base) {
+        rebased = rebase_href_attrs(old_href_base, new_href_base, attributes);
+        attributes = rebased;
+    }
+    for (const auto &iter : attributes) {
         if (!inlineattrs) {
             out.writeChar('\n');
             if (indent) {
@@ -17,6 +17,7 @@
  */
 
 #include <cstring>
+#include <mutex>
 
 #include <glib.h>
 #include <glibmm.h>
@@ -65,9 +66,15 @@ static char *sp_xml_ns_auto_prefix(char const *uri);
 
 static SPXMLNs *namespaces=nullptr;
 
+/*
+ * Guards namespaces, as documents are read and written on other threads too. Recursive, since
+ * sp_xml_ns_uri_prefix() looks up prefixes through sp_xml_ns_auto_prefix().
+ */
+static std::recursive_mutex namespaces_mutex;
+
 /*
  * There are the prefixes to use for the XML namespaces defined
- * in repr.h
+ * in repr.h. Called with namespaces_mutex held.
  */
 static void sp_xml_ns_register_defaults()
 {
@@ -133,6 +140,7 @@ static void sp_xml_ns_register_defaults()
 
 char *sp_xml_ns_auto_prefix(char const *uri)
 {
+    auto lock = std::lock_guard{namespaces_mutex};
     char const *start, *end;
     char *new_prefix;
     start = uri;
@@ -163,6 +171,7 @@ gchar const *sp_xml_ns_uri_prefix(gchar const *uri, gchar const *suggested)
 
     if (!uri) return nullptr;
 
+    auto lock = std::lock_guard{namespaces_mutex};
     if (!namespaces) {
         sp_xml_ns_register_defaults();
     }
@@ -224,6 +233,7 @@ gchar const *sp_xml_ns_prefix_uri(gchar const *prefix)
 
     if (!prefix) return nullptr;
 
+    auto lock = std::lock_guard{namespaces_mutex};
     if (!namespaces) {
         sp_xml_ns_register_defaults();
     }
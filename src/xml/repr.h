@@ -68,6 +68,19 @@ void sp_repr_save_stream(Inkscape::XML::Document *doc, FILE *to_file,
                          char const *old_href_base = nullptr,
                          char const *new_href_base = nullptr);
 
+/**
+ * Write a document as sp_repr_save_stream() does, but with the output settings given rather than
+ * taken from the preferences, without cleaning or sorting its attributes first, and without
+ * rebasing links. The document is only read, and nothing is anchored, released or allocated from
+ * the garbage collector, so this may run on another thread than the one owning the document, as
+ * long as the document stays anchored and unchanged meanwhile, e.g. a private copy of it. The
+ * registry of namespace prefixes that it consults is guarded for such use.
+ *
+ * @throws Inkscape::IO::StreamException if writing or compressing fails.
+ */
+void sp_repr_save_snapshot(Inkscape::XML::Document *doc, FILE *to_file, char const *default_ns,
+                           bool compress, int inlineattrs, int indent);
+
 bool sp_repr_save_file(Inkscape::XML::Document *doc, char const *filename, char const *default_ns=nullptr);
 bool sp_repr_save_rebased_file(Inkscape::XML::Document *doc, char const *filename_utf8,
                                char const *default_ns,